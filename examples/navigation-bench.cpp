@@ -0,0 +1,105 @@
+/* Compare cursor-style (in-place) navigation with the old
+ * build-a-new-iterator-and-move-assign path, over a whole file,
+ * and both with the native (non-libdwarf) decoder.
+ * Run it on something big, e.g. a debug build of a browser. */
+
+#include <fstream>
+#include <cassert>
+#include <chrono>
+#include <fileno.hpp>
+#include <dwarfpp/lib.hpp>
+#include <dwarfpp/native.hpp>
+
+using std::cout;
+using std::cerr;
+using std::endl;
+using namespace dwarf;
+using dwarf::core::root_die;
+using dwarf::core::iterator_df;
+using dwarf::core::iterator_bf;
+using dwarf::core::iterator_sibs;
+using dwarf::core::native_root_die;
+
+typedef std::chrono::steady_clock clock_type;
+
+static double ms_since(clock_type::time_point start)
+{
+	return std::chrono::duration<double, std::milli>(clock_type::now() - start).count();
+}
+
+static unsigned long walk_df(root_die& r)
+{
+	unsigned long count = 0;
+	for (iterator_df<> i = r.begin(); i != r.end(); ++i) ++count;
+	return count;
+}
+
+static unsigned long walk_bf(root_die& r)
+{
+	unsigned long count = 0;
+	for (iterator_bf<> i = r.begin(); i != r.end(); ++i) ++count;
+	return count;
+}
+
+static unsigned long walk_sibs(root_die& r)
+{
+	/* Children of every CU, but no deeper. */
+	unsigned long count = 0;
+	auto cus = r.begin().children_here();
+	for (auto i_cu = std::move(cus.first); i_cu != cus.second; ++i_cu)
+	{
+		auto children = i_cu.children_here();
+		for (auto i = std::move(children.first); i != children.second; ++i) ++count;
+	}
+	return count;
+}
+
+static void run(const char *label, unsigned long (*walk)(root_die&), int fd)
+{
+	unsigned long counts[2];
+	double times[2];
+	for (int cursor = 0; cursor < 2; ++cursor)
+	{
+		/* Use a fresh root each time, so neither run benefits
+		 * from the other's payload cache or parent cache. */
+		root_die r(fd);
+		r.cursor_navigation = cursor;
+		auto start = clock_type::now();
+		counts[cursor] = walk(r);
+		times[cursor] = ms_since(start);
+	}
+	assert(counts[0] == counts[1]);
+	cout << label << ": " << counts[0] << " DIEs; "
+		<< "old path " << times[0] << "ms, "
+		<< "cursor " << times[1] << "ms "
+		<< "(speedup " << (times[1] > 0 ? times[0] / times[1] : 0) << "x)" << endl;
+}
+
+int main(int argc, char **argv)
+{
+	const char *path = (argc > 1) ? argv[1] : argv[0];
+	std::ifstream in(path);
+	assert(in);
+	int fd = fileno(in);
+	cerr << "Benchmarking navigation over " << path << endl;
+
+	run("depth-first", walk_df, fd);
+	run("siblings", walk_sibs, fd);
+	run("breadth-first", walk_bf, fd);
+
+	/* The native decoder, doing the same depth-first walk as above
+	 * plus the variable-with-location test from sranges.cpp. */
+	auto start = clock_type::now();
+	auto p_native = native_root_die::open(fd);
+	if (!p_native) { cout << "native: can't decode this file natively" << endl; return 0; }
+	unsigned long count = 0, vars_with_location = 0;
+	for (auto i = p_native->begin(); i != p_native->end(); ++i)
+	{
+		++count;
+		if (i.tag_here() == DW_TAG_variable && i.has_attr_here(DW_AT_location)) ++vars_with_location;
+	}
+	cout << "native depth-first: " << count << " DIEs (" << vars_with_location 
+		<< " variables with locations) in " << ms_since(start) << "ms" << endl;
+
+	return 0;
+}
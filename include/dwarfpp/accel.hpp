@@ -0,0 +1,140 @@
+/* dwarfpp: C++ binding for a useful subset of libdwarf, plus extra goodies.
+ *
+ * accel.hpp: readers for the name-lookup tables that producers put
+ * alongside the DWARF, i.e. .debug_names, .gdb_index and pubnames.
+ *
+ * Copyright (c) 2013, Stephen Kell.
+ */
+
+#ifndef DWARFPP_ACCEL_HPP_
+#define DWARFPP_ACCEL_HPP_
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <unordered_map>
+#include <mutex>
+#include "native.hpp"
+
+namespace dwarf
+{
+	namespace core
+	{
+		using std::string;
+		using std::vector;
+		using std::shared_ptr;
+
+		/* Compilers and linkers can emit tables that map names to DIEs (or
+		 * at least to CUs). We read whichever of these the file has, in order
+		 * of preference:
+		 *
+		 * - DWARF 5 .debug_names, which is an on-disk hash table of names to
+		 *   DIE offsets (possibly one table per CU, if the linker didn't
+		 *   merge them);
+		 * - GDB's .gdb_index (versions 5 to 8), which is an on-disk hash
+		 *   table of names to the CUs defining them;
+		 * - .debug_pubnames and .debug_pubtypes (or their .debug_gnu_*
+		 *   variants), which are flat lists, so we hash them on opening.
+		 *
+		 * None of these is exhaustive in our sense. E.g. pubnames only
+		 * lists external names, and .debug_names leaves out declarations.
+		 * So lookups only give *candidates*, and a miss proves nothing:
+		 * callers must check what they get and fall back to searching. */
+		class accel_index
+		{
+		public:
+			enum kind { DEBUG_NAMES, GDB_INDEX, PUBNAMES };
+			struct candidate
+			{
+				Dwarf_Off cu_offset;  // of the unit header, in .debug_info
+				Dwarf_Off die_offset; // 0 if we only know the CU (.gdb_index)
+				bool operator==(const candidate& c) const
+				{ return cu_offset == c.cu_offset && die_offset == c.die_offset; }
+			};
+		private:
+			shared_ptr<const native_root_die> p_native;
+			kind k;
+
+			/* One .debug_names table, decoded as far as its header. */
+			struct names_table
+			{
+				unsigned offset_size;
+				uint32_t cu_count, local_tu_count, bucket_count, name_count;
+				const unsigned char *cu_list;
+				const unsigned char *buckets;
+				const unsigned char *hashes;
+				const unsigned char *string_offsets;
+				const unsigned char *entry_offsets;
+				const unsigned char *entry_pool;
+				const unsigned char *end;
+				struct abbrev
+				{
+					Dwarf_Half tag;
+					vector<std::pair<Dwarf_Unsigned, Dwarf_Half> > idx_forms;
+				};
+				std::unordered_map<Dwarf_Unsigned, abbrev> abbrevs;
+
+				Dwarf_Off cu_at(uint32_t i) const;
+				const char *name_at(uint32_t i, const debug_sections& s) const;
+				bool read_entries(uint32_t i, vector<candidate>& out) const;
+			};
+			vector<names_table> names_tables;
+
+			/* .gdb_index, in place. */
+			uint32_t gdb_index_version;
+			const unsigned char *gdb_cu_list;
+			uint32_t gdb_cu_count;
+			const unsigned char *gdb_symbol_table;
+			uint32_t gdb_symbol_slots; // a power of two
+			const unsigned char *gdb_constant_pool;
+			const unsigned char *gdb_end;
+
+			/* Anything without an on-disk hash table, hashed by us. This is
+			 * pubnames, and any .debug_names table without buckets. */
+			std::unordered_multimap<string, candidate> hashed;
+
+			accel_index(shared_ptr<const native_root_die> p_native, kind k)
+			 : p_native(p_native), k(k), gdb_index_version(0), gdb_cu_list(nullptr),
+			   gdb_cu_count(0), gdb_symbol_table(nullptr), gdb_symbol_slots(0),
+			   gdb_constant_pool(nullptr), gdb_end(nullptr), first_undecodable(0) {}
+			bool read_debug_names(const debug_sections::section& s);
+			bool read_gdb_index(const debug_sections::section& s);
+			bool read_pubnames(const debug_sections::section& s, bool gnu);
+			void lookup_gdb_index(const string& name, vector<candidate>& out) const;
+
+			/* The CUs' children that our kind of table might leave out (see
+			 * may_omit()), found by one native scan the first time we need
+			 * them: the first such DIE for each name, and the first child
+			 * whose name we can't decode, or 0. */
+			mutable std::once_flag omitted_once;
+			mutable std::unordered_map<string, Dwarf_Off> omitted;
+			mutable Dwarf_Off first_undecodable;
+			bool may_omit(const native_iterator_df& i) const;
+			void find_omitted() const;
+		public:
+			/* Returns null if the file has none of the tables, or they are
+			 * malformed, or in a version we don't understand. */
+			static shared_ptr<accel_index> open(shared_ptr<const native_root_die> p_native);
+			kind get_kind() const { return k; }
+
+			/* Append whatever the tables list under name, without duplicates. */
+			void lookup(const string& name, vector<candidate>& out) const;
+
+			/* The answer to file_toplevel_die::visible_named_grandchild() and
+			 * friends, as far as the tables know it: offsets of DIEs called
+			 * name that are immediate children of a CU and not DW_VIS_local.
+			 * We check every candidate by decoding it, so the answer is never
+			 * wrong, but it may be incomplete. In offset order. */
+			vector<Dwarf_Off> visible_grandchildren(const string& name) const;
+
+			/* The first of those in offset order, i.e. exactly what a search
+			 * would find, or 0 if we can't tell. Since the tables are
+			 * incomplete, we trust them only for the DIEs they index, and
+			 * check the rest (statics, declarations...) against what we
+			 * find by scanning the CUs' children, once. */
+			Dwarf_Off first_visible_grandchild(const string& name) const;
+		};
+	}
+}
+
+#endif
@@ -31,6 +31,9 @@ namespace dwarf
 		using std::make_pair;
 		using std::dynamic_pointer_cast;
 		using std::shared_ptr;
+		using dwarf::spec::adt_ptr;
+		using dwarf::spec::adt_cast;
+		using dwarf::spec::make_adt;
 		using dwarf::spec::opt; // FIXME: put this in a different namespace
 	
 		typedef spec::abstract_dieset abstract_dieset;
@@ -64,20 +67,20 @@ namespace dwarf
 			basic_die(dieset& ds, int dummy);
         public:
 			// "next sibling"
-			basic_die(dieset& ds, shared_ptr<basic_die> p_d);
+			basic_die(dieset& ds, adt_ptr<basic_die> p_d);
 			
 			// "first child"
-			basic_die(shared_ptr<basic_die> p_d);
+			basic_die(adt_ptr<basic_die> p_d);
 			 
 			// "specific offset"
 			basic_die(dieset& ds, Dwarf_Off off);
 			
 		    Dwarf_Off get_offset() const;
             Dwarf_Half get_tag() const;
-            std::shared_ptr<spec::basic_die> get_parent();
-            std::shared_ptr<spec::basic_die> get_first_child();
+            adt_ptr<spec::basic_die> get_parent();
+            adt_ptr<spec::basic_die> get_first_child();
             Dwarf_Off get_first_child_offset() const;
-            std::shared_ptr<spec::basic_die> get_next_sibling();
+            adt_ptr<spec::basic_die> get_next_sibling();
             Dwarf_Off get_next_sibling_offset() const;
             opt<std::string> get_name() const;
             const spec::abstract_def& get_spec() const;
@@ -87,7 +90,7 @@ namespace dwarf
             // ^^^ not a const function, because may create backrefs
 			
 			// override
-			std::shared_ptr<spec::compile_unit_die> 
+			adt_ptr<spec::compile_unit_die> 
 			enclosing_compile_unit() __attribute__((deprecated));
 			
 		};
@@ -131,18 +134,23 @@ namespace dwarf
             friend class compile_unit_die;
 
 			file *p_f; // optional
-			std::shared_ptr<lib::file_toplevel_die> m_toplevel;
+			adt_ptr<lib::file_toplevel_die> m_toplevel;
 			std::map<Dwarf_Off, Dwarf_Off> parent_cache; // HACK: doesn't evict
+			/* Lookup indexes, loaded together the first time we want one. */
+			std::shared_ptr<const core::name_index> p_name_index;
+			std::shared_ptr<const core::accel_index> p_accel;
+			bool tried_indexes;
+			void load_indexes();
 
 			/* factory methods */
-			std::shared_ptr<basic_die> get(Dwarf_Off off); // shortcut
-			std::shared_ptr<basic_die> get(const lib::die& d); // the main factory method
+			adt_ptr<basic_die> get(Dwarf_Off off); // shortcut
+			adt_ptr<basic_die> get(const lib::die& d); // the main factory method
 
 			// factory uses the usual HACK for make_shared calling private constructors! 
 			template<typename T, typename... Args > 
-			static std::shared_ptr<basic_die>
+			static adt_ptr<basic_die>
 			my_make_shared(Args&&... args) 
-			{ std::shared_ptr<basic_die> p(new T(std::forward<Args>(args)...)); return p; }
+			{ adt_ptr<basic_die> p(new T(std::forward<Args>(args)...)); return p; }
 
 
 
@@ -161,6 +169,9 @@ namespace dwarf
 			Dwarf_Off get_last_monotonic_offset() 
 			{ return highest_offset_upper_bound(); }
 			
+			std::shared_ptr<const core::name_index> get_name_index();
+			std::shared_ptr<const core::accel_index> get_accel_index();
+			
 			// FIXME: aranges interface was broken because I confused it with ranges
 			//encap::arangelist arangelist_at(Dwarf_Unsigned i) const;
 			//{ return encap::rangelist(p_f->get_ranges(), i); }
@@ -169,11 +180,11 @@ namespace dwarf
 			//path_from_root(Dwarf_Off off);
 
 			// support associative indexing
-			std::shared_ptr<spec::basic_die> 
+			adt_ptr<spec::basic_die> 
 			operator[](Dwarf_Off off) const;
 
 			// backlinks aren't necessarily stored, so support search for parent
-			std::shared_ptr<basic_die> find_parent_of(Dwarf_Off off);
+			adt_ptr<basic_die> find_parent_of(Dwarf_Off off);
 			Dwarf_Off find_parent_offset_of(Dwarf_Off off);
 
 			// navigation API
@@ -185,7 +196,7 @@ namespace dwarf
 				
 				try
 				{
-					arg.p_d = get(lib::die(*dynamic_pointer_cast<lib::die>(arg.p_d)));
+					arg.p_d = get(lib::die(dynamic_cast<lib::die&>(*arg.p_d)));
 				} catch (...) { return false; }
 				arg.off = arg.p_d->get_offset();
 				arg.path_from_root.push_back(arg.off);
@@ -218,7 +229,7 @@ namespace dwarf
 				
 				try
 				{
-					lib::die& current = *dynamic_pointer_cast<lib::die>(arg.p_d).get();
+					lib::die& current = dynamic_cast<lib::die&>(*arg.p_d);
 					arg.p_d = get(lib::die(*p_f, current));
 				} catch (...) { return false; }
 				arg.off = arg.p_d->get_offset();
@@ -235,7 +246,7 @@ namespace dwarf
 			bool move_to_next_cu(spec::abstract_dieset::iterator_base& base);
 
 			// get the toplevel die
-			std::shared_ptr<spec::file_toplevel_die> toplevel(); /* NOT const */
+			adt_ptr<spec::file_toplevel_die> toplevel(); /* NOT const */
 			
 			// get the DWARF spec
 			const spec::abstract_def& get_spec() const { return spec::DEFAULT_DWARF_SPEC; } // FIXME
@@ -244,12 +255,12 @@ namespace dwarf
 			Dwarf_Half get_address_size() const;
 // 			{
 // 				auto nonconst_this = const_cast<dieset *>(this); // HACK
-// 				auto nonconst_toplevel = dynamic_pointer_cast<file_toplevel_die>(
+// 				auto nonconst_toplevel = adt_cast<file_toplevel_die>(
 // 					nonconst_this->m_toplevel);
 // 				assert(nonconst_toplevel->compile_unit_children_begin()
 // 					!= nonconst_toplevel->compile_unit_children_end());
 // 				return nonconst_toplevel->get_address_size_for_cu(
-// 					dynamic_pointer_cast<lib::compile_unit_die>(
+// 					adt_cast<lib::compile_unit_die>(
 // 						*(nonconst_toplevel->compile_unit_children_begin())));
 // 			}
 		};
@@ -266,7 +277,7 @@ namespace dwarf
 				int version_stamp;
 				Dwarf_Half address_size;
 				shared_ptr<lib::srcfiles> source_files;
-				shared_ptr<compile_unit_die> p_cu;
+				adt_ptr<compile_unit_die> p_cu;
 			};
 			std::map<Dwarf_Off, cu_info_t> cu_info;
 			
@@ -278,9 +289,7 @@ namespace dwarf
 			friend class dieset;
 		private:
 			void add_all_cu_info();
-			void add_cu_intervals() {
-				//ds.p_f->iterate_cu(&dwarf::lib::add_cu_intervals, this);
-			}
+			void add_cu_intervals();
 			lib::dieset& ds;
 			// let's construct a core:: root_die too!
 			// SUPER HACK: do it by reopening the underlying file
@@ -309,18 +318,18 @@ namespace dwarf
 			lib::dieset& get_ds() { return ds; }
 			Dwarf_Off get_offset() const { return 0UL; }
 			Dwarf_Half get_tag() const { return 0UL; }
-			std::shared_ptr<spec::basic_die> get_parent() { return std::shared_ptr<spec::basic_die>(); }
-			std::shared_ptr<spec::basic_die> get_first_child(); 
+			adt_ptr<spec::basic_die> get_parent() { return adt_ptr<spec::basic_die>(); }
+			adt_ptr<spec::basic_die> get_first_child(); 
 			Dwarf_Off get_first_child_offset() const;
 			Dwarf_Off get_next_sibling_offset() const;
 			opt<std::string> get_name() const { return 0; }
 			const spec::abstract_def& get_spec() const { assert(p_spec); return *p_spec; }
 			
 			/* Getters for per-CU state */
-			Dwarf_Half get_address_size_for_cu(shared_ptr<compile_unit_die> cu) const;
-			std::string source_file_name_for_cu(shared_ptr<compile_unit_die> cu,
+			Dwarf_Half get_address_size_for_cu(adt_ptr<compile_unit_die> cu) const;
+			std::string source_file_name_for_cu(adt_ptr<compile_unit_die> cu,
 				unsigned o);
-			unsigned source_file_count_for_cu(shared_ptr<compile_unit_die> cu);
+			unsigned source_file_count_for_cu(adt_ptr<compile_unit_die> cu);
 			
 			// toplevel DIE has no attrs
 			std::map<Dwarf_Half, encap::attribute_value> get_attrs()
@@ -358,18 +367,18 @@ namespace dwarf
 		};
 		
 		inline dieset::dieset(file& f)
-		 : p_f(&f), m_toplevel(std::make_shared<file_toplevel_die>(*this)) 
+		 : p_f(&f), m_toplevel(make_adt<file_toplevel_die>(*this)), tried_indexes(false)
 		{ m_toplevel->add_cu_intervals(); }
 		
 		inline	Dwarf_Half dieset::get_address_size() const
 		{
 			auto nonconst_this = const_cast<dieset *>(this); // HACK
-			auto nonconst_toplevel = dynamic_pointer_cast<file_toplevel_die>(
+			auto nonconst_toplevel = adt_cast<file_toplevel_die>(
 				nonconst_this->m_toplevel);
 			assert(nonconst_toplevel->compile_unit_children_begin()
 				!= nonconst_toplevel->compile_unit_children_end());
 			return nonconst_toplevel->get_address_size_for_cu(
-				dynamic_pointer_cast<lib::compile_unit_die>(
+				adt_cast<lib::compile_unit_die>(
 					*(nonconst_toplevel->compile_unit_children_begin())));
 		}
 
@@ -388,10 +397,10 @@ namespace dwarf
 		private: fragment ## _die(const lib::die& d, dieset& ds) \
 		: basic_die(d, ds) {} \
 		/* "next sibling" */ \
-		public: fragment ## _die(dieset& ds, shared_ptr<basic_die> p_prevsib) \
+		public: fragment ## _die(dieset& ds, adt_ptr<basic_die> p_prevsib) \
 		 : basic_die(ds, p_prevsib) {} \
 		/* "first child" */ \
-		fragment ## _die(shared_ptr<basic_die> p_parent) \
+		fragment ## _die(adt_ptr<basic_die> p_parent) \
 		 : basic_die(p_parent) {} \
 		/* "specific offset" */ \
 		fragment ## _die(dieset& ds, Dwarf_Off off) \
@@ -413,8 +422,8 @@ namespace dwarf
 #define stored_type_tag Dwarf_Half
 #define stored_type_loclist dwarf::encap::loclist
 #define stored_type_address dwarf::encap::attribute_value::address
-#define stored_type_refdie std::shared_ptr<spec::basic_die> 
-#define stored_type_refdie_is_type std::shared_ptr<spec::type_die> 
+#define stored_type_refdie adt_ptr<spec::basic_die> 
+#define stored_type_refdie_is_type adt_ptr<spec::type_die> 
 #define stored_type_rangelist dwarf::encap::rangelist
 
 #define attr_optional(name, stored_t) \
@@ -446,7 +455,7 @@ namespace dwarf
 
 // compile_unit_die has an override for get_next_sibling()
 #define extra_decls_compile_unit \
-		std::shared_ptr<spec::basic_die> get_next_sibling(); \
+		adt_ptr<spec::basic_die> get_next_sibling(); \
 		Dwarf_Off get_next_sibling_offset() const; \
 		Dwarf_Half get_address_size() const; \
 		std::string source_file_name(unsigned o) const; \
@@ -0,0 +1,83 @@
+/* dwarfpp: C++ binding for a useful subset of libdwarf, plus extra goodies.
+ *
+ * adt_ptr.hpp: how the ADT (spec::basic_die and friends) points to DIEs.
+ *
+ * Copyright (c) 2013, Stephen Kell.
+ */
+
+#ifndef DWARFPP_ADT_PTR_HPP_
+#define DWARFPP_ADT_PTR_HPP_
+
+#include <memory>
+#include <utility>
+#include <boost/smart_ptr/intrusive_ptr.hpp>
+#ifndef DWARFPP_ADT_SINGLE_THREADED
+#include <atomic>
+#endif
+
+namespace dwarf
+{
+	namespace spec
+	{
+		/* By default, ADT DIEs are held by std::shared_ptr, as always. Every
+		 * DIE then pays for a separate control block, and every copy of a
+		 * pointer (e.g. each get_parent() / get_first_child() /
+		 * get_next_sibling()) is atomic traffic on it.
+		 *
+		 * Define DWARFPP_INTRUSIVE_ADT to use boost::intrusive_ptr instead,
+		 * with the count inside the DIE (see adt_counted). Also define
+		 * DWARFPP_ADT_SINGLE_THREADED to make that count a plain integer, if
+		 * no DIE is ever shared between threads.
+		 *
+		 * ADT code should say adt_ptr<>, adt_counted<> and adt_cast<>, not
+		 * shared_ptr, enable_shared_from_this and dynamic_pointer_cast, so
+		 * that it works either way. The mode changes the ABI, so the library
+		 * and its clients must agree on it. */
+#ifdef DWARFPP_INTRUSIVE_ADT
+		template <typename T> using adt_ptr = boost::intrusive_ptr<T>;
+
+		/* Like enable_shared_from_this<Self>, but holding the count itself.
+		 * Copying a DIE doesn't copy its count. */
+		template <typename Self>
+		class adt_counted
+		{
+#ifdef DWARFPP_ADT_SINGLE_THREADED
+			mutable unsigned adt_refcount;
+#else
+			mutable std::atomic<unsigned> adt_refcount;
+#endif
+			friend void intrusive_ptr_add_ref(const adt_counted *p)
+			{ ++p->adt_refcount; }
+			friend void intrusive_ptr_release(const adt_counted *p)
+			{ if (--p->adt_refcount == 0) delete p; }
+		protected:
+			adt_counted() : adt_refcount(0) {}
+			adt_counted(const adt_counted&) : adt_refcount(0) {}
+			adt_counted& operator=(const adt_counted&) { return *this; }
+			virtual ~adt_counted() {}
+		public:
+			adt_ptr<Self> shared_from_this() { return adt_ptr<Self>(static_cast<Self *>(this)); }
+			adt_ptr<const Self> shared_from_this() const { return adt_ptr<const Self>(static_cast<const Self *>(this)); }
+		};
+
+		template <typename T, typename U>
+		inline adt_ptr<T> adt_cast(const adt_ptr<U>& p)
+		{ return boost::dynamic_pointer_cast<T>(p); }
+		template <typename T, typename... Args>
+		inline adt_ptr<T> make_adt(Args&&... args)
+		{ return adt_ptr<T>(new T(std::forward<Args>(args)...)); }
+#else
+		template <typename T> using adt_ptr = std::shared_ptr<T>;
+		template <typename Self> using adt_counted = std::enable_shared_from_this<Self>;
+
+		template <typename T, typename U>
+		inline adt_ptr<T> adt_cast(const adt_ptr<U>& p)
+		{ return std::dynamic_pointer_cast<T>(p); }
+		template <typename T, typename... Args>
+		inline adt_ptr<T> make_adt(Args&&... args)
+		{ return std::make_shared<T>(std::forward<Args>(args)...); }
+#endif
+	}
+}
+
+#endif
@@ -13,6 +13,7 @@
 #include <vector>
 
 #include "spec.hpp"
+#include "adt_ptr.hpp"
 #include "private/libdwarf.hpp" /* includes libdwarf.h, Error, No_entry, some fwddecls */
 
 #include <boost/optional.hpp>
@@ -48,6 +49,9 @@ namespace dwarf
 	namespace encap
 	{
 		using namespace dwarf::lib;
+		using spec::adt_ptr;
+		using spec::adt_cast;
+		using spec::make_adt;
 		class rangelist;
 		
 		template <typename Value> struct die_out_edge_iterator; // forward decl
@@ -55,13 +59,39 @@ namespace dwarf
 		class dieset; // forward decl
 		class die;
 		class loclist;
+		class snapshot;
+		struct attribute_payloads;
 		using core::root_die;
 		
+		/* An attribute_value's string, block, loclist or rangelist. Values
+		 * share these, counting references, so that copying a value (which
+		 * happens a lot, e.g. get_attrs()) is cheap, yet each value still
+		 * owns its payload: it outlives the dieset if the value does, and
+		 * goes when the last value using it does (e.g. when put_attr()
+		 * overwrites it, or its CU is evicted). Like the rest of encap,
+		 * the counts are not thread-safe. */
+		template <typename T>
+		struct counted_payload
+		{
+			T value;
+			unsigned refs;
+			explicit counted_payload(T&& value) : value(std::move(value)), refs(1) {}
+		};
+		/* Strings in an encap::dieset are also interned in its
+		 * attribute_payloads, which forgets them when they go. */
+		struct counted_string : counted_payload<std::string>
+		{
+			attribute_payloads *p_interned_in; // null if not (or no longer) interned
+			counted_string(std::string&& value, attribute_payloads *p_interned_in)
+			 : counted_payload<std::string>(std::move(value)), p_interned_in(p_interned_in) {}
+		};
+		
 		class attribute_value {
 				friend std::ostream& operator<<(std::ostream& o, const dwarf::encap::die& d);
 				friend std::ostream& dwarf::spec::operator<<(std::ostream& o, const dwarf::spec::basic_die& d);                
 				friend class encap::die; // for the "convert to strong references" hack
 				friend class encap::dieset;
+				friend class encap::snapshot; // builds values directly
 		public: 
 			struct weak_ref { 
 				friend class attribute_value;
@@ -170,17 +200,30 @@ namespace dwarf
 			//};
 			// HACK: we can't include these in the union, it seems
 			// TODO: instead of allocating them here, use new (here) and delete (in destructor)
-				std::vector<unsigned char> *v_block;
-				std::string *v_string;
+				counted_payload<std::vector<unsigned char> > *v_block;
+				counted_string *v_string; // interned, if we're in an encap::dieset
 				weak_ref *v_ref;
-				encap::loclist *v_loclist;
-                encap::rangelist *v_rangelist;
+				counted_payload<encap::loclist> *v_loclist;
+                counted_payload<encap::rangelist> *v_rangelist;
 			};
 			// -- the operator<< is a friend
 			friend std::ostream& ::dwarf::lib::operator<<(std::ostream& s, const dwarf::lib::Dwarf_Loc& l);
 
 			static form dwarf_form_to_form(const Dwarf_Half form); // helper hack
 
+			/* Wrap a payload, holding the first reference to it. Strings get
+			 * interned if our dieset is an encap::dieset. */
+			counted_string *hold(std::string&& s);
+			counted_payload<std::vector<unsigned char> > *hold(std::vector<unsigned char>&& b);
+			counted_payload<encap::loclist> *hold(encap::loclist&& l);
+			counted_payload<encap::rangelist> *hold(encap::rangelist&& l);
+			/* After p_ds changes, re-intern our string in the new dieset. */
+			void rehold();
+			/* Drop a reference, freeing the payload if it was the last. */
+			template <typename T>
+			static void release(counted_payload<T> *p) { if (--p->refs == 0) delete p; }
+			static void release(counted_string *p);
+
 			/*attribute_value() : orig_form(0), f(NO_ATTR) { v_u = 0U; } // FIXME: this zero value can still be harmful when clients do get_ on wrong type
 				// ideally the return values of get_() methods should return some Option-style type,
 				// which I think boost provides... i.e. Some of value | None*/
@@ -192,6 +235,9 @@ namespace dwarf
 			// the following constructor is a HACK to re-use formatting logic when printing Dwarf_Locs
 			attribute_value(Dwarf_Unsigned data, Dwarf_Half o_form) 
 				: p_ds(0), orig_form(o_form), f(dwarf_form_to_form(o_form)), v_u(data) {} 
+			// the following is for encap::snapshot, which fills in f and the value itself
+			attribute_value(spec::abstract_dieset& ds, Dwarf_Half o_form, form f) 
+				: p_ds(&ds), orig_form(o_form), f(f) { v_u = 0; }
 			// the following is a temporary HACK to allow core:: to create attribute_values
 		public:
 			attribute_value(const dwarf::core::Attribute& attr, 
@@ -206,10 +252,10 @@ namespace dwarf
  			attribute_value(spec::abstract_dieset& ds, address addr) : p_ds(&ds), orig_form(DW_FORM_addr), f(ADDR), v_addr(addr) {}		
  			attribute_value(spec::abstract_dieset& ds, Dwarf_Unsigned u) : p_ds(&ds), orig_form(DW_FORM_udata), f(UNSIGNED), v_u(u) {}				
  			attribute_value(spec::abstract_dieset& ds, Dwarf_Signed s) : p_ds(&ds), orig_form(DW_FORM_sdata), f(SIGNED), v_s(s) {}			
- 			attribute_value(spec::abstract_dieset& ds, const char *s) : p_ds(&ds), orig_form(DW_FORM_string), f(STRING), v_string(new std::string(s)) {}
- 			attribute_value(spec::abstract_dieset& ds, const std::string& s) : p_ds(&ds), orig_form(DW_FORM_string), f(STRING), v_string(new std::string(s)) {}				
+ 			attribute_value(spec::abstract_dieset& ds, const char *s) : p_ds(&ds), orig_form(DW_FORM_string), f(STRING), v_string(hold(std::string(s))) {}
+ 			attribute_value(spec::abstract_dieset& ds, const std::string& s) : p_ds(&ds), orig_form(DW_FORM_string), f(STRING), v_string(hold(std::string(s))) {}				
  			attribute_value(spec::abstract_dieset& ds, weak_ref& r) : p_ds(&ds), orig_form(DW_FORM_ref_addr), f(REF), v_ref(r.clone()) {}
- 			attribute_value(spec::abstract_dieset& ds, std::shared_ptr<spec::basic_die> ref_target);
+ 			attribute_value(spec::abstract_dieset& ds, adt_ptr<spec::basic_die> ref_target);
 			attribute_value(spec::abstract_dieset& ds, const encap::loclist& l);
 			attribute_value(spec::abstract_dieset& ds, const encap::rangelist& l);
 		public:
@@ -217,20 +263,21 @@ namespace dwarf
 			Dwarf_Bool get_flag() const { assert(f == FLAG); return v_flag; }
 			Dwarf_Unsigned get_unsigned() const { assert(f == UNSIGNED); return v_u; }
 			Dwarf_Signed get_signed() const { assert(f == SIGNED); return v_s; }
-			const std::vector<unsigned char> *get_block() const { assert(f == BLOCK); return v_block; }
-			const std::string& get_string() const { assert(f == STRING); return *v_string; }
+			const std::vector<unsigned char> *get_block() const { assert(f == BLOCK); return &v_block->value; }
+			const std::string& get_string() const { assert(f == STRING); return v_string->value; }
 			address get_address() const { assert(f == ADDR); return v_addr; }
-			const loclist& get_loclist() const { assert(f == LOCLIST); return *v_loclist; }
-			const rangelist& get_rangelist() const { assert(f == RANGELIST); return *v_rangelist; }
+			// these two are defined in the cpp file, where loclist and rangelist are complete
+			const loclist& get_loclist() const;
+			const rangelist& get_rangelist() const;
 
 			weak_ref& get_ref() const { assert(f == REF); return *v_ref; }
 			Dwarf_Off get_refoff() const { assert(f == REF); return v_ref->off; }
 			Dwarf_Off get_refoff_is_type() const { assert(f == REF); return v_ref->off; }
 			core::iterator_df<> get_refiter() const;// { assert(f == REF); return v_ref->off; }
 			core::iterator_df<core::type_die> get_refiter_is_type() const;// { assert(f == REF); return v_ref->off; }
-			std::shared_ptr<spec::basic_die> get_refdie() const; // defined in cpp file
+			adt_ptr<spec::basic_die> get_refdie() const; // defined in cpp file
 			//spec::basic_die& get_refdie() const; // defined in cpp file
-			std::shared_ptr<spec::type_die> get_refdie_is_type() const; 
+			adt_ptr<spec::type_die> get_refdie_is_type() const; 
 			//spec::type_die& get_refdie_is_type() { return dynamic_cast<spec::type_die&>(get_refdie()); }
 			/* ^^^ I think a plain reference is okay here because the "this" pointer
 			 * (i.e. whatever pointer we'll be accessing the attribute through)
@@ -405,6 +405,7 @@ namespace dwarf
 			 * To integrate these, is it as simple as
 			 * - s/shared_ptr/intrusive_ptr/ in ADT;
 			 * - include a refcount in every basic_die (basic_die_core?);
+			 *   (NOTE: -DDWARFPP_INTRUSIVE_ADT now does these two; see adt_ptr.hpp)
 			 * - redefine abstract_dieset::iterator to be like core, but
 			 *   returning the intrusive_ptr (not raw ref) on dereference? 
 			 * Ideally I would separate out the namespaces so that
@@ -12,6 +12,8 @@ namespace dwarf
 		using std::dynamic_pointer_cast;
 		using boost::optional;
 		using std::shared_ptr;
+		using dwarf::spec::adt_ptr;
+		using dwarf::spec::adt_cast;
 		using std::string;
 		using std::vector;
 		using std::pair;
@@ -50,7 +52,7 @@ namespace dwarf
 					&&	bit_offset == arg.bit_offset
 					&&	bit_size == arg.bit_size;
 				}
-				base_type(shared_ptr<spec::base_type_die> p_d);
+				base_type(adt_ptr<spec::base_type_die> p_d);
 				friend std::ostream& operator<<(std::ostream& s, const base_type& c);
 			}; 
 		
@@ -41,12 +41,12 @@ public:
 	
 // 	void 
 // 	emit_typedef(
-// 		shared_ptr<spec::type_die> p_d,
+// 		adt_ptr<spec::type_die> p_d,
 // 		const string& name
 // 	)
 // 	{ out << make_typedef(p_d, name); }
 
-	void emit_all_decls(shared_ptr<spec::file_toplevel_die> p_d);
+	void emit_all_decls(adt_ptr<spec::file_toplevel_die> p_d);
 	
 	void emit_forward_decls(const set<encap::basic_die *>& fds);
 };
@@ -271,10 +271,7 @@ public:
 		graph_traits<dwarf::tool::cpp_dependency_order>::vertex_descriptor u,
 		const dwarf::tool::cpp_dependency_order& g)
 	{
-		// HACK: we shouldn't really do this
 		unsigned count = 0;
-		dwarf::tool::cpp_dependency_order& vg = const_cast<dwarf::tool::cpp_dependency_order&>(g);
-		encap::die::attribute_map::iterator attrs_end = vg.p_parent->m_attrs.end();
 		for (dwarf::tool::skip_edge_iterator<> i = out_edges(u, g).first;
 				i != out_edges(u, g).second;
 				i++) count++;
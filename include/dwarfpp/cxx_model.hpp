@@ -32,6 +32,8 @@ using std::map;
 using std::string;
 using boost::optional;
 using std::shared_ptr;
+using dwarf::spec::adt_ptr;
+using dwarf::spec::adt_cast;
 using dwarf::spec::basic_die;
 using srk31::indenting_ostream;
 using dwarf::spec::abstract_dieset;
@@ -66,51 +68,51 @@ public:
 	cxx_generator_from_dwarf(const spec::abstract_def& s) : p_spec(&s) {}
 
 
-	bool is_builtin(shared_ptr<spec::basic_die> p_d);
+	bool is_builtin(adt_ptr<spec::basic_die> p_d);
 
 	string 
-	name_for(shared_ptr<spec::type_die> t) 
+	name_for(adt_ptr<spec::type_die> t) 
 	{ return local_name_for(t); }
 	
 	virtual 
 	optional<string>
-	name_for_base_type(shared_ptr<spec::base_type_die>) = 0;
+	name_for_base_type(adt_ptr<spec::base_type_die>) = 0;
 	
 	vector<string> 
-	name_parts_for(shared_ptr<spec::type_die> t) 
+	name_parts_for(adt_ptr<spec::type_die> t) 
 	{ return local_name_parts_for(t); }
 
 	bool 
-	type_infixes_name(shared_ptr<spec::basic_die> p_d);
+	type_infixes_name(adt_ptr<spec::basic_die> p_d);
 
 	string 
-	local_name_for(shared_ptr<spec::basic_die> p_d,
+	local_name_for(adt_ptr<spec::basic_die> p_d,
 		bool use_friendly_names = true) 
 	{ return name_from_name_parts(local_name_parts_for(p_d, use_friendly_names)); }
 
 	vector<string> 
-	local_name_parts_for(shared_ptr<spec::basic_die> p_d,
+	local_name_parts_for(adt_ptr<spec::basic_die> p_d,
 		bool use_friendly_names = true);
 		
 	string 
-	fq_name_for(shared_ptr<spec::basic_die> p_d)
+	fq_name_for(adt_ptr<spec::basic_die> p_d)
 	{ return name_from_name_parts(fq_name_parts_for(p_d)); }
 	
 	vector<string> 
-	fq_name_parts_for(shared_ptr<spec::basic_die> p_d);
+	fq_name_parts_for(adt_ptr<spec::basic_die> p_d);
 	
 	string 
-	cxx_name_from_die(shared_ptr<spec::basic_die> p_d);
+	cxx_name_from_die(adt_ptr<spec::basic_die> p_d);
 
 	bool 
-	cxx_type_can_be_qualified(shared_ptr<spec::type_die> p_d) const;
+	cxx_type_can_be_qualified(adt_ptr<spec::type_die> p_d) const;
 
 	bool 
-	cxx_type_can_have_name(shared_ptr<spec::type_die> p_d) const;
+	cxx_type_can_have_name(adt_ptr<spec::type_die> p_d) const;
 
 	pair<string, bool>
 	cxx_declarator_from_type_die(
-		shared_ptr<spec::type_die> p_d, 
+		adt_ptr<spec::type_die> p_d, 
 		optional<const string&> infix_typedef_name = optional<const string&>(),
 		bool use_friendly_names = true,
 		optional<const string&> extra_prefix = optional<const string&>(),
@@ -119,33 +121,33 @@ public:
 
 	bool 
 	cxx_assignable_from(
-		shared_ptr<spec::type_die> dest,
-		shared_ptr<spec::type_die> source
+		adt_ptr<spec::type_die> dest,
+		adt_ptr<spec::type_die> source
 	);
 
 	bool 
-	cxx_is_complete_type(shared_ptr<spec::type_die> t);
+	cxx_is_complete_type(adt_ptr<spec::type_die> t);
 	
 	pair<string, bool>
 	name_for_type(
-		shared_ptr<spec::type_die> p_d, 
+		adt_ptr<spec::type_die> p_d, 
 		optional<const string&> infix_typedef_name = optional<const string&>(),
 		bool use_friendly_names = true);
 
 	string 
 	name_for_argument(
-		shared_ptr<spec::formal_parameter_die> p_d, 
+		adt_ptr<spec::formal_parameter_die> p_d, 
 		int argnum);
 
 	string
 	make_typedef(
-		shared_ptr<spec::type_die> p_d,
+		adt_ptr<spec::type_die> p_d,
 		const string& name 
 	);
 	
 	string
 	make_function_declaration_of_type(
-		shared_ptr<spec::subroutine_type_die> p_d,
+		adt_ptr<spec::subroutine_type_die> p_d,
 		const string& name,
 		bool write_semicolon = true,
 		bool wrap_with_extern_lang = true
@@ -153,7 +155,7 @@ public:
 
 	string 
 	create_ident_for_anonymous_die(
-		shared_ptr<spec::basic_die> p_d
+		adt_ptr<spec::basic_die> p_d
 	);
 
 	string 
@@ -166,7 +168,7 @@ public:
 		abstract_dieset::iterator i_d
 	);
 	
-	template<typename Pred = srk31::True<shared_ptr<spec::basic_die> > > 
+	template<typename Pred = srk31::True<adt_ptr<spec::basic_die> > > 
 	void 
 	dispatch_to_model_emitter(
 		indenting_ostream& out, 
@@ -176,16 +178,16 @@ public:
 
 protected:
 	virtual 
-	shared_ptr<spec::type_die>
+	adt_ptr<spec::type_die>
 	transform_type(
-		shared_ptr<spec::type_die> t,
+		adt_ptr<spec::type_die> t,
 		abstract_dieset::iterator context
 	)
 	{
 		return t;
 	}
 
-	template <typename Pred = srk31::True< shared_ptr<spec::basic_die> > >
+	template <typename Pred = srk31::True< adt_ptr<spec::basic_die> > >
 	void 
 	recursively_emit_children(
 		indenting_ostream& out,
@@ -193,7 +195,7 @@ protected:
 		const Pred& pred = Pred()
 	);
 // 	template <typename Ret, typename Func, typename Args...>
-// 	Ret dispatch(const Func&, shared_ptr<spec::basic_die> p_d, Args...)
+// 	Ret dispatch(const Func&, adt_ptr<spec::basic_die> p_d, Args...)
 // 	{
 // 		switch(p_d->get_tag())
 // 		{
@@ -244,13 +246,13 @@ template<> void cxx_generator_from_dwarf::emit_model<DW_TAG_restrict_type>
 template<> void cxx_generator_from_dwarf::emit_model<DW_TAG_subrange_type>         (indenting_ostream& out, abstract_dieset::iterator i_d);
 
 	/* The dispatch function (template) defined. */
-	template <typename Pred /* = srk31::True<shared_ptr<spec::basic_die> > */ > 
+	template <typename Pred /* = srk31::True<adt_ptr<spec::basic_die> > */ > 
 	void cxx_generator_from_dwarf::dispatch_to_model_emitter(
 		indenting_ostream& out,
 		abstract_dieset::iterator i_d,
 		const Pred& pred /* = Pred() */)
 	{
-		auto p_d = dynamic_pointer_cast<basic_die>(*i_d);
+		auto p_d = adt_cast<basic_die>(*i_d);
 
 		// if it's a compiler builtin, skip it
 		if (is_builtin(p_d->get_this())) return;
@@ -317,7 +319,7 @@ public:
 	cxx_target() {}
 	
 	// implementation of pure virtual function in cxx_generator_from_dwarf
-	optional<string> name_for_base_type(shared_ptr<spec::base_type_die> p_d);
+	optional<string> name_for_base_type(adt_ptr<spec::base_type_die> p_d);
 };
 
 } // end namespace tool
@@ -13,6 +13,8 @@
 #include "lib.hpp"
 #include "attr.hpp"
 #include "spec_adt.hpp"
+#include "flat_offset_map.hpp"
+#include "small_attr_map.hpp"
 #include <boost/optional.hpp>
 #include <memory>
 #include <boost/iterator/iterator_adaptor.hpp>
@@ -23,6 +25,7 @@
 #include <concatenating_iterator.hpp>
 
 #include <vector>
+#include <unordered_set>
 #include <set>
 #include <map>
 #include <string>
@@ -47,6 +50,8 @@ namespace dwarf {
 		class basic_die;
 		class factory;
 		class file_toplevel_die;
+		class file;
+		class snapshot;
 		template <typename Iter> 
 		struct has_name
 		{
@@ -60,14 +65,57 @@ namespace dwarf {
 		//typedef std::vector<Dwarf_Off> die_off_list;
 		typedef std::vector<die*> die_ptr_list;
 
+		/* How a dieset stores its DIEs. The flat map is much smaller and faster
+		 * to walk; define DWARFPP_ENCAP_STD_MAP_DIESET to get the old std::map,
+		 * whose iterators survive insertions. */
+#ifdef DWARFPP_ENCAP_STD_MAP_DIESET
+		typedef std::map<Dwarf_Off, adt_ptr<dwarf::encap::die> > dieset_storage;
+#else
+		typedef flat_offset_map<adt_ptr<dwarf::encap::die> > dieset_storage;
+#endif
+
+		/* Where a dieset interns its attribute_values' strings, since the same
+		 * names turn up everywhere (see attribute_value::hold()). We don't
+		 * keep them alive: the values using a string own it between them
+		 * (see counted_payload), and it leaves us when the last of them goes.
+		 * So nothing lingers after put_attr() overwrites a value or a CU is
+		 * evicted. Values can outlive us, so we un-intern what's left when
+		 * we go. Blocks, loclists and rangelists are shared but not interned. */
+		struct attribute_payloads
+		{
+			struct hash_value
+			{
+				size_t operator()(const counted_string *p) const 
+				{ return std::hash<std::string>()(p->value); }
+			};
+			struct equal_value
+			{
+				bool operator()(const counted_string *p1, const counted_string *p2) const 
+				{ return p1->value == p2->value; }
+			};
+			std::unordered_set<counted_string *, hash_value, equal_value> strings;
+			
+			attribute_payloads() {}
+			// each dieset interns its own; see attribute_value::rehold()
+			attribute_payloads(const attribute_payloads&) {}
+			attribute_payloads& operator=(const attribute_payloads&) { return *this; }
+			~attribute_payloads();
+			counted_string *intern(std::string&& s); // returns a new reference
+			void forget(counted_string *p) { strings.erase(p); }
+		};
+
 		// basic definitions for dealing with encap data
+		/* NOTE: attribute_payloads comes before dieset_storage, so that it is
+		 * destroyed after the DIEs whose attributes point into it. */
 		class dieset 
-		 : private std::map<Dwarf_Off, std::shared_ptr<dwarf::encap::die> >,
+		 : private attribute_payloads,
+		   private dieset_storage,
 		   public virtual spec::abstract_mutable_dieset
 		{
-			typedef std::map<Dwarf_Off, std::shared_ptr<dwarf::encap::die> > super;
+			typedef dieset_storage super;
 			friend class file;
 			friend class die;
+			friend class snapshot;
 			bool destructing;
 			/* We don't guarantee that DIEs' offsets are monotonic across any depthfirst
 			 * or siblingwise traversal of the tree. This is so that we can always insert 
@@ -76,14 +124,55 @@ namespace dwarf {
 			 * a particular range of DIEs is covered, so we remember where the nonmonotonic
 			 * DIEs begin at. */
 			Dwarf_Off last_monotonic_offset;
+			/* In lazy mode (see file), each CU is only encapsulated when something
+			 * first asks for a DIE inside it. We keep the CUs by the offset of
+			 * their CU DIE; each covers offsets up to (not including) end. */
+			struct lazy_cu
+			{
+				Dwarf_Off end;
+				bool loaded;
+				bool touched; // since the last evict_untouched()
+				bool changed; // never evict these
+			};
+			std::map<Dwarf_Off, lazy_cu> lazy_cus;
+			file *p_lazy_file; // who encapsulates them; null if we're not lazy
+			bool lazy_loading; // so that encapsulating doesn't count as changing
+			void add_lazy_cu(Dwarf_Off cu_off, Dwarf_Off end);
+			std::map<Dwarf_Off, lazy_cu>::iterator lazy_cu_containing(Dwarf_Off off);
+			void ensure_loaded(Dwarf_Off off)
+			{ if (p_lazy_file) load_cu_containing(off); }
+			void load_cu_containing(Dwarf_Off off);
+			/* A CU's DIEs come in offset order, usually below DIEs we already
+			 * have, so have the storage merge them in once (see flat_offset_map). */
+#ifdef DWARFPP_ENCAP_STD_MAP_DIESET
+			void begin_cu_run() {}
+			void end_cu_run() {}
+#else
+			void begin_cu_run() { this->super::begin_run(); }
+			void end_cu_run() { this->super::end_run(); }
+#endif
+			void note_changed(Dwarf_Off off);
+			Dwarf_Off lazy_end() const
+			{ return lazy_cus.empty() ? (Dwarf_Off) 0 : lazy_cus.rbegin()->second.end; }
 		public:
 			bool is_destructing() const { return destructing; }
+			bool is_lazy() const { return p_lazy_file != 0; }
+			/* Encapsulate every CU not yet encapsulated, e.g. before walking
+			 * map_begin()..map_end(), which only see what has been loaded. */
+			void load_all();
+			/* Throw away the DIEs of loaded CUs that nothing has asked for since
+			 * the last call (or since loading), unless we know they were changed
+			 * through put_attr() or by adding children. They get encapsulated
+			 * again if asked for later. Anyone still holding pointers to evicted
+			 * DIEs keeps them alive, but they are no longer in the dieset.
+			 * Returns how many CUs were evicted. */
+			unsigned evict_untouched();
 			Dwarf_Off get_last_monotonic_offset() const { return last_monotonic_offset; }
 		private:
 			friend struct Print_Action;
 			const ::dwarf::spec::abstract_def *p_spec;
 			void create_toplevel_entry();
-			dieset() : destructing(false), last_monotonic_offset(0UL), p_spec(&spec::DEFAULT_DWARF_SPEC)
+			dieset() : destructing(false), last_monotonic_offset(0UL), p_lazy_file(0), lazy_loading(false), p_spec(&spec::DEFAULT_DWARF_SPEC)
 			{
 				create_toplevel_entry();
 				//std::cerr << "Default-constructed a dieset!" << std::endl;
@@ -95,16 +184,17 @@ namespace dwarf {
 			typedef std::pair<Dwarf_Off, Dwarf_Half> backref_rec;
 			typedef std::vector<backref_rec> backref_list;
 			explicit dieset(const ::dwarf::spec::abstract_def& spec) 
-			: destructing(false), last_monotonic_offset(0UL), p_spec(&spec) 
+			: destructing(false), last_monotonic_offset(0UL), p_lazy_file(0), lazy_loading(false), p_spec(&spec) 
 			{
 				create_toplevel_entry();
 				//std::cerr << "Non-default-constructed a dieset!" << std::endl;
 			}
 			virtual ~dieset() { destructing = true; }
+			attribute_payloads& payloads() { return *this; }
 			const ::dwarf::spec::abstract_def& spec() const { assert(p_spec); return *p_spec; }
 			const ::dwarf::spec::abstract_def& get_spec() const { assert(p_spec); return *p_spec; }			
-			std::shared_ptr<file_toplevel_die> all_compile_units();
-			/* std::shared_ptr<file_toplevel_die> toplevel() { return all_compile_units(); } */
+			adt_ptr<file_toplevel_die> all_compile_units();
+			/* adt_ptr<file_toplevel_die> toplevel() { return all_compile_units(); } */
 			struct pair_compare_by_key
 			{
 				bool operator()(const value_type& v1, const value_type& v2) const
@@ -116,8 +206,9 @@ namespace dwarf {
 			Dwarf_Off next_free_offset() const 
 			{ 
 				//std::cerr << "getting next free offset from dieset of size " << size() << std::endl;
-				return std::max_element(
-					this->super::begin(), this->super::end(), pair_compare_by_key())->first + 1; 
+				// the storage is sorted, so the last is the highest;
+				// in lazy mode, don't hand out offsets inside CUs we haven't loaded
+				return std::max((--this->super::end())->first + 1, lazy_end()); 
 			}
 			encap::dieset& operator=(const encap::dieset& arg);
 			std::pair<map_iterator, bool> insert(const value_type& val)
@@ -133,10 +224,10 @@ namespace dwarf {
 				return this->super::insert(pos, val);
 			}
 			virtual 
-			std::shared_ptr<dwarf::spec::basic_die> 
+			adt_ptr<dwarf::spec::basic_die> 
 			insert(
 				dwarf::lib::Dwarf_Off pos, 
-				std::shared_ptr<dwarf::spec::basic_die> p_d)
+				adt_ptr<dwarf::spec::basic_die> p_d)
 			{
 				/* We assume that the parent of the DIE is correctly set up. */
 				
@@ -146,13 +237,13 @@ namespace dwarf {
 				 * new one, we have to build it from scratch or by cloning
 				 * an existing one. The built DIE only has to implement the
 				 * non-mutable */
-				std::shared_ptr<dwarf::encap::die> encap_d
-				 = std::dynamic_pointer_cast<encap::die>(p_d);
-				if (!encap_d) return std::shared_ptr<dwarf::spec::basic_die>(); // return null
+				adt_ptr<dwarf::encap::die> encap_d
+				 = adt_cast<encap::die>(p_d);
+				if (!encap_d) return adt_ptr<dwarf::spec::basic_die>(); // return null
 				else 
 				{
 					if (super::find(pos) != super::end()) throw Error(0, 0); // FIXME: better error
-					auto ret = super::insert(std::make_pair(pos, std::dynamic_pointer_cast<encap::die>(p_d)));
+					auto ret = super::insert(std::make_pair(pos, adt_cast<encap::die>(p_d)));
 					assert(ret.second);
 					return p_d;
 				}
@@ -177,13 +268,14 @@ namespace dwarf {
 			map_const_iterator map_begin() const { return this->super::begin(); }
 			map_iterator map_end() { return this->super::end(); }
 			map_const_iterator map_end() const { return this->super::end(); }
-			map_const_iterator map_find(Dwarf_Off off) const { return this->super::find(off); }
-			map_iterator map_find(Dwarf_Off off) { return this->super::find(off); }
+			map_const_iterator map_find(Dwarf_Off off) const 
+			{ const_cast<dieset *>(this)->ensure_loaded(off); return this->super::find(off); }
+			map_iterator map_find(Dwarf_Off off) { ensure_loaded(off); return this->super::find(off); }
 			super::size_type map_size() const { return this->super::size(); }
 			
 			// override of abstract_dieset
 			Dwarf_Off highest_offset_upper_bound() 
-			{ return (--map_end())->first; }
+			{ return std::max((--map_end())->first, lazy_end() ? lazy_end() - 1 : (Dwarf_Off) 0); }
 			
 //			Encap_all_compile_units& all_compile_units()
 //			{ return dynamic_cast<Encap_all_compile_units&>(*(this->find(0UL)->second)); }
@@ -211,9 +303,9 @@ namespace dwarf {
 			{ return abstract_dieset::iterator(*this, 
 				std::numeric_limits<Dwarf_Off>::max(),
 				path_type()); }
-			std::shared_ptr<dwarf::spec::basic_die> 
+			adt_ptr<dwarf::spec::basic_die> 
 			operator[](dwarf::lib::Dwarf_Off off) const;
-			std::shared_ptr<spec::file_toplevel_die> toplevel();
+			adt_ptr<spec::file_toplevel_die> toplevel();
 			//std::deque< spec::abstract_dieset::position > path_from_root(Dwarf_Off off);
 
 			bool move_to_first_child(spec::abstract_dieset::iterator_base& arg);
@@ -241,12 +333,15 @@ namespace dwarf {
 		
 		class file : public dwarf::lib::file
 		{
+			friend class dieset;
 			dieset m_ds;
 			
 			//die_off_list cu_off_list;
 			std::map<Dwarf_Off, Dwarf_Half> cu_version_stamps;
 			
 			void encapsulate_die(lib::die& d, Dwarf_Off parent_off);
+			void encapsulate_all();
+			void encapsulate_cu(Dwarf_Off cu_off); // for dieset, in lazy mode
 			//const dwarf::spec::abstract_def *p_spec;
 			file() /*: p_spec(spec::DEFAULT_DWARF_SPEC)*/ {} // private constructor
 		public:
@@ -254,6 +349,18 @@ namespace dwarf {
 			const dieset& get_ds() const { return m_ds; }
 			dieset& ds() { return m_ds; }
 			file(int fd, Dwarf_Unsigned access = DW_DLC_READ);
+			/* The same, but go via a snapshot (see encap_snapshot.hpp): if there
+			 * is a usable one at snapshot_path, or at snapshot::default_path() if
+			 * that's empty, restore the dieset from it; otherwise encapsulate as
+			 * above, then write the snapshot for next time. */
+			file(int fd, Dwarf_Unsigned access, const std::string& snapshot_path);
+			/* In LAZY mode, we only read the CU headers now. Each CU's DIEs are
+			 * encapsulated when the dieset is first asked for one of them (by
+			 * find(), operator[], map_find() or iteration), and can be evicted
+			 * again with dieset::evict_untouched(). Backrefs only cover the CUs
+			 * loaded so far, and there's no integrity check up front. */
+			enum mode { EAGER, LAZY };
+			file(int fd, Dwarf_Unsigned access, mode m);
 			static file& default_file()
 			{
 				static file *pointer_to_default = 0;
@@ -274,7 +381,7 @@ namespace dwarf {
 		std::pair<
 			dwarf::encap::die_out_edge_iterator<dwarf::encap::attribute_value::weak_ref>, 
 			dwarf::encap::die_out_edge_iterator<dwarf::encap::attribute_value::weak_ref> >
-		out_edges(std::pair<dwarf::lib::Dwarf_Off, std::shared_ptr<dwarf::encap::die> >, const dwarf::encap::dieset&);	
+		out_edges(std::pair<dwarf::lib::Dwarf_Off, dwarf::spec::adt_ptr<dwarf::encap::die> >, const dwarf::encap::dieset&);	
 	} namespace dwarf { namespace encap {
 
 		// lenses for generating 
@@ -337,28 +444,35 @@ namespace dwarf {
 			friend struct die_out_edge_iterator<attribute_value::weak_ref>; // in encap_graph.hpp
 			friend class factory;
 			friend class dieset;
+			friend class snapshot;
 			friend class dwarf3_factory_t; // HACK
 			friend std::pair<
 				die_out_edge_iterator<attribute_value::weak_ref>, 
 				die_out_edge_iterator<attribute_value::weak_ref> > 
-			boost::out_edges(std::pair<dwarf::lib::Dwarf_Off, std::shared_ptr<dwarf::encap::die> >, const dwarf::encap::dieset&);
+			boost::out_edges(std::pair<dwarf::lib::Dwarf_Off, dwarf::spec::adt_ptr<dwarf::encap::die> >, const dwarf::encap::dieset&);
 		protected:
 			/* TODO: make this a handle/body implementation, to allow copying of DIEs
 			 * without unnecessarily copying those vectors and maps around. */
 			dieset& m_ds;
-			shared_ptr<die> p_parent;
+			adt_ptr<die> p_parent;
 			Dwarf_Half m_tag;
 			Dwarf_Off m_offset;
 			Dwarf_Off cu_offset;
 		public:
-			std::map<Dwarf_Half, attribute_value> m_attrs;
+			/* How a DIE stores its attributes. Define DWARFPP_ENCAP_STD_MAP_ATTRS
+			 * to get the old std::map, whose iterators survive insertions. */
+#ifdef DWARFPP_ENCAP_STD_MAP_ATTRS
+			typedef std::map<Dwarf_Half, attribute_value> attribute_map;
+#else
+			typedef small_attr_map<attribute_value> attribute_map;
+#endif
+			attribute_map m_attrs;
 		protected:
 			std::set<Dwarf_Off> m_children;
-			void attach_child(std::shared_ptr<encap::basic_die> p);
+			void attach_child(adt_ptr<encap::basic_die> p);
 			
 		public:
 			typedef dwarf::encap::factory factory_type;
-			typedef std::map<Dwarf_Half, attribute_value> attribute_map;
 			
 			
 			struct is_ref_attr_t : public std::unary_function<attribute_map::value_type, bool>
@@ -416,8 +530,8 @@ namespace dwarf {
 				const attribute_map& attrs, const set<Dwarf_Off>& children) :
 				m_ds(ds), 
 				p_parent((offset == 0UL) 
-					? shared_ptr<encap::die>()
-					: dynamic_pointer_cast<encap::die>(m_ds[parent])), 
+					? adt_ptr<encap::die>()
+					: adt_cast<encap::die>(m_ds[parent])), 
 				m_tag(tag), m_offset(offset), 
 				cu_offset(cu_offset), m_attrs(attrs), m_children(children) 
 				{ assert(offset == 0UL || p_parent); }
@@ -462,7 +576,8 @@ namespace dwarf {
 						
 			Dwarf_Off get_offset() const { return m_offset; }
 				
-			attribute_map get_attrs() { return m_attrs; } // copying
+			std::map<Dwarf_Half, attribute_value> get_attrs() // copying
+			{ return std::map<Dwarf_Half, attribute_value>(m_attrs.begin(), m_attrs.end()); }
 			attribute_map& attrs() { return m_attrs; }
 			const attribute_map& const_attrs() const { return m_attrs; }
 			
@@ -470,11 +585,11 @@ namespace dwarf {
 			Dwarf_Half set_tag(Dwarf_Half v) { return m_tag = v; }
 			
 			Dwarf_Off parent_offset() const { return p_parent->get_offset(); }
-			std::shared_ptr<spec::basic_die> get_parent() { return /*m_ds[m_parent];*/ p_parent; }
+			adt_ptr<spec::basic_die> get_parent() { return /*m_ds[m_parent];*/ p_parent; }
 			Dwarf_Off get_first_child_offset() const
 			{ if (m_children.size() > 0) return *m_children.begin();
 			  else throw lib::No_entry(); }
-			std::shared_ptr<spec::basic_die> get_first_child() 
+			adt_ptr<spec::basic_die> get_first_child() 
 			{ return m_ds[get_first_child_offset()]; }
 
 			Dwarf_Off get_next_sibling_offset() const
@@ -486,7 +601,7 @@ namespace dwarf {
 				assert(*found != m_offset);
 				return *found; 
 			}
-			std::shared_ptr<spec::basic_die> get_next_sibling()
+			adt_ptr<spec::basic_die> get_next_sibling()
 			{
 				return m_ds[get_next_sibling_offset()]; 
 			}
@@ -500,14 +615,15 @@ namespace dwarf {
 			const attribute_value& get_attr(Dwarf_Half at) const { return (*this)[at]; }
 			const attribute_value& operator[] (Dwarf_Half at) const 
 			{ 
-				if (has_attr(at)) return m_attrs.find(at)->second; 
+				auto found = m_attrs.find(at);
+				if (found != m_attrs.end()) return found->second; 
 				else throw No_entry();
 			}
 			attribute_value& put_attr(Dwarf_Half attr, attribute_value val); 
 			//attribute_value& put_attr(Dwarf_Half attr, 
 			//	Die_encap_base& target);
 			attribute_value& put_attr(Dwarf_Half attr, 
-				std::shared_ptr<basic_die> target);
+				adt_ptr<basic_die> target);
 
 			opt<std::string> 
 			get_name() const { 
@@ -549,7 +665,7 @@ namespace dwarf {
 				{ Dwarf_Half t; d.tag(&t); assert(t == DW_TAG_ ## fragment); } \
 	public: \
 			/* "create" constructor */ \
-	fragment ## _die(shared_ptr<encap::basic_die> parent, \
+	fragment ## _die(adt_ptr<encap::basic_die> parent, \
 				opt<std::string> name = opt<string>()) \
 			 :	basic_die(parent->get_ds(), parent->get_offset(), DW_TAG_ ## fragment, \
 			 	parent->get_ds().next_free_offset(),  \
@@ -576,27 +692,27 @@ namespace dwarf {
 #define stored_type_tag Dwarf_Half
 #define stored_type_loclist dwarf::encap::loclist
 #define stored_type_address dwarf::encap::attribute_value::address
-#define stored_type_refdie std::shared_ptr<spec::basic_die> 
-#define stored_type_refdie_is_type std::shared_ptr<spec::type_die> 
+#define stored_type_refdie adt_ptr<spec::basic_die> 
+#define stored_type_refdie_is_type adt_ptr<spec::type_die> 
 #define stored_type_rangelist dwarf::encap::rangelist
 
 #define attr_optional(name, stored_t) \
 	opt<stored_type_ ## stored_t> get_ ## name() const \
 	{ if (has_attr(DW_AT_ ## name)) return (*this)[DW_AT_ ## name].get_ ## stored_t (); \
 	  else return opt< stored_type_ ## stored_t>(); } \
-	std::shared_ptr<self_type> set_ ## name(opt<stored_type_ ## stored_t> arg) { \
+	adt_ptr<self_type> set_ ## name(opt<stored_type_ ## stored_t> arg) { \
 	if (arg) put_attr(DW_AT_ ## name, encap::attribute_value(this->m_ds, deref_opt(arg))); \
 	else m_attrs.erase(DW_AT_ ## name); \
-	return std::dynamic_pointer_cast<self_type>(this->shared_from_this()); }
+	return adt_cast<self_type>(this->shared_from_this()); }
 
 #define super_attr_optional(name, stored_t) attr_optional(name, stored_t)
 
 #define attr_mandatory(name, stored_t) \
 	stored_type_ ## stored_t get_ ## name() const \
 	{ assert (has_attr(DW_AT_ ## name)); return (*this)[DW_AT_ ## name].get_ ## stored_t (); } \
-	/*std::shared_ptr<self_type>*/ void set_ ## name(stored_type_ ## stored_t arg) { \
+	/*adt_ptr<self_type>*/ void set_ ## name(stored_type_ ## stored_t arg) { \
 	put_attr(DW_AT_ ## name, encap::attribute_value(this->m_ds, arg)); \
-	/* return std::dynamic_pointer_cast<self_type>(this->shared_from_this());*/ }
+	/* return adt_cast<self_type>(this->shared_from_this());*/ }
 // HACK: don't use shared_from_this until its interaction with multiple inheritance
 // is fixed <http://lists.boost.org/Archives/boost/2010/11/173366.php>
 
@@ -679,12 +795,12 @@ namespace dwarf {
 
 			// manually defined because they don't map to DWARF attributes
 			Dwarf_Off get_offset() const { return m_offset; }
-			std::shared_ptr<self> get_parent() const 
+			adt_ptr<self> get_parent() const 
 			{ 
 				//auto found = m_ds.map_find(m_parent); 
 				//assert(found != m_ds.map_end()); 
-				//return dynamic_pointer_cast<basic_die>(found->second); 
-				return dynamic_pointer_cast<encap::basic_die>(p_parent);
+				//return adt_cast<basic_die>(found->second); 
+				return adt_cast<encap::basic_die>(p_parent);
 			}
 			Dwarf_Half get_tag() const { return m_tag; }
 			
@@ -708,7 +824,7 @@ namespace dwarf {
 							<< this->get_ds().get_spec().attr_lookup(i->first)
 							<< " refers to nonexistent DIE offset 0x" << std::hex << target
 							<< " in " 
-							<< *dynamic_pointer_cast<encap::die, spec::basic_die>(
+							<< *adt_cast<encap::die, spec::basic_die>(
 								this->get_ds()[i->second.get_ref().referencing_off]
 								)
 							<< std::endl;
@@ -777,27 +893,33 @@ namespace dwarf {
 			// convenience forwarder
 			static factory& for_spec(const dwarf::spec::abstract_def& spec); 
 		protected:
-			void attach_to_ds(std::shared_ptr<basic_die> p) const
+			void attach_to_ds(adt_ptr<basic_die> p) const
 			{ 
 				assert(p->get_ds().find(p->parent_offset()) != p->get_ds().end());
-				dynamic_pointer_cast<encap::basic_die>(p->get_ds()[p->parent_offset()])
+				adt_cast<encap::basic_die>(p->get_ds()[p->parent_offset()])
 					->attach_child(p);
 			}
 			template<typename T, typename... Args > 
-			std::shared_ptr<encap::basic_die>
+			adt_ptr<encap::basic_die>
 			my_make_shared(Args&&... args) const
-			{ std::shared_ptr<encap::basic_die> p(new T(std::forward<Args>(args)...)); return p; }
-			virtual std::shared_ptr<die> encapsulate_die(Dwarf_Half tag, 
+			{ adt_ptr<encap::basic_die> p(new T(std::forward<Args>(args)...)); return p; }
+			virtual adt_ptr<die> encapsulate_die(Dwarf_Half tag, 
 				dieset& ds, lib::die& d, Dwarf_Off parent_off) const = 0;
 		public:
 			virtual 
-			std::shared_ptr<basic_die> 
-			create_die(Dwarf_Half tag, shared_ptr<basic_die> parent,
+			adt_ptr<basic_die> 
+			create_die(Dwarf_Half tag, adt_ptr<basic_die> parent,
 				opt<std::string> name 
 					= opt<std::string>()) const = 0;
 			virtual
-			std::shared_ptr<basic_die>
-			clone_die(dieset& dest_ds, std::shared_ptr<basic_die> p_d) const = 0;
+			adt_ptr<basic_die>
+			clone_die(dieset& dest_ds, adt_ptr<basic_die> p_d) const = 0;
+			/* Make a DIE with no attributes yet, of the right class for tag,
+			 * and attach it under parent_off (for restoring snapshots). */
+			virtual
+			adt_ptr<basic_die>
+			restore_die(dieset& ds, Dwarf_Half tag, Dwarf_Off parent_off,
+				Dwarf_Off offset, Dwarf_Off cu_offset) const = 0;
 		};
 	} // end namespace encap
 } // end namespace dwarf
@@ -154,7 +154,7 @@ namespace boost
                     	*const_cast<dwarf::encap::basic_die&>(g).children_begin()
                       )
 	        	).find_sibling_ancestor_of(
-                    std::dynamic_pointer_cast<dwarf::encap::basic_die>((*e.p_ds)[e.referencing_off])
+                    dwarf::spec::adt_cast<dwarf::encap::basic_die>((*e.p_ds)[e.referencing_off])
                 )
             )
         );
@@ -171,9 +171,9 @@ namespace boost
         auto begin_iter = g_nonconst.children_begin();
         dwarf::encap::basic_die *begin_ptr = dynamic_cast<dwarf::encap::basic_die *>(begin_iter->get());
         dwarf::encap::basic_die& base_ref = *begin_ptr;
-        return std::dynamic_pointer_cast<dwarf::encap::basic_die>(
+        return dwarf::spec::adt_cast<dwarf::encap::basic_die>(
         	base_ref.find_sibling_ancestor_of(
-        		std::dynamic_pointer_cast<dwarf::encap::basic_die>((*e.p_ds)[e.off]))
+        		dwarf::spec::adt_cast<dwarf::encap::basic_die>((*e.p_ds)[e.off]))
                 ).get();
     }
     
@@ -211,13 +211,9 @@ namespace boost
     	graph_traits<dwarf::encap::basic_die>::vertex_descriptor u,
         const dwarf::encap::basic_die& g)
     {
-    	// HACK: we shouldn't really do this
         unsigned count = 0;
-        dwarf::encap::basic_die& vg = const_cast<dwarf::encap::basic_die&>(g);
-        dwarf::encap::die::attribute_map::iterator attrs_end = vg.m_attrs.end();
         for (graph_traits<dwarf::encap::basic_die>::out_edge_iterator i = 
         		out_edges(u, g).first;
-        			///*i != attrs_end*/true;
                     i != out_edges(u, g).second;
                     i++) count++;
         return count;
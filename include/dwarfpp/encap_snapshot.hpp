@@ -0,0 +1,141 @@
+/* dwarfpp: C++ binding for a useful subset of libdwarf, plus extra goodies.
+ *
+ * encap_snapshot.hpp: saving an encap::dieset to a binary file, and
+ * rebuilding it from that file without going through libdwarf.
+ *
+ * Copyright (c) 2013, Stephen Kell.
+ */
+
+#ifndef DWARFPP_ENCAP_SNAPSHOT_HPP_
+#define DWARFPP_ENCAP_SNAPSHOT_HPP_
+
+#include <string>
+#include <memory>
+#include <cstdint>
+#include "encap.hpp"
+
+namespace dwarf
+{
+	namespace encap
+	{
+		using std::string;
+		using std::shared_ptr;
+
+		/* encap::file's constructor encapsulates every DIE through libdwarf,
+		 * which on a big binary takes far longer than reading the result back
+		 * would. A snapshot is the result, written out once: every DIE with
+		 * its attributes (including location and range lists) and the dieset's
+		 * backrefs. Restoring one just allocates the DIEs again.
+		 *
+		 * Like the name index, a snapshot records the build-id of the binary
+		 * it came from, and open() refuses a file for any other build-id. The
+		 * layout is host-endian and fixed-width, so it can be used straight
+		 * from the mapping:
+		 *
+		 *     header
+		 *     die_rec[ndies]          depth-first, so parents come first
+		 *     attr_rec[nattrs]        each DIE's are contiguous, in attribute order
+		 *     cu_rec[ncus]            each CU's DIEs are a contiguous run of the above
+		 *     backref_rec[nbackrefs]  grouped by target, in list order
+		 *     heap                    strings, blocks, location and range lists
+		 *
+		 * Heap items start 8-byte aligned. A location list is a uint64_t count
+		 * of expressions, then for each, lopc, hipc and an instruction count,
+		 * then four uint64_ts per instruction (atom, number, number2, offset).
+		 * A range list is three uint64_ts per range (addr1, addr2, type). */
+		class snapshot
+		{
+		public:
+			struct header
+			{
+				char magic[8]; // "DWPPSNP1"
+				uint32_t version;
+				uint32_t build_id_len;
+				unsigned char build_id[64];
+				uint64_t ndies, dies_off;
+				uint64_t nattrs, attrs_off;
+				uint64_t ncus, cus_off;
+				uint64_t nbackrefs, backrefs_off;
+				uint64_t heap_off, heap_len;
+				uint64_t last_monotonic_offset;
+			};
+			struct die_rec
+			{
+				uint64_t offset;
+				uint64_t parent;
+				uint64_t cu_offset;
+				uint64_t first_attr;
+				uint32_t nattrs;
+				uint16_t tag;
+				uint16_t unused;
+			};
+			/* What a and b hold depends on form, an attribute_value::form:
+			 * the value itself for FLAG, UNSIGNED, SIGNED and ADDR; the target
+			 * offset and whether it is global, for REF; a heap offset and a
+			 * length in bytes (STRING, BLOCK) or in items (LOCLIST, RANGELIST). */
+			struct attr_rec
+			{
+				uint64_t a;
+				uint64_t b;
+				uint16_t attr;
+				uint16_t orig_form;
+				uint8_t form;
+				uint8_t unused[3];
+			};
+			struct cu_rec
+			{
+				uint64_t first_die;
+				uint64_t ndies; // including the CU DIE itself
+			};
+			struct backref_rec
+			{
+				uint64_t target;
+				uint64_t referencing_off;
+				uint16_t referencing_attr; // 0 for the parent--child link
+				uint16_t unused[3];
+			};
+			static const uint32_t VERSION = 1;
+			static_assert(sizeof (header) % 8 == 0 && sizeof (die_rec) % 8 == 0
+				&& sizeof (attr_rec) % 8 == 0 && sizeof (cu_rec) % 8 == 0
+				&& sizeof (backref_rec) % 8 == 0, "records must stay 8-byte aligned");
+		private:
+			void *mapping;
+			size_t mapping_length;
+			const header *p_header;
+			const die_rec *dies;
+			const attr_rec *attrs;
+			const cu_rec *cus;
+			const backref_rec *backrefs;
+			const unsigned char *heap;
+			snapshot() : mapping(nullptr), mapping_length(0), p_header(nullptr),
+				dies(nullptr), attrs(nullptr), cus(nullptr), backrefs(nullptr), heap(nullptr) {}
+			bool check() const;
+			bool check_heap_item(const attr_rec& a) const;
+			attribute_value value_of(dieset& ds, const die_rec& d, const attr_rec& a) const;
+		public:
+			~snapshot();
+			snapshot(const snapshot&) = delete;
+			snapshot& operator=(const snapshot&) = delete;
+
+			/* Map a snapshot, checking it is well-formed and was written for a
+			 * binary with this build-id. Returns null otherwise. */
+			static shared_ptr<snapshot> open(const string& path, const string& build_id);
+			/* Write ds to path, via a temporary which we rename into place.
+			 * Returns false on failure (including if there is no build-id). */
+			static bool write(dieset& ds, const string& build_id, const string& path);
+			/* Alongside the name index for this build-id (see name_index.hpp). */
+			static string default_path(const string& build_id);
+
+			uint64_t die_count() const { return p_header->ndies; }
+			uint64_t cu_count() const { return p_header->ncus; }
+			Dwarf_Off last_monotonic_offset() const { return p_header->last_monotonic_offset; }
+
+			/* Rebuild one CU's DIEs in ds, whose toplevel must already exist. */
+			void restore_cu(dieset& ds, uint64_t cu_idx) const;
+			/* Rebuild everything into an otherwise-empty ds. */
+			void restore(dieset& ds) const;
+		};
+	}
+}
+
+#endif
@@ -0,0 +1,212 @@
+/* dwarfpp: C++ binding for a useful subset of libdwarf, plus extra goodies.
+ *
+ * flat_offset_map.hpp: an offset-keyed map kept in one sorted vector,
+ * used to store the DIEs of an encap::dieset.
+ *
+ * Copyright (c) 2013, Stephen Kell.
+ */
+
+#ifndef DWARFPP_FLAT_OFFSET_MAP_HPP_
+#define DWARFPP_FLAT_OFFSET_MAP_HPP_
+
+#include <vector>
+#include <utility>
+#include <algorithm>
+#include <cassert>
+#include <boost/iterator/filter_iterator.hpp>
+#include "private/libdwarf.hpp"
+
+namespace dwarf
+{
+	namespace encap
+	{
+		/* This does the subset of std::map<Dwarf_Off, Value> that dieset uses,
+		 * but keeps the entries in one vector sorted by offset, so there's no
+		 * tree node per entry and in-order walks are linear scans. Finding an
+		 * offset is a binary search.
+		 *
+		 * Value must be something like a pointer, whose null value is never
+		 * stored. Erasing leaves a tombstone: the slot keeps its offset, but
+		 * its value is null, and iterators skip it. Inserting reuses a
+		 * tombstone if one is in the right place (the exact offset, or either
+		 * neighbour of where the new offset goes); otherwise it is a push_back
+		 * for the usual case of a new highest offset, or a shift of the rest
+		 * of the vector. When tombstones outnumber live entries, we squeeze
+		 * them out.
+		 *
+		 * Shifting would make loading many entries below existing ones (e.g.
+		 * a lazily loaded CU's DIEs) quadratic. So between begin_run() and
+		 * end_run(), new entries with increasing offsets are appended after
+		 * the sorted slots, and end_run() merges them in, in one go. During
+		 * a run, only find() and insert() may be used.
+		 *
+		 * NOTE: unlike std::map, inserting or erasing invalidates iterators. */
+		template <typename Value>
+		class flat_offset_map
+		{
+		public:
+			typedef lib::Dwarf_Off key_type;
+			typedef Value mapped_type;
+			typedef std::pair<key_type, Value> value_type;
+			typedef typename std::vector<value_type>::size_type size_type;
+		private:
+			typedef std::vector<value_type> storage_type;
+			storage_type slots;
+			size_type live;
+			bool running; // in a run, slots from run_begin on are the run
+			size_type run_begin;
+			struct is_live
+			{
+				bool operator()(const value_type& v) const { return static_cast<bool>(v.second); }
+			};
+			struct key_less
+			{
+				bool operator()(const value_type& v, key_type k) const { return v.first < k; }
+				bool operator()(key_type k, const value_type& v) const { return k < v.first; }
+			};
+			typename storage_type::iterator slot_lower_bound(key_type k)
+			{ return std::lower_bound(slots.begin(), slots.end(), k, key_less()); }
+			typename storage_type::const_iterator slot_lower_bound(key_type k) const
+			{ return std::lower_bound(slots.begin(), slots.end(), k, key_less()); }
+			// the live slot for k, or slots.end(), searching the run too
+			typename storage_type::iterator find_slot(key_type k)
+			{
+				auto sorted_end = running ? slots.begin() + run_begin : slots.end();
+				auto found = std::lower_bound(slots.begin(), sorted_end, k, key_less());
+				if (found != sorted_end && found->first == k && found->second) return found;
+				if (!running) return slots.end();
+				found = std::lower_bound(sorted_end, slots.end(), k, key_less());
+				return (found != slots.end() && found->first == k) ? found : slots.end();
+			}
+			void maybe_compact()
+			{
+				if (slots.size() - live <= live) return;
+				slots.erase(std::remove_if(slots.begin(), slots.end(),
+					[](const value_type& v) { return !v.second; }), slots.end());
+			}
+		public:
+			typedef boost::filter_iterator<is_live, typename storage_type::iterator> iterator;
+			typedef boost::filter_iterator<is_live, typename storage_type::const_iterator> const_iterator;
+
+			flat_offset_map() : live(0), running(false), run_begin(0) {}
+
+			iterator begin() { assert(!running); return iterator(is_live(), slots.begin(), slots.end()); }
+			iterator end() { return iterator(is_live(), slots.end(), slots.end()); }
+			const_iterator begin() const { assert(!running); return const_iterator(is_live(), slots.begin(), slots.end()); }
+			const_iterator end() const { return const_iterator(is_live(), slots.end(), slots.end()); }
+			size_type size() const { return live; }
+			bool empty() const { return live == 0; }
+			void reserve(size_type n) { slots.reserve(n); }
+
+			iterator lower_bound(key_type k)
+			{ assert(!running); return iterator(is_live(), slot_lower_bound(k), slots.end()); }
+			const_iterator lower_bound(key_type k) const
+			{ assert(!running); return const_iterator(is_live(), slot_lower_bound(k), slots.end()); }
+			iterator upper_bound(key_type k)
+			{
+				assert(!running);
+				return iterator(is_live(), std::upper_bound(slots.begin(), slots.end(), k, key_less()), slots.end());
+			}
+			const_iterator upper_bound(key_type k) const
+			{
+				assert(!running);
+				return const_iterator(is_live(), std::upper_bound(slots.begin(), slots.end(), k, key_less()), slots.end());
+			}
+
+			iterator find(key_type k)
+			{
+				auto found = find_slot(k);
+				if (found == slots.end()) return end();
+				return iterator(is_live(), found, slots.end());
+			}
+			const_iterator find(key_type k) const
+			{
+				typename storage_type::const_iterator found = const_cast<flat_offset_map *>(this)->find_slot(k);
+				if (found == slots.end()) return end();
+				return const_iterator(is_live(), found, slots.end());
+			}
+
+			void begin_run() { assert(!running); running = true; run_begin = slots.size(); }
+			void end_run()
+			{
+				assert(running);
+				running = false;
+				if (run_begin == slots.size() || run_begin == 0
+					|| slots[run_begin - 1].first < slots[run_begin].first) return; // in order already
+				/* Squeeze out the tombstones first, since the run may have
+				 * reused their offsets. */
+				auto sorted_end = std::remove_if(slots.begin(), slots.begin() + run_begin,
+					[](const value_type& v) { return !v.second; });
+				size_type merge_at = sorted_end - slots.begin();
+				slots.erase(sorted_end, slots.begin() + run_begin);
+				std::inplace_merge(slots.begin(), slots.begin() + merge_at, slots.end(),
+					[](const value_type& v1, const value_type& v2) { return v1.first < v2.first; });
+			}
+
+			std::pair<iterator, bool> insert(const value_type& v)
+			{
+				assert(v.second);
+				if (running)
+				{
+					auto found = find_slot(v.first);
+					if (found != slots.end()) return std::make_pair(iterator(is_live(), found, slots.end()), false);
+					if (slots.size() == run_begin || slots.back().first < v.first)
+					{
+						slots.push_back(v);
+						++live;
+						return std::make_pair(iterator(is_live(), slots.end() - 1, slots.end()), true);
+					}
+					// out of order, so merge what we have, and start a new run after this
+					end_run();
+					auto ret = insert(v);
+					begin_run();
+					return ret;
+				}
+				typename storage_type::iterator pos;
+				if (slots.empty() || slots.back().first < v.first)
+				{
+					// the common case: a new highest offset
+					if (!slots.empty() && !slots.back().second) pos = slots.end() - 1;
+					else { slots.push_back(v); ++live; return std::make_pair(iterator(is_live(), slots.end() - 1, slots.end()), true); }
+				}
+				else
+				{
+					pos = slot_lower_bound(v.first);
+					if (pos->first == v.first && pos->second) return std::make_pair(iterator(is_live(), pos, slots.end()), false);
+					if (!(pos->first == v.first || !pos->second))
+					{
+						// can we have the tombstone just before?
+						if (pos != slots.begin() && !(pos - 1)->second) --pos;
+						else pos = slots.insert(pos, value_type(v.first, Value()));
+					}
+				}
+				// pos is a tombstone we can use without disturbing the order
+				*pos = v;
+				++live;
+				return std::make_pair(iterator(is_live(), pos, slots.end()), true);
+			}
+			iterator insert(iterator hint, const value_type& v) { return insert(v).first; }
+
+			void erase(iterator first, iterator last)
+			{
+				assert(!running);
+				for (auto i = first.base(); i != last.base(); ++i)
+				{
+					if (i->second) { i->second = Value(); --live; }
+				}
+				maybe_compact();
+			}
+			void erase(iterator pos) { iterator next = pos; erase(pos, ++next); }
+			size_type erase(key_type k)
+			{
+				iterator found = find(k);
+				if (found == end()) return 0;
+				erase(found);
+				return 1;
+			}
+			void clear() { slots.clear(); live = 0; running = false; }
+		};
+	}
+}
+
+#endif
@@ -14,10 +14,17 @@
 #include <stack>
 #include <vector>
 #include <queue>
+#include <map>
+#include <list>
+#include <unordered_map>
+#include <cstdint>
+#include <cstddef>
+#include <functional>
 #include <cassert>
 #include <boost/optional.hpp>
 #include <boost/icl/interval_map.hpp>
 #include <boost/smart_ptr/intrusive_ptr.hpp>
+#include <boost/utility/string_ref.hpp>
 #include <boost/iterator/iterator_facade.hpp>
 #include <boost/iterator/filter_iterator.hpp>
 #include <srk31/selective_iterator.hpp>
@@ -64,6 +71,7 @@ namespace dwarf
 		using std::deque;
 		using boost::optional;
 		using boost::intrusive_ptr;
+		using boost::string_ref;
 		using std::dynamic_pointer_cast;
 		
 		using dwarf::spec::opt;
@@ -85,6 +93,13 @@ namespace dwarf
 		struct iterator_base;
 		
 		struct dwarf3_factory_t;
+		struct payload_arena;
+		
+		class native_root_die; // see native.hpp
+		class name_index; // see name_index.hpp
+		class accel_index; // see accel.hpp
+		struct native_die;
+		struct unit_header;
 
 		struct basic_die;
 		struct compile_unit_die;
@@ -139,6 +154,7 @@ namespace dwarf
 		{
 			friend struct iterator_base;
 			friend class root_die;
+			friend struct payload_cache; // looks at refcount, for pinning
 		protected:
 			// we need to embed a refcount
 			unsigned refcount;
@@ -188,20 +204,29 @@ namespace dwarf
 			// and therefore have our own r, we should delegate with that one. 
 			
 			// protected constructor constructing dummy instances only
-			inline basic_die(spec& s): d(nullptr, 0), s(s) {}
+			inline basic_die(spec& s): refcount(0), d(nullptr, 0), s(s) {}
 			// protected constructor that is never actually used, but 
 			// required to avoid special-casing in macros -- see begin_class() macro
-			inline basic_die() : d(nullptr, nullptr), s(::dwarf::spec::DEFAULT_DWARF_SPEC) 
+			inline basic_die() : refcount(0), d(nullptr, nullptr), s(::dwarf::spec::DEFAULT_DWARF_SPEC) 
 			{ assert(false); }
 			friend struct dwarf3_factory_t;
 		public:
 			inline basic_die(spec& s, Die&& h)
-			 : d(std::move(h)), s(s) {}
+			 : refcount(0), d(std::move(h)), s(s) {}
 			
 			friend std::ostream& operator<<(std::ostream& s, const basic_die& d);
 			friend void intrusive_ptr_add_ref(basic_die *p);
 			friend void intrusive_ptr_release(basic_die *p);
 			
+			/* The factory puts payloads in their CU's region of the root's
+			 * payload_arena (see below), using the placement form. Plain new
+			 * still works, e.g. for subclasses made elsewhere; either way,
+			 * delete does the right thing. */
+			static void *operator new(size_t sz);
+			static void *operator new(size_t sz, payload_arena& a, Dwarf_Off cu_off);
+			static void operator delete(void *p);
+			static void operator delete(void *p, payload_arena& a, Dwarf_Off cu_off);
+			
 			virtual ~basic_die() {}
 			
 			/* implement the abstract_die interface 
@@ -209,7 +234,7 @@ namespace dwarf
 			inline Dwarf_Off get_offset() const { assert(d.handle); return d.offset_here(); }
 			inline Dwarf_Half get_tag() const { assert(d.handle); return d.tag_here(); }
 			inline opt<string> get_name() const 
-			{ assert(d.handle); return opt<string>(string(d.name_here().get())); }
+			{ assert(d.handle); auto n = d.name_view_here(); return n.data() ? opt<string>(n.to_string()) : opt<string>(); }
 			inline unique_ptr<const char, string_deleter> get_raw_name() const
 			{ assert(d.handle); return d.name_here(); }
 			inline Dwarf_Off get_enclosing_cu_offset() const 
@@ -237,11 +262,303 @@ namespace dwarf
 		template <typename DerefAs = basic_die> struct iterator_bf;
 		template <typename DerefAs = basic_die> struct iterator_sibs;
 		
-		//template <typename Pred, typename DerefAs = basic_die> 
+		//template <typename Pred, typename DerefAs = basic_die>
 		//using iterator_sibs_where
 		// = boost::filter_iterator< Pred, iterator_sibs<DerefAs> >;
-		
-		// FIXME: this is not libdwarf-agnostic! 
+
+		/* The parent cache. This used to be a map<Dwarf_Off, Dwarf_Off>, i.e.
+		 * one heap node per DIE we ever issued, kept for the lifetime of the root.
+		 * Instead we keep one flat table per CU, sorted by offset, storing
+		 * CU-relative offsets in 32 bits (a non-DWARF64 CU can't be bigger).
+		 * Depth-first traversal issues DIEs in offset order, so inserts are
+		 * almost always appends; breadth-first traversal doesn't, so we stash
+		 * out-of-order inserts and merge them in on the next lookup.
+		 *
+		 * We keep a table for every CU we've issued DIEs from, until the total
+		 * number of entries goes over a budget; only then do we drop tables,
+		 * least recently used first. (Bounding the number of tables instead
+		 * made traversals that alternate between CUs, like breadth-first,
+		 * miss on almost every lookup.) So the cache is soft: a miss does
+		 * *not* mean the DIE wasn't issued by us.
+		 * root_die::find_parent_offset() re-derives the parent in that case. */
+		struct parent_cache
+		{
+			struct entry
+			{
+				uint32_t off;    // relative to the CU DIE's offset
+				uint32_t parent; // ditto, or NO_PARENT for the CU DIE itself
+				bool operator<(const entry& e) const { return off < e.off; }
+			};
+			static const uint32_t NO_PARENT = ~(uint32_t)0;
+			struct cu_table
+			{
+				vector<entry> sorted;
+				vector<entry> unsorted; // pending out-of-order inserts
+				std::list<Dwarf_Off>::iterator lru_pos;
+				size_t merge_pending(); // returns how many entries went away
+				size_t size() const { return sorted.size() + unsorted.size(); }
+			};
+			static const size_t DEFAULT_MAX_ENTRIES = 1u<<22; // 32MB of entries
+		private:
+			map<Dwarf_Off, cu_table> tables; // keyed by CU DIE offset
+			std::list<Dwarf_Off> recently_used;  // front is most recent
+			size_t n_entries;
+			size_t max_entries;
+			cu_table& table_for(Dwarf_Off cu_off);
+			void evict_over_budget();
+		public:
+			parent_cache(size_t max_entries = DEFAULT_MAX_ENTRIES)
+			 : n_entries(0), max_entries(max_entries) {}
+
+			/* cu_off is the offset of the CU DIE containing off;
+			 * for the CU DIE itself, cu_off == off and parent_off == 0. */
+			void insert(Dwarf_Off cu_off, Dwarf_Off off, Dwarf_Off parent_off);
+			optional<Dwarf_Off> find(Dwarf_Off off);
+			void drop(Dwarf_Off cu_off);
+			void clear() { tables.clear(); recently_used.clear(); n_entries = 0; }
+
+			size_t get_max_entries() const { return max_entries; }
+			void set_max_entries(size_t n) { assert(n > 0); max_entries = n; evict_over_budget(); }
+			unsigned size() const { return n_entries; } // entries, for diagnostics
+			unsigned table_count() const { return tables.size(); }
+		};
+
+		/* libdwarf only lets us walk CU headers forwards, one at a time,
+		 * so seeking to an arbitrary CU used to cost O(#CUs). Instead we walk
+		 * them once, recording each header, and keep the result sorted by
+		 * CU DIE offset. It's immutable once built. */
+		struct cu_index
+		{
+			struct record
+			{
+				Dwarf_Off cu_die_offset; // what offset_here() says for the CU DIE
+				Dwarf_Unsigned cu_header_length;
+				Dwarf_Half version_stamp;
+				Dwarf_Unsigned abbrev_offset;
+				Dwarf_Half address_size;
+				Dwarf_Half offset_size;
+				Dwarf_Half extension_size;
+				Dwarf_Unsigned next_cu_header; // as libdwarf reports it
+				bool operator<(const record& r) const { return cu_die_offset < r.cu_die_offset; }
+			};
+			vector<record> records;
+
+			/* These return nullptr if there's no such CU. */
+			const record *find(Dwarf_Off cu_die_off) const;
+			const record *next_after(Dwarf_Off cu_die_off) const; // 0 means "before the first"
+			const record *containing(Dwarf_Off off) const; // the last CU starting at or before off
+		};
+
+		/* Hashes of children's names, for DIEs we've looked up named children
+		 * in. Each table maps a name to the first child with that name, so
+		 * answers match the linear search. Like parent_cache, we bound the
+		 * total number of entries, not the number of tables (one scope can
+		 * have hundreds of thousands of children), dropping the oldest
+		 * tables first; name lookups tend to hit the same few scopes. The
+		 * newest table is always kept, even if it is over budget on its own,
+		 * since big scopes are where the hashing pays off most. */
+		struct child_name_cache
+		{
+			typedef std::unordered_map<string, Dwarf_Off> table;
+			static const size_t DEFAULT_MAX_ENTRIES = 1u<<18; // ~16MB, names included
+		private:
+			std::unordered_map<Dwarf_Off, table> tables; // keyed by parent offset
+			deque<Dwarf_Off> order; // front is oldest
+			size_t n_entries;
+			size_t max_entries;
+			void evict_over_budget();
+		public:
+			child_name_cache(size_t max_entries = DEFAULT_MAX_ENTRIES)
+			 : n_entries(0), max_entries(max_entries) {}
+			const table *find(Dwarf_Off parent_off) const;
+			/* Takes a filled-in table. Returns the kept copy. */
+			const table *insert(Dwarf_Off parent_off, table&& t);
+			void clear() { tables.clear(); order.clear(); n_entries = 0; }
+
+			size_t get_max_entries() const { return max_entries; }
+			void set_max_entries(size_t n) { max_entries = n; evict_over_budget(); }
+			size_t size() const { return n_entries; } // entries, for diagnostics
+			unsigned table_count() const { return tables.size(); }
+		};
+
+		/* A skeleton of the whole DIE tree: an entry per DIE, in offset order,
+		 * holding just what we need to position an iterator (depth and parent)
+		 * without walking down from the root. It's optional, because building
+		 * it means one pass over the whole file (done natively if we can), and
+		 * it costs 16 bytes per DIE. See root_die::build_skeleton_index(). */
+		struct skeleton_index
+		{
+			struct entry
+			{
+				Dwarf_Off off;
+				uint32_t depth;
+				uint32_t parent; // index into entries, or NO_PARENT for CU DIEs
+				bool operator<(const entry& e) const { return off < e.off; }
+			};
+			static const uint32_t NO_PARENT = ~(uint32_t)0;
+			vector<entry> entries;
+			
+			const entry *find(Dwarf_Off off) const; // null if no DIE starts at off
+			Dwarf_Off parent_offset(const entry& e) const
+			{ return (e.parent == NO_PARENT) ? 0UL : entries[e.parent].off; }
+		};
+
+		/* A file-wide map from file-relative addresses to the CUs, subprograms
+		 * and static variables covering them, i.e. what each one's
+		 * with_static_location_die::file_relative_intervals() says (from
+		 * low/high pc, DW_AT_ranges or a static DW_AT_location). Each kind has
+		 * its own flat array of entries, sorted by start address. Entries can
+		 * nest (nested functions, say) or overlap, so a single entry starting
+		 * early can reach over any number of later ones; scanning back from a
+		 * binary search would then be linear. So we also cut each layer's
+		 * address range at every entry's lo and hi, and keep the answer for
+		 * each resulting segment. That's at most 2n segments, built in
+		 * O(n log n), and lookup is one binary search, i.e. O(log n).
+		 * See root_die::build_address_index(). */
+		struct address_index
+		{
+			enum kind { CU, SUBPROGRAM, VARIABLE, NKINDS };
+			struct entry
+			{
+				Dwarf_Addr lo, hi; // right-open
+				Dwarf_Off off; // of the DIE
+				Dwarf_Off object_off; // how far into the DIE's object (or code) lo is
+				uint32_t depth;
+				bool operator<(const entry& e) const
+				{ return lo < e.lo || (lo == e.lo && depth < e.depth); }
+			};
+			struct layer
+			{
+				vector<entry> entries; // sorted
+				/* Each segment runs from its lo to the next one's, and holds
+				 * the deepest (then narrowest) entry covering it, if any. */
+				struct segment
+				{
+					Dwarf_Addr lo;
+					uint32_t best; // index into entries, or NONE
+				};
+				static const uint32_t NONE = ~(uint32_t)0;
+				vector<segment> segments; // sorted by lo
+				void build_segments(); // once entries are sorted
+				const entry *best_of(const segment& s) const
+				{ return (s.best == NONE) ? nullptr : &entries[s.best]; }
+			};
+			layer layers[NKINDS];
+			
+			/* The deepest piece of kind k covering addr, or null. */
+			const entry *find(Dwarf_Addr addr, kind k) const;
+			/* The most specific piece covering addr: a variable, else a
+			 * subprogram, else a CU. */
+			const entry *find(Dwarf_Addr addr) const;
+			/* out[i] = find(addrs[i], k), for addrs in ascending order, e.g. 
+			 * a profile's sorted PCs. We merge rather than binary-search, so
+			 * this is linear in the addresses plus the segments they span. */
+			void find_sorted(const vector<Dwarf_Addr>& addrs, kind k,
+				vector<const entry *>& out) const;
+			/* How far into the DIE's object addr is, for an entry covering it. */
+			static Dwarf_Off offset_within(const entry& e, Dwarf_Addr addr)
+			{ return e.object_off + (addr - e.lo); }
+		};
+
+		/* Payloads (heap-allocated basic_dies) we've made, keyed by offset,
+		 * so that copying an iterator to a DIE we've already upgraded doesn't
+		 * allocate again. This used to be the "sticky set", which only held
+		 * sticky DIEs (CUs, by default) and never let go of them. Now it holds
+		 * any payload, up to max_entries, evicting the least recently used.
+		 * Sticky DIEs go in first, but are evictable like anything else.
+		 * 
+		 * An entry whose payload is referenced from outside the cache (i.e.
+		 * whose refcount is more than our one) is pinned: we never evict it,
+		 * so there's never more than one payload per offset. This means we
+		 * can go over max_entries if lots of iterators are held. */
+		struct payload_cache
+		{
+			typedef intrusive_ptr<basic_die> ptr_type;
+		private:
+			struct entry
+			{
+				ptr_type p;
+				std::list<Dwarf_Off>::iterator lru_pos;
+			};
+			std::unordered_map<Dwarf_Off, entry> entries;
+			std::list<Dwarf_Off> lru; // front is most recent
+			unsigned max_entries;
+			static bool is_pinned(const ptr_type& p) { return p->refcount > 1; }
+			void evict();
+		public:
+			unsigned long hits;
+			unsigned long misses;
+			unsigned long evictions;
+			
+			payload_cache(unsigned max_entries = 16384)
+			 : max_entries(max_entries), hits(0), misses(0), evictions(0) {}
+			
+			/* Returns null on a miss. */
+			ptr_type find(Dwarf_Off off);
+			void insert(Dwarf_Off off, const ptr_type& p);
+			void erase(Dwarf_Off off);
+			void erase_unpinned_in(Dwarf_Off begin, Dwarf_Off end); // e.g. a whole CU
+			void clear() { entries.clear(); lru.clear(); }
+			
+			unsigned size() const { return entries.size(); }
+			unsigned pinned() const; // for diagnostics
+			unsigned get_max_entries() const { return max_entries; }
+			void set_max_entries(unsigned n) { assert(n > 0); max_entries = n; evict(); }
+		};
+
+		/* Payloads are small, numerous and short-lived, and most of them
+		 * die together (when traversal leaves their CU). So rather than 
+		 * going to malloc for each one, we bump-allocate them from a region
+		 * per CU, recycling freed blocks within the region by size. When
+		 * the root is done with a CU, it releases the region, which then
+		 * goes back to malloc in one step as soon as its last payload dies
+		 * (which is immediately, unless somebody still holds one).
+		 * 
+		 * Each block is preceded by a header pointing to its region, so that
+		 * basic_die::operator delete can find it. Like the rest of root_die,
+		 * this is not thread-safe: don't let payloads outlive their thread. */
+		struct payload_arena
+		{
+			struct region;
+			struct block_header
+			{
+				region *p_region; // null if the block came from plain operator new
+				size_t size;      // of the block proper, not counting this header
+			};
+			// keep the block proper maximally aligned
+			static const size_t header_size
+			 = (sizeof (block_header) + alignof(std::max_align_t) - 1) 
+			 	/ alignof(std::max_align_t) * alignof(std::max_align_t);
+			static const size_t chunk_size = 64 * 1024;
+			struct region
+			{
+				Dwarf_Off cu_off;
+				vector<unique_ptr<char[]> > chunks;
+				size_t used_in_last_chunk;
+				unsigned live;
+				bool released; // if so, delete this region when live hits zero
+				map<size_t, void *> free_lists; // by block size; chained through the blocks
+				region(Dwarf_Off cu_off) 
+				 : cu_off(cu_off), used_in_last_chunk(chunk_size), live(0), released(false) {}
+				void *allocate(size_t sz);
+			};
+		private:
+			map<Dwarf_Off, region *> regions; // only unreleased ones
+			size_t bytes_allocated; // from malloc, for diagnostics
+		public:
+			payload_arena() : bytes_allocated(0) {}
+			~payload_arena();
+			payload_arena(const payload_arena&) = delete;
+			payload_arena& operator=(const payload_arena&) = delete;
+			
+			void *allocate(Dwarf_Off cu_off, size_t sz);
+			static void deallocate(void *p);
+			void release(Dwarf_Off cu_off);
+			unsigned region_count() const { return regions.size(); }
+			size_t get_bytes_allocated() const { return bytes_allocated; }
+		};
+
+		// FIXME: this is not libdwarf-agnostic!
 		// ** Could we use it for encap too, with a null Debug?
 		// ** Can we abstract out a core base class
 		// --- yes, where "Debug" just means "root resource", and encap doesn't have one
@@ -266,16 +583,33 @@ namespace dwarf
 		public: // was protected -- consider changing back
 			typedef intrusive_ptr<basic_die> ptr_type;
 
-			map<Dwarf_Off, Dwarf_Off> parent_of;
-			map<Dwarf_Off, ptr_type > sticky_dies; // compile_unit_die is always sticky
+			parent_cache parent_of;
+			payload_arena arena; // must outlive payloads, so comes first
+			payload_cache payloads; // compile_unit_die is always sticky, i.e. goes in here first
 			Debug dbg;
+			int fd; // so that parallel_for_each_cu can open more Debugs on the same file
 			Dwarf_Off current_cu_offset; // 0 means none
+			/* Cursor-style navigation: the move_to_* primitives step the iterator's
+			 * own Dwarf_Die in place, instead of building a new iterator_base via
+			 * parent()/first_child()/next_sibling() and move-assigning it. On by
+			 * default; turning it off gives the old path, e.g. for benchmarking. */
+			bool cursor_navigation;
+			/* If we can map the file's debug sections, we keep a native decoder
+			 * (see native.hpp) alongside libdwarf. We use its per-CU abbreviation
+			 * tables to answer some questions (e.g. has_attr) without libdwarf. */
+			std::shared_ptr<native_root_die> p_native;
+			const unit_header *p_last_native_unit; // one-entry cache for native_die_at
 
 			virtual ptr_type make_payload(const iterator_base& it)/* = 0*/;
 			virtual bool is_sticky(const abstract_die& d) /* = 0*/;
 			
 		public:
-			root_die(int fd) : dbg(fd), current_cu_offset(0UL) {}
+			root_die(int fd);
+			/* A root for another thread: it gets its own libdwarf context
+			 * (and so its own CU context, payloads and parent cache), but 
+			 * shares the native decoder's mapped sections, the CU index and any
+			 * other indexes built so far, none of which change once built. */
+			root_die(int fd, root_die& shared_from);
 			// we don't provide this constructor because sharing the CU state is a bad idea
 			//root_die(lib::file& f) : dbg(f.dbg), current_cu_offset
 		
@@ -312,9 +646,43 @@ namespace dwarf
 			template <typename Iter = iterator_df<compile_unit_die> >
 			inline Iter enclosing_cu(const iterator_base& it);
 			
-			/* This is the expensive version. */
+			/* This is the expensive version -- unless we have a skeleton index,
+			 * in which case it's a binary search. */
 			template <typename Iter = iterator_df<> >
 			Iter find(Dwarf_Off off);
+			void build_skeleton_index();
+			const skeleton_index *get_skeleton_index() const { return p_skeleton.get(); }
+			/* Like the skeleton index, the address index is optional and 
+			 * built once, in one pass, and then shared. */
+			void build_address_index();
+			const address_index *get_address_index() const { return p_address_index.get(); }
+			/* If there's a persistent name index for this file (see 
+			 * name_index.hpp), we pick it up when constructed, and resolve()
+			 * uses it. build_name_index() writes one if there isn't one, which
+			 * needs the native decoder and a build-id. */
+			bool build_name_index();
+			const name_index *get_name_index() const { return p_name_index.get(); }
+			/* The producer's name tables (.debug_names, .gdb_index or pubnames;
+			 * see accel.hpp), opened the first time we ask. Null if there are
+			 * none, or if we have no native decoder. */
+			const accel_index *get_accel_index();
+			/* The first DIE called name that is a child of some CU and not
+			 * DW_VIS_local, cf. file_toplevel_die::visible_named_grandchild.
+			 * We try the name index, then the producer's tables, and only
+			 * if both fail do we search every CU's children. */
+			iterator_base visible_named_grandchild(const string& name);
+		protected:
+			std::shared_ptr<const skeleton_index> p_skeleton;
+			std::shared_ptr<const address_index> p_address_index;
+			std::shared_ptr<const name_index> p_name_index;
+			std::shared_ptr<const accel_index> p_accel;
+			bool tried_accel;
+			/* Answer resolve(start, path) from the name index, where qualified
+			 * is the path joined with "::". Returns false if the index can't
+			 * answer, e.g. because we have none, or start has no qualified name. */
+			bool resolve_by_name_index(const iterator_base& start, const string& qualified,
+				unsigned path_len, iterator_base& out);
+		public:
 			/* This is the cheap version -- must give a valid offset. */
 			template <typename Iter = iterator_df<> >
 			Iter pos(Dwarf_Off off, unsigned depth, 
@@ -341,6 +709,14 @@ namespace dwarf
 			iterator_base parent(const iterator_base& it);
 			iterator_base first_child(const iterator_base& it);
 			iterator_base next_sibling(const iterator_base& it);
+		protected:
+			// the cursor-style versions of the move_to_* functions
+			bool step_to_parent_in_place(iterator_base& it);
+			bool step_to_first_child_in_place(iterator_base& it);
+			bool step_to_next_sibling_in_place(iterator_base& it);
+			void replace_handle_in_place(iterator_base& it, Die&& d, unsigned depth);
+			static Die::raw_handle_type raw_handle_of(const iterator_base& it);
+		public:
 			// NOTE: we *don't* put named_child and move_to_named_child here, because
 			// we want to allow exploitation of in-payload data, which might support
 			// faster-than-linear search. So to do name lookups, we want to
@@ -350,8 +726,37 @@ namespace dwarf
 			// BUT we do put a special find_named_child method, emphasising the linear
 			// search (slow). This the fallback implementation used by the iterator.
 			iterator_base find_named_child(const iterator_base& start, const string& name);
-			
-			// libdwarf has this weird stateful CU API
+			/* The same, but hash the children's names the first time we search 
+			 * start's children, and look up in the hash from then on. The 
+			 * payload's named_child uses this. Set cache_child_names to make
+			 * find_named_child use it too. */
+			iterator_base find_named_child_cached(const iterator_base& start, const string& name);
+			bool cache_child_names;
+			child_name_cache child_names;
+			
+			/* Parent lookup that doesn't rely on the parent cache having seen
+			 * the DIE: on a miss, we walk down from the enclosing CU DIE
+			 * (skipping sibling subtrees) and refill the cache as we go. 
+			 * Returns 0 for CU DIEs, and nothing for bogus offsets. */
+			optional<Dwarf_Off> find_parent_offset(Dwarf_Off off);
+			
+			/* Decode the DIE at off using the native decoder's abbreviation
+			 * tables. This doesn't touch libdwarf, so it's cheap. Returns false
+			 * if we have no native decoder or off is not a DIE we understand. */
+			bool native_die_at(Dwarf_Off off, native_die *out);
+			native_root_die *get_native() const { return p_native.get(); }
+			
+			/* libdwarf has this weird stateful CU API. We now only use it to
+			 * build the CU index, the first time we need one; after that,
+			 * the "current CU" is just a position in the index, and moving
+			 * it is a binary search. The last_seen_* fields are kept for
+			 * clients that read them. */
+			const cu_index& get_cu_index();
+		protected:
+			std::shared_ptr<const cu_index> p_cu_index;
+			void build_cu_index();
+			void set_cu_context_from(const cu_index::record *p_rec);
+		public:
 			optional<Dwarf_Off> first_cu_offset;
 			optional<Dwarf_Unsigned> last_seen_cu_header_length;
 			optional<Dwarf_Half> last_seen_version_stamp;
@@ -367,6 +772,24 @@ namespace dwarf
 		public:
 			bool set_cu_context(Dwarf_Off off);
 			
+			/* Say we're done with a CU for now: forget its cached payloads 
+			 * and parent table, and release its payload region. Payloads still 
+			 * held by iterators stay valid; they keep the region alive until
+			 * they die. Visiting the CU again is fine; it just costs more. */
+			void release_cu(Dwarf_Off cu_off);
+			
+			/* Run fn once on every CU, on a pool of nthreads workers (0 means
+			 * one per hardware thread). Each worker has its own root_die, made
+			 * as above, and that's the one fn gets; don't use *this in fn.
+			 * Calls on different CUs run concurrently and in no particular
+			 * order, and each CU is released (as above) after its call.
+			 * Workers start with a contiguous run of CUs each, and
+			 * steal from the back of other workers' runs when theirs is done.
+			 * If fn throws, the remaining CUs are abandoned and we rethrow 
+			 * the first exception once all workers have stopped. */
+			typedef std::function<void(root_die&, iterator_df<compile_unit_die>&)> cu_callback;
+			void parallel_for_each_cu(const cu_callback& fn, unsigned nthreads = 0);
+			
 			friend struct compile_unit_die; // redundant because we're struct, but future hint
 
 			// print the whole lot
@@ -406,6 +829,7 @@ namespace dwarf
 		 * To integrate these, is it as simple as
 		 * - s/shared_ptr/intrusive_ptr/ in ADT;
 		 * - include a refcount in every basic_die (basic_die_core?);
+		 *   (NOTE: -DDWARFPP_INTRUSIVE_ADT now does these two; see adt_ptr.hpp)
 		 * - redefine abstract_dieset::iterator to be like core, but
 		 *   returning the intrusive_ptr (not raw ref) on dereference? 
 		 * Ideally I would separate out the namespaces so that
@@ -421,6 +845,7 @@ namespace dwarf
 		 * - encap ADT stuff should become an always-sticky variant?
 		 * ... This involves unifying dieset/file_toplevel_die with root_die.
 		 *  */
+		template <typename Payload> inline Payload& payload_cast(basic_die& d); // defined below, once we have factory
 		struct iterator_base : private virtual abstract_die
 		{
 			/* Everything that calls a libdwarf constructor-style function
@@ -504,24 +929,22 @@ namespace dwarf
 			 : cur_handle(nullptr, nullptr), state(HANDLE_ONLY), m_depth(0), p_root(&r) {}
 			
 			// this constructor sets us up using a handle -- 
-			// this does the exploitation of the sticky set
+			// this does the exploitation of the payload cache (and sticky set)
 			iterator_base(Die&& d, unsigned depth, root_die& r)
 			 : cur_handle(Die(nullptr, nullptr)) // will be replaced in function body...
 			{
 				// get the offset of the handle we've been passed
 				Dwarf_Off off = d.get_offset(); 
-				// is it an existing sticky DIE?
-				auto found = r.sticky_dies.find(off);
-				if (found != r.sticky_dies.end())
+				// do we already have payload for it?
+				auto found = r.payloads.find(off);
+				if (found)
 				{
-					// sticky and exists
+					// sticky, or non-sticky but copied recently -- either way, reuse
 					cur_handle = Die(nullptr, nullptr);
 					state = WITH_PAYLOAD;
-					cur_payload = found->second;
-					assert(cur_payload);
-					//m_depth = found->second->get_depth(); assert(depth == m_depth);
-					//p_root = &found->second->get_root();
-					assert(r.is_sticky(static_cast<const abstract_die&>(d)));
+					cur_payload = found;
+					//m_depth = found->get_depth(); assert(depth == m_depth);
+					//p_root = &found->get_root();
 				}
 				else if (r.is_sticky(static_cast<const abstract_die&>(d)))
 				{
@@ -530,7 +953,7 @@ namespace dwarf
 					state = WITH_PAYLOAD;
 					cur_payload = factory::for_spec(d.spec_here(r)).make_payload(std::move(d.handle), r);
 					assert(cur_payload);
-					r.sticky_dies[off] = cur_payload;
+					r.payloads.insert(off, cur_payload);
 				}
 				else
 				{
@@ -660,6 +1083,10 @@ namespace dwarf
 			
 			opt<string> 
 			name_here() const;
+			/* Like name_here(), but with no allocation or copying: this points
+			 * straight at the name's bytes in .debug_str or .debug_info, so it
+			 * stays valid as long as the root_die. data() is null if no name. */
+			string_ref name_view_here() const;
 			
 			inline spec& spec_here() const;
 			
@@ -818,12 +1245,12 @@ namespace dwarf
 			{
 				typedef srk31::selective_iterator< is_a_t<Payload>, Iter> filtered_iterator;
 
-				// transformer is just dynamic_cast, wrapped as a function
+				// transformer is just payload_cast, wrapped as a function
 				typedef Payload& derived_ref;
 				typedef basic_die& base_ref;
 				typedef std::function<derived_ref(base_ref)> transformer;
 				inline static derived_ref transf(base_ref arg) { 
-					return dynamic_cast<Payload&>(arg);
+					return payload_cast<Payload>(arg);
 				}
 
 				typedef boost::transform_iterator<transformer, filtered_iterator >
@@ -998,16 +1425,66 @@ namespace dwarf
 			assert(false); // FIXME support more specs
 		}
 
-		/* Now we can define that pesky template operator function. 
-		 * The factory exposes a dummy method (NOT type-level though! it's 
-		 * polymorphic!) that returns us a fake singleton of any instantiable  
-		 * DIE type. */
+		/* Compile-time map from payload class to the one tag the factory
+		 * makes it for, built from the same generated list as the factory.
+		 * Classes not in the list, notably abstract mixins like type_die or
+		 * with_static_location_die, get is_concrete == false. */
+		template <typename Payload>
+		struct payload_tag
+		{
+			static const bool is_concrete = false;
+		};
+#define factory_case(name, ...) \
+		struct name ## _die; \
+		template <> struct payload_tag<name ## _die> \
+		{ static const bool is_concrete = true; static const Dwarf_Half value = DW_TAG_ ## name; };
+#include "dwarf3-factory.h"
+#undef factory_case
+
+		/* The downcast done on every iterator dereference, and the is_a test.
+		 * dynamic_cast to a class with virtual bases is a slow RTTI walk.
+		 * For concrete classes we can test the tag instead: the factory
+		 * always makes a payload of exactly the class for its tag, so if
+		 * the tag matches, the complete object *is* a Payload. We still
+		 * can't static_cast down from our virtual basic_die, but
+		 * dynamic_cast<void*> just reads the offset-to-top, and from there
+		 * static_cast is fine. */
+		template <typename Payload, bool IsConcrete = payload_tag<Payload>::is_concrete>
+		struct payload_dispatch
+		{
+			/* The factory exposes a dummy method (NOT type-level though! it's
+			 * polymorphic!) that returns us a fake singleton of any instantiable
+			 * DIE type. */
+			static bool is_a(const iterator_base& it)
+			{
+				return dynamic_cast<Payload *>(
+					factory::for_spec(it.spec_here()).dummy_for_tag(it.tag_here())
+				) ? true : false;
+			}
+			static Payload& cast(basic_die& d) { return dynamic_cast<Payload&>(d); }
+		};
+		template <typename Payload>
+		struct payload_dispatch<Payload, true>
+		{
+			static bool is_a(const iterator_base& it)
+			{ return it.tag_here() == payload_tag<Payload>::value; }
+			static Payload& cast(basic_die& d)
+			{
+				if (d.get_tag() != payload_tag<Payload>::value) return dynamic_cast<Payload&>(d); // throws
+				Payload *p = static_cast<Payload *>(dynamic_cast<void *>(&d));
+				assert(p == dynamic_cast<Payload *>(&d));
+				return *p;
+			}
+		};
+		template <typename Payload>
+		inline Payload& payload_cast(basic_die& d)
+		{ return payload_dispatch<Payload>::cast(d); }
+
+		/* Now we can define that pesky template operator function. */
 		template <typename Payload>
 		inline bool iterator_base::is_a_t<Payload>::operator()(const iterator_base& it) const
 		{
-			return dynamic_cast<Payload *>(
-				factory::for_spec(it.spec_here()).dummy_for_tag(it.tag_here())
-			) ? true : false;
+			return payload_dispatch<Payload>::is_a(it);
 		}
 		/* Make sure we can construct any iterator from an iterator_base. 
 		 * In the case of BFS it may be expensive. */
@@ -1034,7 +1511,7 @@ namespace dwarf
 			iterator_df(const iterator_base& arg)
 			 : iterator_base(arg) {}// this COPIES so avoid
 			iterator_df(iterator_base&& arg)
-			 : iterator_base(arg) {}
+			 : iterator_base(std::move(arg)) {}
 			
 			iterator_df& operator=(const iterator_base& arg) 
 			{ this->base_reference() = arg; return *this; }
@@ -1060,7 +1537,7 @@ namespace dwarf
 			bool equal(const self& arg) const { return this->base() == arg.base(); }
 			
 			DerefAs& dereference() const
-			{ return dynamic_cast<DerefAs&>(this->iterator_base::dereference()); }
+			{ return payload_cast<DerefAs>(this->iterator_base::dereference()); }
 		};
 		
 		template <typename DerefAs /* = basic_die */>
@@ -1076,8 +1553,38 @@ namespace dwarf
 			typedef iterator_bf<DerefAs> self;
 			friend class boost::iterator_core_access;
 
-			// extra state needed!
-			deque< iterator_base > m_queue;
+			/* Extra state needed! We only queue where the pending first
+			 * children are, not iterators to them, so that a wide tree doesn't
+			 * cost us a live handle per queued node, and copying us is cheap.
+			 * Handles get rebuilt (by offset) when we dequeue. We also keep the
+			 * parent, which we know at enqueue time, so that the rebuilt handle
+			 * has it without a lookup. It's in the same CU as the child and comes
+			 * before it, so a 32-bit distance back from the child is enough, and
+			 * an entry is 16 bytes. Zero means "not recorded" (only if a 64-bit
+			 * CU is bigger than 4GB), and we let pos() find the parent itself. */
+			struct queued
+			{
+				Dwarf_Off off;
+				uint32_t parent_delta;
+				uint32_t depth;
+			};
+			deque< queued > m_queue;
+			
+			void enqueue(const iterator_base& it, Dwarf_Off parent)
+			{
+				Dwarf_Off off = it.offset_here();
+				assert(parent < off);
+				uint32_t delta = (uint32_t)(off - parent);
+				if (delta != off - parent) delta = 0;
+				queued q = { off, delta, (uint32_t) it.depth() };
+				m_queue.push_back(q);
+			}
+			void dequeue()
+			{
+				queued q = m_queue.front(); m_queue.pop_front();
+				this->base_reference() = get_root().template pos<iterator_base>(q.off, q.depth,
+					q.parent_delta ? optional<Dwarf_Off>(q.off - q.parent_delta) : optional<Dwarf_Off>());
+			}
 			
 			iterator_base& base_reference()
 			{ return static_cast<iterator_base&>(*this); }
@@ -1088,11 +1595,11 @@ namespace dwarf
 			iterator_bf(const iterator_base& arg)
 			 : iterator_base(arg) {}// this COPIES so avoid
 			iterator_bf(iterator_base&& arg)
-			 : iterator_base(arg) {}
+			 : iterator_base(std::move(arg)) {}
 			iterator_bf(const iterator_bf<DerefAs>& arg)
 			 : iterator_base(arg), m_queue(arg.m_queue) {}// this COPIES so avoid
 			iterator_bf(iterator_bf<DerefAs>&& arg)
-			 : iterator_base(arg), m_queue(std::move(arg.m_queue)) {}
+			 : iterator_base(std::move(arg)), m_queue(std::move(arg.m_queue)) {}
 			
 			iterator_bf& operator=(const iterator_base& arg) 
 			{ this->base_reference() = arg; this->m_queue.clear(); return *this; }
@@ -1113,15 +1620,16 @@ namespace dwarf
 				 */
 				auto first_child = get_root().first_child(this->base_reference()); 
 				//   ^-- might be END
+				// enqueue it whether or not we have a next sibling
+				if (first_child != iterator_base::END) enqueue(first_child, this->offset_here());
 				
 				if (get_root().move_to_next_sibling(this->base_reference()))
 				{
-					// success, so enqueue the first child if there is one
-					if (first_child != iterator_base::END) m_queue.push_back(first_child);
+					// success
 				}
 				else if (m_queue.size() > 0)
 				{
-					this->base_reference() = m_queue.front(); m_queue.pop_front();
+					dequeue();
 				}
 				else
 				{
@@ -1140,7 +1648,7 @@ namespace dwarf
 				}
 				else if (m_queue.size() > 0)
 				{
-					this->base_reference() = m_queue.front(); m_queue.pop_front();
+					dequeue();
 				}
 				else
 				{
@@ -1153,7 +1661,7 @@ namespace dwarf
 				assert(false); // FIXME
 			}
 			DerefAs& dereference() const
-			{ return dynamic_cast<DerefAs&>(this->iterator_base::dereference()); }
+			{ return payload_cast<DerefAs>(this->iterator_base::dereference()); }
 		};
 		
 		template <typename DerefAs /* = basic_die*/>
@@ -1203,7 +1711,7 @@ namespace dwarf
 			
 			bool equal(const self& arg) const { return this->base() == arg.base(); }
 			DerefAs& dereference() const
-			{ return dynamic_cast<DerefAs&>(this->iterator_base::dereference()); }
+			{ return payload_cast<DerefAs>(this->iterator_base::dereference()); }
 		};
 
 
@@ -1279,6 +1787,7 @@ namespace dwarf
 struct type_die; 
 } namespace lib {
 struct regs;
+class line_table;
 } namespace core {
 	struct with_static_location_die : public virtual basic_die
 	{
@@ -1494,6 +2003,11 @@ end_class(with_data_members)
 public: \
 inline std::string source_file_name(unsigned o) const; \
 inline unsigned source_file_count() const; \
+/* The line table, decoded the first time we ask for it and then kept. */ \
+std::shared_ptr<const lib::line_table> get_line_table() const; \
+protected: \
+mutable std::shared_ptr<const lib::line_table> p_line_table; \
+public: \
 /* We define fields and getters for the per-CU info (NOT attributes) */ \
 /* available from libdwarf. These will be filled in by root_die::make_payload(). */ \
 protected: \
@@ -1583,6 +2097,18 @@ friend class factory;
 		root_die::resolve(const iterator_base& start, Iter path_pos, Iter path_end)
 		{
 			if (path_pos == path_end) return start;
+			if (p_name_index)
+			{
+				string qualified;
+				unsigned path_len = 0;
+				for (Iter i = path_pos; i != path_end; ++i, ++path_len)
+				{
+					if (path_len > 0) qualified += "::";
+					qualified += *i;
+				}
+				iterator_base found;
+				if (resolve_by_name_index(start, qualified, path_len, found)) return found;
+			}
 			Iter cur_plus_one = path_pos; cur_plus_one++;
 			if (cur_plus_one == path_end) return start.named_child(*path_pos);
 			else
@@ -1678,7 +2204,7 @@ friend class factory;
 			 * scenarios (deletions). 
 			 */
 			root_die& r = get_root(opt_r);
-			return r.find_named_child(r.find(get_offset()), name); 
+			return r.find_named_child_cached(r.find(get_offset()), name); 
 		}
 
 		// now compile_unit_die is complete...
@@ -1767,11 +2293,13 @@ friend class factory;
 				// also update the parent cache
 				GET_HANDLE_OFFSET;
 				auto found = r.parent_of.find(it.offset_here());
-				if (found != r.parent_of.end())
+				if (found)
 				{
-					// parent of the sibling is the same as parent of "it"
-					r.parent_of[off] = found->second;
-				} else cerr << "Warning: parent cache did not know 0x" << std::hex << it.offset_here() << std::dec << endl;
+					// parent of the sibling is the same as parent of "it";
+					// if the cache has forgotten, next_sibling() fills it in
+					r.parent_of.insert(*found == 0UL ? off : it.enclosing_cu_offset_here(),
+						off, *found);
+				}
 				return handle_type(returned, deleter(r.dbg.handle.get(), r));
 			}
 			else return handle_type(nullptr, deleter(nullptr, r));
@@ -1779,14 +2307,17 @@ friend class factory;
 		inline Die::handle_type 
 		Die::try_construct(root_die& r) /* siblingof in root case */
 		{
+			/* i.e. the current CU's DIE. The CU context lives in our 
+			 * CU index now, not in libdwarf, so we go by offset. */
+			if (r.current_cu_offset == 0UL) return handle_type(nullptr, deleter(nullptr, r));
 			raw_handle_type returned;
 			int ret
-			 = dwarf_siblingof(r.dbg.handle.get(), nullptr, &returned, &current_dwarf_error);
+			 = dwarf_offdie(r.dbg.handle.get(), r.current_cu_offset, &returned, &current_dwarf_error);
 			if (ret == DW_DLV_OK)
 			{
 				// update parent cache
 				GET_HANDLE_OFFSET;
-				r.parent_of[off] = 0UL;
+				r.parent_of.insert(off, off, 0UL);
 				return handle_type(returned, deleter(r.dbg.handle.get(), r));
 			}
 			else return handle_type(nullptr, deleter(nullptr, r));
@@ -1806,7 +2337,8 @@ friend class factory;
 			if (ret == DW_DLV_OK)
 			{
 				GET_HANDLE_OFFSET;
-				r.parent_of[off] = it.offset_here();
+				r.parent_of.insert(it.depth() == 1 ? it.offset_here() : it.enclosing_cu_offset_here(),
+					off, it.offset_here());
 				return handle_type(returned, deleter(it.get_root().dbg.handle.get(), r));
 			}
 			else return handle_type(nullptr, deleter(nullptr, r));
@@ -1894,8 +2426,8 @@ friend class factory;
 // 				// return nearest_enclosing(DW_TAG_compile_unit).spec_here();
 		
 		}
-		/* NOTE: pos() is incompatible with a strict parent cache.
-		 * But it is necessary to support following references.
+		/* NOTE: pos() used to be incompatible with a strict parent cache.
+		 * The cache is now soft (see parent_cache), so it's fine not to know.
 		 * We fill in the parent if depth <= 2, or if the user can tell us. */
 		template <typename Iter /* = iterator_df<> */ >
 		inline Iter root_die::pos(Dwarf_Off off, unsigned depth,
@@ -1905,9 +2437,10 @@ friend class factory;
 			auto handle = Die::try_construct(*this, off);
 			assert(handle);
 			iterator_base base(std::move(handle), depth, *this);
-			if (depth == 1) parent_of[off] = 0UL;
-			else if (depth == 2) parent_of[off] = base.enclosing_cu_offset_here();
-			else if (parent_off) parent_of[off] = *parent_off;
+			if (depth == 1) parent_of.insert(off, off, 0UL);
+			else if (depth == 2) parent_of.insert(base.enclosing_cu_offset_here(), off, 
+				base.enclosing_cu_offset_here());
+			else if (parent_off) parent_of.insert(base.enclosing_cu_offset_here(), off, *parent_off);
 			
 			return Iter(std::move(base));
 		}
@@ -1924,6 +2457,15 @@ friend class factory;
 		template <typename Iter /* = iterator_df<> */ >
 		inline Iter root_die::find(Dwarf_Off off)
 		{
+			if (p_skeleton)
+			{
+				if (off == 0UL) return Iter(begin());
+				const skeleton_index::entry *p_e = p_skeleton->find(off);
+				if (!p_e) return Iter(iterator_base::END);
+				return pos<Iter>(off, p_e->depth, 
+					optional<Dwarf_Off>(p_skeleton->parent_offset(*p_e)));
+			}
+			
 			/* Interesting problem: our iterators don't make searching a subtree 
 			 * easy. I think there is a neat way of expressing this by combining
 			 * dfs and bfs traversal. FIXME: work out the recipe. */
@@ -2370,6 +2912,7 @@ friend class factory;
 			friend class ranges;
 			friend class srclines;
 			friend class srcfiles;
+			friend class line_table;
 			
 			friend class basic_die;
 			friend class file_toplevel_die;
@@ -2599,6 +3142,34 @@ friend class factory;
             Dwarf_Arange *p_aranges;
             Dwarf_Signed cnt;
             // TODO: forbid copying or assignment
+		public:
+			/* dwarf_get_arange() is a linear scan, so we decode everything 
+			 * once, up front, into a table sorted by start address, with
+			 * adjacent or overlapping ranges of the same CU coalesced.
+			 * Ranges of different CUs shouldn't overlap, but sometimes do;
+			 * then the latest-starting range covering an address wins. To
+			 * find that in O(log n) however wide the earlier ranges are, we
+			 * also cut the address space into disjoint segments, each
+			 * knowing its winner. */
+			struct entry
+			{
+				Dwarf_Addr start;
+				Dwarf_Addr end; // one past
+				Dwarf_Off cu_die_offset;
+				bool operator<(const entry& e) const
+				{ return start < e.start || (start == e.start && cu_die_offset < e.cu_die_offset); }
+			};
+			struct segment
+			{
+				Dwarf_Addr lo; // a segment runs to the next one's lo
+				uint32_t best; // index into the sorted entries, or NONE
+			};
+			static const uint32_t NONE = ~(uint32_t)0;
+		private:
+			std::vector<entry> sorted;
+			std::vector<segment> segments;
+			void build_sorted();
+			void build_segments();
         public:
         	aranges(file& f, Dwarf_Error *error = 0) : f(f), p_last_error(error ? error : &f.last_error)
             {
@@ -2606,14 +3177,18 @@ friend class factory;
                 int retval = dwarf_get_aranges(f.get_dbg(), &p_aranges, &cnt, error);
                 if (retval == DW_DLV_NO_ENTRY) { cnt = 0; p_aranges = 0; }
                 else if (retval != DW_DLV_OK) throw Error(*error, f.get_dbg());
-				cerr << "Constructed an aranges from block at " << p_aranges 
-					<< ", count " << cnt << endl;
+				build_sorted();
             }
 			Dwarf_Signed count() { return cnt; }		
 			int get_info(int i, Dwarf_Addr *start, Dwarf_Unsigned *length, Dwarf_Off *cu_die_offset,
 				Dwarf_Error *error = 0);
+			/* This is a binary search in the sorted table. NOTE: the start and
+			 * length we return are those of the coalesced range. */
 			int get_info_for_addr(Dwarf_Addr a, Dwarf_Addr *start, Dwarf_Unsigned *length, Dwarf_Off *cu_die_offset,
 				Dwarf_Error *error = 0);
+			const entry *find(Dwarf_Addr a) const; // null if no range covers a
+			const std::vector<entry>& sorted_entries() const { return sorted; }
+			const std::vector<segment>& disjoint_segments() const { return segments; }
 			void *arange_block_base() const { return p_aranges; }
             virtual ~aranges()
             {
@@ -2724,6 +3299,50 @@ friend class factory;
 			
 			unsigned count() { return filescount; }
 		};		
+
+		/* A CU's line table, decoded once into a struct of arrays sorted by
+		 * address. srclines just holds libdwarf's Dwarf_Line handles, so 
+		 * mapping an address to a line that way means calling accessors on
+		 * every row; here it's a binary search. File names are interned, so
+		 * each row holds an index into file_names(). 
+		 *
+		 * Rows from all the sequences are merged. A row ending a sequence
+		 * marks the start of a gap, and sorts before any row starting another
+		 * sequence at the same address, so lookups never land in a gap. */
+		class line_table
+		{
+		public:
+			enum row_flags { IS_STMT = 1, BASIC_BLOCK = 2, END_SEQUENCE = 4 };
+			static const size_t npos = ~(size_t)0;
+		private:
+			std::vector<Dwarf_Addr> addrs;
+			std::vector<uint32_t> file_idxs;
+			std::vector<uint32_t> line_nos;
+			std::vector<uint32_t> column_nos;
+			std::vector<uint8_t> row_flags_;
+			std::vector<std::string> files;
+			void build(Dwarf_Debug dbg, Dwarf_Die cu_die, Dwarf_Error *error);
+		public:
+			line_table(Dwarf_Debug dbg, Dwarf_Die cu_die, Dwarf_Error *error);
+			line_table(die& d, Dwarf_Error *error = 0);
+
+			size_t size() const { return addrs.size(); }
+			Dwarf_Addr addr(size_t i) const { return addrs[i]; }
+			unsigned file_index(size_t i) const { return file_idxs[i]; }
+			const std::string& file_name(size_t i) const { return files[file_idxs[i]]; }
+			unsigned line(size_t i) const { return line_nos[i]; }
+			unsigned column(size_t i) const { return column_nos[i]; }
+			unsigned flags(size_t i) const { return row_flags_[i]; }
+			const std::vector<Dwarf_Addr>& addresses() const { return addrs; }
+			const std::vector<std::string>& file_names() const { return files; }
+
+			/* The row covering a, i.e. the last row at or before it, 
+			 * or npos if a isn't in any sequence. */
+			size_t find(Dwarf_Addr a) const;
+			/* out[i] = find(sorted_addrs[i]), for addresses in ascending order
+			 * (e.g. a profile's PCs). This is a merge, not repeated searches. */
+			void find_sorted(const std::vector<Dwarf_Addr>& sorted_addrs, std::vector<size_t>& out) const;
+		};
 		class Not_supported
         {
         	const string& m_msg;
@@ -0,0 +1,109 @@
+/* dwarfpp: C++ binding for a useful subset of libdwarf, plus extra goodies.
+ *
+ * name_index.hpp: a persistent, mmap-able index from qualified names to
+ * DIE offsets, kept in a sidecar file keyed by the binary's build-id.
+ *
+ * Copyright (c) 2013, Stephen Kell.
+ */
+
+#ifndef DWARFPP_NAME_INDEX_HPP_
+#define DWARFPP_NAME_INDEX_HPP_
+
+#include <string>
+#include <memory>
+#include <utility>
+#include <cstdint>
+#include "native.hpp"
+
+namespace dwarf
+{
+	namespace core
+	{
+		using std::string;
+		using std::shared_ptr;
+		using std::pair;
+
+		/* Name lookups (resolve(), visible_named_grandchild() and friends)
+		 * start from a cold linear scan in every process that opens a binary.
+		 * Instead, we can do one pass over the file (natively) and write out
+		 * every named DIE whose named ancestors give it a qualified name,
+		 * e.g. "std::vector" or "main::argc", as a sorted table. Later
+		 * processes just map the table and binary-search it.
+		 *
+		 * The file lives in a cache directory (see default_path()), named
+		 * after the hex build-id, and records the build-id in its header, so
+		 * a stale or foreign file is never used. Binaries without a build-id
+		 * don't get an index. The layout is host-endian and fixed-width:
+		 *
+		 *     header
+		 *     entry[nentries]     sorted by (name, die offset)
+		 *     char strings[]      names, not NUL-terminated
+		 */
+		class name_index
+		{
+		public:
+			struct header
+			{
+				char magic[8]; // "DWPPNIX1"
+				uint32_t version;
+				uint32_t build_id_len;
+				unsigned char build_id[64];
+				uint64_t nentries;
+				uint64_t entries_off;
+				uint64_t strings_off;
+				uint64_t strings_len;
+			};
+			enum flags
+			{
+				VISIBLE = 1 // i.e. not DW_VIS_local -- see file_toplevel_die::is_visible
+			};
+			struct entry
+			{
+				uint32_t name_off; // into strings
+				uint32_t name_len;
+				uint64_t die_off;
+				uint16_t tag;
+				uint16_t flags;
+				uint32_t depth;
+			};
+			static const uint32_t VERSION = 1;
+			static_assert(sizeof (header) % alignof(entry) == 0, "entries must follow the header aligned");
+		private:
+			void *mapping;
+			size_t mapping_length;
+			const header *p_header;
+			const entry *entries;
+			const char *strings;
+			name_index() : mapping(nullptr), mapping_length(0), p_header(nullptr),
+				entries(nullptr), strings(nullptr) {}
+		public:
+			~name_index();
+			name_index(const name_index&) = delete;
+			name_index& operator=(const name_index&) = delete;
+
+			/* Map an index file, checking it is well-formed and was built for
+			 * a binary with this build-id. Returns null otherwise. */
+			static shared_ptr<name_index> open(const string& path, const string& build_id);
+			/* Walk the whole file natively and write its index to path. We write
+			 * to a temporary and rename it into place, so concurrent builders
+			 * and readers never see half a file. Returns false on failure. */
+			static bool write(const native_root_die& r, const string& path);
+			/* Where the index for this build-id lives: $DWARFPP_NAME_INDEX_DIR
+			 * if set, else $XDG_CACHE_HOME/dwarfpp, else ~/.cache/dwarfpp. */
+			static string default_path(const string& build_id);
+			/* Open the index for this file from its default path, if it's there. */
+			static shared_ptr<name_index> open_for(const debug_sections& s);
+			/* The same, but if it's not there, build and write it first. */
+			static shared_ptr<name_index> build_for(const native_root_die& r);
+
+			/* All DIEs with this qualified name, in offset order. */
+			pair<const entry *, const entry *> equal_range(const string& qualified_name) const;
+			const entry *begin() const { return entries; }
+			const entry *end() const { return entries + p_header->nentries; }
+			string name_of(const entry& e) const { return string(strings + e.name_off, e.name_len); }
+			uint64_t size() const { return p_header->nentries; }
+		};
+	}
+}
+
+#endif
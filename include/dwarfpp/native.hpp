@@ -0,0 +1,383 @@
+/* dwarfpp: C++ binding for a useful subset of libdwarf, plus extra goodies.
+ *
+ * native.hpp: read-only DIE decoding straight out of the mapped debug
+ * sections, bypassing libdwarf.
+ *
+ * Copyright (c) 2013, Stephen Kell.
+ */
+
+#ifndef DWARFPP_NATIVE_HPP_
+#define DWARFPP_NATIVE_HPP_
+
+#include <vector>
+#include <map>
+#include <memory>
+#include <cstring>
+#include <bitset>
+#include <tuple>
+#include <atomic>
+#include <cstddef>
+#include <boost/iterator/iterator_facade.hpp>
+#include "lib.hpp"
+
+namespace dwarf
+{
+	namespace core
+	{
+		using std::vector;
+		using std::map;
+		using std::shared_ptr;
+
+		/* Every core::root_die navigation step is a libdwarf call that allocates
+		 * a handle. For read-only bulk scans, that's most of the cost. This file
+		 * provides an alternative backend: we map the file, find .debug_info,
+		 * .debug_abbrev, .debug_str and friends, and decode DIEs in place using
+		 * the abbreviation tables. A walk in DWARF order is then a linear scan
+		 * of .debug_info, and subtrees can be skipped using DW_AT_sibling.
+		 *
+		 * This is deliberately narrow. DIEs are exposed through abstract_die,
+		 * plus some zero-copy accessors; for anything richer (payloads,
+		 * encap::attribute_value) you can hop to the equivalent core iterator
+		 * by calling core_pos(), which is cheap because we know the depth and
+		 * the parent. */
+
+		/* The mapped file and the sections we care about. We refuse (i.e.
+		 * return null from open()) if the file is not ELF, has byte order
+		 * different from ours, or has compressed debug sections. */
+		struct debug_sections
+		{
+			struct section
+			{
+				const unsigned char *data;
+				Dwarf_Unsigned size;
+				section() : data(nullptr), size(0) {}
+				section(const unsigned char *data, Dwarf_Unsigned size) : data(data), size(size) {}
+				operator bool() const { return data != nullptr; }
+				const unsigned char *end() const { return data + size; }
+			};
+		private:
+			void *mapping;
+			size_t mapping_length;
+			map<string, section> by_name;
+			debug_sections() : mapping(nullptr), mapping_length(0) {}
+		public:
+			static shared_ptr<debug_sections> open(int fd);
+			~debug_sections();
+			// no copying, since we own the mapping
+			debug_sections(const debug_sections&) = delete;
+			debug_sections& operator=(const debug_sections&) = delete;
+
+			section get(const string& name) const
+			{
+				auto found = by_name.find(name);
+				return (found == by_name.end()) ? section() : found->second;
+			}
+			// the ones we use all the time
+			section info, abbrev, str, line_str, str_offsets;
+			// the raw bytes of the GNU build-id note, or empty if there isn't one
+			string build_id() const;
+		};
+
+		/* Decoding primitives. We assume the file's byte order is ours
+		 * (debug_sections::open() checks this). */
+		namespace native_decode
+		{
+			inline Dwarf_Unsigned read_uleb128(const unsigned char *& p)
+			{
+				Dwarf_Unsigned result = 0;
+				unsigned shift = 0;
+				unsigned char byte;
+				do
+				{
+					byte = *p++;
+					if (shift < 64) result |= (Dwarf_Unsigned)(byte & 0x7f) << shift;
+					shift += 7;
+				} while (byte & 0x80);
+				return result;
+			}
+			inline Dwarf_Signed read_sleb128(const unsigned char *& p)
+			{
+				Dwarf_Signed result = 0;
+				unsigned shift = 0;
+				unsigned char byte;
+				do
+				{
+					byte = *p++;
+					if (shift < 64) result |= (Dwarf_Signed)(byte & 0x7f) << shift;
+					shift += 7;
+				} while (byte & 0x80);
+				if (shift < 64 && (byte & 0x40)) result |= -((Dwarf_Signed)1 << shift);
+				return result;
+			}
+			template <typename T>
+			inline T read_fixed(const unsigned char *& p)
+			{
+				T val; std::memcpy(&val, p, sizeof val); p += sizeof val; return val;
+			}
+			/* Bounded versions, for when the input might be corrupt. If we'd
+			 * read at or past end, p becomes null and we return 0. A null p
+			 * stays null, so a run of reads can be checked once at the end. */
+			inline Dwarf_Unsigned read_uleb128(const unsigned char *& p, const unsigned char *end)
+			{
+				const unsigned char *q = p;
+				while (q && q < end && (*q & 0x80)) ++q;
+				if (!q || q >= end) { p = nullptr; return 0; }
+				return read_uleb128(p);
+			}
+			inline Dwarf_Signed read_sleb128(const unsigned char *& p, const unsigned char *end)
+			{
+				const unsigned char *q = p;
+				while (q && q < end && (*q & 0x80)) ++q;
+				if (!q || q >= end) { p = nullptr; return 0; }
+				return read_sleb128(p);
+			}
+			template <typename T>
+			inline T read_fixed(const unsigned char *& p, const unsigned char *end)
+			{
+				if (!p || end - p < (std::ptrdiff_t) sizeof (T)) { p = nullptr; return T(); }
+				return read_fixed<T>(p);
+			}
+			// read an unsigned quantity of 1, 2, 3, 4 or 8 bytes
+			inline Dwarf_Unsigned read_sized(const unsigned char *& p, unsigned size)
+			{
+				switch (size)
+				{
+					case 1: return read_fixed<uint8_t>(p);
+					case 2: return read_fixed<uint16_t>(p);
+					case 3: { Dwarf_Unsigned v = 0; std::memcpy(&v, p, 3); p += 3; return v; } // little-endian only
+					case 4: return read_fixed<uint32_t>(p);
+					case 8: return read_fixed<uint64_t>(p);
+					default: assert(false); return 0;
+				}
+			}
+		}
+
+		/* An abbreviation, plus what we can precompute about the DIEs using it.
+		 * Every attribute up to and including the first variable-sized one
+		 * (a string, block, LEB128...) sits at a fixed offset from the end
+		 * of the abbrev code, so we can get at it by pointer arithmetic. 
+		 * If all forms are fixed-size, so is the whole DIE. */
+		struct abbrev
+		{
+			struct attr_spec
+			{
+				Dwarf_Half attr;
+				Dwarf_Half form;
+				Dwarf_Signed implicit_const; // only for DW_FORM_implicit_const
+				int fixed_offset; // -1 if it depends on earlier attributes' values
+			};
+			Dwarf_Unsigned code;
+			Dwarf_Half tag;
+			bool has_children;
+			vector<attr_spec> attrs;
+			int fixed_size; // -1 if not fixed
+			int min_size; // of the attributes before the first variable-size one
+			std::bitset<256> present; // for the common case of attr < 256
+
+			// -1 if not present
+			int index_of(Dwarf_Half attr) const
+			{
+				if (attr < present.size() && !present[attr]) return -1;
+				for (unsigned i = 0; i < attrs.size(); ++i) if (attrs[i].attr == attr) return i;
+				return -1;
+			}
+			bool has_attr(Dwarf_Half attr) const
+			{ return (attr < present.size()) ? present[attr] : index_of(attr) != -1; }
+			int fixed_offset_of(Dwarf_Half attr) const
+			{ int i = index_of(attr); return (i == -1) ? -1 : attrs[i].fixed_offset; }
+		};
+
+		/* Codes are almost always 1..n, so we index a vector by code,
+		 * falling back to a map for the weird cases. Since form sizes depend
+		 * on the unit's address size, offset size and version, a table is
+		 * specific to those, not just to its offset in .debug_abbrev. */
+		struct abbrev_table
+		{
+			vector<abbrev> dense; // dense[i] has code i+1
+			map<Dwarf_Unsigned, abbrev> sparse;
+			bool decodable; // false if a form is unknown or the table is truncated
+			bool has_indirect; // if so, we only learn some forms DIE by DIE
+
+			const abbrev *find(Dwarf_Unsigned code) const
+			{
+				if (code - 1 < dense.size()) return &dense[code - 1];
+				auto found = sparse.find(code);
+				return (found == sparse.end()) ? nullptr : &found->second;
+			}
+			// decode a table starting at p, stopping at the null entry
+			abbrev_table(const unsigned char *p, const unsigned char *end, 
+				Dwarf_Half address_size, Dwarf_Half offset_size, Dwarf_Half version);
+			abbrev_table() : decodable(true), has_indirect(false) {}
+			
+			// the size of a form, or -1 if it varies
+			static int fixed_form_size(Dwarf_Half form, 
+				Dwarf_Half address_size, Dwarf_Half offset_size, Dwarf_Half version);
+			// whether skip_form() knows how to skip it
+			static bool is_known_form(Dwarf_Half form);
+		};
+
+		/* Everything we need to know from a unit header. */
+		struct unit_header
+		{
+			Dwarf_Off offset;            // of the header, in .debug_info
+			Dwarf_Unsigned length;       // excluding the initial length field
+			Dwarf_Half version;
+			Dwarf_Half unit_type;        // DW_UT_compile for pre-v5 CUs
+			Dwarf_Unsigned abbrev_offset;
+			Dwarf_Half address_size;
+			Dwarf_Half offset_size;      // 4, or 8 for DWARF64
+			Dwarf_Off first_die_offset;  // i.e. the CU DIE's offset
+			Dwarf_Off end_offset;        // one past the unit
+			Dwarf_Unsigned str_offsets_base; // from DW_AT_str_offsets_base, if any
+			const abbrev_table *p_abbrevs;
+
+			// read the header at p; returns false if it's garbage
+			bool decode(const unsigned char *section_begin, const unsigned char *p,
+				const unsigned char *section_end);
+		};
+
+		class native_root_die;
+		struct native_iterator_df;
+
+		/* A decoded DIE position. This is just a few pointers into the mapping,
+		 * so it's cheap to copy, and stays valid as long as the root does. */
+		struct native_die : public virtual abstract_die
+		{
+			const native_root_die *p_root;
+			const unit_header *p_unit;
+			const abbrev *p_abbrev;
+			Dwarf_Off off;
+			const unsigned char *attrs_begin; // just after the abbrev code
+
+			native_die() : p_root(nullptr), p_unit(nullptr), p_abbrev(nullptr), off(0), attrs_begin(nullptr) {}
+			native_die(const native_root_die *p_root, const unit_header *p_unit,
+				const abbrev *p_abbrev, Dwarf_Off off, const unsigned char *attrs_begin)
+			 : p_root(p_root), p_unit(p_unit), p_abbrev(p_abbrev), off(off), attrs_begin(attrs_begin) {}
+
+			// implement the abstract_die interface
+			Dwarf_Off get_offset() const { return off; }
+			Dwarf_Half get_tag() const { return p_abbrev->tag; }
+			opt<string> get_name() const;
+			Dwarf_Off get_enclosing_cu_offset() const { return p_unit->first_die_offset; }
+			bool has_attr(Dwarf_Half attr) const { return p_abbrev->has_attr(attr); }
+			// the rest of the attributes come from libdwarf, so we need a root
+			encap::attribute_map copy_attrs(opt<root_die&> opt_r) const;
+			spec& get_spec(root_die& r) const;
+
+			/* Zero-copy accessors. These return a pointer to the attribute's
+			 * bytes (and its form), or null if we don't have the attribute. */
+			const unsigned char *find_attr(Dwarf_Half attr, Dwarf_Half *out_form,
+				Dwarf_Signed *out_implicit_const = nullptr) const;
+			// null-terminated string in .debug_str, .debug_line_str or .debug_info
+			const char *attr_string(Dwarf_Half attr) const;
+			const char *raw_name() const { return attr_string(DW_AT_name); }
+			// constants, flags, addresses and references (refs are made section-relative)
+			optional<Dwarf_Unsigned> attr_unsigned(Dwarf_Half attr) const;
+			// exprlocs and blocks
+			optional<pair<const unsigned char *, Dwarf_Unsigned> > attr_block(Dwarf_Half attr) const;
+			// one past our attributes, i.e. our first child or next sibling
+			const unsigned char *attrs_end() const;
+		};
+
+		/* Depth-first (i.e. DWARF order) traversal of the whole file.
+		 * Depths follow the core convention: the CU DIEs are at depth 1. */
+		struct native_iterator_df
+		 : public boost::iterator_facade<
+		     native_iterator_df
+		   , const native_die
+		   , boost::forward_traversal_tag
+		   >
+		{
+			friend class boost::iterator_core_access;
+			friend class native_root_die;
+		private:
+			native_die cur;
+			unsigned short m_depth;
+			vector<Dwarf_Off> ancestors; // ancestors[i] is our ancestor at depth i+1
+
+			void decode_at(const unsigned char *p);
+			void set_end() { cur = native_die(); m_depth = 0; ancestors.clear(); }
+			void increment();
+			bool equal(const native_iterator_df& arg) const { return cur.off == arg.cur.off; }
+			const native_die& dereference() const { return cur; }
+		public:
+			native_iterator_df() : m_depth(0) {}
+
+			bool is_end_position() const { return cur.off == 0UL; }
+			unsigned depth() const { return m_depth; }
+			Dwarf_Off offset_here() const { return cur.off; }
+			Dwarf_Half tag_here() const { return cur.p_abbrev->tag; }
+			const char *name_here() const { return cur.raw_name(); }
+			bool has_attr_here(Dwarf_Half attr) const { return cur.has_attr(attr); }
+			optional<Dwarf_Off> parent_offset_here() const
+			{ return (m_depth <= 1) ? optional<Dwarf_Off>(0UL)
+				: optional<Dwarf_Off>(ancestors.at(m_depth - 2)); }
+
+			/* Like increment(), but don't descend into our children. Uses
+			 * DW_AT_sibling if the producer gave us one. */
+			void increment_skipping_subtree();
+
+			/* Get the corresponding core iterator (which uses libdwarf). */
+			template <typename Iter = iterator_df<> >
+			Iter core_pos(root_die& r) const
+			{ assert(!is_end_position()); return r.pos<Iter>(cur.off, m_depth, parent_offset_here()); }
+		};
+
+		class native_root_die
+		{
+			shared_ptr<debug_sections> p_sections;
+			vector<unit_header> units; // sorted by offset
+			// keyed by .debug_abbrev offset, address size, offset size, version
+			map<std::tuple<Dwarf_Unsigned, Dwarf_Half, Dwarf_Half, Dwarf_Half>, abbrev_table> abbrev_tables;
+			bool m_complete;
+			// set if a traversal had to give up on a unit halfway
+			mutable std::atomic<bool> m_abandoned;
+			friend struct native_die;
+			friend struct native_iterator_df;
+			// whether a whole unit's DIEs can be decoded, for units we can't trust
+			bool unit_decodes(const unit_header& u) const;
+		public:
+			/* Everything is decoded up front (headers and abbrevs only, so it's
+			 * cheap), after which we are immutable and can be shared by threads. */
+			explicit native_root_die(shared_ptr<debug_sections> p_sections);
+			// no copying: units point into our abbrev_tables
+			native_root_die(const native_root_die&) = delete;
+			native_root_die& operator=(const native_root_die&) = delete;
+
+			/* Units we can't decode (e.g. because their abbrevs use a form
+			 * we don't know) are left out of unit_headers() and traversals,
+			 * and their DIEs are left to libdwarf. So whole-file scans over
+			 * us only see everything if complete() is true. A unit that turns
+			 * out to be corrupt partway through (a bad abbrev code, or a DIE
+			 * running off the end) is abandoned there, which also makes
+			 * complete() false; so a scan that must not miss anything should
+			 * check again once it's done. */
+			bool complete() const { return m_complete && !m_abandoned; }
+
+			/* Returns null if the file can't be decoded natively, in which case
+			 * you should use core::root_die. */
+			static shared_ptr<native_root_die> open(int fd);
+
+			native_iterator_df begin() const;
+			native_iterator_df end() const { return native_iterator_df(); }
+			// start a traversal at any DIE offset -- the depth is recovered by
+			// scanning from the CU DIE
+			native_iterator_df pos(Dwarf_Off off) const;
+
+			const vector<unit_header>& unit_headers() const { return units; }
+			const unit_header *unit_containing(Dwarf_Off off) const;
+			const debug_sections& sections() const { return *p_sections; }
+			shared_ptr<debug_sections> get_sections() const { return p_sections; }
+
+			/* Form decoding, relative to a unit. skip_form() returns null if
+			 * the value would run past the end of the unit, or if it's an
+			 * indirect form we don't know. */
+			const unsigned char *skip_form(Dwarf_Half form, const unsigned char *p,
+				const unit_header& u) const;
+			const char *string_of_form(Dwarf_Half form, const unsigned char *p,
+				const unit_header& u) const;
+		};
+	}
+}
+
+#endif
@@ -3,6 +3,7 @@
 
 #include <boost/optional.hpp>
 #include <memory>
+#include "adt_ptr.hpp"
 
 namespace dwarf
 {
@@ -102,12 +103,12 @@ namespace dwarf
 		
 		/* END the non-specialised opt<> case. */
 		
-		/* BEGIN the opt<> case specialized for shared_ptr. */
+		/* BEGIN the opt<> case specialized for DIE pointers (see adt_ptr.hpp). */
 		
 		template <typename T>
-		struct opt<shared_ptr<T> > : shared_ptr<T> 
+		struct opt<adt_ptr<T> > : adt_ptr<T> 
 		{
-			typedef shared_ptr<T> super;
+			typedef adt_ptr<T> super;
 			
 			/* forward the underlying constructor */ 
 			//template <typename... Args> 
@@ -123,11 +124,11 @@ namespace dwarf
 
     // Creates an optional<T> initialized with 'val'.
     // Can throw if T::T(T const&) does
-    opt ( shared_ptr<T> val ) : super(val) {}
+    opt ( adt_ptr<T> val ) : super(val) {}
 
     // Creates an optional<T> initialized with 'val' IFF cond is true, otherwise creates an uninitialized optional.
     // Can throw if T::T(T const&) does
-    opt ( bool cond, shared_ptr<T> val ) : super(cond ? val : shared_ptr<T>()) {}
+    opt ( bool cond, adt_ptr<T> val ) : super(cond ? val : adt_ptr<T>()) {}
 
 #ifndef BOOST_OPTIONAL_NO_CONVERTING_COPY_CTOR
     // NOTE: MSVC needs templated versions first
@@ -165,19 +166,19 @@ namespace dwarf
 			
 			
 			/* we need a copy constructor and assignment operator too */
-			opt(const opt<shared_ptr<T> >& arg) : super((const super&)arg) {}
+			opt(const opt<adt_ptr<T> >& arg) : super((const super&)arg) {}
 			
-			opt<T>& operator=(const opt<shared_ptr<T> >& arg) 
+			opt<T>& operator=(const opt<adt_ptr<T> >& arg) 
 			{ *((super *) this) = (const super&) arg; return *this; }
 		};
 		
-	/* END specialization for opt<shared_ptr <T> > */
+	/* END specialization for opt<adt_ptr <T> > */
 		
 		/* This does the opposite. We only need it in encap.hpp where we have macros
 		 * that want to do attribute_value(*a) for any argument a. Normally the caller
 		 * would know not to do *a, but in that macroised generic code, we can't know. */
 		template <typename T>
-		std::shared_ptr<T> deref_opt(const opt<shared_ptr<T> >& arg)
+		adt_ptr<T> deref_opt(const opt<adt_ptr<T> >& arg)
 		{ return arg; }
 		
 		template <typename T>
@@ -111,6 +111,7 @@
 			Dwarf_Off offset_here() const;
 			Dwarf_Half tag_here() const;
 			std::unique_ptr<const char, string_deleter> name_here() const;
+			string_ref name_view_here() const; // no allocation; see iterator_base
 			Dwarf_Off enclosing_cu_offset_here() const;
 			bool has_attr_here(Dwarf_Half attr) const;
 			bool has_attribute_here(Dwarf_Half attr) const { return has_attr_here(attr); }
@@ -126,7 +127,7 @@
 			inline Dwarf_Off get_offset() const { return offset_here(); }
 			inline Dwarf_Half get_tag() const { return tag_here(); }
 			inline opt<string> get_name() const 
-			{ return opt<string>(string(name_here().get())); }
+			{ auto n = name_view_here(); return n.data() ? opt<string>(n.to_string()) : opt<string>(); }
 			inline unique_ptr<const char, string_deleter> get_raw_name() const
 			{ return name_here(); }
 			inline Dwarf_Off get_enclosing_cu_offset() const 
@@ -0,0 +1,189 @@
+/* dwarfpp: C++ binding for a useful subset of libdwarf, plus extra goodies.
+ *
+ * small_attr_map.hpp: an attribute-keyed map kept in a small sorted array,
+ * inline for the usual handful of attributes, used by encap::die.
+ *
+ * Copyright (c) 2013, Stephen Kell.
+ */
+
+#ifndef DWARFPP_SMALL_ATTR_MAP_HPP_
+#define DWARFPP_SMALL_ATTR_MAP_HPP_
+
+#include <utility>
+#include <algorithm>
+#include <new>
+#include <type_traits>
+#include <cstddef>
+#include <cassert>
+#include "private/libdwarf.hpp"
+
+namespace dwarf
+{
+	namespace encap
+	{
+		/* This does the subset of std::map<Dwarf_Half, Value> that encap::die
+		 * and its generated accessors use. Most DIEs have fewer than ten
+		 * attributes, so rather than a tree node each, we keep them sorted by
+		 * attribute number in an array of N slots inside the map itself.
+		 * If a DIE has more than that, we spill the whole array to the heap
+		 * and keep growing it there. Iterators are plain pointers.
+		 *
+		 * We never assign Values, only copy-construct and destroy them, since
+		 * attribute_value's assignment is shallow. That also means a Value
+		 * that registers itself somewhere (like a strong ref) is always
+		 * unregistered exactly once.
+		 *
+		 * NOTE: unlike std::map, inserting or erasing invalidates iterators. */
+		template <typename Value, unsigned N = 8>
+		class small_attr_map
+		{
+		public:
+			typedef lib::Dwarf_Half key_type;
+			typedef Value mapped_type;
+			typedef std::pair<key_type, Value> value_type;
+			typedef std::size_t size_type;
+			typedef value_type *iterator;
+			typedef const value_type *const_iterator;
+		private:
+			typename std::aligned_storage<sizeof (value_type), alignof (value_type)>::type inline_slots[N];
+			value_type *p_slots;
+			size_type n;
+			size_type cap;
+
+			value_type *inline_begin() { return reinterpret_cast<value_type *>(&inline_slots[0]); }
+			bool spilled() const { return cap > N; }
+
+			/* Move the live entries to a fresh array of new_cap slots. */
+			void grow(size_type new_cap)
+			{
+				assert(new_cap > cap);
+				value_type *p_new = static_cast<value_type *>(::operator new(new_cap * sizeof (value_type)));
+				for (size_type i = 0; i < n; ++i)
+				{
+					new (p_new + i) value_type(std::move(p_slots[i]));
+					p_slots[i].~value_type();
+				}
+				if (spilled()) ::operator delete(p_slots);
+				p_slots = p_new;
+				cap = new_cap;
+			}
+			void copy_from(const small_attr_map& m)
+			{
+				reserve(m.n);
+				for (const_iterator i = m.begin(); i != m.end(); ++i)
+				{
+					new (p_slots + n) value_type(*i);
+					++n;
+				}
+			}
+		public:
+			small_attr_map() : p_slots(inline_begin()), n(0), cap(N) {}
+			small_attr_map(const small_attr_map& m) : p_slots(inline_begin()), n(0), cap(N)
+			{ copy_from(m); }
+			small_attr_map(small_attr_map&& m) : p_slots(inline_begin()), n(0), cap(N)
+			{
+				if (m.spilled())
+				{
+					// just take its array
+					p_slots = m.p_slots; n = m.n; cap = m.cap;
+					m.p_slots = m.inline_begin(); m.n = 0; m.cap = N;
+				}
+				else
+				{
+					for (size_type i = 0; i < m.n; ++i) new (p_slots + i) value_type(std::move(m.p_slots[i]));
+					n = m.n;
+					m.clear();
+				}
+			}
+			small_attr_map& operator=(const small_attr_map& m)
+			{
+				if (this != &m) { clear(); copy_from(m); }
+				return *this;
+			}
+			~small_attr_map()
+			{
+				clear();
+				if (spilled()) ::operator delete(p_slots);
+			}
+
+			iterator begin() { return p_slots; }
+			iterator end() { return p_slots + n; }
+			const_iterator begin() const { return p_slots; }
+			const_iterator end() const { return p_slots + n; }
+			size_type size() const { return n; }
+			bool empty() const { return n == 0; }
+			size_type capacity() const { return cap; }
+			void reserve(size_type new_cap) { if (new_cap > cap) grow(new_cap); }
+
+			/* With so few entries, a linear scan beats a binary search
+			 * until we've spilled. */
+			iterator lower_bound(key_type k)
+			{
+				if (!spilled())
+				{
+					iterator i = begin();
+					while (i != end() && i->first < k) ++i;
+					return i;
+				}
+				return std::lower_bound(begin(), end(), k,
+					[](const value_type& v, key_type k) { return v.first < k; });
+			}
+			const_iterator lower_bound(key_type k) const
+			{ return const_cast<small_attr_map *>(this)->lower_bound(k); }
+			iterator find(key_type k)
+			{
+				iterator found = lower_bound(k);
+				return (found != end() && found->first == k) ? found : end();
+			}
+			const_iterator find(key_type k) const
+			{ return const_cast<small_attr_map *>(this)->find(k); }
+			size_type count(key_type k) const { return find(k) != end(); }
+
+			std::pair<iterator, bool> insert(const value_type& v)
+			{
+				iterator pos = lower_bound(v.first);
+				if (pos != end() && pos->first == v.first) return std::make_pair(pos, false);
+				size_type idx = pos - begin();
+				if (n == cap) grow(2 * cap);
+				pos = begin() + idx;
+				// open up a slot at pos, shifting the tail up by one
+				for (iterator i = end(); i != pos; --i)
+				{
+					new (i) value_type(std::move(*(i - 1)));
+					(i - 1)->~value_type();
+				}
+				new (pos) value_type(v);
+				++n;
+				return std::make_pair(pos, true);
+			}
+			iterator insert(iterator hint, const value_type& v) { return insert(v).first; }
+
+			void erase(iterator pos)
+			{
+				assert(pos >= begin() && pos < end());
+				pos->~value_type();
+				// close the gap, shifting the tail down by one
+				for (iterator i = pos; i + 1 != end(); ++i)
+				{
+					new (i) value_type(std::move(*(i + 1)));
+					(i + 1)->~value_type();
+				}
+				--n;
+			}
+			size_type erase(key_type k)
+			{
+				iterator found = find(k);
+				if (found == end()) return 0;
+				erase(found);
+				return 1;
+			}
+			void clear()
+			{
+				for (iterator i = begin(); i != end(); ++i) i->~value_type();
+				n = 0;
+			}
+		};
+	}
+}
+
+#endif
@@ -6,6 +6,7 @@
 #include <limits>
 #include <map>
 #include <memory>
+#include <unordered_map>
 #include <boost/iterator_adaptors.hpp>
 #include <boost/iterator/filter_iterator.hpp>
 #include <boost/iterator/transform_iterator.hpp>
@@ -15,6 +16,7 @@
 #include "expr.hpp"
 #include "attr.hpp"
 #include "opt.hpp"
+#include "string_pool.hpp"
 
 namespace dwarf
 {
@@ -203,9 +205,9 @@ namespace dwarf
 			: public position_and_path
 			{
 				/* This pointer points to the target DIE, or null if we are end(). */
-				shared_ptr<basic_die> p_d;
+				adt_ptr<basic_die> p_d;
 				
-				//typedef std::pair<Dwarf_Off, std::shared_ptr<spec::basic_die> > pair_type;
+				//typedef std::pair<Dwarf_Off, adt_ptr<spec::basic_die> > pair_type;
 
 				bool operator==(const iterator_base& arg) const
 				{ return this->off == arg.off && this->p_ds == arg.p_ds
@@ -216,18 +218,18 @@ namespace dwarf
 				{ return !(*this == arg); }
 
 				// helper for constructing p_d
-				static shared_ptr<basic_die> 
+				static adt_ptr<basic_die> 
 				die_from_offset(
 					abstract_dieset& ds, Dwarf_Off off
 				)
 				{
-					if (off == std::numeric_limits<Dwarf_Off>::max()) return shared_ptr<basic_die>();
+					if (off == std::numeric_limits<Dwarf_Off>::max()) return adt_ptr<basic_die>();
 					else return ds[off];
 				}
 
 				iterator_base(abstract_dieset& ds, Dwarf_Off off,
 					const path_type& path_from_root,
-					shared_ptr<basic_die> p_d = shared_ptr<basic_die>())
+					adt_ptr<basic_die> p_d = adt_ptr<basic_die>())
 				: position_and_path((position){&ds, off}, path_from_root), 
 				  p_d(p_d ? p_d : die_from_offset(ds, off))
 				{ 
@@ -240,16 +242,16 @@ namespace dwarf
 
 				iterator_base(abstract_dieset *p_ds, const path_type& arg)
 				: position_and_path(p_ds, arg), 
-				  p_d(p_ds ? die_from_offset(*p_ds, arg.back()) : shared_ptr<basic_die>())
+				  p_d(p_ds ? die_from_offset(*p_ds, arg.back()) : adt_ptr<basic_die>())
 				{}
 
 				iterator_base(const position_and_path& arg)
 				: position_and_path(arg), 
-				  p_d(arg.p_ds ? die_from_offset(*arg.p_ds, arg.off) : shared_ptr<basic_die>()) {}
+				  p_d(arg.p_ds ? die_from_offset(*arg.p_ds, arg.off) : adt_ptr<basic_die>()) {}
 				
 				iterator_base(const iterator_base& arg)
 				: position_and_path(arg),
-				  p_d(arg.p_ds ? die_from_offset(*arg.p_ds, arg.off) : shared_ptr<basic_die>()) {}
+				  p_d(arg.p_ds ? die_from_offset(*arg.p_ds, arg.off) : adt_ptr<basic_die>()) {}
 
 				typedef std::bidirectional_iterator_tag iterator_category;
 				typedef spec::basic_die value_type;
@@ -273,6 +275,14 @@ namespace dwarf
 			{ return std::numeric_limits<Dwarf_Off>::max(); }
 			virtual Dwarf_Off get_last_monotonic_offset()
 			{ return 0UL; }
+			/* A persistent name index for the underlying file, if there is one
+			 * (see core::name_index). Only immutable, file-backed diesets can
+			 * have one, so by default there isn't. */
+			virtual std::shared_ptr<const core::name_index> get_name_index()
+			{ return std::shared_ptr<const core::name_index>(); }
+			// similarly for the producer's name tables (see core::accel_index)
+			virtual std::shared_ptr<const core::accel_index> get_accel_index()
+			{ return std::shared_ptr<const core::accel_index>(); }
 			
 			struct iterator;
 			virtual iterator find(Dwarf_Off off) = 0;
@@ -287,30 +297,30 @@ namespace dwarf
 			// backlinks aren't necessarily stored, so support search for parent
 			virtual Dwarf_Off find_parent_offset_of(Dwarf_Off off) = 0;
 
-			shared_ptr<type_die> canonicalise_type(shared_ptr<type_die> p_t,
+			adt_ptr<type_die> canonicalise_type(adt_ptr<type_die> p_t,
 				dwarf::tool::cxx_compiler& compiler);
 			template <typename Action>
 			void
 			for_all_identical_types(
-				shared_ptr<type_die> p_t,
+				adt_ptr<type_die> p_t,
 				const Action& action
 			);
 			
-			virtual shared_ptr<basic_die> operator[](Dwarf_Off off) const = 0;
+			virtual adt_ptr<basic_die> operator[](Dwarf_Off off) const = 0;
 
-			shared_ptr<basic_die> operator[](Dwarf_Off off)
+			adt_ptr<basic_die> operator[](Dwarf_Off off)
 			{ return const_cast<const abstract_dieset&>(*this)[off]; }
 		   
 			struct iterator
 			: public boost::iterator_adaptor<iterator, // Derived
 					iterator_base,		// Base
-					shared_ptr<basic_die>, // Value
+					adt_ptr<basic_die>, // Value
 					boost::bidirectional_traversal_tag, // Traversal
-					shared_ptr<basic_die> // Reference
+					adt_ptr<basic_die> // Reference
 				>
 			{
 				friend class abstract_dieset; // for mutating navigation functions
-				typedef std::shared_ptr<spec::basic_die> Value;
+				typedef adt_ptr<spec::basic_die> Value;
 				typedef iterator_base Base;
 				
 				// an iterator is an iterator_base + a policy
@@ -327,20 +337,20 @@ namespace dwarf
 				
 				iterator(abstract_dieset& ds, Dwarf_Off off, 
 					const path_type& path_from_root, 
-					shared_ptr<basic_die> p_d = shared_ptr<basic_die>(),
+					adt_ptr<basic_die> p_d = adt_ptr<basic_die>(),
 					policy& pol = default_policy_sg)  
 				: iterator::iterator_adaptor_(
 					iterator_base(ds, off, path_from_root, p_d)), p_policy(&pol) {}
 
 				iterator(const position& pos, 
 					const path_type& path_from_root,
-					shared_ptr<basic_die> p_d = shared_ptr<basic_die>(),
+					adt_ptr<basic_die> p_d = adt_ptr<basic_die>(),
 					policy& pol = default_policy_sg)  
 				: iterator::iterator_adaptor_(iterator_base(
 					*pos.p_ds, pos.off, path_from_root, p_d)), p_policy(&pol) {}
 
 				 iterator(const position_and_path& pos, 
-				 	shared_ptr<basic_die> p_d = shared_ptr<basic_die>(),
+				 	adt_ptr<basic_die> p_d = adt_ptr<basic_die>(),
 					policy& pol = default_policy_sg)  
 				: iterator::iterator_adaptor_(iterator_base(
 					*pos.p_ds, pos.off, pos.path_from_root, p_d)), p_policy(&pol) {}
@@ -398,7 +408,7 @@ namespace dwarf
 			bool move_to_next_sibling(iterator& arg)
 			{ return move_to_next_sibling(arg.base_reference()); }
 			
-			virtual shared_ptr<file_toplevel_die> toplevel() = 0; /* NOT const */
+			virtual adt_ptr<file_toplevel_die> toplevel() = 0; /* NOT const */
 			virtual const spec::abstract_def& get_spec() const = 0;
 			
 			// we return the host address size by default
@@ -442,7 +452,7 @@ namespace dwarf
 		{ return arg1 == arg2 || arg1 > arg2; }
 
 		/* Key interface class. */
-		struct basic_die : public std::enable_shared_from_this<basic_die>
+		struct basic_die : public adt_counted<basic_die>
 		{
 			friend std::ostream& operator<<(std::ostream& s, const basic_die& d);
 			string to_string() const;
@@ -457,8 +467,8 @@ namespace dwarf
 
 			// recover a shared_ptr to this DIE, from a plain this ptr
 			// -- this is okay, because basic_dies are always refcounted
-			std::shared_ptr<basic_die> get_this();
-			std::shared_ptr<basic_die> get_this() const;
+			adt_ptr<basic_die> get_this();
+			adt_ptr<basic_die> get_this() const;
 
 			// children
 			// FIXME: iterator pair //virtual std::pair< > get_children() = 0;
@@ -489,13 +499,13 @@ namespace dwarf
 			 * The right place to do navigation is in iterators. */
 			
 			/* get_parent, normal and const */
-			virtual std::shared_ptr<basic_die> get_parent() __attribute__((deprecated)) = 0;
-			std::shared_ptr<basic_die> get_parent() const __attribute__((deprecated))
+			virtual adt_ptr<basic_die> get_parent() __attribute__((deprecated)) = 0;
+			adt_ptr<basic_die> get_parent() const __attribute__((deprecated))
 			{ return const_cast<basic_die *>(this)->get_parent(); }		   
 			
 			/* get_first_child, normal and const */
-			virtual std::shared_ptr<basic_die> get_first_child() __attribute__((deprecated)) = 0;
-			std::shared_ptr<basic_die> get_first_child() const __attribute__((deprecated))
+			virtual adt_ptr<basic_die> get_first_child() __attribute__((deprecated)) = 0;
+			adt_ptr<basic_die> get_first_child() const __attribute__((deprecated))
 			{ return const_cast<basic_die *>(this)->get_first_child(); }
 
 			/* Functions prefixed "get_" and returning offsets throw No_entry exceptions.
@@ -510,8 +520,8 @@ namespace dwarf
 				catch (No_entry) { return opt<Dwarf_Off>(); } }
 			
 			/* get_next_sibling, normal and onst */
-			virtual std::shared_ptr<basic_die> get_next_sibling() __attribute__((deprecated)) = 0;
-			std::shared_ptr<basic_die> get_next_sibling() const __attribute__((deprecated))
+			virtual adt_ptr<basic_die> get_next_sibling() __attribute__((deprecated)) = 0;
+			adt_ptr<basic_die> get_next_sibling() const __attribute__((deprecated))
 			{ return const_cast<basic_die *>(this)->get_next_sibling(); }
 
 			/* get_next_sibling_offset, normal and nothrow */
@@ -551,20 +561,20 @@ namespace dwarf
 			/* These, and other resolve()-style functions, are not const 
 			 * because they need to be able to return references to mutable
 			 * found DIEs. FIXME: provide const overloads. */
-			std::shared_ptr<basic_die> 
+			adt_ptr<basic_die> 
 			nearest_enclosing(Dwarf_Half tag) const __attribute__((deprecated));
-			std::shared_ptr<spec::basic_die> 
+			adt_ptr<spec::basic_die> 
 			nearest_enclosing(Dwarf_Half tag) __attribute__((deprecated)); /* non-const version */
-			virtual std::shared_ptr<compile_unit_die> 
+			virtual adt_ptr<compile_unit_die> 
 			enclosing_compile_unit() __attribute__((deprecated));
-			std::shared_ptr<const compile_unit_die> 
+			adt_ptr<const compile_unit_die> 
 			enclosing_compile_unit() const  __attribute__((deprecated))
-			{ return std::dynamic_pointer_cast<const compile_unit_die>(
+			{ return adt_cast<const compile_unit_die>(
 					const_cast<basic_die *>(this)->enclosing_compile_unit()); 
 			}
 
-			std::shared_ptr<basic_die>
-			find_sibling_ancestor_of(std::shared_ptr<basic_die> d) __attribute__((deprecated));
+			adt_ptr<basic_die>
+			find_sibling_ancestor_of(adt_ptr<basic_die> d) __attribute__((deprecated));
 		};
 		
 		struct with_static_location_die : public virtual basic_die
@@ -591,7 +601,7 @@ namespace dwarf
 		
 		struct with_type_describing_layout_die : public virtual basic_die
 		{
-			virtual opt<std::shared_ptr<spec::type_die> > get_type() const = 0;
+			virtual opt<adt_ptr<spec::type_die> > get_type() const = 0;
 		};
 
 		struct with_dynamic_location_die : public virtual with_type_describing_layout_die
@@ -617,7 +627,7 @@ namespace dwarf
 					Dwarf_Off dieset_relative_ip,
 					dwarf::lib::regs *p_regs = 0) const;
 		public:
-			virtual std::shared_ptr<spec::program_element_die> 
+			virtual adt_ptr<spec::program_element_die> 
 			get_instantiating_definition() const;
 			
 			virtual Dwarf_Addr calculate_addr(
@@ -650,26 +660,26 @@ namespace dwarf
 	    struct with_named_children_die : public virtual basic_die
         {
             virtual 
-            std::shared_ptr<basic_die>
+            adt_ptr<basic_die>
             named_child(const std::string& name);
 
             template <typename Iter>
-            std::shared_ptr<basic_die> 
+            adt_ptr<basic_die> 
             resolve(Iter path_pos, Iter path_end);
 
-            std::shared_ptr<basic_die> 
+            adt_ptr<basic_die> 
             resolve(const std::string& name);
 
             template <typename Iter>
-            std::shared_ptr<basic_die> 
+            adt_ptr<basic_die> 
             scoped_resolve(Iter path_pos, Iter path_end);
 
             template <typename Iter>
             void
             scoped_resolve_all(Iter path_pos, Iter path_end, 
-            	std::vector<std::shared_ptr<basic_die> >& results, int max = 0) 
+            	std::vector<adt_ptr<basic_die> >& results, int max = 0) 
             {
-            	std::shared_ptr<basic_die> found_from_here = resolve(path_pos, path_end);
+            	adt_ptr<basic_die> found_from_here = resolve(path_pos, path_end);
             	if (found_from_here) 
                 { 
                 	results.push_back(found_from_here); 
@@ -678,8 +688,8 @@ namespace dwarf
                 if (this->get_tag() == 0) return;
                 else // find our nearest encloser that has named children
                 {
-                	std::shared_ptr<spec::basic_die> p_encl = this->get_parent();
-                    while (std::dynamic_pointer_cast<with_named_children_die>(p_encl) == 0)
+                	adt_ptr<spec::basic_die> p_encl = this->get_parent();
+                    while (adt_cast<with_named_children_die>(p_encl) == 0)
                     {
                     	if (p_encl->get_tag() == 0) return;
                     	p_encl = p_encl->get_parent();
@@ -691,7 +701,7 @@ namespace dwarf
                 }
 			}            
 
-            std::shared_ptr<basic_die> 
+            adt_ptr<basic_die> 
             scoped_resolve(const std::string& name);
         };
         
@@ -699,8 +709,8 @@ namespace dwarf
         {
         public:
         	virtual 
-            std::shared_ptr<spec::basic_die> 
-            insert(Dwarf_Off key, std::shared_ptr<spec::basic_die> val) = 0;
+            adt_ptr<spec::basic_die> 
+            insert(Dwarf_Off key, adt_ptr<spec::basic_die> val) = 0;
         };
 
         
@@ -730,8 +740,8 @@ namespace dwarf
 #define stored_type_tag Dwarf_Half
 #define stored_type_loclist dwarf::encap::loclist
 #define stored_type_address dwarf::encap::attribute_value::address
-#define stored_type_refdie std::shared_ptr<spec::basic_die> 
-#define stored_type_refdie_is_type std::shared_ptr<spec::type_die> 
+#define stored_type_refdie adt_ptr<spec::basic_die> 
+#define stored_type_refdie_is_type adt_ptr<spec::type_die> 
 #define stored_type_rangelist dwarf::encap::rangelist
 
 #define attr_optional(name, stored_t) \
@@ -747,9 +757,9 @@ namespace dwarf
 #define super_attr_mandatory(name, stored_t)
 
 template<Dwarf_Half Tag>
-struct has_tag : public std::unary_function<std::shared_ptr<spec::basic_die>, bool>
+struct has_tag : public std::unary_function<adt_ptr<spec::basic_die>, bool>
 {
-	bool operator()(const std::shared_ptr<spec::basic_die> arg) const
+	bool operator()(const adt_ptr<spec::basic_die> arg) const
     { 
     	//std::cerr << "testing whether die at " << std::hex << arg->get_offset() << std::dec 
         //	<< " has tag " << Tag << std::endl;
@@ -783,9 +793,9 @@ struct with_iterator_partial_order : public Iter
 	: Iter(std::forward<Args>(args)...) {}
 };
 
-//typedef std::unary_function<std::shared_ptr<spec::basic_die>, std::shared_ptr<spec:: arg ## _die > > type_of_dynamic_pointer_cast;
+//typedef std::unary_function<adt_ptr<spec::basic_die>, std::shared_ptr<spec:: arg ## _die > > type_of_dynamic_pointer_cast;
 #define child_tag(arg) \
-	typedef std::shared_ptr<spec:: arg ## _die >(*type_of_dynamic_pointer_cast_ ## arg)(std::shared_ptr<spec::basic_die> const&); \
+	typedef adt_ptr<spec:: arg ## _die >(*type_of_dynamic_pointer_cast_ ## arg)(adt_ptr<spec::basic_die> const&); \
 	typedef boost::filter_iterator<has_tag< DW_TAG_ ## arg >, spec::abstract_dieset::iterator> arg ## _filter_iterator; \
 	typedef boost::transform_iterator<type_of_dynamic_pointer_cast_ ## arg, arg ## _filter_iterator> arg ## _transform_iterator; \
 	typedef with_iterator_partial_order<arg ## _transform_iterator> arg ## _iterator; \
@@ -794,14 +804,14 @@ struct with_iterator_partial_order : public Iter
 		arg ## _iterator( \
 		arg ## _transform_iterator(\
 		arg ## _filter_iterator(children_begin(), children_end()), \
-		 std::dynamic_pointer_cast<spec:: arg ## _die> \
+		 adt_cast<spec:: arg ## _die, spec::basic_die> \
 		)); } \
     arg ## _iterator arg ## _children_end() \
 	{ return \
 		arg ## _iterator(\
 		arg ## _transform_iterator(\
 		arg ## _filter_iterator(children_end(), children_end()), \
-		std::dynamic_pointer_cast<spec:: arg ## _die> \
+		adt_cast<spec:: arg ## _die, spec::basic_die> \
 		)); }
 
 		struct file_toplevel_die : public virtual with_named_children_die
@@ -813,7 +823,7 @@ struct with_iterator_partial_order : public Iter
 			
 			struct is_visible
 			{
-				bool operator()(std::shared_ptr<spec::basic_die> p) const;
+				bool operator()(adt_ptr<spec::basic_die> p) const;
 			};
 			
 			child_tag(compile_unit)
@@ -829,16 +839,16 @@ struct with_iterator_partial_order : public Iter
 			shared_ptr<visible_grandchildren_sequence_t> visible_grandchildren_sequence();
 
 			template <typename Iter>
-			std::shared_ptr<basic_die>
+			adt_ptr<basic_die>
 			resolve_visible(Iter path_pos, Iter path_end/*,
 				optional<visible_grandchildren_iterator> start_here
 					= optional<visible_grandchildren_iterator>()*/
 			);
 			template <typename Iter>
-			vector< std::shared_ptr<basic_die> >
+			vector< adt_ptr<basic_die> >
 			resolve_all_visible(Iter path_pos, Iter path_end);
 
-			virtual std::shared_ptr<basic_die>
+			virtual adt_ptr<basic_die>
 			visible_named_grandchild(const std::string& name);
 			
 		private:
@@ -862,14 +872,19 @@ struct with_iterator_partial_order : public Iter
 				visible_grandchildren_iterator end
 			);
 		private:
-			std::map<string, optional< vector< vg_cache_rec_t > > > visible_grandchildren_cache;
+			/* Keyed by interned name, so a lookup is one hash of the name and
+			 * then pointer comparisons. There's one toplevel per dieset, so
+			 * this is effectively the dieset's pool of toplevel names. */
+			string_pool vg_cache_names;
+			std::unordered_map<string_pool::handle, optional< vector< vg_cache_rec_t > > > visible_grandchildren_cache;
 			Dwarf_Off vg_cache_is_exhaustive_up_to_offset;
 			Dwarf_Off vg_max_offset_on_last_complete_search;
 			void vg_cache_stamp_reset()
 			{ vg_cache_is_exhaustive_up_to_offset = vg_max_offset_on_last_complete_search = 0UL; }
 		public:
 			void clear_vg_cache() { vg_cache_stamp_reset(); visible_grandchildren_cache.clear(); }
-			int clear_vg_cache(const string& key) { vg_cache_stamp_reset(); return visible_grandchildren_cache.erase(key); }
+			int clear_vg_cache(const string& key) 
+			{ vg_cache_stamp_reset(); return visible_grandchildren_cache.erase(vg_cache_names.find(key)); }
 			
 			struct visible_grandchildren_sequence_t
 			 : /* private */ public grandchildren_sequence_t 
@@ -923,7 +938,7 @@ struct with_iterator_partial_order : public Iter
 // 			map<vector<string>, position_and_path> first_defn_cache; 
 // 		public:
 // 			template <typename Iter>
-// 			std::shared_ptr<basic_die>
+// 			adt_ptr<basic_die>
 // 			resolve_visible_definition(Iter path_pos, Iter path_end/*,
 // 				optional<visible_grandchildren_iterator> start_here
 // 					= optional<visible_grandchildren_iterator>()*/
@@ -932,7 +947,7 @@ struct with_iterator_partial_order : public Iter
 		};
 // 		
 // 		template <typename Iter>
-// 		std::shared_ptr<basic_die>
+// 		adt_ptr<basic_die>
 // 		resolve_visible_definition(Iter path_pos, Iter path_end/*,
 // 			optional<visible_grandchildren_iterator> start_here
 // 				= optional<visible_grandchildren_iterator>()*/
@@ -959,26 +974,26 @@ end_class(program_element)
 begin_class(type, base_initializations(initialize_base(program_element)), declare_base(program_element))
         attr_optional(byte_size, unsigned)
         virtual opt<Dwarf_Unsigned> calculate_byte_size() const;
-        virtual bool is_rep_compatible(std::shared_ptr<type_die> arg) const;
-		virtual std::shared_ptr<type_die> get_concrete_type() const;
-		virtual std::shared_ptr<type_die> get_unqualified_type() const;
-        std::shared_ptr<type_die> get_concrete_type();
+        virtual bool is_rep_compatible(adt_ptr<type_die> arg) const;
+		virtual adt_ptr<type_die> get_concrete_type() const;
+		virtual adt_ptr<type_die> get_unqualified_type() const;
+        adt_ptr<type_die> get_concrete_type();
 end_class(type)
 /* type_chain_die */
 begin_class(type_chain, base_initializations(initialize_base(type)), declare_base(type))
         attr_optional(type, refdie_is_type)
         opt<Dwarf_Unsigned> calculate_byte_size() const;
-        std::shared_ptr<type_die> get_concrete_type() const;
+        adt_ptr<type_die> get_concrete_type() const;
 end_class(type_chain)
 /* qualified_type_die */
 begin_class(qualified_type, base_initializations(initialize_base(type_chain)), declare_base(type_chain))
-        virtual std::shared_ptr<type_die> get_unqualified_type() const;
-        std::shared_ptr<type_die> get_unqualified_type();
+        virtual adt_ptr<type_die> get_unqualified_type() const;
+        adt_ptr<type_die> get_unqualified_type();
 end_class(qualified_type)
 /* with_data_members_die */
 begin_class(with_data_members, base_initializations(initialize_base(type), initialize_base(with_named_children)), declare_base(type), declare_base(with_named_children))
         child_tag(member)
-		shared_ptr<type_die> find_my_own_definition() const; // for turning declarations into defns
+		adt_ptr<type_die> find_my_own_definition() const; // for turning declarations into defns
 end_class(with_data_members)
 
 #define has_stack_based_location \
@@ -1010,14 +1025,14 @@ end_class(with_data_members)
 #define extra_decls_compile_unit \
 		encap::rangelist normalize_rangelist(const encap::rangelist& rangelist) const; \
 		opt<Dwarf_Unsigned> implicit_array_base() const; \
-		shared_ptr<type_die> implicit_enum_base_type() const; \
+		adt_ptr<type_die> implicit_enum_base_type() const; \
 		virtual Dwarf_Half get_address_size() const { return this->get_ds().get_address_size(); } \
 		virtual std::string source_file_name(unsigned o) const = 0; \
 		virtual unsigned source_file_count() const = 0; \
 		abstract_dieset::iterator children_begin(); /* faster than the norm */ \
 		abstract_dieset::iterator children_end(); 
 #define extra_decls_subprogram \
-        opt< std::pair<Dwarf_Off, std::shared_ptr<spec::with_dynamic_location_die> > > \
+        opt< std::pair<Dwarf_Off, adt_ptr<spec::with_dynamic_location_die> > > \
         contains_addr_as_frame_local_or_argument( \
                     Dwarf_Addr absolute_addr, \
                     Dwarf_Off dieset_relative_ip, \
@@ -1032,30 +1047,30 @@ end_class(with_data_members)
 #define extra_decls_array_type \
 		opt<Dwarf_Unsigned> element_count() const; \
         opt<Dwarf_Unsigned> calculate_byte_size() const; \
-        bool is_rep_compatible(std::shared_ptr<type_die> arg) const; \
-		shared_ptr<type_die> ultimate_element_type() const; \
+        bool is_rep_compatible(adt_ptr<type_die> arg) const; \
+		adt_ptr<type_die> ultimate_element_type() const; \
 		opt<Dwarf_Unsigned> ultimate_element_count() const; 
 #define extra_decls_pointer_type \
-		std::shared_ptr<type_die> get_concrete_type() const; \
+		adt_ptr<type_die> get_concrete_type() const; \
         opt<Dwarf_Unsigned> calculate_byte_size() const; \
-        bool is_rep_compatible(std::shared_ptr<type_die> arg) const;
+        bool is_rep_compatible(adt_ptr<type_die> arg) const;
 #define extra_decls_reference_type \
-		std::shared_ptr<type_die> get_concrete_type() const; \
+		adt_ptr<type_die> get_concrete_type() const; \
         opt<Dwarf_Unsigned> calculate_byte_size() const; \
-        bool is_rep_compatible(std::shared_ptr<type_die> arg) const;
+        bool is_rep_compatible(adt_ptr<type_die> arg) const;
 #define extra_decls_base_type \
-		bool is_rep_compatible(std::shared_ptr<type_die> arg) const;
+		bool is_rep_compatible(adt_ptr<type_die> arg) const;
 #define extra_decls_structure_type \
 		opt<Dwarf_Unsigned> calculate_byte_size() const; \
-		bool is_rep_compatible(std::shared_ptr<type_die> arg) const; 
+		bool is_rep_compatible(adt_ptr<type_die> arg) const; 
 #define extra_decls_union_type \
-		bool is_rep_compatible(std::shared_ptr<type_die> arg) const; 
+		bool is_rep_compatible(adt_ptr<type_die> arg) const; 
 #define extra_decls_class_type \
-		bool is_rep_compatible(std::shared_ptr<type_die> arg) const; 
+		bool is_rep_compatible(adt_ptr<type_die> arg) const; 
 #define extra_decls_enumeration_type \
-		bool is_rep_compatible(std::shared_ptr<type_die> arg) const;
+		bool is_rep_compatible(adt_ptr<type_die> arg) const;
 #define extra_decls_subroutine_type \
-		bool is_rep_compatible(std::shared_ptr<type_die> arg) const;
+		bool is_rep_compatible(adt_ptr<type_die> arg) const;
 #define extra_decls_member \
 		opt<Dwarf_Unsigned> byte_offset_in_enclosing_type() const; \
 		has_object_based_location
@@ -1114,7 +1129,7 @@ end_class(with_data_members)
 /****************************************************************/
 
         template <typename Iter>
-        std::shared_ptr<basic_die> 
+        adt_ptr<basic_die> 
         with_named_children_die::resolve(Iter path_pos, Iter path_end)
         {
             /* We can't return "this" because it's not a shared_ptr, and we don't
@@ -1130,36 +1145,36 @@ end_class(with_data_members)
             else
             {
                 auto found = named_child(*path_pos);
-                if (!found) return shared_ptr<basic_die>();
+                if (!found) return adt_ptr<basic_die>();
                 auto p_next_hop =
-                    std::dynamic_pointer_cast<with_named_children_die>(found);
-                if (!p_next_hop) return shared_ptr<basic_die>();
+                    adt_cast<with_named_children_die>(found);
+                if (!p_next_hop) return adt_ptr<basic_die>();
                 else return p_next_hop->resolve(++path_pos, path_end);
             }
         }
         
         template <typename Iter>
-        std::shared_ptr<basic_die> 
+        adt_ptr<basic_die> 
         with_named_children_die::scoped_resolve(Iter path_pos, Iter path_end)
         {
             if (resolve(path_pos, path_end)) return this->get_ds().operator[](this->get_offset());
-            if (this->get_tag() == 0) return shared_ptr<basic_die>();
+            if (this->get_tag() == 0) return adt_ptr<basic_die>();
             else // find our nearest encloser that has named children
             {
-                std::shared_ptr<spec::basic_die> p_encl = this->get_parent();
-                while (std::dynamic_pointer_cast<with_named_children_die>(p_encl) == 0)
+                adt_ptr<spec::basic_die> p_encl = this->get_parent();
+                while (adt_cast<with_named_children_die>(p_encl) == 0)
                 {
-                    if (p_encl->get_tag() == 0) return shared_ptr<basic_die>();
+                    if (p_encl->get_tag() == 0) return adt_ptr<basic_die>();
                     p_encl = p_encl->get_parent();
                 }
                 // we've found an encl that has named children
-                return std::dynamic_pointer_cast<with_named_children_die>(p_encl)
+                return adt_cast<with_named_children_die>(p_encl)
                     ->scoped_resolve(path_pos, path_end);
             }
 		}
 		
 		template <typename Iter>
-		std::shared_ptr<basic_die>
+		adt_ptr<basic_die>
 		file_toplevel_die::resolve_visible(Iter path_pos, Iter path_end/*,
 			optional<visible_grandchildren_iterator> opt_start_here*/)
 		{
@@ -1168,7 +1183,7 @@ end_class(with_data_members)
 			{
 				auto p_next_hop = visible_named_grandchild(*path_pos/*, opt_start_here*/);
 				auto p_next_hop_with_children
-				 = dynamic_pointer_cast<with_named_children_die>(p_next_hop);
+				 = adt_cast<with_named_children_die>(p_next_hop);
 				if (!p_next_hop) return p_next_hop;
 				else
 				{
@@ -1180,7 +1195,7 @@ end_class(with_data_members)
 					{
 						// it's okay if we're terminating here
 						if (path_pos + 1 == path_end) return p_next_hop;
-						else return shared_ptr<basic_die>();
+						else return adt_ptr<basic_die>();
 					}
 					else
 					{
@@ -1193,7 +1208,7 @@ end_class(with_data_members)
 	
 // 			
 //             is_visible visible;
-//             std::shared_ptr<basic_die> found;
+//             adt_ptr<basic_die> found;
 //             for (auto i_cu = this->compile_unit_children_begin();
 //                     i_cu != this->compile_unit_children_end(); i_cu++)
 //             {
@@ -1209,7 +1224,7 @@ end_class(with_data_members)
 //                     if (!found_under_cu || 
 //                             !visible(found_under_cu)) continue;
 //                     auto p_next_hop =
-//                         std::dynamic_pointer_cast<with_named_children_die>(found_under_cu);
+//                         adt_cast<with_named_children_die>(found_under_cu);
 //                     if (!p_next_hop) continue; // try next compile unit
 //                     else 
 //                     { 
@@ -1219,11 +1234,11 @@ end_class(with_data_members)
 //                     }
 //                 }
 //             }
-//             if (found) return found; else return std::shared_ptr<basic_die>();
+//             if (found) return found; else return adt_ptr<basic_die>();
 //         }
 		
         template <typename Iter>
-        vector< std::shared_ptr<basic_die> >
+        vector< adt_ptr<basic_die> >
         file_toplevel_die::resolve_all_visible(Iter path_pos, Iter path_end)
         {
 			//if (path_pos == path_end) return vectorget_this();
@@ -1235,8 +1250,8 @@ end_class(with_data_members)
 			/* This is like resolve_visible but we push results into a vector
 			 * and keep going. */
 			optional<vg_cache_rec_t> next_start_pos;
-			shared_ptr<basic_die> last_resolved;
-			vector< std::shared_ptr<basic_die> > all_resolved;
+			adt_ptr<basic_die> last_resolved;
+			vector< adt_ptr<basic_die> > all_resolved;
 			auto vg_seq = visible_grandchildren_sequence();
 			
 			auto pos_is_end = [this](const vg_cache_rec_t& arg) {
@@ -1270,7 +1285,7 @@ end_class(with_data_members)
 					{
 						auto p_next_hop = *i_next_hop;
 						auto p_next_hop_with_children
-						 = dynamic_pointer_cast<with_named_children_die>(p_next_hop);
+						 = adt_cast<with_named_children_die>(p_next_hop);
 						/* NOTE: the wart with the recursion here is that 
 						 * we can't call resolve() on all DIEs that we might want
 						 * to terminate on, because the last hop needn't be a
@@ -1304,7 +1319,7 @@ end_class(with_data_members)
 // 					{
 // 						auto p_next_hop = *i_next_hop;
 // 						auto p_next_hop_with_children
-// 						 = dynamic_pointer_cast<with_named_children_die>(p_next_hop);
+// 						 = adt_cast<with_named_children_die>(p_next_hop);
 // 						/* NOTE: the wart with the recursion here is that 
 // 						 * we can't call resolve() on all DIEs that we might want
 // 						 * to terminate on, because the last hop needn't be a
@@ -1332,7 +1347,7 @@ end_class(with_data_members)
 // 			{
 // 				auto p_next_hop = visible_named_grandchild(*path_pos);
 // 				auto p_next_hop_with_children
-// 				 = dynamic_pointer_cast<with_named_children_die>(p_next_hop);
+// 				 = adt_cast<with_named_children_die>(p_next_hop);
 // 				if (!p_next_hop) return p_next_hop;
 // 				else
 // 				{
@@ -1348,7 +1363,7 @@ end_class(with_data_members)
 // 			}
 			
 //             is_visible visible;
-//             vector< std::shared_ptr<basic_die> > found;
+//             vector< adt_ptr<basic_die> > found;
 //             for (auto i_cu = this->compile_unit_children_begin();
 //                     i_cu != this->compile_unit_children_end(); i_cu++)
 //             {
@@ -1364,7 +1379,7 @@ end_class(with_data_members)
 //                     if (!found_under_cu || 
 //                             !visible(found_under_cu)) continue;
 //                     auto p_next_hop =
-//                         std::dynamic_pointer_cast<with_named_children_die>(found_under_cu);
+//                         adt_cast<with_named_children_die>(found_under_cu);
 //                     if (!p_next_hop) continue; // try next compile unit
 //                     else 
 //                     { 
@@ -1394,12 +1409,12 @@ end_class(with_data_members)
 		template <typename Action>
 		void
 		abstract_dieset::for_all_identical_types(
-			shared_ptr<type_die> p_t,
+			adt_ptr<type_die> p_t,
 			const Action& action
 		)
 		{
 			auto opt_ident_path = p_t->ident_path_from_cu();
-			vector< shared_ptr<type_die> > ts;
+			vector< adt_ptr<type_die> > ts;
 			if (!opt_ident_path) ts.push_back(p_t);
 			else
 			{
@@ -1407,9 +1422,9 @@ end_class(with_data_members)
 					i_cu != this->toplevel()->compile_unit_children_end(); ++i_cu)
 				{
 					auto candidate = (*i_cu)->resolve(opt_ident_path->begin(), opt_ident_path->end());
-					if (dynamic_pointer_cast<type_die>(candidate))
+					if (adt_cast<type_die>(candidate))
 					{
-						ts.push_back(dynamic_pointer_cast<type_die>(candidate));
+						ts.push_back(adt_cast<type_die>(candidate));
 					}
 				}
 			}
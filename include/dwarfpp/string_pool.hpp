@@ -0,0 +1,46 @@
+/* dwarfpp: C++ binding for a useful subset of libdwarf, plus extra goodies.
+ *
+ * string_pool.hpp: interned strings, for the names that a big binary's
+ * DWARF repeats over and over.
+ *
+ * Copyright (c) 2013, Stephen Kell.
+ */
+
+#ifndef DWARFPP_STRING_POOL_HPP_
+#define DWARFPP_STRING_POOL_HPP_
+
+#include <string>
+#include <unordered_set>
+#include <utility>
+
+namespace dwarf
+{
+	namespace lib
+	{
+		/* Keeps one copy of each distinct string put into it, and hands out
+		 * a pointer to that copy. The pointers stay valid until the pool
+		 * goes away (unordered_set never moves its elements), so two handles
+		 * from the same pool are equal exactly when their strings are.
+		 * NOTE: nothing is ever taken out. */
+		class string_pool
+		{
+			std::unordered_set<std::string> strings;
+		public:
+			typedef const std::string *handle;
+			typedef std::unordered_set<std::string>::size_type size_type;
+
+			handle intern(const std::string& s) { return &*strings.insert(s).first; }
+			handle intern(std::string&& s) { return &*strings.insert(std::move(s)).first; }
+			/* For lookups: if s was never interned, nothing can be keyed by it,
+			 * so we return null rather than growing the pool. */
+			handle find(const std::string& s) const
+			{
+				auto found = strings.find(s);
+				return (found == strings.end()) ? 0 : &*found;
+			}
+			size_type size() const { return strings.size(); }
+		};
+	}
+}
+
+#endif
@@ -0,0 +1,478 @@
+/* dwarfpp: C++ binding for a useful subset of libdwarf, plus extra goodies.
+ *
+ * accel.cpp: reading .debug_names, .gdb_index and pubnames.
+ *
+ * Copyright (c) 2013, Stephen Kell.
+ */
+
+#include "dwarfpp/accel.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+#ifndef DW_IDX_compile_unit
+#define DW_IDX_compile_unit 1
+#define DW_IDX_type_unit 2
+#define DW_IDX_die_offset 3
+#endif
+#ifndef DW_FORM_ref_sig8
+#define DW_FORM_ref_sig8 0x20
+#endif
+
+namespace dwarf
+{
+	namespace core
+	{
+		using namespace native_decode;
+		using std::make_pair;
+
+		static inline uint32_t read32_at(const unsigned char *p) { return read_fixed<uint32_t>(p); }
+		static inline uint64_t read64_at(const unsigned char *p) { return read_fixed<uint64_t>(p); }
+
+		static void add_candidate(vector<accel_index::candidate>& out, const accel_index::candidate& c)
+		{
+			if (std::find(out.begin(), out.end(), c) == out.end()) out.push_back(c);
+		}
+
+		/* .debug_names uses the DJB hash of the case-folded name. We only
+		 * fold ASCII, so we also try the unfolded hash, in case a producer
+		 * differs from us on non-ASCII names (or doesn't fold at all). */
+		static uint32_t djb_hash(const string& s, bool fold)
+		{
+			uint32_t h = 5381;
+			for (auto i_c = s.begin(); i_c != s.end(); ++i_c)
+			{
+				unsigned char c = *i_c;
+				if (fold && c >= 'A' && c <= 'Z') c += 'a' - 'A';
+				h = h * 33 + c;
+			}
+			return h;
+		}
+
+		/* This is mapped_index_string_hash in gdb. Before version 5,
+		 * it didn't lower-case, but we don't read those. */
+		static uint32_t gdb_index_hash(const string& s)
+		{
+			uint32_t h = 0;
+			for (auto i_c = s.begin(); i_c != s.end(); ++i_c)
+			{
+				unsigned char c = *i_c;
+				if (c >= 'A' && c <= 'Z') c += 'a' - 'A';
+				h = h * 67 + c - 113;
+			}
+			return h;
+		}
+
+		Dwarf_Off accel_index::names_table::cu_at(uint32_t i) const
+		{
+			const unsigned char *p = cu_list + i * offset_size;
+			return read_sized(p, offset_size);
+		}
+
+		const char *accel_index::names_table::name_at(uint32_t i, const debug_sections& s) const
+		{
+			const unsigned char *p = string_offsets + i * offset_size;
+			Dwarf_Off str_off = read_sized(p, offset_size);
+			if (str_off >= s.str.size) return nullptr;
+			return reinterpret_cast<const char *>(s.str.data + str_off);
+		}
+
+		bool accel_index::names_table::read_entries(uint32_t i, vector<candidate>& out) const
+		{
+			const unsigned char *p = entry_offsets + i * offset_size;
+			Dwarf_Off entry_off = read_sized(p, offset_size);
+			p = entry_pool + entry_off;
+			/* A series of entries, each starting with an abbrev code,
+			 * ending with a zero code. */
+			while (p < end)
+			{
+				Dwarf_Unsigned code = read_uleb128(p);
+				if (code == 0) return true;
+				auto found = abbrevs.find(code);
+				if (found == abbrevs.end()) return false;
+				bool have_cu = false, have_die = false, is_type_unit = false;
+				Dwarf_Unsigned cu_idx = 0, die_off = 0;
+				for (auto i_f = found->second.idx_forms.begin(); i_f != found->second.idx_forms.end(); ++i_f)
+				{
+					Dwarf_Unsigned val;
+					switch (i_f->second)
+					{
+						case DW_FORM_flag_present: val = 1; break;
+						case DW_FORM_data1: case DW_FORM_ref1: case DW_FORM_flag: val = read_sized(p, 1); break;
+						case DW_FORM_data2: case DW_FORM_ref2: val = read_sized(p, 2); break;
+						case DW_FORM_data4: case DW_FORM_ref4: val = read_sized(p, 4); break;
+						case DW_FORM_data8: case DW_FORM_ref8: case DW_FORM_ref_sig8: val = read_sized(p, 8); break;
+						case DW_FORM_udata: case DW_FORM_ref_udata: val = read_uleb128(p); break;
+						case DW_FORM_sdata: val = read_sleb128(p); break;
+						default: return false; // can't skip what we don't understand
+					}
+					switch (i_f->first)
+					{
+						case DW_IDX_compile_unit: have_cu = true; cu_idx = val; break;
+						case DW_IDX_type_unit: is_type_unit = true; break;
+						case DW_IDX_die_offset: have_die = true; die_off = val; break;
+						default: break;
+					}
+				}
+				if (is_type_unit || !have_die) continue;
+				// a table for a single CU can leave out the CU index
+				if (!have_cu && cu_count != 1) continue;
+				if (cu_idx >= cu_count) continue;
+				Dwarf_Off cu_off = cu_at(cu_idx);
+				candidate c = { cu_off, cu_off + die_off }; // die_off is unit-relative
+				add_candidate(out, c);
+			}
+			return false;
+		}
+
+		bool accel_index::read_debug_names(const debug_sections::section& s)
+		{
+			const debug_sections& sections = p_native->sections();
+			const unsigned char *p = s.data;
+			/* There may be several tables, e.g. one per CU if the linker
+			 * just concatenated them. */
+			while (p + 4 <= s.end())
+			{
+				names_table t;
+				uint64_t length = read_fixed<uint32_t>(p);
+				t.offset_size = 4;
+				if (length == 0xffffffff)
+				{
+					if (p + 8 > s.end()) return false;
+					length = read_fixed<uint64_t>(p);
+					t.offset_size = 8;
+				}
+				if (length > (uint64_t)(s.end() - p) || length < 32) return false;
+				t.end = p + length;
+				uint16_t version = read_fixed<uint16_t>(p);
+				read_fixed<uint16_t>(p); // padding
+				if (version != 5) return false;
+				t.cu_count = read_fixed<uint32_t>(p);
+				t.local_tu_count = read_fixed<uint32_t>(p);
+				uint32_t foreign_tu_count = read_fixed<uint32_t>(p);
+				t.bucket_count = read_fixed<uint32_t>(p);
+				t.name_count = read_fixed<uint32_t>(p);
+				uint32_t abbrev_table_size = read_fixed<uint32_t>(p);
+				uint32_t augmentation_size = read_fixed<uint32_t>(p);
+				uint64_t needed = (uint64_t) augmentation_size
+					+ ((uint64_t) t.cu_count + t.local_tu_count) * t.offset_size
+					+ (uint64_t) foreign_tu_count * 8
+					+ (uint64_t) t.bucket_count * 4
+					+ (t.bucket_count ? (uint64_t) t.name_count * 4 : 0)
+					+ (uint64_t) t.name_count * 2 * t.offset_size
+					+ abbrev_table_size;
+				if (needed > (uint64_t)(t.end - p)) return false;
+				p += augmentation_size;
+				t.cu_list = p;
+				p += t.cu_count * t.offset_size;
+				p += t.local_tu_count * t.offset_size + foreign_tu_count * 8; // we don't do TUs
+				t.buckets = p;
+				p += t.bucket_count * 4;
+				t.hashes = p;
+				if (t.bucket_count) p += t.name_count * 4;
+				t.string_offsets = p;
+				p += t.name_count * t.offset_size;
+				t.entry_offsets = p;
+				p += t.name_count * t.offset_size;
+				t.entry_pool = p + abbrev_table_size;
+				while (p < t.entry_pool)
+				{
+					Dwarf_Unsigned code = read_uleb128(p);
+					if (code == 0) break;
+					names_table::abbrev a;
+					a.tag = read_uleb128(p);
+					while (true)
+					{
+						if (p >= t.entry_pool) return false;
+						Dwarf_Unsigned idx = read_uleb128(p);
+						Dwarf_Unsigned form = read_uleb128(p);
+						if (idx == 0 && form == 0) break;
+						a.idx_forms.push_back(make_pair(idx, (Dwarf_Half) form));
+					}
+					t.abbrevs[code] = a;
+				}
+				p = t.end;
+
+				if (t.bucket_count != 0) names_tables.push_back(std::move(t));
+				else
+				{
+					/* The hash table is optional; if it's not there, make our own. */
+					for (uint32_t i = 0; i < t.name_count; ++i)
+					{
+						const char *name = t.name_at(i, sections);
+						if (!name) continue;
+						vector<candidate> found;
+						t.read_entries(i, found);
+						for (auto i_c = found.begin(); i_c != found.end(); ++i_c)
+						{
+							hashed.insert(make_pair(string(name), *i_c));
+						}
+					}
+				}
+			}
+			return !names_tables.empty() || !hashed.empty();
+		}
+
+		bool accel_index::read_gdb_index(const debug_sections::section& s)
+		{
+			if (s.size < 24) return false;
+			const unsigned char *p = s.data;
+			uint32_t version = read_fixed<uint32_t>(p);
+			if (version < 5 || version > 8) return false;
+			uint32_t cu_list_off = read_fixed<uint32_t>(p);
+			uint32_t types_list_off = read_fixed<uint32_t>(p);
+			uint32_t address_area_off = read_fixed<uint32_t>(p);
+			uint32_t symbol_table_off = read_fixed<uint32_t>(p);
+			uint32_t constant_pool_off = read_fixed<uint32_t>(p);
+			if (!(cu_list_off <= types_list_off && types_list_off <= address_area_off
+				&& address_area_off <= symbol_table_off && symbol_table_off <= constant_pool_off
+				&& constant_pool_off <= s.size)) return false;
+			gdb_index_version = version;
+			gdb_cu_list = s.data + cu_list_off;
+			gdb_cu_count = (types_list_off - cu_list_off) / 16; // offset and length, 8 bytes each
+			gdb_symbol_table = s.data + symbol_table_off;
+			gdb_symbol_slots = (constant_pool_off - symbol_table_off) / 8;
+			gdb_constant_pool = s.data + constant_pool_off;
+			gdb_end = s.end();
+			return gdb_symbol_slots != 0 && (gdb_symbol_slots & (gdb_symbol_slots - 1)) == 0;
+		}
+
+		bool accel_index::read_pubnames(const debug_sections::section& s, bool gnu)
+		{
+			const unsigned char *p = s.data;
+			while (p + 4 <= s.end())
+			{
+				unsigned offset_size = 4;
+				uint64_t length = read_fixed<uint32_t>(p);
+				if (length == 0xffffffff)
+				{
+					if (p + 8 > s.end()) return false;
+					length = read_fixed<uint64_t>(p);
+					offset_size = 8;
+				}
+				if (length > (uint64_t)(s.end() - p) || length < 2 + 2 * offset_size) return false;
+				const unsigned char *set_end = p + length;
+				uint16_t version = read_fixed<uint16_t>(p);
+				if (version != 2) { p = set_end; continue; }
+				Dwarf_Off cu_off = read_sized(p, offset_size);
+				read_sized(p, offset_size); // length of the CU
+				while (p + offset_size <= set_end)
+				{
+					Dwarf_Off die_off = read_sized(p, offset_size);
+					if (die_off == 0) break;
+					if (gnu) ++p; // GDB's flags byte
+					const void *nul = (p < set_end) ? memchr(p, 0, set_end - p) : nullptr;
+					if (!nul) return false;
+					candidate c = { cu_off, cu_off + die_off };
+					hashed.insert(make_pair(string(reinterpret_cast<const char *>(p)), c));
+					p = static_cast<const unsigned char *>(nul) + 1;
+				}
+				p = set_end;
+			}
+			return true;
+		}
+
+		shared_ptr<accel_index> accel_index::open(shared_ptr<const native_root_die> p_native)
+		{
+			/* We find the DIEs that the tables point at by decoding natively,
+			 * so we can't answer for units that the decoder left out. */
+			if (!p_native || !p_native->complete()) return shared_ptr<accel_index>();
+			const debug_sections& s = p_native->sections();
+			shared_ptr<accel_index> p;
+			auto debug_names = s.get(".debug_names");
+			if (debug_names)
+			{
+				p.reset(new accel_index(p_native, DEBUG_NAMES));
+				if (p->read_debug_names(debug_names)) return p;
+			}
+			auto gdb_index = s.get(".gdb_index");
+			if (gdb_index)
+			{
+				p.reset(new accel_index(p_native, GDB_INDEX));
+				if (p->read_gdb_index(gdb_index)) return p;
+			}
+			p.reset(new accel_index(p_native, PUBNAMES));
+			const char *pub_sections[] = { ".debug_pubnames", ".debug_pubtypes",
+				".debug_gnu_pubnames", ".debug_gnu_pubtypes" };
+			for (unsigned i = 0; i < sizeof pub_sections / sizeof pub_sections[0]; ++i)
+			{
+				auto pub = s.get(pub_sections[i]);
+				// a malformed set stops us reading the section, but we keep what we got
+				if (pub) p->read_pubnames(pub, i >= 2);
+			}
+			return p->hashed.empty() ? shared_ptr<accel_index>() : p;
+		}
+
+		void accel_index::lookup_gdb_index(const string& name, vector<candidate>& out) const
+		{
+			uint32_t h = gdb_index_hash(name);
+			uint32_t mask = gdb_symbol_slots - 1;
+			uint32_t step = ((h * 17) & mask) | 1;
+			uint64_t pool_size = gdb_end - gdb_constant_pool;
+			for (uint32_t slot = h & mask, probes = 0; probes < gdb_symbol_slots;
+				slot = (slot + step) & mask, ++probes)
+			{
+				const unsigned char *p = gdb_symbol_table + 8 * slot;
+				uint32_t name_off = read32_at(p);
+				uint32_t vec_off = read32_at(p + 4);
+				if (name_off == 0 && vec_off == 0) return; // empty slot, so not there
+				if (name_off >= pool_size || (uint64_t) vec_off + 4 > pool_size) return;
+				if (0 != strcmp(name.c_str(), reinterpret_cast<const char *>(gdb_constant_pool + name_off))) continue;
+				const unsigned char *v = gdb_constant_pool + vec_off;
+				uint32_t count = read_fixed<uint32_t>(v);
+				if (count > (uint64_t)(gdb_end - v) / 4) return;
+				for (uint32_t i = 0; i < count; ++i)
+				{
+					uint32_t val = read_fixed<uint32_t>(v);
+					// from version 7, the top byte holds the symbol kind
+					uint32_t cu = (gdb_index_version >= 7) ? (val & 0xffffff) : val;
+					if (cu >= gdb_cu_count) continue; // a type unit
+					candidate c = { read64_at(gdb_cu_list + 16 * cu), 0 };
+					add_candidate(out, c);
+				}
+				return;
+			}
+		}
+
+		void accel_index::lookup(const string& name, vector<candidate>& out) const
+		{
+			const debug_sections& s = p_native->sections();
+			switch (k)
+			{
+				case DEBUG_NAMES:
+					for (auto i_t = names_tables.begin(); i_t != names_tables.end(); ++i_t)
+					{
+						uint32_t hashes[] = { djb_hash(name, true), djb_hash(name, false) };
+						for (unsigned n = 0; n < (hashes[0] == hashes[1] ? 1u : 2u); ++n)
+						{
+							uint32_t h = hashes[n];
+							uint32_t bucket = h % i_t->bucket_count;
+							uint32_t first = read32_at(i_t->buckets + 4 * bucket);
+							if (first == 0) continue; // empty bucket
+							for (uint32_t i = first - 1; i < i_t->name_count; ++i)
+							{
+								uint32_t h_here = read32_at(i_t->hashes + 4 * i);
+								if (h_here % i_t->bucket_count != bucket) break;
+								if (h_here != h) continue;
+								const char *name_here = i_t->name_at(i, s);
+								if (name_here && name == name_here) i_t->read_entries(i, out);
+							}
+						}
+					}
+					break;
+				case GDB_INDEX:
+					lookup_gdb_index(name, out);
+					break;
+				default:
+					break;
+			}
+			auto range = hashed.equal_range(name);
+			for (auto i_c = range.first; i_c != range.second; ++i_c) add_candidate(out, i_c->second);
+		}
+
+		static bool is_visible_named(const native_iterator_df& i, const string& name)
+		{
+			const char *name_here = i.name_here();
+			if (!name_here || name != name_here) return false;
+			auto vis = (*i).attr_unsigned(DW_AT_visibility);
+			return !vis || *vis != DW_VIS_local;
+		}
+		
+		vector<Dwarf_Off> accel_index::visible_grandchildren(const string& name) const
+		{
+			vector<candidate> candidates;
+			lookup(name, candidates);
+			vector<Dwarf_Off> out;
+			for (auto i_c = candidates.begin(); i_c != candidates.end(); ++i_c)
+			{
+				if (i_c->die_offset != 0)
+				{
+					auto i = p_native->pos(i_c->die_offset);
+					if (i != p_native->end() && i.depth() == 2 && is_visible_named(i, name)) out.push_back(i.offset_here());
+					continue;
+				}
+				/* We only know the CU, so search its children, skipping
+				 * their subtrees. */
+				const unit_header *p_u = p_native->unit_containing(i_c->cu_offset);
+				if (!p_u || p_u->offset != i_c->cu_offset) continue;
+				auto i = p_native->pos(p_u->first_die_offset);
+				if (i == p_native->end()) continue;
+				for (++i; i != p_native->end() && i.depth() == 2 && i.offset_here() < p_u->end_offset;
+					i.increment_skipping_subtree())
+				{
+					if (is_visible_named(i, name)) out.push_back(i.offset_here());
+				}
+			}
+			std::sort(out.begin(), out.end());
+			out.erase(std::unique(out.begin(), out.end()), out.end());
+			return out;
+		}
+		
+		bool accel_index::may_omit(const native_iterator_df& i) const
+		{
+			/* Err on the side of yes: that only costs a bigger omitted map. */
+			auto decl = (*i).attr_unsigned(DW_AT_declaration);
+			if (decl && *decl) return true; // nobody lists declarations
+			switch (i.tag_here())
+			{
+				case DW_TAG_subprogram:
+					if (!i.has_attr_here(DW_AT_low_pc) && !i.has_attr_here(DW_AT_ranges)
+						&& !i.has_attr_here(DW_AT_entry_pc)) return true;
+					break;
+				case DW_TAG_variable:
+					if (!i.has_attr_here(DW_AT_location) && !i.has_attr_here(DW_AT_const_value)) return true;
+					break;
+				case DW_TAG_base_type: case DW_TAG_typedef: case DW_TAG_structure_type:
+				case DW_TAG_union_type: case DW_TAG_class_type: case DW_TAG_enumeration_type:
+				case DW_TAG_namespace:
+					// .debug_names lists these; the others only list functions and variables
+					return k != DEBUG_NAMES;
+				default:
+					return true;
+			}
+			if (k == DEBUG_NAMES) return false;
+			// pubnames only lists external names, and we assume .gdb_index might too
+			auto ext = (*i).attr_unsigned(DW_AT_external);
+			return !ext || !*ext;
+		}
+
+		void accel_index::find_omitted() const
+		{
+			const vector<unit_header>& units = p_native->unit_headers();
+			for (auto i_u = units.begin(); i_u != units.end(); ++i_u)
+			{
+				auto i = p_native->pos(i_u->first_die_offset);
+				if (i == p_native->end()) continue;
+				for (++i; i != p_native->end() && i.depth() == 2 && i.offset_here() < i_u->end_offset;
+					i.increment_skipping_subtree())
+				{
+					const char *name = i.name_here();
+					if (!name)
+					{
+						/* A name we can't decode (e.g. dwz's DW_FORM_GNU_strp_alt)
+						 * might be anything. */
+						if (i.has_attr_here(DW_AT_name) && first_undecodable == 0) first_undecodable = i.offset_here();
+						continue;
+					}
+					if (!may_omit(i) || !is_visible_named(i, name)) continue;
+					omitted.insert(make_pair(string(name), i.offset_here())); // keeps the first
+				}
+			}
+		}
+		
+		Dwarf_Off accel_index::first_visible_grandchild(const string& name) const
+		{
+			std::call_once(omitted_once, [this]() { find_omitted(); });
+			vector<Dwarf_Off> found = visible_grandchildren(name);
+			Dwarf_Off first = found.empty() ? 0UL : found.front();
+			auto i_omitted = omitted.find(name);
+			if (i_omitted != omitted.end() && (first == 0UL || i_omitted->second < first))
+			{
+				first = i_omitted->second;
+			}
+			// if a name we can't decode comes first, it might be this one
+			if (first_undecodable != 0UL && (first == 0UL || first_undecodable < first)) return 0UL;
+			return first;
+		}
+	}
+}
@@ -7,6 +7,8 @@
 #include "spec_adt.hpp"
 #include "adt.hpp"
 #include "attr.hpp"
+#include "name_index.hpp"
+#include "accel.hpp"
 #include "cxx_compiler.hpp" // FIXME: factor out the "base type alias description" & use just that
 
 #include <srk31/algorithm.hpp>
@@ -48,9 +50,9 @@ namespace dwarf
 		{
 			cerr << *this;
 		}
-        std::shared_ptr<basic_die> basic_die::get_this()
+        adt_ptr<basic_die> basic_die::get_this()
         { return this->get_ds()[this->get_offset()]; }
-        std::shared_ptr<basic_die> basic_die::get_this() const
+        adt_ptr<basic_die> basic_die::get_this() const
         { return this->get_ds()[this->get_offset()]; }
 
         opt<std::vector<std::string> >
@@ -131,12 +133,12 @@ namespace dwarf
 				return built;
 			}
 		}
-		std::shared_ptr<spec::basic_die> 
+		adt_ptr<spec::basic_die> 
 		basic_die::nearest_enclosing(Dwarf_Half tag) const
 		{
 			return const_cast<basic_die *>(this)->nearest_enclosing(tag);
 		}
-		std::shared_ptr<spec::basic_die> 
+		adt_ptr<spec::basic_die> 
 		basic_die::nearest_enclosing(Dwarf_Half tag) 
 		{
 			// instead use more efficient (and hopefully correct!) iterative approach
@@ -152,24 +154,24 @@ namespace dwarf
 					return this->get_ds()[*path_iter];
 				}
 			}
-			return std::shared_ptr<spec::basic_die>();
+			return adt_ptr<spec::basic_die>();
 		}
 
-		std::shared_ptr<compile_unit_die> 
+		adt_ptr<compile_unit_die> 
 		basic_die::enclosing_compile_unit()
 		{
 			// HACK: special case: compile units enclose themselves (others don't)
 			// -- see with_static_location_die::contains_addr for motivation
 			if (get_tag() == DW_TAG_compile_unit) 
 			{
-				return dynamic_pointer_cast<compile_unit_die>(shared_from_this());
+				return adt_cast<compile_unit_die>(shared_from_this());
 			}
 			
 			/* We use the cu_info maintained by file_toplevel_die to implement
 			 * this faster than the more general nearest_enclosing(tag). */
 			
 			
-			return std::dynamic_pointer_cast<compile_unit_die>(
+			return adt_cast<compile_unit_die>(
 				nearest_enclosing(DW_TAG_compile_unit)
 			);
 		}
@@ -201,11 +203,11 @@ namespace dwarf
 	}
 	namespace lib 
 	{
-		std::shared_ptr<spec::compile_unit_die> 
+		adt_ptr<spec::compile_unit_die> 
 		basic_die::enclosing_compile_unit() 
 		{
 			Dwarf_Off my_offset = get_offset();
-			auto toplevel = dynamic_pointer_cast<file_toplevel_die>(get_ds().toplevel());
+			auto toplevel = adt_cast<file_toplevel_die>(get_ds().toplevel());
 
 			/* We use the cu_info maintained by file_toplevel_die to implement
 			 * this faster than the more general nearest_enclosing(tag). */
@@ -223,7 +225,7 @@ namespace dwarf
 			//	<< " yielded " << ((cu_entry == toplevel->cu_info.end()) ? " no " : " an ")
 			//	<< " entry." << std::endl;
 			assert(cu_entry != toplevel->cu_info.end());
-			auto p_d = dynamic_pointer_cast<spec::compile_unit_die>(
+			auto p_d = adt_cast<spec::compile_unit_die>(
 				get_ds()[cu_entry->first]
 			);
 			assert(p_d);
@@ -234,13 +236,13 @@ namespace dwarf
 	}
 	namespace spec
 	{
-        std::shared_ptr<spec::basic_die>
-        basic_die::find_sibling_ancestor_of(std::shared_ptr<spec::basic_die> p_d) 
+        adt_ptr<spec::basic_die>
+        basic_die::find_sibling_ancestor_of(adt_ptr<spec::basic_die> p_d) 
         {
             // search upward from the argument die to find a sibling of us
             if (p_d.get() == dynamic_cast<spec::basic_die*>(this)) return p_d;
-            else if (p_d->get_offset() == 0UL) return shared_ptr<basic_die>(); // reached the top without finding anything
-            else if (this->get_offset() == 0UL) return shared_ptr<basic_die>(); // we have no siblings
+            else if (p_d->get_offset() == 0UL) return adt_ptr<basic_die>(); // reached the top without finding anything
+            else if (this->get_offset() == 0UL) return adt_ptr<basic_die>(); // we have no siblings
             else if (p_d->get_parent() == this->get_parent()) // we are siblings
             {
                 return p_d;
@@ -405,7 +407,7 @@ namespace dwarf
 						if (found_type == attrs.end()) goto out;
 						else
 						{
-							auto calculated_byte_size = dynamic_pointer_cast<spec::type_die>(
+							auto calculated_byte_size = adt_cast<spec::type_die>(
 								get_ds()[found_type->second.get_ref().off]
 							)->calculate_byte_size();
 							assert(calculated_byte_size);
@@ -614,7 +616,7 @@ namespace dwarf
 			}
 		}
 /* from spec::subprogram_die */
-		opt< std::pair<Dwarf_Off, std::shared_ptr<with_dynamic_location_die> > >
+		opt< std::pair<Dwarf_Off, adt_ptr<with_dynamic_location_die> > >
         subprogram_die::contains_addr_as_frame_local_or_argument( 
             	    Dwarf_Addr absolute_addr, 
                     Dwarf_Off dieset_relative_ip, 
@@ -659,7 +661,7 @@ namespace dwarf
 					 * we increment *with* enqueueing children.
 					 * Otherwise we increment without enqueueing children.
 					 */
-					if (dynamic_pointer_cast<spec::with_dynamic_location_die>(base.p_d))
+					if (adt_cast<spec::with_dynamic_location_die>(base.p_d))
 					{
 						return super::increment(base);
 					}
@@ -687,7 +689,7 @@ namespace dwarf
                     ++i_bfs)
             {
             	std::cerr << "Considering whether DIE has stack location: " << (*i_bfs)->summary() << std::endl;
-            	auto with_stack_loc = std::dynamic_pointer_cast<spec::with_dynamic_location_die>(
+            	auto with_stack_loc = adt_cast<spec::with_dynamic_location_die>(
                 	*i_bfs);
                 if (!with_stack_loc) continue;
                 
@@ -697,7 +699,7 @@ namespace dwarf
                     p_regs);
                 if (result) return std::make_pair(*result, with_stack_loc);
             }
-            return opt< std::pair<Dwarf_Off, std::shared_ptr<with_dynamic_location_die> > >();
+            return opt< std::pair<Dwarf_Off, adt_ptr<with_dynamic_location_die> > >();
         }
         bool subprogram_die::is_variadic() const
         {
@@ -716,7 +718,7 @@ namespace dwarf
             return false;
         }
 /* from spec::with_dynamic_location_die */
-		std::shared_ptr<spec::program_element_die> 
+		adt_ptr<spec::program_element_die> 
 		with_dynamic_location_die::get_instantiating_definition() const
 		{
 			/* We want to return a parent DIE describing the thing whose instances
@@ -729,18 +731,18 @@ namespace dwarf
 			if (this->get_tag() == DW_TAG_formal_parameter
 			||  this->get_tag() == DW_TAG_variable) 
 			{
-				return std::dynamic_pointer_cast<dwarf::spec::program_element_die>(
+				return adt_cast<dwarf::spec::program_element_die>(
 					nearest_enclosing(DW_TAG_subprogram));
 			}
 			else
 			{
-				std::shared_ptr<dwarf::spec::basic_die> candidate = this->get_parent();
+				adt_ptr<dwarf::spec::basic_die> candidate = this->get_parent();
 				while (candidate 
-					&& !std::dynamic_pointer_cast<dwarf::spec::type_die>(candidate))
+					&& !adt_cast<dwarf::spec::type_die>(candidate))
 				{
 					candidate = candidate->get_parent();
 				}
-				return std::dynamic_pointer_cast<dwarf::spec::program_element_die>(candidate);
+				return adt_cast<dwarf::spec::program_element_die>(candidate);
 			}
 		}
 
@@ -878,7 +880,7 @@ namespace dwarf
 				std::stack<Dwarf_Unsigned>(std::deque<Dwarf_Unsigned>(1, object_base_addr))).tos();
 		}
 /* from spec::with_named_children_die */
-        std::shared_ptr<spec::basic_die>
+        adt_ptr<spec::basic_die>
         with_named_children_die::named_child(const std::string& name) 
         { 
 			try
@@ -891,10 +893,10 @@ namespace dwarf
                     	&& *current->get_name() == name) return current;
                 }
             }
-            catch (No_entry) { return shared_ptr<spec::basic_die>(); }
+            catch (No_entry) { return adt_ptr<spec::basic_die>(); }
         }
 
-        std::shared_ptr<spec::basic_die> 
+        adt_ptr<spec::basic_die> 
         with_named_children_die::resolve(const std::string& name) 
         {
             std::vector<std::string> multipart_name;
@@ -902,7 +904,7 @@ namespace dwarf
             return resolve(multipart_name.begin(), multipart_name.end());
         }
 
-        std::shared_ptr<spec::basic_die> 
+        adt_ptr<spec::basic_die> 
         with_named_children_die::scoped_resolve(const std::string& name) 
         {
             std::vector<std::string> multipart_name;
@@ -956,7 +958,7 @@ namespace dwarf
 					return opt<Dwarf_Unsigned>();
 			}
 		}
-		shared_ptr<type_die> compile_unit_die::implicit_enum_base_type() const
+		adt_ptr<type_die> compile_unit_die::implicit_enum_base_type() const
 		{
 			auto nonconst_this = const_cast<compile_unit_die *>(this);
 			switch(this->get_language())
@@ -970,12 +972,12 @@ namespace dwarf
 					for (auto i_attempt = 0; i_attempt < total_attempts; ++i_attempt)
 					{
 						auto found = nonconst_this->named_child(attempts[i_attempt]);
-						if (found) return dynamic_pointer_cast<type_die>(found);
+						if (found) return adt_cast<type_die>(found);
 					}
 					assert(false && "enum but no int or signed int");
 				}
 				default:
-					return shared_ptr<type_die>();
+					return adt_ptr<type_die>();
 			}
 		}
 		
@@ -1016,30 +1018,30 @@ namespace dwarf
 			if (this->get_byte_size()) return *this->get_byte_size();
 			else return opt<Dwarf_Unsigned>();
 		}
-		std::shared_ptr<type_die> type_die::get_concrete_type() const
+		adt_ptr<type_die> type_die::get_concrete_type() const
 		{
 			// by default, our concrete self is our self
-			return std::dynamic_pointer_cast<type_die>(
+			return adt_cast<type_die>(
 				const_cast<type_die*>(this)->shared_from_this());
 		} 
-		std::shared_ptr<type_die> type_die::get_concrete_type()
+		adt_ptr<type_die> type_die::get_concrete_type()
 		{
 			return const_cast<const type_die *>(this)->get_concrete_type();
 		}
-		std::shared_ptr<type_die> type_die::get_unqualified_type() const
+		adt_ptr<type_die> type_die::get_unqualified_type() const
 		{
 			// by default, our unqualified self is our self
-			return std::dynamic_pointer_cast<type_die>(
+			return adt_cast<type_die>(
 				const_cast<type_die*>(this)->shared_from_this());
 		} 
 /* from spec::qualified_type_die */
-		std::shared_ptr<type_die> qualified_type_die::get_unqualified_type() const
+		adt_ptr<type_die> qualified_type_die::get_unqualified_type() const
 		{
 			// for qualified types, our unqualified self is our get_type, recursively unqualified
-			if (!this->get_type()) return shared_ptr<type_die>();
+			if (!this->get_type()) return adt_ptr<type_die>();
 			return this->get_type()->get_unqualified_type();
 		} 
-		std::shared_ptr<type_die> qualified_type_die::get_unqualified_type()
+		adt_ptr<type_die> qualified_type_die::get_unqualified_type()
 		{
 			return const_cast<const qualified_type_die *>(this)->get_unqualified_type();
 		}
@@ -1064,7 +1066,7 @@ namespace dwarf
 				return opt<Dwarf_Unsigned>();
 			}
 		}
-        std::shared_ptr<type_die> type_chain_die::get_concrete_type() const
+        adt_ptr<type_die> type_chain_die::get_concrete_type() const
         {
         	// pointer and reference *must* override us -- they do not follow chain
         	assert(this->get_tag() != DW_TAG_pointer_type
@@ -1072,15 +1074,15 @@ namespace dwarf
 
             if (!this->get_type()) 
             {
-            	return //std::dynamic_pointer_cast<type_die>(get_this()); // broken chain
-					std::shared_ptr<type_die>();
+            	return //adt_cast<type_die>(get_this()); // broken chain
+					adt_ptr<type_die>();
             }
             else return const_cast<type_chain_die*>(this)->get_type()->get_concrete_type();
         }
 /* from spec::pointer_type_die */  
-        std::shared_ptr<type_die> pointer_type_die::get_concrete_type() const 
+        adt_ptr<type_die> pointer_type_die::get_concrete_type() const 
         {
-        	return std::dynamic_pointer_cast<pointer_type_die>(get_this()); 
+        	return adt_cast<pointer_type_die>(get_this()); 
         }
         opt<Dwarf_Unsigned> pointer_type_die::calculate_byte_size() const 
         {
@@ -1088,9 +1090,9 @@ namespace dwarf
 			else return this->enclosing_compile_unit()->get_address_size();
         }
 /* from spec::reference_type_die */  
-        std::shared_ptr<type_die> reference_type_die::get_concrete_type() const 
+        adt_ptr<type_die> reference_type_die::get_concrete_type() const 
         {
-        	return std::dynamic_pointer_cast<reference_type_die>(get_this()); 
+        	return adt_cast<reference_type_die>(get_this()); 
         }
         opt<Dwarf_Unsigned> reference_type_die::calculate_byte_size() const 
         {
@@ -1109,7 +1111,7 @@ namespace dwarf
                 {
                 	if (child->get_tag() == DW_TAG_subrange_type)
                     {
-            	        auto subrange = std::dynamic_pointer_cast<subrange_type_die>(child);
+            	        auto subrange = adt_cast<subrange_type_die>(child);
                         if (subrange->get_count()) 
                         {
                         	count = *subrange->get_count();
@@ -1155,15 +1157,15 @@ namespace dwarf
             else return opt<Dwarf_Unsigned>();
 		}
 		
-		shared_ptr<type_die> array_type_die::ultimate_element_type() const
+		adt_ptr<type_die> array_type_die::ultimate_element_type() const
 		{
 			auto nonconst_this = const_cast<array_type_die *>(this);
-			shared_ptr<type_die> cur
-			 = dynamic_pointer_cast<type_die>(nonconst_this->shared_from_this());
+			adt_ptr<type_die> cur
+			 = adt_cast<type_die>(nonconst_this->shared_from_this());
 			while (cur->get_concrete_type()
 				 && cur->get_concrete_type()->get_tag() == DW_TAG_array_type)
 			{
-				cur = dynamic_pointer_cast<array_type_die>(cur->get_concrete_type())->get_type();
+				cur = adt_cast<array_type_die>(cur->get_concrete_type())->get_type();
 			}
 			return cur;
 		}
@@ -1171,13 +1173,13 @@ namespace dwarf
 		opt<Dwarf_Unsigned> array_type_die::ultimate_element_count() const 
 		{
 			auto nonconst_this = const_cast<array_type_die *>(this);
-			shared_ptr<type_die> cur
-			 = dynamic_pointer_cast<type_die>(nonconst_this->shared_from_this());
+			adt_ptr<type_die> cur
+			 = adt_cast<type_die>(nonconst_this->shared_from_this());
 			Dwarf_Unsigned count = 1;
 			while (cur->get_concrete_type()
 				 && cur->get_concrete_type()->get_tag() == DW_TAG_array_type)
 			{
-				auto as_array = dynamic_pointer_cast<array_type_die>(cur->get_concrete_type());
+				auto as_array = adt_cast<array_type_die>(cur->get_concrete_type());
 				auto opt_count = as_array->element_count();
 				
 				if (!opt_count) return opt<Dwarf_Unsigned>();
@@ -1202,12 +1204,12 @@ namespace dwarf
 			return this->type_die::calculate_byte_size();
 		}
 /* from spec::with_data_members_die */
-		shared_ptr<type_die> with_data_members_die::find_my_own_definition() const
+		adt_ptr<type_die> with_data_members_die::find_my_own_definition() const
 		{
 			auto nonconst_this = const_cast<with_data_members_die *>(this);
 			if (!get_declaration() || !*get_declaration()) 
 			{
-				return dynamic_pointer_cast<type_die>(get_this());
+				return adt_cast<type_die>(get_this());
 			}
 			cerr << "Looking for definition of declaration " << this->summary() << endl;
 			
@@ -1236,18 +1238,18 @@ namespace dwarf
 				for (++i_sibling /* i.e. don't check ourselves */; 
 					i_sibling != nonconst_this->get_ds().end(); ++i_sibling)
 				{
-					auto p_d = dynamic_pointer_cast<with_data_members_die>(*i_sibling);
+					auto p_d = adt_cast<with_data_members_die>(*i_sibling);
 					if (p_d && p_d->get_name() && *p_d->get_name() == my_name
 						&& (!p_d->get_declaration() || !*p_d->get_declaration()))
 					{
 						cerr << "Found definition " << p_d->summary() << endl;
-						return dynamic_pointer_cast<type_die>(p_d);
+						return adt_cast<type_die>(p_d);
 					}
 				}
 			}
 		return_no_result:
 			cerr << "Failed to find definition of declaration " << this->summary() << endl;
-			return shared_ptr<type_die>();
+			return adt_ptr<type_die>();
 		}
 /* from spec::variable_die */        
 		bool variable_die::has_static_storage() const
@@ -1296,7 +1298,7 @@ namespace dwarf
         {
         	auto nonconst_this = const_cast<member_die *>(this); // HACK: eliminate
         
-        	auto enclosing_type_die = std::dynamic_pointer_cast<type_die>(
+        	auto enclosing_type_die = adt_cast<type_die>(
             	this->get_parent());
             if (!enclosing_type_die) return opt<Dwarf_Unsigned>();
             
@@ -1311,7 +1313,7 @@ namespace dwarf
 					enclosing_type_die->get_tag() == DW_TAG_class_type)
                  && /*static_cast<abstract_dieset::position>(*/nonconst_this->iterator_here().base()/*)*/ == 
                  	/*static_cast<abstract_dieset::position>(*/
-                    	std::dynamic_pointer_cast<structure_type_die>(enclosing_type_die)
+                    	adt_cast<structure_type_die>(enclosing_type_die)
                  			->member_children_begin().base().base().base()/*)*/
 				) || enclosing_type_die->get_tag() == DW_TAG_union_type)
 				
@@ -1375,12 +1377,12 @@ namespace dwarf
 		 : die((assert(ds.p_f), *ds.p_f)), p_ds(&ds) {}
 
 		// "next sibling"
-		basic_die::basic_die(dieset& ds, shared_ptr<basic_die> p_d)
+		basic_die::basic_die(dieset& ds, adt_ptr<basic_die> p_d)
 		 : lib::die(p_d->f, *p_d), p_ds(&ds), m_parent_offset(0UL) 
 		{ assert(p_d->p_ds == &ds); }
 
 		// "first child"
-		basic_die::basic_die(shared_ptr<basic_die> p_d)
+		basic_die::basic_die(adt_ptr<basic_die> p_d)
 		 : lib::die(*p_d), p_ds(p_d->p_ds), m_parent_offset(0UL) {}
 
 		// "specific offset"
@@ -1400,7 +1402,7 @@ namespace dwarf
         	Dwarf_Half ret; this->tag(&ret); return ret;
         }
         
-		std::shared_ptr<spec::basic_die> 
+		adt_ptr<spec::basic_die> 
 		basic_die::get_parent() 
 		{
 			// if we're toplevel, we have no parent
@@ -1432,13 +1434,13 @@ namespace dwarf
 		 * constructed as a temporary, and uses that. 
 		 * Ideally we would handle/body-ify lib::die to avoid this
 		 * allocation/deallocation overhead. */
-        std::shared_ptr<spec::basic_die> 
+        adt_ptr<spec::basic_die> 
         basic_die::get_first_child() 
         {
 			return p_ds->get(lib::die(*this));
         }
 
-        std::shared_ptr<spec::basic_die> 
+        adt_ptr<spec::basic_die> 
         basic_die::get_next_sibling() 
         {
             return p_ds->get(lib::die(*p_ds->p_f, *this));
@@ -1520,12 +1522,11 @@ namespace dwarf
 			 * So instead, ask the file_toplevel_die. */
 			//auto parent = const_cast<const compile_unit_die *>(this)->get_parent();
 			// HACK: why can't I use get_parent() const ?
-			auto parent_toplevel = std::dynamic_pointer_cast<file_toplevel_die>(
+			auto parent_toplevel = adt_cast<file_toplevel_die>(
 				const_cast<compile_unit_die*>(this)->get_parent());
 			return parent_toplevel->get_address_size_for_cu(
-				std::const_pointer_cast<compile_unit_die>(
-					dynamic_pointer_cast<const compile_unit_die>(
-						shared_from_this())));
+				adt_cast<compile_unit_die>(
+					const_cast<compile_unit_die*>(this)->shared_from_this()));
 		}
 		
 		std::string compile_unit_die::source_file_name(unsigned o) const
@@ -1533,20 +1534,20 @@ namespace dwarf
 			/* We have the same problem here: we want to get per-CU
 			 * data from libdwarf, but where to store it? Use the toplevel. */
 			auto nonconst_this = const_cast<compile_unit_die *>(this);
-			auto nonconst_toplevel = dynamic_pointer_cast<lib::file_toplevel_die>(
+			auto nonconst_toplevel = adt_cast<lib::file_toplevel_die>(
 				nonconst_this->get_ds().toplevel());
 			return nonconst_toplevel->source_file_name_for_cu(
-					dynamic_pointer_cast<compile_unit_die>(nonconst_this->shared_from_this()), 
+					adt_cast<compile_unit_die>(nonconst_this->shared_from_this()), 
 					o);
 		}
 		
 		unsigned compile_unit_die::source_file_count() const
 		{
 			auto nonconst_this = const_cast<compile_unit_die *>(this);
-			auto nonconst_toplevel = dynamic_pointer_cast<lib::file_toplevel_die>(
+			auto nonconst_toplevel = adt_cast<lib::file_toplevel_die>(
 				nonconst_this->get_ds().toplevel());
 			return nonconst_toplevel->source_file_count_for_cu(
-					dynamic_pointer_cast<compile_unit_die>(nonconst_this->shared_from_this()));
+					adt_cast<compile_unit_die>(nonconst_this->shared_from_this()));
 		}
         //abstract_dieset::path_type dieset::path_from_root(Dwarf_Off off)
         //{
@@ -1564,7 +1565,7 @@ namespace dwarf
 // 		abstract_dieset::iterator_base::iterator_base(
 // 			abstract_dieset& ds, Dwarf_Off off,
 // 			const path_type& path_from_root,
-// 			shared_ptr<basic_die> p_d /* = shared_ptr<basic_die>() */)
+// 			adt_ptr<basic_die> p_d /* = adt_ptr<basic_die>() */)
 // 		: position_and_path((position){&ds, off}, path_from_root), 
 // 		  p_d(p_d ? p_d : die_from_offset(ds, off))
 // 		{ 
@@ -1591,8 +1592,8 @@ namespace dwarf
 		  this->dereference()->get_offset() < i.dereference()->get_offset(); 
 		}
 		
-		shared_ptr<type_die> 
-		abstract_dieset::canonicalise_type(shared_ptr<type_die> p_t,
+		adt_ptr<type_die> 
+		abstract_dieset::canonicalise_type(adt_ptr<type_die> p_t,
 			dwarf::tool::cxx_compiler& compiler)
 		{
 			using std::clog;
@@ -1641,20 +1642,20 @@ namespace dwarf
 					 * If there are none, it is an error.
 					 */
 
-					shared_ptr<type_die> first_non_decl;
-					shared_ptr<type_die> first_concrete;
+					adt_ptr<type_die> first_non_decl;
+					adt_ptr<type_die> first_concrete;
 					//for (auto i_resolved = resolved_all.begin();
 					//	i_resolved != resolved_all.end(); ++i_resolved)
 					//{
 					do
 					{
-						if (dynamic_pointer_cast<type_die>(p_resolved))
+						if (adt_cast<type_die>(p_resolved))
 						{
-							auto temp_concrete_t = dynamic_pointer_cast<type_die>(p_resolved)
+							auto temp_concrete_t = adt_cast<type_die>(p_resolved)
 								->get_concrete_type();
 							if (!first_concrete) first_concrete = temp_concrete_t;
 							auto with_data_members
-							 = dynamic_pointer_cast<spec::with_data_members_die>(temp_concrete_t);
+							 = adt_cast<spec::with_data_members_die>(temp_concrete_t);
 							if (with_data_members)
 							{
 								// we do another canonicalisation here: find the defn of a decl
@@ -1684,7 +1685,7 @@ namespace dwarf
 			{
 				/* To canonicalise base types, we have to use the compiler's 
 				 * set of base types (i.e. the base types that it considers distinct). */
-				auto base_t = dynamic_pointer_cast<base_type_die>(concrete_t);
+				auto base_t = adt_cast<base_type_die>(concrete_t);
 				assert(base_t);
 				auto compiler_base_t = dwarf::tool::cxx_compiler::base_type(base_t);
 				auto& our_cache = cache[make_pair(this, &compiler)];
@@ -1699,7 +1700,7 @@ namespace dwarf
 						i_vis != visible_grandchildren_seq->end();
 						++i_vis)
 					{
-						auto vis_as_base = dynamic_pointer_cast<base_type_die>(*i_vis);
+						auto vis_as_base = adt_cast<base_type_die>(*i_vis);
 						if (vis_as_base
 							&& vis_as_base->get_name()
 							&& dwarf::tool::cxx_compiler::base_type(vis_as_base)
@@ -1719,7 +1720,7 @@ namespace dwarf
 					assert(i_vis != visible_grandchildren_seq->end());
 				}
 				assert(found_in_cache != our_cache.end());
-				auto found_as_type = dynamic_pointer_cast<type_die>(*found_in_cache->second);
+				auto found_as_type = adt_cast<type_die>(*found_in_cache->second);
 				assert(found_as_type);
 				//cerr << "Canonicalised base type " << concrete_t->summary() 
 				//	<< " to " << found_as_type->summary() 
@@ -1730,9 +1731,9 @@ namespace dwarf
 
         bool 
 		file_toplevel_die::is_visible::operator()(
-			std::shared_ptr<spec::basic_die> p) const
+			adt_ptr<spec::basic_die> p) const
         {
-            auto p_el = std::dynamic_pointer_cast<program_element_die>(p);
+            auto p_el = adt_cast<program_element_die>(p);
             if (!p_el) return true;
             return !p_el->get_visibility() 
                 || *p_el->get_visibility() != DW_VIS_local;
@@ -1748,18 +1749,41 @@ namespace dwarf
 //                     } catch (std::bad_cast e) { return true; }
 //                 }
 
-		shared_ptr<basic_die>
+		adt_ptr<basic_die>
 		file_toplevel_die::visible_named_grandchild(
 			const std::string& name
 		)
 		{
+			/* If we have a name index, the visible grandchildren are just its
+			 * visible entries at depth 2 (CUs being at depth 1). */
+			if (auto p_idx = get_ds().get_name_index())
+			{
+				auto range = p_idx->equal_range(name);
+				for (auto i_e = range.first; i_e != range.second; ++i_e)
+				{
+					if (i_e->depth == 2 && (i_e->flags & core::name_index::VISIBLE))
+					{
+						return get_ds()[i_e->die_off];
+					}
+				}
+				return adt_ptr<basic_die>();
+			}
+			/* Otherwise the producer's tables might know. They don't list
+			 * everything, so if they can't vouch for their answer being the
+			 * first, we search as before. */
+			if (auto p_accel = get_ds().get_accel_index())
+			{
+				Dwarf_Off found = p_accel->first_visible_grandchild(name);
+				if (found != 0UL) return get_ds()[found];
+			}
+			
 			auto returned = visible_named_grandchild_pos(name);
 			if (returned)
 			{
 				auto iter = abstract_dieset::iterator(returned->first);
 				if (iter != get_ds().end()) return *iter;
 			}
-			return shared_ptr<basic_die>();
+			return adt_ptr<basic_die>();
 		}
 		
 		optional<file_toplevel_die::vg_cache_rec_t>
@@ -1793,7 +1817,7 @@ namespace dwarf
 			 = opt_seq ? opt_seq : visible_grandchildren_sequence();
 
 			// first cheque the cash
-			auto found_in_cache = visible_grandchildren_cache.find(name);
+			auto found_in_cache = visible_grandchildren_cache.find(vg_cache_names.find(name));
 			if (found_in_cache != visible_grandchildren_cache.end())
 			{
 				//clog << "Hit cache..." << endl;
@@ -1855,7 +1879,7 @@ namespace dwarf
 						== this->get_ds().highest_offset_upper_bound())
 					{
 						//cerr << "Hit cached negative result for " << name << endl;
-						//return optional<vg_cache_rec_t>(); // shared_ptr<basic_die>();
+						//return optional<vg_cache_rec_t>(); // adt_ptr<basic_die>();
 						goto return_no_entry;
 					}
 					// else we will do the lookup afresh
@@ -1889,7 +1913,7 @@ namespace dwarf
 // 					<< " and there are no nonmonotonic DIEs."
 // 					<< endl;
 // 					
-// 				return shared_ptr<basic_die>();
+// 				return adt_ptr<basic_die>();
 // 			}
 
 			{
@@ -1916,24 +1940,25 @@ namespace dwarf
 				if (found_vg != vg_seq->end())
 				{
 					Dwarf_Off cur_off = (*found_vg)->get_offset();
-					string cur_name = *(*found_vg)->get_name();
+					auto& cached = visible_grandchildren_cache[
+						vg_cache_names.intern(*(*found_vg)->get_name())];
 					
 					// ensure we have a vector in the cache to write to
-					if (!visible_grandchildren_cache[cur_name]) 
+					if (!cached) 
 					{
-						visible_grandchildren_cache[cur_name] = vector<vg_cache_rec_t>();
+						cached = vector<vg_cache_rec_t>();
 					}
 					vg_cache_rec_t cache_ent_added
 					 = make_pair(found_vg.base().base().base(), found_vg.base().get_currently_in());
 					//clog << "Traversing cacheable entry " << (*i_vg)->summary() << endl;
 
 					// we should not be adding something we've added already
-					/*if*/ assert( (std::find(visible_grandchildren_cache[cur_name]->begin(),
-							visible_grandchildren_cache[cur_name]->end(), 
-							cache_ent_added) == visible_grandchildren_cache[cur_name]->end()));
+					/*if*/ assert( (std::find(cached->begin(),
+							cached->end(), 
+							cache_ent_added) == cached->end()));
 					//{
 					//	clog << "Cacheable entry is not already cached, so adding it." << endl;
-						visible_grandchildren_cache[cur_name]->push_back(
+						cached->push_back(
 							cache_ent_added
 						);
 					//}
@@ -1957,7 +1982,7 @@ namespace dwarf
 
 					// we can also store a negative result if we searched all the way
 					//cerr << "Installing negative cache result for " << name << endl;
-					visible_grandchildren_cache[name] = optional< vector<vg_cache_rec_t> >();
+					visible_grandchildren_cache[vg_cache_names.intern(name)] = optional< vector<vg_cache_rec_t> >();
 
 					// timestamp this search
 					// HACK: "upper bound" is not appropriate here, but it'll do for now
@@ -2036,21 +2061,22 @@ namespace dwarf
 					// remember that we've visited this offset
 					cur_off = i.offset_here();
 					
-					/* Are we visible? */
-					bool visible;
-					if (!i.has_attribute_here(DW_AT_visibility)) visible = true;
-					else
+					/* Do we have the name? This doesn't allocate, so ask it
+					 * before the visibility question, which does. */
+					auto name_here = i.name_view_here();
+					if (name_here.data() && name_here == name)
 					{
-						core::Attribute a(dynamic_cast<core::Die&>(i.get_handle()), DW_AT_visibility);
-						encap::attribute_value val(a, 
-							dynamic_cast<core::Die&>(i.get_handle()), i.get_root());
-						visible = (val.get_unsigned() != DW_VIS_local);
-					}
-
-					if (visible)
-					{
-						auto name_here = i.name_here();
-						if (name_here && string(name_here.get()) == name)
+						/* Are we visible? */
+						bool visible;
+						if (!i.has_attribute_here(DW_AT_visibility)) visible = true;
+						else
+						{
+							core::Attribute a(dynamic_cast<core::Die&>(i.get_handle()), DW_AT_visibility);
+							encap::attribute_value val(a, 
+								dynamic_cast<core::Die&>(i.get_handle()), i.get_root());
+							visible = (val.get_unsigned() != DW_VIS_local);
+						}
+						if (visible)
 						{
 							/* It's a result. */
 							//cerr << "Found visible DIE named " << name << " at 0x"
@@ -2141,7 +2167,7 @@ namespace dwarf
 			
 			/* We can do better than linear search, using the properties of
 			 * DWARF offsets.  */
-			std::shared_ptr<spec::basic_die> current = this->toplevel();
+			adt_ptr<spec::basic_die> current = this->toplevel();
 			spec::abstract_dieset::path_type path_from_root(1, 0UL); // start with root node only
 			/* We do this because iterators can point at the root, and all iterators should 
 			 * have the property that the last element in the path is their current node. */
@@ -2152,7 +2178,7 @@ namespace dwarf
 				auto child = current->get_first_child(); // index for loop below
 				/* Note that we may throw No_entry here ^^^ -- this happens
 				 * if and only if our search has failed, which is what we want. */
-				std::shared_ptr<spec::basic_die> prev_child; // starts at 0
+				adt_ptr<spec::basic_die> prev_child; // starts at 0
 				
 				// ...linear search for the child we should accept or descend to
 				// (NOTE: if they first child is the one we want, we'll go round once,
@@ -2168,7 +2194,7 @@ namespace dwarf
 					catch (No_entry)
 					{
 						// reached the last sibling
-						child = std::shared_ptr<spec::basic_die>();
+						child = adt_ptr<spec::basic_die>();
 					}
 				}
 				// on terminating this loop: child is *after* the one we want, or null
@@ -2202,6 +2228,33 @@ namespace dwarf
 				path_type());
 		}
 		
+		void
+		dieset::load_indexes()
+		{
+			/* Only try once; most files won't have our name index, and
+			 * many won't have the producer's tables either. */
+			if (tried_indexes || !p_f) return;
+			tried_indexes = true;
+			auto p_native = core::native_root_die::open(p_f->get_fd());
+			if (!p_native) return;
+			p_name_index = core::name_index::open_for(p_native->sections());
+			p_accel = core::accel_index::open(p_native);
+		}
+		
+		std::shared_ptr<const core::name_index>
+		dieset::get_name_index()
+		{
+			load_indexes();
+			return p_name_index;
+		}
+		
+		std::shared_ptr<const core::accel_index>
+		dieset::get_accel_index()
+		{
+			load_indexes();
+			return p_accel;
+		}
+		
 		/* FIXME: can't we just get rid of these find_parent functions?
 		 * HMM. Actually they are faster than find() because we can start
 		 * with an offset that we know exists. */
@@ -2227,21 +2280,21 @@ namespace dwarf
 			else throw lib::No_entry();
 		}
 
-		std::shared_ptr<basic_die> 
+		adt_ptr<basic_die> 
 		dieset::find_parent_of(Dwarf_Off off)
 		{
 			return get(find_parent_offset_of(off));
 		}
 
-		std::shared_ptr<lib::basic_die> 
+		adt_ptr<lib::basic_die> 
 		dieset::get(Dwarf_Off off)
 		{
-			if (off == 0UL) return std::dynamic_pointer_cast<lib::basic_die>(toplevel());
+			if (off == 0UL) return adt_cast<lib::basic_die>(toplevel());
 			return get(lib::die(*p_f, off)); // "offdie" constructor
 		}
 			
 		/* factory method -- this is private */
-		std::shared_ptr<lib::basic_die>
+		adt_ptr<lib::basic_die>
 		dieset::get(const lib::die& d)
 		{
 			Dwarf_Half tag;
@@ -2255,7 +2308,7 @@ namespace dwarf
 			switch(ret = d.tag(&tag), assert(ret == DW_DLV_OK), tag)
 			{
 #define factory_case(name, ...) \
-case DW_TAG_ ## name: return dynamic_pointer_cast<basic_die>(my_make_shared<lib:: name ## _die >(*this, offset));
+case DW_TAG_ ## name: return adt_cast<basic_die>(my_make_shared<lib:: name ## _die >(*this, offset));
 #include "dwarf3-factory.h"
 #undef factory_case
 				default: return my_make_shared<lib::basic_die>(*this, offset);
@@ -2263,15 +2316,15 @@ case DW_TAG_ ## name: return dynamic_pointer_cast<basic_die>(my_make_shared<lib:
 		
 		}
 	
-		std::shared_ptr<spec::basic_die> dieset::operator[](Dwarf_Off off) const
+		adt_ptr<spec::basic_die> dieset::operator[](Dwarf_Off off) const
 		{
-			if (off == 0UL) return std::shared_ptr<spec::basic_die>(m_toplevel);
+			if (off == 0UL) return adt_ptr<spec::basic_die>(m_toplevel);
 			return const_cast<dieset *>(this)->get(off);
 		}
 		
-		std::shared_ptr<spec::file_toplevel_die> dieset::toplevel()
+		adt_ptr<spec::file_toplevel_die> dieset::toplevel()
 		{
-			return std::dynamic_pointer_cast<spec::file_toplevel_die>(m_toplevel);
+			return adt_cast<spec::file_toplevel_die>(m_toplevel);
 		}
 		
 	}
@@ -2482,7 +2535,7 @@ case DW_TAG_ ## name: return dynamic_pointer_cast<basic_die>(my_make_shared<lib:
 	}
 	namespace lib
 	{
-		Dwarf_Half file_toplevel_die::get_address_size_for_cu(shared_ptr<compile_unit_die> cu) const
+		Dwarf_Half file_toplevel_die::get_address_size_for_cu(adt_ptr<compile_unit_die> cu) const
 		{ 
 			auto found = cu_info.find(cu->get_offset());
 			assert(found != cu_info.end());
@@ -2525,7 +2578,7 @@ case DW_TAG_ ## name: return dynamic_pointer_cast<basic_die>(my_make_shared<lib:
 		{
 			/* This function is supposed to be idempotent, so don't clobber 
 			 * any existing state. */
-			auto p_cu = dynamic_pointer_cast<compile_unit_die>(
+			auto p_cu = adt_cast<compile_unit_die>(
 				get_ds().get(lib::die(*get_ds().p_f))
 			);
 			
@@ -2548,6 +2601,33 @@ case DW_TAG_ ## name: return dynamic_pointer_cast<basic_die>(my_make_shared<lib:
 			prev_version_stamp = version_stamp;
 		}
 		
+		void file_toplevel_die::add_cu_intervals()
+		{
+			/* .debug_aranges already says which CU covers which addresses, and
+			 * lib::aranges has it sorted and coalesced, so we don't need to
+			 * compute every CU's intervals. If there are no aranges, we leave
+			 * the map empty. */
+			assert(ds.p_f);
+			lib::aranges *p_aranges;
+			try { p_aranges = &ds.p_f->get_aranges(); }
+			catch (No_entry) { return; }
+			/* Ranges of different CUs shouldn't overlap, but they do, e.g.
+			 * when ranges of discarded sections get resolved to 0. Use the
+			 * table's disjoint segments, so that we pick the same CU as
+			 * aranges::find() does. */
+			auto& entries = p_aranges->sorted_entries();
+			auto& segments = p_aranges->disjoint_segments();
+			for (auto i_seg = segments.begin(); i_seg != segments.end(); ++i_seg)
+			{
+				if (i_seg->best == lib::aranges::NONE) continue;
+				// the last segment is always past the end of every range
+				assert(i_seg + 1 != segments.end());
+				cu_intervals.insert(make_pair(
+					boost::icl::interval<Dwarf_Addr>::right_open(i_seg->lo, (i_seg + 1)->lo),
+					entries[i_seg->best].cu_die_offset));
+			}
+		}
+		
 		// the actual member function
 		void file_toplevel_die::add_cu_intervals(Dwarf_Off off,
 			Dwarf_Unsigned cu_header_length,
@@ -2577,7 +2657,7 @@ case DW_TAG_ ## name: return dynamic_pointer_cast<basic_die>(my_make_shared<lib:
 		
 		std::string 
 		file_toplevel_die::source_file_name_for_cu(
-			shared_ptr<compile_unit_die> cu,
+			adt_ptr<compile_unit_die> cu,
 			unsigned o
 		)
 		{
@@ -2595,7 +2675,7 @@ case DW_TAG_ ## name: return dynamic_pointer_cast<basic_die>(my_make_shared<lib:
 		
 		unsigned 
 		file_toplevel_die::source_file_count_for_cu(
-			shared_ptr<compile_unit_die> cu)
+			adt_ptr<compile_unit_die> cu)
 		{
 			Dwarf_Off off = cu->get_offset();
 			// don't create cu_info if it's not there
@@ -2618,11 +2698,11 @@ case DW_TAG_ ## name: return dynamic_pointer_cast<basic_die>(my_make_shared<lib:
 		bool dieset::move_to_first_cu(spec::abstract_dieset::iterator_base& base)
 		{
 			/* Use the cu_info in toplevel. */
-			auto p_toplevel = dynamic_pointer_cast<lib::file_toplevel_die>(m_toplevel);
+			auto p_toplevel = adt_cast<lib::file_toplevel_die>(m_toplevel);
 			if (p_toplevel->cu_info.size() == 0) return false;
 			else
 			{
-				base.p_d = dynamic_pointer_cast<basic_die>(p_toplevel->cu_info.begin()->second.p_cu);
+				base.p_d = adt_cast<basic_die>(p_toplevel->cu_info.begin()->second.p_cu);
 				base.off = base.p_d->get_offset();
 				base.path_from_root = (abstract_dieset::path_type){ 0UL, base.off };
 				parent_cache[base.off] = 0UL;
@@ -2632,7 +2712,7 @@ case DW_TAG_ ## name: return dynamic_pointer_cast<basic_die>(my_make_shared<lib:
 		
 		bool dieset::move_to_next_cu(spec::abstract_dieset::iterator_base& base)
 		{
-			auto p_toplevel = dynamic_pointer_cast<lib::file_toplevel_die>(m_toplevel);
+			auto p_toplevel = adt_cast<lib::file_toplevel_die>(m_toplevel);
 			auto found = p_toplevel->cu_info.find(base.off);
 			assert(found != p_toplevel->cu_info.end());
 			++found;
@@ -2648,7 +2728,7 @@ case DW_TAG_ ## name: return dynamic_pointer_cast<basic_die>(my_make_shared<lib:
 		}
 
 		// deprecated
-		std::shared_ptr<spec::basic_die> file_toplevel_die::get_first_child()
+		adt_ptr<spec::basic_die> file_toplevel_die::get_first_child()
 		{
 			// We have to explicitly loop through CU headers, 
 			// to set the CU context when getting dies.
@@ -2700,7 +2780,7 @@ case DW_TAG_ ## name: return dynamic_pointer_cast<basic_die>(my_make_shared<lib:
 		Dwarf_Off compile_unit_die::get_next_sibling_offset() const
 		{
 			auto nonconst_this = const_cast<compile_unit_die *>(this); // HACK
-			auto parent = dynamic_pointer_cast<file_toplevel_die>(nonconst_this->get_parent());
+			auto parent = adt_cast<file_toplevel_die>(nonconst_this->get_parent());
 			assert(parent);
 			
 			Dwarf_Off off = get_offset();
@@ -2723,11 +2803,11 @@ case DW_TAG_ ## name: return dynamic_pointer_cast<basic_die>(my_make_shared<lib:
 			else return found->first;
 		}
 		// deprecated
-		std::shared_ptr<spec::basic_die> compile_unit_die::get_next_sibling()
+		adt_ptr<spec::basic_die> compile_unit_die::get_next_sibling()
 		{
 			int retval;
 			Dwarf_Half prev_version_stamp 
-				= std::dynamic_pointer_cast<file_toplevel_die>(p_ds->toplevel())
+				= adt_cast<file_toplevel_die>(p_ds->toplevel())
 					->prev_version_stamp;
 			Dwarf_Half version_stamp = prev_version_stamp;
 			Dwarf_Off next_cu_offset;
@@ -2758,9 +2838,9 @@ case DW_TAG_ ## name: return dynamic_pointer_cast<basic_die>(my_make_shared<lib:
 				Dwarf_Off off;
 				p_cu->offset(&off); // retrieve the offset
 				// store the data for later
-				dynamic_pointer_cast<file_toplevel_die>(get_parent())
+				adt_cast<file_toplevel_die>(get_parent())
 				->cu_info[off].version_stamp = version_stamp;
-				dynamic_pointer_cast<file_toplevel_die>(get_parent())
+				adt_cast<file_toplevel_die>(get_parent())
 				->cu_info[off].address_size = address_size;
 				// don't touch srcfiles
 				if (off == this->get_offset()) // found us
@@ -2788,11 +2868,11 @@ case DW_TAG_ ## name: return dynamic_pointer_cast<basic_die>(my_make_shared<lib:
 				// store the data for later
 				// -- no need to do this now, as we did it during reset_context
 				
-				//dynamic_pointer_cast<file_toplevel_die>(get_parent())
+				//adt_cast<file_toplevel_die>(get_parent())
 				//->cu_info[off].version_stamp = version_stamp;
-				//dynamic_pointer_cast<file_toplevel_die>(get_parent())
+				//adt_cast<file_toplevel_die>(get_parent())
 				//->cu_info[off].address_size = address_size;
-				auto parent = dynamic_pointer_cast<file_toplevel_die>(get_parent());
+				auto parent = adt_cast<file_toplevel_die>(get_parent());
 				assert(parent->cu_info.find(off) != parent->cu_info.end());
 				
 				return p_cu;
@@ -10,8 +10,8 @@ namespace dwarf
 {
 	namespace encap
     {
-		std::shared_ptr<spec::type_die> attribute_value::get_refdie_is_type() const 
-		{ return std::dynamic_pointer_cast<spec::type_die>(get_refdie()); }
+		adt_ptr<spec::type_die> attribute_value::get_refdie_is_type() const 
+		{ return adt_cast<spec::type_die>(get_refdie()); }
 		
 		void attribute_value::print_raw(std::ostream& s) const
 		{
@@ -31,7 +31,7 @@ namespace dwarf
 					break;
 				case BLOCK:
 					s << "(block) ";
-					for (std::vector<unsigned char>::iterator p = v_block->begin(); p != v_block->end(); p++)
+					for (std::vector<unsigned char>::iterator p = v_block->value.begin(); p != v_block->value.end(); p++)
 					{
 						//s.setf(std::ios::hex);
 						s << std::hex << (int) *p << std::dec << " ";
@@ -39,7 +39,7 @@ namespace dwarf
 					}
 					break;
 				case STRING:
-					s << "(string) " << *v_string;
+					s << "(string) " << v_string->value;
 					break;
 				
 				case REF:
@@ -107,7 +107,7 @@ namespace dwarf
 			}	
 		}
 	
-    	std::shared_ptr<spec::basic_die> attribute_value::get_refdie() const
+    	adt_ptr<spec::basic_die> attribute_value::get_refdie() const
         //spec::basic_die& attribute_value::get_refdie() const
 	    { assert(f == REF); 
 		  assert(p_ds);
@@ -229,7 +229,7 @@ namespace dwarf
 				case spec::interp::loclistptr: switch(f)
 				{
 					case LOCLIST:
-						s << *v_loclist; 
+						s << v_loclist->value; 
 						break;
 					default: assert(false);
 				} break;		
@@ -244,7 +244,7 @@ namespace dwarf
 				{
 					case RANGELIST: // specifically data4 or data8
 						//s << "(rangelist) 0x" << std::hex << v_u << std::dec;
-                        s << *v_rangelist;
+                        s << v_rangelist->value;
 						break;
 					default: assert(false);
 				} break;
@@ -307,7 +307,7 @@ namespace dwarf
 				case spec::interp::string:
 					dwarf_formstring(a.handle.get(), &str, &core::current_dwarf_error);
 					this->f = STRING; 
-					this->v_string = new string(str);
+					this->v_string = new counted_string(string(str), 0);
 					break;
 				case spec::interp::flag:
 					dwarf_formflag(a.handle.get(), &flag, &core::current_dwarf_error);
@@ -323,9 +323,9 @@ namespace dwarf
 					{
 						core::Block b(a);
 						this->f = BLOCK;
-						this->v_block = new vector<unsigned char>(
+						this->v_block = new counted_payload<vector<unsigned char> >(vector<unsigned char>(
 							(unsigned char *) b.handle->bl_data, 
-							((unsigned char *) b.handle->bl_data) + b.handle->bl_len);
+							((unsigned char *) b.handle->bl_data) + b.handle->bl_len));
 					}
 					break;
 				case spec::interp::reference: {
@@ -379,7 +379,7 @@ namespace dwarf
 						// replaced lib::loclist with core::LocdescList
 						//this->v_loclist = new loclist(dwarf::lib::loclist(a, a.get_dbg()));
 						core::LocdescList ll(core::LocdescList::try_construct(a)); // why not just ll(a)? 
-						this->v_loclist = new loclist(ll);
+						this->v_loclist = new counted_payload<loclist>(loclist(ll));
 						break;
 					}
 					catch (...)
@@ -390,7 +390,7 @@ namespace dwarf
 					}
 				case spec::interp::rangelistptr: {
 					this->f = RANGELIST;
-					this->v_rangelist = new rangelist(core::RangeList(a, d));
+					this->v_rangelist = new counted_payload<rangelist>(rangelist(core::RangeList(a, d)));
 				} break;
 				case spec::interp::lineptr:
 				case spec::interp::macptr:
@@ -517,7 +517,7 @@ namespace dwarf
 				case spec::interp::string:
 					a.formstring(&str);
 					this->f = STRING; 
-					this->v_string = new std::string(str);
+					this->v_string = hold(std::string(str));
 					break;
 				case spec::interp::flag:
 					a.formflag(&flag);
@@ -533,8 +533,8 @@ namespace dwarf
 					{
 						block b(a);
 						this->f = BLOCK;
-						this->v_block = new std::vector<unsigned char>(
-		 					(unsigned char *) b.data(), ((unsigned char *) b.data()) + b.len());
+						this->v_block = hold(std::vector<unsigned char>(
+		 					(unsigned char *) b.data(), ((unsigned char *) b.data()) + b.len()));
 					}
 					break;
 				case spec::interp::reference:
@@ -581,7 +581,7 @@ namespace dwarf
 					try
 					{
 						this->f = LOCLIST;
-						this->v_loclist = new loclist(dwarf::lib::loclist(a));
+						this->v_loclist = hold(loclist(dwarf::lib::loclist(a)));
 						break;
 					}
 					catch (...)
@@ -594,7 +594,7 @@ namespace dwarf
                 	this->f = RANGELIST;
                     retval = a.formudata(&u); assert(retval == DW_DLV_OK);
                     dwarf::lib::ranges rs(a, u);
-                    this->v_rangelist = new rangelist(rs.begin(), rs.end());
+                    this->v_rangelist = hold(rangelist(rs.begin(), rs.end()));
                 	} break;
 				case spec::interp::lineptr:
 				case spec::interp::macptr:
@@ -616,7 +616,7 @@ namespace dwarf
 		
 		/* Constructors we couldn't define inline for dependency reasons. */
 		attribute_value::attribute_value(spec::abstract_dieset& ds, 
-				std::shared_ptr<spec::basic_die> ref_target)
+				adt_ptr<spec::basic_die> ref_target)
 		 : p_ds(&ds), orig_form(DW_FORM_ref_addr), f(REF), 
 		   v_ref(new weak_ref(ref_target->get_ds(), 
 		        ref_target->get_offset(), false,
@@ -624,9 +624,9 @@ namespace dwarf
 						    std::numeric_limits<lib::Dwarf_Half>::max())) {}
 
 		attribute_value::attribute_value(spec::abstract_dieset& ds, const encap::loclist& l) 
-		: p_ds(&ds), orig_form(DW_FORM_data4), f(LOCLIST), v_loclist(new encap::loclist(l)) {}
+		: p_ds(&ds), orig_form(DW_FORM_data4), f(LOCLIST), v_loclist(hold(encap::loclist(l))) {}
 		attribute_value::attribute_value(spec::abstract_dieset& ds, const encap::rangelist& l)
-		 : p_ds(&ds), orig_form(DW_FORM_data4), f(RANGELIST), v_rangelist(new encap::rangelist(l)) {}
+		 : p_ds(&ds), orig_form(DW_FORM_data4), f(RANGELIST), v_rangelist(hold(encap::rangelist(l))) {}
 
 		attribute_value::attribute_value(const attribute_value& av) : p_ds(av.p_ds), f(av.f)
 		{
@@ -645,12 +645,12 @@ namespace dwarf
 				break;
 				case BLOCK:
 					//std::cerr << "Copy constructing a block attribute value from vector at 0x" << std::hex << (unsigned) v_block << std::dec << std::endl;
-					v_block = new std::vector<unsigned char>(*av.v_block);
+					v_block = av.v_block; ++v_block->refs;
 					//std::cerr << "New block is at " << std::hex << (unsigned) v_block << std::dec << std::endl;						
 				break;
 				case STRING:
 					//std::cerr << "Copy constructing a string attribute value from string at 0x" << std::hex << (unsigned) v_string << std::dec << std::endl;
-					v_string = new std::string(*av.v_string);
+					v_string = av.v_string; ++v_string->refs;
 					//std::cerr << "New string is at " << std::hex << (unsigned) v_string << std::dec << std::endl;
 				break;
 				case REF:
@@ -662,10 +662,10 @@ namespace dwarf
 					v_addr = av.v_addr;
 				break;
 				case LOCLIST:
-					v_loclist = new loclist(*av.v_loclist);
+					v_loclist = av.v_loclist; ++v_loclist->refs;
 				break;
 				case RANGELIST:
-					v_rangelist = new rangelist(*av.v_rangelist);
+					v_rangelist = av.v_rangelist; ++v_rangelist->refs;
 				break;
 				case UNRECOG:
 					std::cerr << "Warning: copy-constructing a dwarf::encap::attribute_value of unknown form " << f << std::endl;
@@ -692,17 +692,20 @@ namespace dwarf
 				case SIGNED:
 					return this->v_s == v.v_s;
 				case BLOCK:
-					return this->v_block == v.v_block;
+					return this->v_block == v.v_block || this->v_block->value == v.v_block->value;
 				case STRING:
-					return *(this->v_string) == *(v.v_string);
+					// strings interned in the same place are equal only if they're the same
+					if (this->v_string->p_interned_in && this->v_string->p_interned_in == v.v_string->p_interned_in)
+						return this->v_string == v.v_string;
+					return this->v_string->value == v.v_string->value;
 				case REF:
 					return this->v_ref == v.v_ref;
 				case ADDR:
 					return this->v_addr == v.v_addr;
 				case LOCLIST:
-					return *(this->v_loclist) == *(v.v_loclist);
+					return this->v_loclist->value == v.v_loclist->value;
                 case RANGELIST:
-                    return *(this->v_rangelist) == *(v.v_rangelist);
+                    return this->v_rangelist->value == v.v_rangelist->value;
 				default: 
 					std::cerr << "Warning: comparing a dwarf::encap::attribute_value of unknown form " << v.f << std::endl;
 					return false;
@@ -719,24 +722,76 @@ namespace dwarf
 				break;
 				case BLOCK:
 					//std::cerr << "Destructing a block attribute_value with vector at 0x" << std::hex << (unsigned) v_block << std::dec << std::endl;
-					delete v_block;
+					release(v_block);
 				break;
 				case STRING:
-					delete v_string;
+					release(v_string);
 				break;
 				case REF:
 					delete v_ref;
 				break;
 				case LOCLIST:
-					delete v_loclist;
+					release(v_loclist);
 				break;
 				case RANGELIST:
-					delete v_rangelist;
+					release(v_rangelist);
 				break;
 				default: break;
 			} // end switch
 			} // end ~attribute_value
 
+		const loclist& attribute_value::get_loclist() const { assert(f == LOCLIST); return v_loclist->value; }
+		const rangelist& attribute_value::get_rangelist() const { assert(f == RANGELIST); return v_rangelist->value; }
+
+		/* Strings of attributes in an encap::dieset are interned there. */
+		static encap::attribute_payloads *payloads_of(spec::abstract_dieset *p_ds)
+		{
+			encap::dieset *p_eds = dynamic_cast<encap::dieset *>(p_ds);
+			return p_eds ? &p_eds->payloads() : 0;
+		}
+		counted_string *attribute_value::hold(std::string&& s)
+		{
+			auto p_payloads = payloads_of(p_ds);
+			return p_payloads ? p_payloads->intern(std::move(s)) : new counted_string(std::move(s), 0);
+		}
+		counted_payload<std::vector<unsigned char> > *attribute_value::hold(std::vector<unsigned char>&& b)
+		{ return new counted_payload<std::vector<unsigned char> >(std::move(b)); }
+		counted_payload<encap::loclist> *attribute_value::hold(encap::loclist&& l)
+		{ return new counted_payload<encap::loclist>(std::move(l)); }
+		counted_payload<encap::rangelist> *attribute_value::hold(encap::rangelist&& l)
+		{ return new counted_payload<encap::rangelist>(std::move(l)); }
+		void attribute_value::release(counted_string *p)
+		{
+			if (--p->refs != 0) return;
+			if (p->p_interned_in) p->p_interned_in->forget(p);
+			delete p;
+		}
+		void attribute_value::rehold()
+		{
+			/* Only strings care which dieset we're in. */
+			if (f != STRING) return;
+			auto p_payloads = payloads_of(p_ds);
+			if (!p_payloads || v_string->p_interned_in == p_payloads) return;
+			counted_string *p_new = p_payloads->intern(std::string(v_string->value));
+			release(v_string);
+			v_string = p_new;
+		}
+		
+		counted_string *attribute_payloads::intern(std::string&& s)
+		{
+			counted_string key(std::move(s), this);
+			auto found = strings.find(&key);
+			if (found != strings.end()) { ++(*found)->refs; return *found; }
+			counted_string *p = new counted_string(std::move(key.value), this);
+			strings.insert(p);
+			return p;
+		}
+		attribute_payloads::~attribute_payloads()
+		{
+			/* Whatever's left is still used by some value, which owns it. */
+			for (auto i_s = strings.begin(); i_s != strings.end(); ++i_s) (*i_s)->p_interned_in = 0;
+		}
+
 		attribute_value::ref::ref(spec::abstract_dieset& ds, Dwarf_Off off, bool abs, 
 			Dwarf_Off referencing_off, Dwarf_Half referencing_attr)	
 				: weak_ref(ds, off, abs, referencing_off, referencing_attr), 
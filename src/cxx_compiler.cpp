@@ -262,7 +262,7 @@ namespace dwarf { namespace tool {
 
 		try
 		{
-			auto p_cu = dynamic_pointer_cast<spec::compile_unit_die>(
+			auto p_cu = adt_cast<spec::compile_unit_die>(
 				ds.toplevel()->get_first_child());
 			assert(p_cu);
 			assert(p_cu->get_producer());
@@ -277,7 +277,7 @@ namespace dwarf { namespace tool {
 				//cerr << "Found a base type!" << endl << **i_bt 
 				//	<< ", name " << *((*i_bt)->get_name()) << endl;
 				base_types.insert(make_pair(
-					base_type(dynamic_pointer_cast<spec::base_type_die>(i_bt)),
+					base_type(adt_cast<spec::base_type_die>(i_bt)),
 					*i_bt->get_name()));
 			}
 		}
@@ -288,7 +288,7 @@ namespace dwarf { namespace tool {
 		fclose(f);
 	}
 	
-	cxx_compiler::base_type::base_type(shared_ptr<spec::base_type_die> p_d)
+	cxx_compiler::base_type::base_type(adt_ptr<spec::base_type_die> p_d)
 		: byte_size(*p_d->get_byte_size()),
 		  encoding(p_d->get_encoding()),
 		  bit_offset(p_d->get_bit_offset() ? *(p_d->get_bit_offset()) : 0),
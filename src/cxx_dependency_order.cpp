@@ -53,7 +53,7 @@ void dwarfidl_cxx_target::emit_forward_decls(const set<encap::basic_die *>& fds)
 }
 
 // this is the base case
-void dwarfidl_cxx_target::emit_all_decls(shared_ptr<spec::file_toplevel_die> p_d)
+void dwarfidl_cxx_target::emit_all_decls(adt_ptr<spec::file_toplevel_die> p_d)
 {
 	/* Basic operation:
 	 * For each DIE that is something we can put into a header,
@@ -84,12 +84,12 @@ void dwarfidl_cxx_target::emit_all_decls(shared_ptr<spec::file_toplevel_die> p_d
 	 
 	auto i_d = p_d->iterator_here();
 	
-	map< vector<string>, shared_ptr<spec::basic_die> > toplevel_decls_emitted;
+	map< vector<string>, adt_ptr<spec::basic_die> > toplevel_decls_emitted;
 	Dwarf_Off o = 0UL;
 	for (abstract_dieset::iterator cu = p_d->children_begin(); 
 				cu != p_d->children_end(); ++cu)
 	{ 
-		cpp_dependency_order order(*dynamic_pointer_cast<encap::basic_die>(*cu)); 
+		cpp_dependency_order order(*adt_cast<encap::basic_die>(*cu)); 
 		emit_forward_decls(order.forward_decls); 
 		for (cpp_dependency_order::container::iterator i = order.topsorted_container.begin(); 
 				i != order.topsorted_container.end(); 
@@ -99,9 +99,9 @@ void dwarfidl_cxx_target::emit_all_decls(shared_ptr<spec::file_toplevel_die> p_d
 			//if (!spec::file_toplevel_die::is_visible()(p_d)) continue; 
 			dispatch_to_model_emitter( 
 				out,
-				dynamic_pointer_cast<encap::basic_die>((*i)->shared_from_this())->iterator_here(),
+				adt_cast<encap::basic_die>((*i)->shared_from_this())->iterator_here(),
 				// this is our predicate
-				[&toplevel_decls_emitted, this](shared_ptr<spec::basic_die> p_d)
+				[&toplevel_decls_emitted, this](adt_ptr<spec::basic_die> p_d)
 				{
 					/* We check whether we've been declared already */
 					auto opt_ident_path = p_d->ident_path_from_cu();
@@ -112,9 +112,9 @@ void dwarfidl_cxx_target::emit_all_decls(shared_ptr<spec::file_toplevel_die> p_d
 						{
 							/* This means we would be redecling if we emitted here. */
 							auto current_is_type
-							 = dynamic_pointer_cast<spec::type_die>(p_d);
+							 = adt_cast<spec::type_die>(p_d);
 							auto previous_is_type
-							 = dynamic_pointer_cast<spec::type_die>(found->second);
+							 = adt_cast<spec::type_die>(found->second);
 							auto print_name_parts = [](const vector<string>& ident_path)
 							{
 								for (auto i_name_part = ident_path.begin();
@@ -154,7 +154,7 @@ void dwarfidl_cxx_target::emit_all_decls(shared_ptr<spec::file_toplevel_die> p_d
 						/* Some declarations are harmless to emit, because they never 
 						 * conflict (forward decls). We won't bother remembering these. */
 						auto is_program_element
-						 = dynamic_pointer_cast<spec::program_element_die>(p_d);
+						 = adt_cast<spec::program_element_die>(p_d);
 						bool is_harmless_fwddecl = is_program_element
 							&& is_program_element->get_declaration()
 							&& *is_program_element->get_declaration();
@@ -166,7 +166,7 @@ void dwarfidl_cxx_target::emit_all_decls(shared_ptr<spec::file_toplevel_die> p_d
 						// where the const type and the structure have the same name.
 						// We won't use the name on the const type, so we use the
 						// cxx_type_can_have_name helper to rule those cases out.
-						auto is_type = dynamic_pointer_cast<spec::type_die>(p_d);
+						auto is_type = adt_cast<spec::type_die>(p_d);
 						if (
 							(!is_type || (is_type && this->cxx_type_can_have_name(is_type)))
 						&&  !is_harmless_fwddecl
@@ -268,14 +268,14 @@ void cycle_handler::print_edge(Edge e, Graph& g)
 {
 	assert(e.p_ds != 0);
 
-	shared_ptr<encap::die> from_die = 
-		std::dynamic_pointer_cast<encap::die>((*e.p_ds)[e.referencing_off]);
-	shared_ptr<encap::die> from_projected_die = 
-		std::dynamic_pointer_cast<encap::die>(source(e, g)->shared_from_this());
-	shared_ptr<encap::die> to_die = 
-		std::dynamic_pointer_cast<encap::die>((*e.p_ds)[e.off]);
-	shared_ptr<encap::die> to_projected_die = 
-		std::dynamic_pointer_cast<encap::die>(target(e, g)->shared_from_this());
+	adt_ptr<encap::die> from_die = 
+		adt_cast<encap::die>((*e.p_ds)[e.referencing_off]);
+	adt_ptr<encap::die> from_projected_die = 
+		adt_cast<encap::die>(source(e, g)->shared_from_this());
+	adt_ptr<encap::die> to_die = 
+		adt_cast<encap::die>((*e.p_ds)[e.off]);
+	adt_ptr<encap::die> to_projected_die = 
+		adt_cast<encap::die>(target(e, g)->shared_from_this());
 
 	std::cerr << "@0x" << std::hex << e.referencing_off 
 					<< " " << from_die->get_spec().tag_lookup(from_die->get_tag())
@@ -352,10 +352,10 @@ void cycle_handler::back_edge(Edge e, Graph& g)
 		 (Edge candidate_e)
 		{
 			auto e_source_projected = source(candidate_e, g);
-			auto e_source_ultimate = dynamic_pointer_cast<encap::basic_die>(
+			auto e_source_ultimate = adt_cast<encap::basic_die>(
 				(*candidate_e.p_ds)[candidate_e.referencing_off]).get();
 			auto e_target_projected = target(candidate_e, g);
-			auto e_target_ultimate = dynamic_pointer_cast<encap::basic_die>(
+			auto e_target_ultimate = adt_cast<encap::basic_die>(
 				(*candidate_e.p_ds)[candidate_e.off]).get();
 				
 			// is the target of this edge forward-declarable?
@@ -421,10 +421,10 @@ void cycle_handler::back_edge(Edge e, Graph& g)
 		auto process_one_edge
 		 = [&coming_from_pointer, &removed, &g, this, &remove_edge_if_fwddeclable](Edge e) {
 			auto e_source_projected = source(e, g);
-			auto e_source_ultimate = dynamic_pointer_cast<encap::basic_die>(
+			auto e_source_ultimate = adt_cast<encap::basic_die>(
 				(*e.p_ds)[e.referencing_off]).get();
 			auto e_target_projected = target(e, g);
-			auto e_target_ultimate = dynamic_pointer_cast<encap::basic_die>(
+			auto e_target_ultimate = adt_cast<encap::basic_die>(
 				(*e.p_ds)[e.off]).get();
 			
 			if (e_source_ultimate->get_tag() == DW_TAG_pointer_type
@@ -652,7 +652,7 @@ cpp_dependency_order::cpp_dependency_order(dwarf::encap::basic_die& parent)
 		
 		 */
 			
-		auto is_fwd_declable = [](shared_ptr<spec::basic_die> p_d) {
+		auto is_fwd_declable = [](adt_ptr<spec::basic_die> p_d) {
 			return p_d->get_name() && (
 				p_d->get_tag() == DW_TAG_structure_type
 			 || p_d->get_tag() == DW_TAG_union_type
@@ -676,9 +676,9 @@ cpp_dependency_order::cpp_dependency_order(dwarf::encap::basic_die& parent)
 			auto my_edges = out_edges(*i_vert, *this);
 			for (auto i_edge = my_edges.first; i_edge != my_edges.second; ++i_edge)
 			{
-				auto e_source_ultimate = dynamic_pointer_cast<encap::basic_die>(
+				auto e_source_ultimate = adt_cast<encap::basic_die>(
 					(*(*i_edge).p_ds)[(*i_edge).referencing_off]).get();
-				auto e_target_ultimate = dynamic_pointer_cast<encap::basic_die>(
+				auto e_target_ultimate = adt_cast<encap::basic_die>(
 					(*(*i_edge).p_ds)[(*i_edge).off]).get();
 
 				if (e_source_ultimate->get_tag() == DW_TAG_member
@@ -686,8 +686,8 @@ cpp_dependency_order::cpp_dependency_order(dwarf::encap::basic_die& parent)
 				{
 					auto member = dynamic_cast<spec::member_die *>(e_source_ultimate);
 					assert(member);
-					shared_ptr<spec::type_die> member_type = member->get_type();
-					auto member_type_chain = dynamic_pointer_cast<spec::type_chain_die>(member_type);
+					adt_ptr<spec::type_die> member_type = member->get_type();
+					auto member_type_chain = adt_cast<spec::type_chain_die>(member_type);
 					//   ^ this one may be null
 					while (member_type
 					   && (
@@ -698,11 +698,11 @@ cpp_dependency_order::cpp_dependency_order(dwarf::encap::basic_die& parent)
 					{
 						if (member_type->get_tag() == DW_TAG_array_type)
 						{
-							member_type = dynamic_pointer_cast<spec::array_type_die>(member_type)
+							member_type = adt_cast<spec::array_type_die>(member_type)
 								->get_type();
 						}
 						else member_type = member_type_chain->get_type();
-						member_type_chain = dynamic_pointer_cast<spec::type_chain_die>(member_type);
+						member_type_chain = adt_cast<spec::type_chain_die>(member_type);
 					}
 					// Here we "end" at the named type mentioned by the member's type
 					// (e.g. "char" if it's a char *[]).
@@ -711,7 +711,7 @@ cpp_dependency_order::cpp_dependency_order(dwarf::encap::basic_die& parent)
 					// then we will be forward-declaring it, so
 					// we can skip this edge.
 					if (member_type && 
-						is_fwd_declable(dynamic_pointer_cast<spec::basic_die>(member_type)))
+						is_fwd_declable(adt_cast<spec::basic_die>(member_type)))
 					{
 						new_skipped_edges.push_back(*i_edge);
 					}
@@ -721,8 +721,8 @@ cpp_dependency_order::cpp_dependency_order(dwarf::encap::basic_die& parent)
 				{
 					auto fp = dynamic_cast<spec::formal_parameter_die *>(e_source_ultimate);
 					assert(fp);
-					shared_ptr<spec::type_die> fp_type = fp->get_type();
-					auto fp_type_chain = dynamic_pointer_cast<spec::type_chain_die>(fp_type);
+					adt_ptr<spec::type_die> fp_type = fp->get_type();
+					auto fp_type_chain = adt_cast<spec::type_chain_die>(fp_type);
 					//   ^ this one may be null
 					while (fp_type
 					   && (
@@ -733,11 +733,11 @@ cpp_dependency_order::cpp_dependency_order(dwarf::encap::basic_die& parent)
 					{
 						if (fp_type->get_tag() == DW_TAG_array_type)
 						{
-							fp_type = dynamic_pointer_cast<spec::array_type_die>(fp_type)
+							fp_type = adt_cast<spec::array_type_die>(fp_type)
 								->get_type();
 						}
 						else fp_type = fp_type_chain->get_type();
-						fp_type_chain = dynamic_pointer_cast<spec::type_chain_die>(fp_type);
+						fp_type_chain = adt_cast<spec::type_chain_die>(fp_type);
 					}
 					// Here we "end" at the named type mentioned by the fp's type
 					// (e.g. "char" if it's a char *[]).
@@ -745,7 +745,7 @@ cpp_dependency_order::cpp_dependency_order(dwarf::encap::basic_die& parent)
 					// If we end at something forward-decl'able, 
 					// then we will be forward-declaring it, so
 					if (fp_type && 
-						is_fwd_declable(dynamic_pointer_cast<spec::basic_die>(fp_type)))
+						is_fwd_declable(adt_cast<spec::basic_die>(fp_type)))
 					{
 						new_skipped_edges.push_back(*i_edge);
 					}
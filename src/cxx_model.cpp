@@ -85,9 +85,9 @@ namespace tool {
 	}
 	
 	bool 
-	cxx_generator_from_dwarf::type_infixes_name(shared_ptr<spec::basic_die> p_d)
+	cxx_generator_from_dwarf::type_infixes_name(adt_ptr<spec::basic_die> p_d)
 	{
-		auto t = dynamic_pointer_cast<spec::type_die>(p_d);
+		auto t = adt_cast<spec::type_die>(p_d);
 		//cerr << "Does this type infix a name? " << *t << endl;
 		assert(t);
 		auto unq_t = t->get_unqualified_type();
@@ -97,15 +97,15 @@ namespace tool {
 			||  unq_t->get_tag() == DW_TAG_array_type
 			|| 
 			(unq_t->get_tag() == DW_TAG_pointer_type &&
-				dynamic_pointer_cast<spec::pointer_type_die>(unq_t)->get_type()
+				adt_cast<spec::pointer_type_die>(unq_t)->get_type()
 				&& 
-				dynamic_pointer_cast<spec::pointer_type_die>(unq_t)->get_type()
+				adt_cast<spec::pointer_type_die>(unq_t)->get_type()
 					->get_tag()	== DW_TAG_subroutine_type)
 				);
 	}
 
 	string 
-	cxx_generator_from_dwarf::cxx_name_from_die(shared_ptr<spec::basic_die> p_d)
+	cxx_generator_from_dwarf::cxx_name_from_die(adt_ptr<spec::basic_die> p_d)
 	{
 		/* In C code, we can get a problem with tagged namespaces (struct, union, enum) 
 		 * overlapping with member names (and with each other). This causes an error like
@@ -121,7 +121,7 @@ namespace tool {
 		auto conflicting_toplevel_die = 
 			(p_d->get_name() && p_d->get_parent()->get_tag() != DW_TAG_compile_unit) 
 				? p_d->get_ds().toplevel()->visible_named_grandchild(*p_d->get_name())
-				: shared_ptr<spec::basic_die>();
+				: adt_ptr<spec::basic_die>();
 		assert(!conflicting_toplevel_die
 		|| conflicting_toplevel_die->iterator_here() != p_d->iterator_here());
 		string name_to_use;
@@ -149,32 +149,32 @@ namespace tool {
 		}
 	}
 	
-	bool cxx_generator_from_dwarf::cxx_type_can_be_qualified(shared_ptr<spec::type_die> p_d) const
+	bool cxx_generator_from_dwarf::cxx_type_can_be_qualified(adt_ptr<spec::type_die> p_d) const
 	{
 		if (p_d->get_tag() == DW_TAG_array_type) return false;
 		if (p_d->get_tag() == DW_TAG_subroutine_type) return false;
 		// FIXME: any more?
 		// now we know this bit of the type is fine for qualifying 
 		// what about chained bits?
-		if (!dynamic_pointer_cast<type_chain_die>(p_d)) return true;
+		if (!adt_cast<type_chain_die>(p_d)) return true;
 		// if we're chaining void, also true
-		if (!dynamic_pointer_cast<type_chain_die>(p_d)->get_type()) return true;
+		if (!adt_cast<type_chain_die>(p_d)->get_type()) return true;
 		return cxx_type_can_be_qualified(
-			dynamic_pointer_cast<type_chain_die>(p_d)->get_type()
+			adt_cast<type_chain_die>(p_d)->get_type()
 		);
 	}
 
-	bool cxx_generator_from_dwarf::cxx_type_can_have_name(shared_ptr<spec::type_die> p_d) const
+	bool cxx_generator_from_dwarf::cxx_type_can_have_name(adt_ptr<spec::type_die> p_d) const
 	{
 		/* In C++, introducing a name to a modified type requires typedef. */
 		if (p_d->get_tag() == DW_TAG_typedef) return true;
-		else if (dynamic_pointer_cast<type_chain_die>(p_d)) return false;
+		else if (adt_cast<type_chain_die>(p_d)) return false;
 		else return true;
 	}
 
 	pair<string, bool>
 	cxx_generator_from_dwarf::cxx_declarator_from_type_die(
-		shared_ptr<spec::type_die> p_d, 
+		adt_ptr<spec::type_die> p_d, 
 		optional<const string&> infix_typedef_name/*= optional<const std::string&>()*/,
 		bool use_friendly_names /*= true*/,  
 		optional<const string&> extra_prefix /* = optional<const string&>() */,
@@ -188,14 +188,14 @@ namespace tool {
 			case DW_TAG_base_type:
 				return make_pair(
 					((extra_prefix && !use_friendly_names) ? *extra_prefix : "")
-					+ local_name_for(dynamic_pointer_cast<spec::base_type_die>(p_d),
+					+ local_name_for(adt_cast<spec::base_type_die>(p_d),
 						use_friendly_names),
 					false);
 			case DW_TAG_typedef:
 				return make_pair((extra_prefix ? *extra_prefix : "") + *p_d->get_name(), false);
 			case DW_TAG_reference_type: {
-				shared_ptr<spec::reference_type_die> reference 
-				 = dynamic_pointer_cast<spec::reference_type_die>(p_d);
+				adt_ptr<spec::reference_type_die> reference 
+				 = adt_cast<spec::reference_type_die>(p_d);
 				assert(reference);
 				assert(reference->get_type());
 				auto declarator = cxx_declarator_from_type_die(
@@ -205,8 +205,8 @@ namespace tool {
 				return make_pair(declarator.first + "&", declarator.second);
 			}
 			case DW_TAG_pointer_type: {
-				shared_ptr<spec::pointer_type_die> pointer 
-				 = dynamic_pointer_cast<spec::pointer_type_die>(p_d);
+				adt_ptr<spec::pointer_type_die> pointer 
+				 = adt_cast<spec::pointer_type_die>(p_d);
 				if (pointer->get_type())
 				{
 //					if (pointer->get_type()->get_tag() == DW_TAG_subroutine_type)
@@ -235,13 +235,13 @@ namespace tool {
 			}
 			case DW_TAG_array_type: {
 				// we only understand C arrays, for now
-				int language = dynamic_pointer_cast<spec::type_die>(p_d)
+				int language = adt_cast<spec::type_die>(p_d)
 					->enclosing_compile_unit()->get_language();
 				assert(language == DW_LANG_C89 
 					|| language == DW_LANG_C 
 					|| language == DW_LANG_C99);
-				shared_ptr<spec::array_type_die> arr
-				 = dynamic_pointer_cast<spec::array_type_die>(p_d);
+				adt_ptr<spec::array_type_die> arr
+				 = adt_cast<spec::array_type_die>(p_d);
 				// calculate array size, if we have a subrange type
 				auto array_size = arr->element_count();
 				ostringstream arrsize; 
@@ -257,8 +257,8 @@ namespace tool {
 			}
 			case DW_TAG_subroutine_type: {
 				ostringstream s;
-				shared_ptr<spec::subroutine_type_die> subroutine_type 
-				 = dynamic_pointer_cast<spec::subroutine_type_die>(p_d);
+				adt_ptr<spec::subroutine_type_die> subroutine_type 
+				 = adt_cast<spec::subroutine_type_die>(p_d);
 				s << (subroutine_type->get_type() 
 					? cxx_declarator_from_type_die(subroutine_type->get_type(),
 					optional<const string&>(), 
@@ -277,7 +277,7 @@ namespace tool {
 						{
 							case DW_TAG_formal_parameter:
 								s << cxx_declarator_from_type_die( 
-										dynamic_pointer_cast<spec::formal_parameter_die>(i)->get_type(),
+										adt_cast<spec::formal_parameter_die>(i)->get_type(),
 											optional<const string&>(), 
 											use_friendly_names, extra_prefix, 
 											use_struct_and_union_prefixes
@@ -317,7 +317,7 @@ namespace tool {
 				/* This is complicated by the fact that array types in C/C++ can't be qualified directly,
 				 * but such qualified types can be defined using typedefs. (FIXME: I think this is correct
 				 * but don't quote me -- there might just be some syntax I'm missing.) */
-				auto chained_type =  dynamic_pointer_cast<spec::type_chain_die>(p_d)->get_type();
+				auto chained_type =  adt_cast<spec::type_chain_die>(p_d)->get_type();
 				/* Note that many DWARF emitters record C/C++ "const void" (as in "const void *")
 				 * as a const type with no "type" attribute. So handle this case. */
 				if (!chained_type) return make_pair("void" + qualifier_suffix, false);
@@ -346,7 +346,7 @@ namespace tool {
 	}
 	
 	bool 
-	cxx_generator_from_dwarf::is_builtin(shared_ptr<spec::basic_die> p_d)
+	cxx_generator_from_dwarf::is_builtin(adt_ptr<spec::basic_die> p_d)
 	{ 
 		bool retval = p_d->get_name() && p_d->get_name()->find("__builtin_") == 0;
 		if (retval) cerr << 
@@ -358,12 +358,12 @@ namespace tool {
 
 	vector<string> 
 	cxx_generator_from_dwarf::local_name_parts_for(
-		shared_ptr<spec::basic_die> p_d,
+		adt_ptr<spec::basic_die> p_d,
 		bool use_friendly_names /* = true */)
 	{ 
 		if (use_friendly_names && p_d->get_tag() == DW_TAG_base_type)
 		{
-			auto opt_name = name_for_base_type(dynamic_pointer_cast<spec::base_type_die>(p_d));
+			auto opt_name = name_for_base_type(adt_cast<spec::base_type_die>(p_d));
 			if (opt_name) return vector<string>(1, *opt_name);
 			else assert(false);
 		}
@@ -374,7 +374,7 @@ namespace tool {
 	}
 
 	vector<string> 
-	cxx_generator_from_dwarf::fq_name_parts_for(shared_ptr<spec::basic_die> p_d)
+	cxx_generator_from_dwarf::fq_name_parts_for(adt_ptr<spec::basic_die> p_d)
 	{
 		if (p_d->get_offset() != 0UL && p_d->get_parent()->get_tag() != DW_TAG_compile_unit)
 		{
@@ -394,8 +394,8 @@ namespace tool {
 	
 	bool 
 	cxx_generator_from_dwarf::cxx_assignable_from(
-		shared_ptr<spec::type_die> dest,
-		shared_ptr<spec::type_die> source
+		adt_ptr<spec::type_die> dest,
+		adt_ptr<spec::type_die> source
 	)
 	{
 		// FIXME: better approximation of C++ assignability rules goes here
@@ -417,17 +417,17 @@ namespace tool {
 		if (dest->get_tag() == DW_TAG_pointer_type
 		&& source->get_tag() == DW_TAG_pointer_type)
 		{
-			if (!dynamic_pointer_cast<spec::pointer_type_die>(dest)->get_type())
+			if (!adt_cast<spec::pointer_type_die>(dest)->get_type())
 			{
 				return true; // can always assign to void
 			}
 			else return 
-				dynamic_pointer_cast<spec::pointer_type_die>(source)
+				adt_cast<spec::pointer_type_die>(source)
 					->get_type()
-				&& fq_name_for(dynamic_pointer_cast<spec::pointer_type_die>(source)
+				&& fq_name_for(adt_cast<spec::pointer_type_die>(source)
 					->get_type()) 
 					== 
-					fq_name_for(dynamic_pointer_cast<spec::pointer_type_die>(dest)
+					fq_name_for(adt_cast<spec::pointer_type_die>(dest)
 					->get_type());
 		}
 
@@ -435,7 +435,7 @@ namespace tool {
 	}
 
 	bool 
-	cxx_generator_from_dwarf::cxx_is_complete_type(shared_ptr<spec::type_die> t)
+	cxx_generator_from_dwarf::cxx_is_complete_type(adt_ptr<spec::type_die> t)
 	{
 		t = t->get_concrete_type();
 		if (!t) return false;
@@ -443,7 +443,7 @@ namespace tool {
 // 		// if we can't find a definition, we're not complete
 // 		if (t->get_declaration() && *t->get_declaration()) 
 // 		{
-// 			auto with_data_members = dynamic_pointer_cast<with_data_members_die>(t);
+// 			auto with_data_members = adt_cast<with_data_members_die>(t);
 // 			if (with_data_members)
 // 			{
 // 				auto defn = with_data_members->find_my_own_definition();
@@ -460,9 +460,9 @@ namespace tool {
 		
 		if (t->get_tag() == DW_TAG_array_type)
 		{
-			if (!dynamic_pointer_cast<spec::array_type_die>(t)
+			if (!adt_cast<spec::array_type_die>(t)
 				->element_count()
-			|| *dynamic_pointer_cast<spec::array_type_die>(t)
+			|| *adt_cast<spec::array_type_die>(t)
 				->element_count() == 0)
 			{
 				return false;
@@ -472,16 +472,16 @@ namespace tool {
 		// if we're structured, we're complete iff 
 		// we don't have the "declaration" flag
 		// and all members are complete
-		if (dynamic_pointer_cast<spec::with_named_children_die>(t))
+		if (adt_cast<spec::with_named_children_die>(t))
 		{
-			auto nc = dynamic_pointer_cast<spec::with_named_children_die>(t);
+			auto nc = adt_cast<spec::with_named_children_die>(t);
 			//cerr << "DEBUG: testing completeness of cxx type for " << *t << endl;
 			for (auto i_member = t->children_begin(); 
 				i_member != t->children_end();
 				i_member++)
 			{
 				if ((*i_member)->get_tag() != DW_TAG_member) continue;
-				auto memb = dynamic_pointer_cast<spec::member_die>(*i_member);
+				auto memb = adt_cast<spec::member_die>(*i_member);
 				auto memb_opt_type = memb->get_type();
 				if (!memb_opt_type)
 				{
@@ -499,7 +499,7 @@ namespace tool {
 	
 	pair<string, bool>
 	cxx_generator_from_dwarf::name_for_type(
-		shared_ptr<spec::type_die> p_d, 
+		adt_ptr<spec::type_die> p_d, 
 		boost::optional<const string&> infix_typedef_name /*= none*/,
 		bool use_friendly_names/*= true*/)
 	{
@@ -513,7 +513,7 @@ namespace tool {
 // 		{
 // 			// HACK around this strange (const (array)) case
 // 			if (p_d->get_tag() == DW_TAG_const_type
-// 			 && dynamic_pointer_cast<const_type_die>(p_d)->get_type()->get_concrete_type()->get_tag()
+// 			 && adt_cast<const_type_die>(p_d)->get_type()->get_concrete_type()->get_tag()
 // 			 	== DW_TAG_array_type)
 // 			{
 // 				// assume that we will be emitting a typedef for the const type itself,
@@ -527,7 +527,7 @@ namespace tool {
 
 	string 
 	cxx_generator_from_dwarf::name_for_argument(
-		shared_ptr<spec::formal_parameter_die> p_d, 
+		adt_ptr<spec::formal_parameter_die> p_d, 
 		int argnum
 	)
 	{
@@ -540,7 +540,7 @@ namespace tool {
 	} 
 
 	string cxx_generator_from_dwarf::create_ident_for_anonymous_die(
-		shared_ptr<spec::basic_die> p_d
+		adt_ptr<spec::basic_die> p_d
 	)
 	{
 		std::ostringstream s;
@@ -575,7 +575,7 @@ namespace tool {
 	
 	string 
 	cxx_generator_from_dwarf::make_typedef(
-		shared_ptr<spec::type_die> p_d,
+		adt_ptr<spec::type_die> p_d,
 		const string& name
 	)
 	{
@@ -599,7 +599,7 @@ namespace tool {
 	
 	string
 	cxx_generator_from_dwarf::make_function_declaration_of_type(
-		shared_ptr<spec::subroutine_type_die> p_d,
+		adt_ptr<spec::subroutine_type_die> p_d,
 		const string& name,
 		bool write_semicolon /* = true */,
 		bool wrap_with_extern_lang /* = true */
@@ -709,14 +709,14 @@ namespace tool {
 	// define specializations here
 	template<> void cxx_generator_from_dwarf::emit_model<DW_TAG_base_type>             (indenting_ostream& out, abstract_dieset::iterator i_d)
 	{
-		auto p_d = dynamic_pointer_cast<base_type_die>(*i_d);
+		auto p_d = adt_cast<base_type_die>(*i_d);
 		optional<string> type_name_in_compiler = 
 			name_for_base_type(p_d);
 
 		if (!type_name_in_compiler) return; // FIXME: could define a C++ ADT!
 
 		auto our_name_for_this_type = name_for_type(
-			dynamic_pointer_cast<spec::type_die>(p_d), 
+			adt_cast<spec::type_die>(p_d), 
 			0 /* no infix */, 
 			false /* no friendly names*/);
 		assert(!our_name_for_this_type.second);
@@ -731,13 +731,13 @@ namespace tool {
 
 	template<> void cxx_generator_from_dwarf::emit_model<DW_TAG_subprogram>            (indenting_ostream& out, abstract_dieset::iterator i_d) 
 	{
-		auto p_d = dynamic_pointer_cast<subprogram_die>(*i_d);
+		auto p_d = adt_cast<subprogram_die>(*i_d);
 		
 		// skip unnamed, for now (FIXME)
 		if (!p_d->get_name() || (*p_d->get_name()).empty()) return;
 
 		// wrap with extern "lang"
-		switch(dynamic_pointer_cast<compile_unit_die>(
+		switch(adt_cast<compile_unit_die>(
 			p_d->enclosing_compile_unit())->get_language())
 		{
 			case DW_LANG_C:
@@ -769,13 +769,13 @@ namespace tool {
 		 * then unspecified parameters,
 		 * then others. */
 		recursively_emit_children(out, i_d, 
-			[](shared_ptr<basic_die> p){ return p->get_tag() == DW_TAG_formal_parameter; }
+			[](adt_ptr<basic_die> p){ return p->get_tag() == DW_TAG_formal_parameter; }
 		);
 		recursively_emit_children(out, i_d, 
-			[](shared_ptr<basic_die> p){ return p->get_tag() == DW_TAG_unspecified_parameters; }
+			[](adt_ptr<basic_die> p){ return p->get_tag() == DW_TAG_unspecified_parameters; }
 		);
 		recursively_emit_children(out, i_d, 
-			[](shared_ptr<basic_die> p){ 
+			[](adt_ptr<basic_die> p){ 
 				return p->get_tag() != DW_TAG_unspecified_parameters
 				    && p->get_tag() != DW_TAG_formal_parameter; }
 		);
@@ -789,11 +789,11 @@ namespace tool {
 
 	template<> void cxx_generator_from_dwarf::emit_model<DW_TAG_formal_parameter>      (indenting_ostream& out, abstract_dieset::iterator i_d)
 	{
-		auto p_d = dynamic_pointer_cast<spec::formal_parameter_die>(*i_d);
+		auto p_d = adt_cast<spec::formal_parameter_die>(*i_d);
 	
 		// recover arg position
 		int argpos = 0;
-		shared_ptr<subprogram_die> p_subp = dynamic_pointer_cast<subprogram_die>(
+		adt_ptr<subprogram_die> p_subp = adt_cast<subprogram_die>(
 			(*i_d)->get_parent());
 
 		auto i = p_subp->formal_parameter_children_begin();
@@ -815,11 +815,11 @@ namespace tool {
 
 	template<> void cxx_generator_from_dwarf::emit_model<DW_TAG_unspecified_parameters>(indenting_ostream& out, abstract_dieset::iterator i_d)
 	{
-		auto p_d = dynamic_pointer_cast<unspecified_parameters_die>(*i_d);
+		auto p_d = adt_cast<unspecified_parameters_die>(*i_d);
 		
 		// were there any specified args?
-		shared_ptr<subprogram_die> p_subp
-		 = dynamic_pointer_cast<subprogram_die>(p_d->get_parent());
+		adt_ptr<subprogram_die> p_subp
+		 = adt_cast<subprogram_die>(p_d->get_parent());
 
 		if (p_subp->formal_parameter_children_begin()
 			 != p_subp->formal_parameter_children_end())
@@ -833,7 +833,7 @@ namespace tool {
 	template<> void cxx_generator_from_dwarf::emit_model<DW_TAG_array_type>            (indenting_ostream& out, abstract_dieset::iterator i_d)
 	{
 		out << make_typedef(
-			dynamic_pointer_cast<spec::type_die>(*i_d),
+			adt_cast<spec::type_die>(*i_d),
 			create_ident_for_anonymous_die(*i_d)
 		);
 	}
@@ -856,16 +856,16 @@ namespace tool {
 
 	template<> void cxx_generator_from_dwarf::emit_model<DW_TAG_member>                (indenting_ostream& out, abstract_dieset::iterator i_d)
 	{
-		auto p_d = dynamic_pointer_cast<member_die>(*i_d);
+		auto p_d = adt_cast<member_die>(*i_d);
 		
 		/* To reproduce the member's alignment, we always issue an align attribute. 
 		 * We choose our alignment so as to ensure that the emitted field is located
 		 * at the offset specified in DWARF. */
-		shared_ptr<type_die> member_type = transform_type(p_d->get_type(), i_d);
+		adt_ptr<type_die> member_type = transform_type(p_d->get_type(), i_d);
 
 		// recover the previous formal parameter's offset and size
-		shared_ptr<spec::with_data_members_die> p_type = 
-			dynamic_pointer_cast<spec::with_data_members_die>(p_d->get_parent());
+		adt_ptr<spec::with_data_members_die> p_type = 
+			adt_cast<spec::with_data_members_die>(p_d->get_parent());
 		assert(p_type);
 		auto i = p_type->member_children_begin();
 		auto prev_i = p_type->member_children_end();
@@ -880,7 +880,7 @@ namespace tool {
 		if (prev_i == p_type->member_children_end()) cur_offset = 0;
 		else 
 		{
-			shared_ptr<member_die> prev_member = dynamic_pointer_cast<member_die>(*prev_i);
+			adt_ptr<member_die> prev_member = adt_cast<member_die>(*prev_i);
 			assert(prev_member->get_type());
 
 			if (prev_member->get_data_member_location())
@@ -1025,7 +1025,7 @@ namespace tool {
 
 	template<> void cxx_generator_from_dwarf::emit_model<DW_TAG_pointer_type>          (indenting_ostream& out, abstract_dieset::iterator i_d)
 	{
-		auto p_d = dynamic_pointer_cast<pointer_type_die>(*i_d);
+		auto p_d = adt_cast<pointer_type_die>(*i_d);
 		
 		// we always emit a typedef with synthetic name
 		// (but the user could just use the pointed-to type and "*")
@@ -1046,13 +1046,13 @@ namespace tool {
 		}
 		else 
 		{
-			out << make_typedef(dynamic_pointer_cast<spec::type_die>(p_d), name_to_use);
+			out << make_typedef(adt_cast<spec::type_die>(p_d), name_to_use);
 		}
 	}
 	
 	template<> void cxx_generator_from_dwarf::emit_model<DW_TAG_reference_type>        (indenting_ostream& out, abstract_dieset::iterator i_d)
 	{
-		auto p_d = dynamic_pointer_cast<reference_type_die>(*i_d);
+		auto p_d = adt_cast<reference_type_die>(*i_d);
 		
 		// we always emit a typedef with synthetic name
 		// (but the user could just use the pointed-to type and "*")
@@ -1073,13 +1073,13 @@ namespace tool {
 		}
 		else 
 		{
-			out << make_typedef(dynamic_pointer_cast<spec::type_die>(p_d), name_to_use);
+			out << make_typedef(adt_cast<spec::type_die>(p_d), name_to_use);
 		}
 	}
 
 	template<> void cxx_generator_from_dwarf::emit_model<DW_TAG_structure_type>        (indenting_ostream& out, abstract_dieset::iterator i_d)
 	{
-		auto p_d = dynamic_pointer_cast<structure_type_die>(*i_d);
+		auto p_d = adt_cast<structure_type_die>(*i_d);
 		
 		out << "struct " 
 			<< protect_ident(
@@ -1112,7 +1112,7 @@ namespace tool {
 
 	template<> void cxx_generator_from_dwarf::emit_model<DW_TAG_typedef>               (indenting_ostream& out, abstract_dieset::iterator i_d)
 	{
-		auto p_d = dynamic_pointer_cast<typedef_die>(*i_d);
+		auto p_d = adt_cast<typedef_die>(*i_d);
 		assert(p_d->get_name());
 		if (!p_d->get_type())
 		{
@@ -1127,7 +1127,7 @@ namespace tool {
 
 	template<> void cxx_generator_from_dwarf::emit_model<DW_TAG_union_type>            (indenting_ostream& out, abstract_dieset::iterator i_d)
 	{
-		auto p_d = dynamic_pointer_cast<union_type_die>(*i_d);
+		auto p_d = adt_cast<union_type_die>(*i_d);
 		
 		/* FIXME: this needs the same treatment of forward declarations
 		 * that structure_type gets. */
@@ -1147,7 +1147,7 @@ namespace tool {
 
 	template<> void cxx_generator_from_dwarf::emit_model<DW_TAG_const_type>            (indenting_ostream& out, abstract_dieset::iterator i_d)
 	{
-		auto p_d = dynamic_pointer_cast<const_type_die>(*i_d);
+		auto p_d = adt_cast<const_type_die>(*i_d);
 		
 		// we always emit a typedef with synthetic name
 		// (but the user could just use the pointed-to type and "const")
@@ -1155,7 +1155,7 @@ namespace tool {
 		try
 		{
 			out << make_typedef(
-				dynamic_pointer_cast<spec::type_die>(p_d),
+				adt_cast<spec::type_die>(p_d),
 				create_ident_for_anonymous_die(p_d)
 			);
 		}
@@ -1180,10 +1180,10 @@ namespace tool {
 
 	template<> void cxx_generator_from_dwarf::emit_model<DW_TAG_enumerator>            (indenting_ostream& out, abstract_dieset::iterator i_d)
 	{
-		auto p_d = dynamic_pointer_cast<enumerator_die>(*i_d);
+		auto p_d = adt_cast<enumerator_die>(*i_d);
 		
 		// FIXME
-		if ((*dynamic_pointer_cast<enumeration_type_die>(p_d->get_parent())
+		if ((*adt_cast<enumeration_type_die>(p_d->get_parent())
 			->enumerator_children_begin())
 				->get_offset() != p_d->get_offset()) // .. then we're not the first, so
 				out << ", " << endl;
@@ -1195,14 +1195,14 @@ namespace tool {
 
 	template<> void cxx_generator_from_dwarf::emit_model<DW_TAG_volatile_type>         (indenting_ostream& out, abstract_dieset::iterator i_d)
 	{
-		auto p_d = dynamic_pointer_cast<volatile_type_die>(*i_d);
+		auto p_d = adt_cast<volatile_type_die>(*i_d);
 		// we always emit a typedef with synthetic name
 		// (but the user could just use the pointed-to type and "const")
 
 		try
 		{
 			out << make_typedef(
-				dynamic_pointer_cast<spec::type_die>(p_d),
+				adt_cast<spec::type_die>(p_d),
 				create_ident_for_anonymous_die(p_d)
 			);
 		}
@@ -1221,12 +1221,12 @@ namespace tool {
 	
 	template<> void cxx_generator_from_dwarf::emit_model<DW_TAG_subrange_type>         (indenting_ostream& out, abstract_dieset::iterator i_d)
 	{
-		auto p_d = dynamic_pointer_cast<subrange_type_die>(*i_d);
+		auto p_d = adt_cast<subrange_type_die>(*i_d);
 		// Since we can't express subranges directly in C++, we just
 		// emit a typedef of the underlying type.
 		out << "typedef " 
 			<< protect_ident(name_for_type( 
-				dynamic_pointer_cast<spec::type_chain_die>(p_d)->get_type()).first
+				adt_cast<spec::type_chain_die>(p_d)->get_type()).first
 				)
 			<< " " 
 			<< protect_ident(
@@ -1239,7 +1239,7 @@ namespace tool {
 
 /* from dwarf::tool::cxx_target */
 	optional<string>
-	cxx_target::name_for_base_type(shared_ptr<spec::base_type_die> p_d)
+	cxx_target::name_for_base_type(adt_ptr<spec::base_type_die> p_d)
 	{
 		map<base_type, string>::iterator found = base_types.find(
 			base_type(p_d));
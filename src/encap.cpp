@@ -7,6 +7,8 @@
  */
 
 #include "encap.hpp"
+#include "encap_snapshot.hpp"
+#include "native.hpp"
 /* #include "encap_adt.hpp" */
 #include <iostream>
 #include <limits>
@@ -35,7 +37,7 @@ namespace dwarf
 		void dieset::create_toplevel_entry()
 		{
 			// create a fake toplevel parent die
-			shared_ptr<die> spd(new file_toplevel_die(*this));
+			adt_ptr<die> spd(new file_toplevel_die(*this));
 			// HACK: can't use make_shared because this is a protected constructor
 
 			this->insert(
@@ -48,12 +50,12 @@ namespace dwarf
 		bool dieset::move_to_first_child(spec::abstract_dieset::iterator_base& arg)
 		{
 			if (!arg.p_d) return false;
-			auto p_encap = dynamic_pointer_cast<encap::basic_die>(arg.p_d);
+			auto p_encap = adt_cast<encap::basic_die>(arg.p_d);
 			assert(p_encap);
 			if (p_encap->m_children.size() == 0) return false;
 			Dwarf_Off child_off = *p_encap->m_children.begin();
 
-			arg.p_d = dynamic_pointer_cast<spec::basic_die>((*this)[child_off]);
+			arg.p_d = adt_cast<spec::basic_die>((*this)[child_off]);
 			arg.off = child_off;
 			arg.path_from_root.push_back(child_off);
 
@@ -62,11 +64,11 @@ namespace dwarf
 		bool dieset::move_to_parent(spec::abstract_dieset::iterator_base& arg)
 		{
 			if (!arg.p_d) return false;
-			auto p_encap = dynamic_pointer_cast<encap::basic_die>(arg.p_d);
+			auto p_encap = adt_cast<encap::basic_die>(arg.p_d);
 			assert(p_encap);
 			if (p_encap->get_offset() == 0UL) return false;
 
-			arg.p_d = dynamic_pointer_cast<spec::basic_die>(p_encap->p_parent);
+			arg.p_d = adt_cast<spec::basic_die>(p_encap->p_parent);
 			arg.off = arg.p_d->get_offset();
 			arg.path_from_root.pop_back();
 
@@ -76,7 +78,7 @@ namespace dwarf
 		{
 			if (!arg.p_d) return false;
 			if (arg.path_from_root.back() == 0UL) return false;
-			auto p_encap = dynamic_pointer_cast<encap::basic_die>(arg.p_d);
+			auto p_encap = adt_cast<encap::basic_die>(arg.p_d);
 			assert(p_encap);
 
 			auto& parent_children = p_encap->p_parent->m_children;
@@ -86,7 +88,7 @@ namespace dwarf
 			Dwarf_Off sibling_off = *found;
 			assert(sibling_off != p_encap->m_offset);
 
-			arg.p_d = dynamic_pointer_cast<spec::basic_die>((*this)[sibling_off]);
+			arg.p_d = adt_cast<spec::basic_die>((*this)[sibling_off]);
 			arg.off = sibling_off;
 			arg.path_from_root.back() = sibling_off;
 
@@ -97,6 +99,153 @@ namespace dwarf
 				: dwarf::lib::file(fd, access, 
 				/*errarg = */0, /*errhand = */dwarf::lib::default_error_handler, 
 				/*error =*/ 0)
+		{
+			encapsulate_all();
+		}
+
+		file::file(int fd, Dwarf_Unsigned access, mode m)
+				: dwarf::lib::file(fd, access, 
+				/*errarg = */0, /*errhand = */dwarf::lib::default_error_handler, 
+				/*error =*/ 0)
+		{
+			if (m == EAGER) { encapsulate_all(); return; }
+
+			/* Just note where each CU is. We still have to walk the headers 
+			 * (but no further) to get the CU DIE offsets. */
+			Dwarf_Unsigned cu_header_length;
+			Dwarf_Half version_stamp;
+			Dwarf_Unsigned abbrev_offset;
+			Dwarf_Half address_size;
+			Dwarf_Unsigned next_cu_header;
+			// as in encapsulate_all(), first get back to the first CU header
+			while(DW_DLV_OK == this->next_cu_header(&cu_header_length, &version_stamp,
+				&abbrev_offset, &address_size, &next_cu_header));
+			for (int retval = this->next_cu_header(&cu_header_length, &version_stamp,
+						&abbrev_offset, &address_size, &next_cu_header);
+					retval == DW_DLV_OK;
+					retval = this->next_cu_header(&cu_header_length, &version_stamp,
+						&abbrev_offset, &address_size, &next_cu_header))
+			{
+				// FIXME: as in encapsulate_all(), we only do DWARF 3 (version stamp 2)
+				if (version_stamp != 2) throw std::string("Unsupported DWARF version stamp!");
+				m_ds.p_spec = &dwarf::spec::dwarf3;
+				dwarf::lib::die first(*this);
+				Dwarf_Off cu_off;
+				first.offset(&cu_off);
+				m_ds.add_lazy_cu(cu_off, next_cu_header);
+			}
+			m_ds.p_lazy_file = this;
+			// we don't know the last DIE's offset without loading the last CU
+			m_ds.last_monotonic_offset = m_ds.lazy_end() ? m_ds.lazy_end() - 1 : 0UL;
+		}
+
+		void file::encapsulate_cu(Dwarf_Off cu_off)
+		{
+			dwarf::lib::die cu(*this, cu_off);
+			encapsulate_die(cu, /* parent = */0UL); // as before, this won't explore the CU's siblings
+		}
+
+		void dieset::add_lazy_cu(Dwarf_Off cu_off, Dwarf_Off end)
+		{
+			lazy_cu c = { end, false, false, false };
+			lazy_cus.insert(make_pair(cu_off, c));
+			// the toplevel lists it as a child straight away, so iteration finds it
+			this->super::find(0UL)->second->m_children.insert(cu_off);
+		}
+
+		std::map<Dwarf_Off, dieset::lazy_cu>::iterator 
+		dieset::lazy_cu_containing(Dwarf_Off off)
+		{
+			auto found = lazy_cus.upper_bound(off);
+			if (found == lazy_cus.begin()) return lazy_cus.end();
+			--found;
+			return (off < found->second.end) ? found : lazy_cus.end();
+		}
+
+		void dieset::load_cu_containing(Dwarf_Off off)
+		{
+			auto found = lazy_cu_containing(off);
+			if (found == lazy_cus.end()) return; // toplevel, or a DIE added since
+			found->second.touched = true;
+			if (found->second.loaded) return;
+			// set this first, because encapsulating looks up DIEs in this CU
+			found->second.loaded = true;
+			bool was_loading = lazy_loading;
+			lazy_loading = true;
+			if (!was_loading) begin_cu_run(); // a nested load just joins the run
+			try { p_lazy_file->encapsulate_cu(found->first); }
+			catch (...) { if (!was_loading) end_cu_run(); lazy_loading = was_loading; throw; }
+			if (!was_loading) end_cu_run();
+			lazy_loading = was_loading;
+		}
+
+		void dieset::note_changed(Dwarf_Off off)
+		{
+			if (!p_lazy_file || lazy_loading) return;
+			auto found = lazy_cu_containing(off);
+			if (found != lazy_cus.end()) found->second.changed = true;
+		}
+
+		void dieset::load_all()
+		{
+			if (!p_lazy_file) return;
+			for (auto i_cu = lazy_cus.begin(); i_cu != lazy_cus.end(); ++i_cu)
+			{
+				if (!i_cu->second.loaded) load_cu_containing(i_cu->first);
+			}
+		}
+
+		unsigned dieset::evict_untouched()
+		{
+			unsigned count = 0;
+			for (auto i_cu = lazy_cus.begin(); i_cu != lazy_cus.end(); ++i_cu)
+			{
+				if (i_cu->second.loaded && !i_cu->second.touched && !i_cu->second.changed)
+				{
+					/* Take the DIEs out of the map before we let go of them, 
+					 * so that their destructors see a consistent dieset. The
+					 * toplevel keeps the CU in its children, so that we can
+					 * load it again. */
+					auto first = this->super::lower_bound(i_cu->first);
+					auto last = this->super::lower_bound(i_cu->second.end);
+					std::vector<adt_ptr<die> > evicted;
+					for (auto i_d = first; i_d != last; ++i_d) evicted.push_back(i_d->second);
+					this->super::erase(first, last);
+					i_cu->second.loaded = false;
+					++count;
+				}
+				i_cu->second.touched = false;
+			}
+			return count;
+		}
+
+		file::file(int fd, Dwarf_Unsigned access, const std::string& snapshot_path)
+				: dwarf::lib::file(fd, access, 
+				/*errarg = */0, /*errhand = */dwarf::lib::default_error_handler, 
+				/*error =*/ 0)
+		{
+			std::string build_id;
+			auto p_sections = core::debug_sections::open(fd);
+			if (p_sections) build_id = p_sections->build_id();
+			std::string path = (snapshot_path.empty() && !build_id.empty()) 
+				? snapshot::default_path(build_id) : snapshot_path;
+			if (build_id.empty() || path.empty())
+			{
+				// no way to tell whether a snapshot is ours, so don't use one
+				encapsulate_all();
+				return;
+			}
+			auto p_snapshot = snapshot::open(path, build_id);
+			if (p_snapshot)
+			{
+				p_snapshot->restore(m_ds);
+				return;
+			}
+			encapsulate_all();
+			snapshot::write(m_ds, build_id, path); // it's fine if this fails
+		}
+
+		void file::encapsulate_all()
 		{
 			// We have to explicitly loop through CU headers, 
 			// to set the CU context when getting dies.
@@ -201,7 +350,7 @@ namespace dwarf
 			// this is now done by attach_child, called from encapsulate_die
 			//m_ds.super::operator[](parent_off)->children().push_back(offset);
 
-			shared_ptr<die> p_encap_d;
+			adt_ptr<die> p_encap_d;
 			p_encap_d = encap::factory::for_spec(m_ds.get_spec()).encapsulate_die(
 				tag, m_ds, d, parent_off);
 			m_ds.insert(make_pair(offset, p_encap_d));
@@ -277,9 +426,9 @@ namespace dwarf
 					
 					// insert a fake wordsized type
 					auto p_first_cu = *p_all_cus->compile_unit_children_begin();
-					shared_ptr<base_type_die> base_type = dynamic_pointer_cast<base_type_die>(
+					adt_ptr<base_type_die> base_type = adt_cast<base_type_die>(
 						encap::factory::for_spec(m_ds.get_spec()).create_die(DW_TAG_base_type,
-							dynamic_pointer_cast<encap::basic_die>(p_first_cu) /*,
+							adt_cast<encap::basic_die>(p_first_cu) /*,
 						std::string("__cake_wordsize_integer_type")*/));
 					base_type->set_byte_size((elf_class == ELFCLASS32) ? 4
 									  : (elf_class == ELFCLASS64) ? 8
@@ -302,11 +451,11 @@ namespace dwarf
 							//cerr << "all_cus.children() size before: " << child_count
 							//	<< endl;
 							assert(ds().size() > 0 && child_count > 0);
-							shared_ptr<subprogram_die> subprogram
-							 = dynamic_pointer_cast<subprogram_die>(
+							adt_ptr<subprogram_die> subprogram
+							 = adt_cast<subprogram_die>(
 								encap::factory::for_spec(m_ds.get_spec()).create_die(
 									DW_TAG_subprogram,
-									dynamic_pointer_cast<encap::basic_die>(p_first_cu),
+									adt_cast<encap::basic_die>(p_first_cu),
 									std::string(symname)
 								)
 							);
@@ -327,7 +476,7 @@ namespace dwarf
 							//if ((*all_cus.compile_units_begin())->named_child(std::string("int")))
 							//{
 								subprogram->set_type(
-									dynamic_pointer_cast<spec::type_die>(base_type)
+									adt_cast<spec::type_die>(base_type)
 								);
 							//
 						}
@@ -336,20 +485,21 @@ namespace dwarf
 			} /* end while */
 		}
 	 
-		shared_ptr<file_toplevel_die> dieset::all_compile_units()
-		{ return dynamic_pointer_cast<file_toplevel_die>( (*this)[0UL] ); }
+		adt_ptr<file_toplevel_die> dieset::all_compile_units()
+		{ return adt_cast<file_toplevel_die>( (*this)[0UL] ); }
 
-		shared_ptr<dwarf::spec::basic_die> 
+		adt_ptr<dwarf::spec::basic_die> 
 		dieset::operator[](dwarf::lib::Dwarf_Off off) const
 		{ 
+			const_cast<dieset *>(this)->ensure_loaded(off);
 			auto found = this->super::find(off);
 			assert(found != this->super::end());
 			return found->second;
 		}
-		shared_ptr<spec::file_toplevel_die> 
+		adt_ptr<spec::file_toplevel_die> 
 		dieset::toplevel()
 		{ 
-			return dynamic_pointer_cast<spec::file_toplevel_die>(operator[](0UL));
+			return adt_cast<spec::file_toplevel_die>(operator[](0UL));
 		}	
 //		 encap::rangelist dieset::rangelist_at(Dwarf_Unsigned i) const
 //		 {
@@ -360,16 +510,18 @@ namespace dwarf
 		dieset& dieset::operator=(const dieset& arg)
 		{
 			cerr << "Copying from dieset at " << &arg << " to dieset at " << this << endl;
+			// HACK: if arg is lazy, copy all of it, not just what's been touched
+			const_cast<dieset&>(arg).load_all();
 			// pretend we're destructing, so that DIE destructors
 			// don't complain about loss of referential integrity during clear().
 			this->destructing = true;
-			this->map::clear();
+			this->super::clear();
 			this->last_monotonic_offset = arg.last_monotonic_offset;
 			this->destructing = arg.destructing;
 			this->p_spec = arg.p_spec;
 			for (auto i = arg.map_begin(); i != arg.map_end(); ++i)
 			{
-				auto p_d = dynamic_pointer_cast<encap::basic_die>(i->second);
+				auto p_d = adt_cast<encap::basic_die>(i->second);
 				auto cloned_die = factory::for_spec(*arg.p_spec).clone_die(
 						*this, 
 						p_d);
@@ -382,6 +534,7 @@ namespace dwarf
 					++i_clone_attr, ++i_orig_attr)
 				{
 					i_clone_attr->second.p_ds = this;
+					i_clone_attr->second.rehold(); // strings are interned per dieset
 					if (i_clone_attr->second.get_form() == attribute_value::REF)
 					{
 						cerr << "Copied a ref, from ref obj at addr " << i_orig_attr->second.v_ref
@@ -397,20 +550,20 @@ namespace dwarf
 				
 				this->insert(make_pair(i->first, cloned_die));
 				assert(this->find(i->first) != this->end()
-					&& &(this->map::find(i->first)->second->m_ds) == this);
+					&& &(this->super::find(i->first)->second->m_ds) == this);
 			}
 			
 			for (auto i_die = this->begin(); i_die != this->end(); ++i_die)
 			{
 				assert(&(*i_die)->get_ds() == this);
-				for (auto i_attr = dynamic_pointer_cast<encap::die>(*i_die)->attrs().begin(); 
-					i_attr != dynamic_pointer_cast<encap::die>(*i_die)->attrs().end();
+				for (auto i_attr = adt_cast<encap::die>(*i_die)->attrs().begin(); 
+					i_attr != adt_cast<encap::die>(*i_die)->attrs().end();
 					++i_attr)
 				{
 					// for all reference attributes, assert that if we follow them,
 					// we are still within the same dieset.
-					assert((*dynamic_pointer_cast<encap::die>(*i_die))[i_attr->first].get_form() != attribute_value::REF
-					   ||  (*dynamic_pointer_cast<encap::die>(*i_die))[i_attr->first].get_ref().p_ds == this);
+					assert((*adt_cast<encap::die>(*i_die))[i_attr->first].get_form() != attribute_value::REF
+					   ||  (*adt_cast<encap::die>(*i_die))[i_attr->first].get_ref().p_ds == this);
 				}
 			}
 
@@ -493,10 +646,10 @@ namespace dwarf
 		{ /*cerr << "Copy constructing an encap::die" << endl;*/ assert(p_parent); }
 				
 		die::die(dieset& ds, lib::die& d, Dwarf_Off parent_off) 
-			: m_ds(ds), p_parent(dynamic_pointer_cast<encap::die>(m_ds[parent_off]))
+			: m_ds(ds), p_parent(adt_cast<encap::die>(m_ds[parent_off]))
 		{ initialize_from_lib_die(d); assert(p_parent); }
 		die::die(dieset& ds, shared_ptr<lib::die> p_d, Dwarf_Off parent_off) 
-			: m_ds(ds), p_parent(dynamic_pointer_cast<encap::die>(m_ds[parent_off]))
+			: m_ds(ds), p_parent(adt_cast<encap::die>(m_ds[parent_off]))
 		{ initialize_from_lib_die(*p_d); assert(p_parent); }
 		
 		void die::initialize_from_lib_die(lib::die& d)
@@ -582,11 +735,12 @@ namespace dwarf
 			}
 		}
 		
-		void die::attach_child(std::shared_ptr<encap::basic_die> p)
+		void die::attach_child(adt_ptr<encap::basic_die> p)
 		{ 
 			assert(m_ds.find(p->get_offset()) == m_ds.end());
 			assert(p->parent_offset() == m_offset);
-			m_ds.super::operator[](p->get_offset()) = p;
+			m_ds.note_changed(m_offset);
+			m_ds.super::insert(std::make_pair(p->get_offset(), adt_ptr<die>(p)));
 			m_children.insert(p->get_offset());
 		}
 							
@@ -616,7 +770,7 @@ namespace dwarf
 // 		{
 // 			opt<die&> none;
 // #define CAST_TO_DIE(arg) \
-// 	dynamic_pointer_cast<die, spec::basic_die>((arg))
+// 	adt_cast<die, spec::basic_die>((arg))
 // 			if (pos == path.end()) { return opt<die&>(*(CAST_TO_DIE((*this)[start]))); }
 // 			else
 // 			{
@@ -661,12 +815,12 @@ namespace dwarf
 		 * backrefs, referential integrity etc.. */
 		attribute_value& die::put_attr(Dwarf_Half attr, attribute_value val)
 		{ 
+			m_ds.note_changed(m_offset);
 			if (val.get_form() != attribute_value::REF)
 			{
 				/* Trivial version. */
 				m_attrs.erase(attr);
-				m_attrs.insert(make_pair(attr, val)); 
-				return m_attrs.find(attr)->second; 
+				return m_attrs.insert(make_pair(attr, val)).first->second; 
 			}
 			else
 			{
@@ -680,12 +834,11 @@ namespace dwarf
 				 * i.e. they may be set to numeric_limits<...>::max(). */
 				/* Now proceed as above. */
 				m_attrs.erase(attr);
-				m_attrs.insert(make_pair(attr, attribute_value(m_ds, r))); 
-				return m_attrs.find(attr)->second; 
+				return m_attrs.insert(make_pair(attr, attribute_value(m_ds, r))).first->second; 
 			}
 		}
 //		 attribute_value& die::put_attr(Dwarf_Half attr, 
-//			 	shared_ptr<basic_die> target)
+//			 	adt_ptr<basic_die> target)
 //		 {
 //		 	attribute_value::ref r(
 //				 target->m_ds, 
@@ -18,7 +18,7 @@ namespace dwarf
         //{ return abstract::factory::get_factory<die>(spec); }
         class dwarf3_factory_t : public factory
         {
-            std::shared_ptr<die> encapsulate_die(Dwarf_Half tag, 
+            adt_ptr<die> encapsulate_die(Dwarf_Half tag, 
 	            dieset& ds, lib::die& d, Dwarf_Off parent_off) const 
             {
                 switch(tag)
@@ -33,8 +33,8 @@ case DW_TAG_ ## name: { auto p = my_make_shared<encap:: name ## _die>(ds, d, par
 						{ auto p = my_make_shared<encap::basic_die>(ds, d, parent_off); attach_to_ds(p); return p; }
                 }
 	        }
-			shared_ptr<basic_die>
-			create_die(Dwarf_Half tag, shared_ptr<basic_die> parent,
+			adt_ptr<basic_die>
+			create_die(Dwarf_Half tag, adt_ptr<basic_die> parent,
 				opt<std::string> die_name 
 					/* = opt<const std::string&>()*/) const
 			{
@@ -49,8 +49,8 @@ case DW_TAG_ ## name: { auto p = my_make_shared<encap:: name ## _die>(parent, di
                 }
 			}
 			
-			shared_ptr<basic_die>
-			clone_die(dieset& dest_ds, shared_ptr<basic_die> p_d) const
+			adt_ptr<basic_die>
+			clone_die(dieset& dest_ds, adt_ptr<basic_die> p_d) const
 			{
                 switch(p_d->get_tag())
                 {
@@ -68,7 +68,27 @@ case DW_TAG_ ## name: { auto p = my_make_shared<encap:: name ## _die>(dest_ds, \
                     default: assert(false);
                 }
 			}
-						
+			
+			adt_ptr<basic_die>
+			restore_die(dieset& ds, Dwarf_Half tag, Dwarf_Off parent_off,
+				Dwarf_Off offset, Dwarf_Off cu_offset) const
+			{
+                switch(tag)
+                {
+                    case 0: assert(false); // toplevel isn't instantiated from here
+#define factory_case(name, ...) /* use the "full" constructor*/ \
+case DW_TAG_ ## name: { auto p = my_make_shared<encap:: name ## _die>(ds, \
+    parent_off, offset, cu_offset, \
+    encap::die::attribute_map(), std::set<Dwarf_Off>()); \
+    attach_to_ds(p); return p; }
+#include "dwarf3-factory.h" // HACK: here ^ we avoid make_shared because of its private constructor problem
+#undef factory_case
+					default: 
+					 /* Probably a vendor extension, as in encapsulate_die. */ 
+						{ auto p = my_make_shared<encap::basic_die>(ds, parent_off, tag, offset, cu_offset,
+							encap::die::attribute_map(), std::set<Dwarf_Off>()); attach_to_ds(p); return p; }
+                }
+			}
 			
 		} the_dwarf3_factory;
 		factory *const factory::dwarf3_factory = &the_dwarf3_factory;
@@ -0,0 +1,426 @@
+/* dwarfpp: C++ binding for a useful subset of libdwarf, plus extra goodies.
+ *
+ * encap_snapshot.cpp: writing, mapping and restoring dieset snapshots.
+ *
+ * Copyright (c) 2013, Stephen Kell.
+ */
+
+#include "dwarfpp/encap_snapshot.hpp"
+#include "dwarfpp/name_index.hpp"
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <cstdio>
+#include <cstring>
+#include <cerrno>
+#include <vector>
+#include <sstream>
+#include <unordered_set>
+
+namespace dwarf
+{
+	namespace encap
+	{
+		using std::vector;
+		using std::make_pair;
+
+		static const char snapshot_magic[8] = { 'D', 'W', 'P', 'P', 'S', 'N', 'P', '1' };
+
+		snapshot::~snapshot()
+		{
+			if (mapping) munmap(mapping, mapping_length);
+		}
+
+		string snapshot::default_path(const string& build_id)
+		{
+			string path = core::name_index::default_path(build_id);
+			if (path.empty()) return path;
+			return path.substr(0, path.rfind('.')) + ".encap";
+		}
+
+		/* Writing. */
+
+		namespace
+		{
+			struct heap_writer
+			{
+				vector<unsigned char> bytes;
+				uint64_t align()
+				{
+					while (bytes.size() % 8 != 0) bytes.push_back(0);
+					return bytes.size();
+				}
+				void put(const void *p, size_t len)
+				{
+					const unsigned char *c = static_cast<const unsigned char *>(p);
+					bytes.insert(bytes.end(), c, c + len);
+				}
+				void put_u64(uint64_t u) { put(&u, sizeof u); }
+			};
+		}
+
+		bool snapshot::write(dieset& ds, const string& build_id, const string& path)
+		{
+			if (build_id.empty() || build_id.size() > sizeof (header().build_id)) return false;
+
+			vector<die_rec> out_dies;
+			vector<attr_rec> out_attrs;
+			vector<cu_rec> out_cus;
+			vector<backref_rec> out_backrefs;
+			heap_writer heap;
+
+			/* Depth-first from each CU, so that restoring can attach each DIE
+			 * to a parent it has already made. */
+			auto p_toplevel = ds.map_find(0UL)->second;
+			for (auto i_cu = p_toplevel->children().begin(); i_cu != p_toplevel->children().end(); ++i_cu)
+			{
+				cu_rec c;
+				c.first_die = out_dies.size();
+				vector<Dwarf_Off> to_visit(1, *i_cu);
+				while (!to_visit.empty())
+				{
+					auto found = ds.map_find(to_visit.back());
+					to_visit.pop_back();
+					assert(found != ds.map_end());
+					die& d = *found->second;
+
+					die_rec r;
+					memset(&r, 0, sizeof r);
+					r.offset = d.m_offset;
+					r.parent = d.p_parent->get_offset();
+					r.cu_offset = d.cu_offset;
+					r.first_attr = out_attrs.size();
+					r.tag = d.m_tag;
+					for (auto i_attr = d.m_attrs.begin(); i_attr != d.m_attrs.end(); ++i_attr)
+					{
+						const attribute_value& v = i_attr->second;
+						attr_rec a;
+						memset(&a, 0, sizeof a);
+						a.attr = i_attr->first;
+						a.orig_form = v.orig_form;
+						a.form = v.f;
+						switch (v.f)
+						{
+							case attribute_value::FLAG: a.a = v.v_flag; break;
+							case attribute_value::UNSIGNED: a.a = v.v_u; break;
+							case attribute_value::SIGNED: a.a = (uint64_t) v.v_s; break;
+							case attribute_value::ADDR: a.a = v.v_addr.addr; break;
+							case attribute_value::REF: a.a = v.v_ref->off; a.b = v.v_ref->abs; break;
+							case attribute_value::STRING:
+								a.a = heap.align();
+								a.b = v.get_string().size();
+								heap.put(v.get_string().data(), v.get_string().size());
+								break;
+							case attribute_value::BLOCK:
+								a.a = heap.align();
+								a.b = v.get_block()->size();
+								if (!v.get_block()->empty()) heap.put(&(*v.get_block())[0], v.get_block()->size());
+								break;
+							case attribute_value::LOCLIST:
+								a.a = heap.align();
+								a.b = v.get_loclist().size();
+								for (auto i_expr = v.get_loclist().begin(); i_expr != v.get_loclist().end(); ++i_expr)
+								{
+									heap.put_u64(i_expr->lopc);
+									heap.put_u64(i_expr->hipc);
+									heap.put_u64(i_expr->size());
+									for (auto i_instr = i_expr->begin(); i_instr != i_expr->end(); ++i_instr)
+									{
+										heap.put_u64(i_instr->lr_atom);
+										heap.put_u64(i_instr->lr_number);
+										heap.put_u64(i_instr->lr_number2);
+										heap.put_u64(i_instr->lr_offset);
+									}
+								}
+								break;
+							case attribute_value::RANGELIST:
+								a.a = heap.align();
+								a.b = v.get_rangelist().size();
+								for (auto i_r = v.get_rangelist().begin(); i_r != v.get_rangelist().end(); ++i_r)
+								{
+									heap.put_u64(i_r->dwr_addr1);
+									heap.put_u64(i_r->dwr_addr2);
+									heap.put_u64(i_r->dwr_type);
+								}
+								break;
+							default: continue; // NO_ATTR, UNRECOG: nothing to keep
+						}
+						out_attrs.push_back(a);
+						++r.nattrs;
+					}
+					out_dies.push_back(r);
+					// push in reverse, so that we visit children in offset order
+					for (auto i_child = d.m_children.rbegin(); i_child != d.m_children.rend(); ++i_child)
+					{
+						to_visit.push_back(*i_child);
+					}
+				}
+				c.ndies = out_dies.size() - c.first_die;
+				out_cus.push_back(c);
+			}
+			for (auto i_list = ds.backrefs().begin(); i_list != ds.backrefs().end(); ++i_list)
+			{
+				for (auto i_br = i_list->second.begin(); i_br != i_list->second.end(); ++i_br)
+				{
+					backref_rec b;
+					memset(&b, 0, sizeof b);
+					b.target = i_list->first;
+					b.referencing_off = i_br->first;
+					b.referencing_attr = i_br->second;
+					out_backrefs.push_back(b);
+				}
+			}
+			heap.align();
+
+			header h;
+			memset(&h, 0, sizeof h);
+			memcpy(h.magic, snapshot_magic, sizeof snapshot_magic);
+			h.version = VERSION;
+			h.build_id_len = build_id.size();
+			memcpy(h.build_id, build_id.data(), build_id.size());
+			h.ndies = out_dies.size();
+			h.dies_off = sizeof h;
+			h.nattrs = out_attrs.size();
+			h.attrs_off = h.dies_off + out_dies.size() * sizeof (die_rec);
+			h.ncus = out_cus.size();
+			h.cus_off = h.attrs_off + out_attrs.size() * sizeof (attr_rec);
+			h.nbackrefs = out_backrefs.size();
+			h.backrefs_off = h.cus_off + out_cus.size() * sizeof (cu_rec);
+			h.heap_off = h.backrefs_off + out_backrefs.size() * sizeof (backref_rec);
+			h.heap_len = heap.bytes.size();
+			h.last_monotonic_offset = ds.last_monotonic_offset;
+
+			/* Make the directory, as for the name index; it's fine if it exists. */
+			string dir = path.substr(0, path.rfind('/'));
+			if (!dir.empty() && dir != path)
+			{
+				string parent = dir.substr(0, dir.rfind('/'));
+				if (!parent.empty() && parent != dir) mkdir(parent.c_str(), 0755);
+				if (mkdir(dir.c_str(), 0755) != 0 && errno != EEXIST) return false;
+			}
+
+			std::ostringstream tmp_name;
+			tmp_name << path << ".tmp." << getpid();
+			string tmp_path = tmp_name.str();
+			FILE *f = fopen(tmp_path.c_str(), "wb");
+			if (!f) return false;
+			bool ok = fwrite(&h, sizeof h, 1, f) == 1
+				&& (out_dies.empty() || fwrite(&out_dies[0], sizeof (die_rec), out_dies.size(), f) == out_dies.size())
+				&& (out_attrs.empty() || fwrite(&out_attrs[0], sizeof (attr_rec), out_attrs.size(), f) == out_attrs.size())
+				&& (out_cus.empty() || fwrite(&out_cus[0], sizeof (cu_rec), out_cus.size(), f) == out_cus.size())
+				&& (out_backrefs.empty() || fwrite(&out_backrefs[0], sizeof (backref_rec), out_backrefs.size(), f) == out_backrefs.size())
+				&& (heap.bytes.empty() || fwrite(&heap.bytes[0], heap.bytes.size(), 1, f) == 1);
+			ok = (fclose(f) == 0) && ok;
+			if (!ok || 0 != rename(tmp_path.c_str(), path.c_str()))
+			{
+				unlink(tmp_path.c_str());
+				return false;
+			}
+			return true;
+		}
+
+		/* Mapping and checking. */
+
+		shared_ptr<snapshot> snapshot::open(const string& path, const string& build_id)
+		{
+			if (build_id.empty() || build_id.size() > sizeof (header().build_id)) return shared_ptr<snapshot>();
+			int fd = ::open(path.c_str(), O_RDONLY);
+			if (fd == -1) return shared_ptr<snapshot>();
+			struct stat st;
+			if (fstat(fd, &st) != 0 || (size_t) st.st_size < sizeof (header)) { close(fd); return shared_ptr<snapshot>(); }
+			void *mapping = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+			close(fd);
+			if (mapping == MAP_FAILED) return shared_ptr<snapshot>();
+			shared_ptr<snapshot> p(new snapshot);
+			p->mapping = mapping;
+			p->mapping_length = st.st_size;
+			p->p_header = static_cast<const header *>(mapping);
+
+			const header& h = *p->p_header;
+			if (0 != memcmp(h.magic, snapshot_magic, sizeof snapshot_magic)
+				|| h.version != VERSION
+				|| h.build_id_len != build_id.size()
+				|| 0 != memcmp(h.build_id, build_id.data(), build_id.size()))
+			{
+				return shared_ptr<snapshot>();
+			}
+			/* Each table must be aligned and lie within the file. */
+			auto table_ok = [&h, &p](uint64_t off, uint64_t n, size_t size) {
+				return off % 8 == 0 && off <= p->mapping_length
+					&& n <= (p->mapping_length - off) / size;
+			};
+			if (!table_ok(h.dies_off, h.ndies, sizeof (die_rec))
+				|| !table_ok(h.attrs_off, h.nattrs, sizeof (attr_rec))
+				|| !table_ok(h.cus_off, h.ncus, sizeof (cu_rec))
+				|| !table_ok(h.backrefs_off, h.nbackrefs, sizeof (backref_rec))
+				|| !table_ok(h.heap_off, h.heap_len, 1))
+			{
+				return shared_ptr<snapshot>();
+			}
+			const char *base = static_cast<const char *>(mapping);
+			p->dies = reinterpret_cast<const die_rec *>(base + h.dies_off);
+			p->attrs = reinterpret_cast<const attr_rec *>(base + h.attrs_off);
+			p->cus = reinterpret_cast<const cu_rec *>(base + h.cus_off);
+			p->backrefs = reinterpret_cast<const backref_rec *>(base + h.backrefs_off);
+			p->heap = reinterpret_cast<const unsigned char *>(base + h.heap_off);
+			if (!p->check()) return shared_ptr<snapshot>();
+			return p;
+		}
+
+		bool snapshot::check_heap_item(const attr_rec& a) const
+		{
+			const uint64_t len = p_header->heap_len;
+			if (a.a > len || a.a % 8 != 0) return false;
+			const uint64_t *p = reinterpret_cast<const uint64_t *>(heap + a.a);
+			uint64_t remaining = (len - a.a) / 8; // in uint64_ts
+			switch (a.form)
+			{
+				case attribute_value::STRING:
+				case attribute_value::BLOCK:
+					return a.b <= len - a.a;
+				case attribute_value::RANGELIST:
+					return a.b <= remaining / 3;
+				case attribute_value::LOCLIST:
+					for (uint64_t i = 0; i < a.b; ++i)
+					{
+						if (remaining < 3) return false;
+						uint64_t ninstrs = p[2];
+						p += 3; remaining -= 3;
+						if (ninstrs > remaining / 4) return false;
+						p += 4 * ninstrs; remaining -= 4 * ninstrs;
+					}
+					return true;
+				default:
+					return true;
+			}
+		}
+
+		bool snapshot::check() const
+		{
+			/* Every DIE's parent must come before it (or be the toplevel),
+			 * its attributes must be in range, and so must any heap items. */
+			std::unordered_set<uint64_t> seen;
+			seen.insert(0UL);
+			for (const die_rec *d = dies; d != dies + p_header->ndies; ++d)
+			{
+				if (d->offset == 0UL || seen.find(d->parent) == seen.end()) return false;
+				if (!seen.insert(d->offset).second) return false;
+				if (d->first_attr > p_header->nattrs || d->nattrs > p_header->nattrs - d->first_attr) return false;
+				for (const attr_rec *a = attrs + d->first_attr; a != attrs + d->first_attr + d->nattrs; ++a)
+				{
+					if (a->form == attribute_value::NO_ATTR || a->form >= attribute_value::UNRECOG) return false;
+					if (!check_heap_item(*a)) return false;
+				}
+			}
+			/* CUs must partition the DIEs, each starting at a CU. */
+			uint64_t next = 0;
+			for (const cu_rec *c = cus; c != cus + p_header->ncus; ++c)
+			{
+				if (c->first_die != next || c->ndies == 0 || c->ndies > p_header->ndies - next) return false;
+				if (dies[c->first_die].parent != 0UL) return false;
+				next += c->ndies;
+			}
+			return next == p_header->ndies;
+		}
+
+		/* Restoring. */
+
+		attribute_value snapshot::value_of(dieset& ds, const die_rec& d, const attr_rec& a) const
+		{
+			attribute_value v(ds, a.orig_form, (attribute_value::form) a.form);
+			const uint64_t *p = reinterpret_cast<const uint64_t *>(heap + a.a);
+			switch (a.form)
+			{
+				case attribute_value::FLAG: v.v_flag = a.a; break;
+				case attribute_value::UNSIGNED: v.v_u = a.a; break;
+				case attribute_value::SIGNED: v.v_s = (Dwarf_Signed) a.a; break;
+				case attribute_value::ADDR: v.v_addr.addr = a.a; break;
+				case attribute_value::REF:
+					/* As in encapsulation, a strong ref; it adds its own backref,
+					 * which restore() later replaces with the recorded ones. */
+					v.v_ref = new attribute_value::ref(ds, a.a, a.b, d.offset, a.attr);
+					break;
+				case attribute_value::STRING:
+					v.v_string = v.hold(std::string(reinterpret_cast<const char *>(heap + a.a), a.b));
+					break;
+				case attribute_value::BLOCK:
+					v.v_block = v.hold(std::vector<unsigned char>(heap + a.a, heap + a.a + a.b));
+					break;
+				case attribute_value::LOCLIST: {
+					vector<loc_expr> exprs;
+					exprs.reserve(a.b);
+					for (uint64_t i = 0; i < a.b; ++i)
+					{
+						loc_expr e(ds.get_spec());
+						e.lopc = p[0];
+						e.hipc = p[1];
+						uint64_t ninstrs = p[2];
+						p += 3;
+						e.reserve(ninstrs);
+						for (uint64_t j = 0; j < ninstrs; ++j, p += 4)
+						{
+							expr_instr instr;
+							instr.lr_atom = p[0];
+							instr.lr_number = p[1];
+							instr.lr_number2 = p[2];
+							instr.lr_offset = p[3];
+							e.push_back(instr);
+						}
+						exprs.push_back(e);
+					}
+					v.v_loclist = v.hold(loclist(exprs));
+				} break;
+				case attribute_value::RANGELIST: {
+					rangelist rs;
+					rs.reserve(a.b);
+					for (uint64_t i = 0; i < a.b; ++i, p += 3)
+					{
+						Dwarf_Ranges r;
+						r.dwr_addr1 = p[0];
+						r.dwr_addr2 = p[1];
+						r.dwr_type = (Dwarf_Ranges_Entry_Type) p[2];
+						rs.push_back(r);
+					}
+					v.v_rangelist = v.hold(std::move(rs));
+				} break;
+				default: assert(false); // check() rules these out
+			}
+			return v;
+		}
+
+		void snapshot::restore_cu(dieset& ds, uint64_t cu_idx) const
+		{
+			assert(cu_idx < p_header->ncus);
+			const cu_rec& c = cus[cu_idx];
+			factory& f = factory::for_spec(ds.get_spec());
+			for (const die_rec *d = dies + c.first_die; d != dies + c.first_die + c.ndies; ++d)
+			{
+				auto p_d = f.restore_die(ds, d->tag, d->parent, d->offset, d->cu_offset);
+				for (const attr_rec *a = attrs + d->first_attr; a != attrs + d->first_attr + d->nattrs; ++a)
+				{
+					p_d->m_attrs.insert(make_pair(a->attr, value_of(ds, *d, *a)));
+				}
+				// the parent--child backref, as die::initialize_from_lib_die makes
+				ds.backrefs()[d->parent].push_back(make_pair((Dwarf_Off) d->offset, (Dwarf_Half) 0));
+			}
+		}
+
+		void snapshot::restore(dieset& ds) const
+		{
+			assert(ds.map_size() == 1); // just the toplevel
+			for (uint64_t i = 0; i < p_header->ncus; ++i) restore_cu(ds, i);
+
+			/* The backrefs we made along the way are the same set as the
+			 * recorded ones, but maybe in a different order. Use the recorded. */
+			ds.backrefs().clear();
+			for (const backref_rec *b = backrefs; b != backrefs + p_header->nbackrefs; ++b)
+			{
+				ds.backrefs()[b->target].push_back(make_pair((Dwarf_Off) b->referencing_off,
+					(Dwarf_Half) b->referencing_attr));
+			}
+			ds.last_monotonic_offset = p_header->last_monotonic_offset;
+		}
+	}
+}
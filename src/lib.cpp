@@ -10,9 +10,19 @@
 #include "dwarfpp/encap.hpp" // re-use some formatting logic in encap, for convenience
 	// FIXME: flip the above around, so that the formatting logic is in here!
 #include "dwarfpp/expr.hpp" /* for absolute_loclist_to_additive_loclist */
+#include "dwarfpp/native.hpp"
+#include "dwarfpp/name_index.hpp"
+#include "dwarfpp/accel.hpp"
 
 #include <sstream>
 #include <libelf.h>
+#include <algorithm>
+#include <set>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <exception>
+#include <limits>
 #include <cstring> /* We use strcmp in linear search-by-name -- likely this will change */ 
 
 namespace dwarf
@@ -129,6 +139,135 @@ namespace dwarf
 			return encap::attribute_value(attr, d, get_root(opt_r));
 		}
 		
+		root_die::root_die(int fd)
+		 : dbg(fd), fd(fd), current_cu_offset(0UL), cursor_navigation(true),
+		   p_native(native_root_die::open(fd)), p_last_native_unit(nullptr),
+		   tried_accel(false), cache_child_names(false)
+		{
+			if (p_native) p_name_index = name_index::open_for(p_native->sections());
+		}
+		
+		root_die::root_die(int fd, root_die& shared_from)
+		 : dbg(fd), fd(fd), current_cu_offset(0UL), 
+		   cursor_navigation(shared_from.cursor_navigation),
+		   p_native(shared_from.p_native), p_last_native_unit(nullptr),
+		   p_accel(shared_from.p_accel), tried_accel(shared_from.tried_accel),
+		   cache_child_names(shared_from.cache_child_names)
+		{
+			// build it here if need be, so that siblings don't each build their own
+			shared_from.get_cu_index();
+			p_cu_index = shared_from.p_cu_index;
+			first_cu_offset = shared_from.first_cu_offset;
+			p_skeleton = shared_from.p_skeleton; // if any
+			p_address_index = shared_from.p_address_index; // ditto
+			p_name_index = shared_from.p_name_index; // ditto
+		}
+		
+		void
+		root_die::parallel_for_each_cu(const cu_callback& fn, unsigned nthreads)
+		{
+			const cu_index& idx = get_cu_index();
+			unsigned ncus = idx.records.size();
+			if (ncus == 0) return;
+			if (nthreads == 0) nthreads = std::thread::hardware_concurrency();
+			if (nthreads == 0) nthreads = 1;
+			if (nthreads > ncus) nthreads = ncus;
+			
+			/* One queue of CU numbers per worker. Nobody adds work once we've 
+			 * started, so a worker can stop as soon as every queue is empty. */
+			struct work_queue
+			{
+				std::mutex m;
+				deque<unsigned> cus;
+			};
+			vector<unique_ptr<work_queue> > queues;
+			for (unsigned w = 0; w < nthreads; ++w)
+			{
+				queues.push_back(unique_ptr<work_queue>(new work_queue));
+				// contiguous runs, so neighbouring CUs (which often share
+				// abbreviations and strings) go to the same worker
+				for (unsigned i = (unsigned long) w * ncus / nthreads;
+					i < (unsigned long) (w + 1) * ncus / nthreads; ++i)
+				{
+					queues.back()->cus.push_back(i);
+				}
+			}
+			std::atomic<bool> failed(false);
+			std::exception_ptr first_exception;
+			std::mutex exception_mutex;
+			
+			auto worker = [&](unsigned w) {
+				try
+				{
+					root_die r(fd, *this);
+					while (!failed)
+					{
+						optional<unsigned> next;
+						{
+							std::lock_guard<std::mutex> guard(queues[w]->m);
+							if (!queues[w]->cus.empty())
+							{
+								next = queues[w]->cus.front();
+								queues[w]->cus.pop_front();
+							}
+						}
+						for (unsigned k = 1; !next && k < nthreads; ++k)
+						{
+							work_queue& victim = *queues[(w + k) % nthreads];
+							std::lock_guard<std::mutex> guard(victim.m);
+							if (!victim.cus.empty())
+							{
+								next = victim.cus.back();
+								victim.cus.pop_back();
+							}
+						}
+						if (!next) break; // all gone
+						
+						Dwarf_Off cu_off = idx.records[*next].cu_die_offset;
+						{
+							iterator_df<compile_unit_die> i_cu = r.cu_pos(cu_off);
+							fn(r, i_cu);
+						}
+						r.release_cu(cu_off);
+					}
+				}
+				catch (...)
+				{
+					std::lock_guard<std::mutex> guard(exception_mutex);
+					if (!first_exception) first_exception = std::current_exception();
+					failed = true;
+				}
+			};
+			
+			vector<std::thread> threads;
+			for (unsigned w = 1; w < nthreads; ++w) threads.push_back(std::thread(worker, w));
+			worker(0); // the calling thread is worker 0
+			for (auto i_t = threads.begin(); i_t != threads.end(); ++i_t) i_t->join();
+			
+			if (first_exception) std::rethrow_exception(first_exception);
+		}
+		
+		bool
+		root_die::native_die_at(Dwarf_Off off, native_die *out)
+		{
+			if (!p_native) return false;
+			const unit_header *p_u = p_last_native_unit;
+			if (!p_u || off < p_u->first_die_offset || off >= p_u->end_offset)
+			{
+				p_u = p_native->unit_containing(off);
+				if (!p_u || off < p_u->first_die_offset) return false;
+				p_last_native_unit = p_u;
+			}
+			const unsigned char *p = p_native->sections().info.data + off;
+			const unsigned char *unit_end = p_native->sections().info.data + p_u->end_offset;
+			Dwarf_Unsigned code = native_decode::read_uleb128(p, unit_end);
+			if (!p) return false;
+			const abbrev *p_abbrev = p_u->p_abbrevs->find(code);
+			if (!p_abbrev || unit_end - p < p_abbrev->min_size) return false;
+			*out = native_die(p_native.get(), p_u, p_abbrev, off, p);
+			return true;
+		}
+		
 		/* Moving around, there are a few concerns to deal with. 
 		 * 1. maintaining the parent cache
 		 * 2. exploiting the parent cache
@@ -154,21 +293,19 @@ namespace dwarf
 			else
 			{
 				assert(it.get_depth() > 0);
-				auto found = parent_of.find(it.offset_here());
-				// if we issued `it', we should have recorded its parent
-				// FIXME: relax this policy perhaps, to allow soft cache?
-				assert(found != parent_of.end());
-				assert(found->first == it.offset_here());
-				assert(found->second < it.offset_here());
-				//cerr << "Parent cache says parent of 0x" << std::hex << found->first
-				// << " is 0x" << std::hex << found->second << std::dec << endl;
-				auto maybe_handle = Die::try_construct(*this, found->second);
+				// the parent cache is soft, so this might have to walk down from the CU
+				auto found = find_parent_offset(it.offset_here());
+				assert(found);
+				assert(*found < it.offset_here());
+				//cerr << "Parent cache says parent of 0x" << std::hex << it.offset_here()
+				// << " is 0x" << std::hex << *found << std::dec << endl;
+				auto maybe_handle = Die::try_construct(*this, *found);
 				
 				if (maybe_handle)
 				{
 					// update it
 					iterator_base new_it(std::move(maybe_handle), it.get_depth() - 1, *this);
-					assert(new_it.offset_here() == found->second);
+					assert(new_it.offset_here() == *found);
 					return new_it;
 				}
 				else
@@ -182,12 +319,16 @@ namespace dwarf
 		bool 
 		root_die::move_to_parent(iterator_base& it)
 		{
+			if (cursor_navigation && it.is_real_die_position() && it.depth() > 2)
+			{
+				return step_to_parent_in_place(it);
+			}
 			auto maybe_parent = parent(it); 
 			if (maybe_parent != iterator_base::END) 
 			{
 				/* check we really got the parent! */
-				assert(parent_of.find(it.offset_here()) != parent_of.end());
-				assert(maybe_parent.offset_here() == parent_of[it.offset_here()]);
+				assert(!maybe_parent.is_real_die_position()
+					|| maybe_parent.offset_here() == *find_parent_offset(it.offset_here()));
 				it = std::move(maybe_parent); 
 				return true; 
 			}
@@ -225,7 +366,10 @@ namespace dwarf
 			{
 				iterator_base new_it(std::move(maybe_handle), it.get_depth() + 1, it.get_root());
 				// install in parent cache
-				parent_of[new_it.offset_here()] = start_offset;
+				Dwarf_Off new_off = new_it.offset_here();
+				if (start_offset == 0UL) parent_of.insert(new_off, new_off, 0UL);
+				else parent_of.insert(new_it.depth() == 2 ? start_offset : new_it.enclosing_cu_offset_here(),
+					new_off, start_offset);
 				return new_it;
 			} else return iterator_base::END;
 		}
@@ -234,6 +378,10 @@ namespace dwarf
 		bool 
 		root_die::move_to_first_child(iterator_base& it)
 		{
+			if (cursor_navigation && it.is_real_die_position())
+			{
+				return step_to_first_child_in_place(it);
+			}
 			unsigned start_depth = it.get_depth();
 			auto maybe_child = first_child(it); 
 			if (maybe_child != iterator_base::END) 
@@ -261,136 +409,843 @@ namespace dwarf
 		iterator_base
 		root_die::find_named_child(const iterator_base& start, const string& name)
 		{
+			if (cache_child_names) return find_named_child_cached(start, name);
 			auto children = start.children_here();
 			for (auto i_child = std::move(children.first); i_child != children.second; ++i_child)
 			{
-				/* Use strcmp because name_here returns us a fancy char*, not a std::string. */
-				if (0 == strcmp(i_child.get_raw_name().get(), name.c_str())) return i_child;
+				auto name_here = i_child.name_view_here();
+				if (name_here.data() && name_here == name) return i_child;
 			}
 			return iterator_base::END;
 		}
 		
-		bool root_die::advance_cu_context()
+		iterator_base
+		root_die::find_named_child_cached(const iterator_base& start, const string& name)
 		{
-			// boost::optional doesn't let us get a writable lvalue out of an
-			// uninitialized optional, so we have to dummy up. 
-
-			Dwarf_Unsigned seen_cu_header_length;
-			Dwarf_Half seen_version_stamp;
-			Dwarf_Unsigned seen_abbrev_offset;
-			Dwarf_Half seen_address_size;
-			Dwarf_Half seen_offset_size;
-			Dwarf_Half seen_extension_size;
-			Dwarf_Unsigned seen_next_cu_header;
-			
-			int retval = dwarf_next_cu_header_b(dbg.handle.get(),
-				&seen_cu_header_length, &seen_version_stamp, 
-				&seen_abbrev_offset, &seen_address_size, 
-				&seen_offset_size, &seen_extension_size,
-				&seen_next_cu_header, &current_dwarf_error);
-			assert(retval == DW_DLV_OK || retval == DW_DLV_NO_ENTRY);
-			if (retval == DW_DLV_NO_ENTRY)
+			Dwarf_Off parent_off = start.offset_here();
+			Dwarf_Off found_off = 0UL; // no child lives at 0
+			const child_name_cache::table *p_t = child_names.find(parent_off);
+			if (p_t)
 			{
-				// this means no variables (including last_seen_next_cu_header) were set
-				last_seen_cu_header_length = optional<decltype(*last_seen_cu_header_length)>(); assert(!last_seen_cu_header_length);
-				last_seen_version_stamp = optional<decltype(*last_seen_version_stamp)>(); assert(!last_seen_version_stamp);
-				last_seen_abbrev_offset = optional<decltype(*last_seen_abbrev_offset)>(); assert(!last_seen_abbrev_offset);
-				last_seen_address_size = optional<decltype(*last_seen_address_size)>(); assert(!last_seen_address_size);
-				last_seen_offset_size = optional<decltype(*last_seen_offset_size)>(); assert(!last_seen_offset_size);
-				last_seen_extension_size = optional<decltype(*last_seen_extension_size)>(); assert(!last_seen_extension_size);
-				last_seen_next_cu_header = optional<decltype(*last_seen_next_cu_header)>(); assert(!last_seen_next_cu_header);
-				current_cu_offset = 0UL;
-				return false;
+				auto found = p_t->find(name);
+				if (found != p_t->end()) found_off = found->second;
 			}
 			else
 			{
-				assert(retval == DW_DLV_OK);
-				optional<Dwarf_Off> prev_next_cu_header = last_seen_next_cu_header;
-				Dwarf_Off prev_current_cu_offset = current_cu_offset;
+				child_name_cache::table t;
+				auto children = start.children_here();
+				for (auto i_child = std::move(children.first); i_child != children.second; ++i_child)
+				{
+					/* The native decoder gives us names without allocating. */
+					native_die nd;
+					if (native_die_at(i_child.offset_here(), &nd))
+					{
+						const char *n = nd.raw_name();
+						if (n) t.insert(make_pair(string(n), i_child.offset_here())); // keeps the first
+						if (n || !nd.has_attr(DW_AT_name)) continue;
+						// else a name we can't decode; name_view_here() falls back
+					}
+					auto name_here = i_child.name_view_here();
+					if (name_here.data()) t.insert(make_pair(name_here.to_string(), i_child.offset_here()));
+				}
+				auto found = t.find(name);
+				if (found != t.end()) found_off = found->second;
+				child_names.insert(parent_off, std::move(t));
+			}
+			if (found_off == 0UL) return iterator_base::END;
+			return pos<iterator_base>(found_off, start.depth() + 1, 
+				optional<Dwarf_Off>(parent_off));
+		}
+		
+		const child_name_cache::table *child_name_cache::find(Dwarf_Off parent_off) const
+		{
+			auto found = tables.find(parent_off);
+			return (found == tables.end()) ? nullptr : &found->second;
+		}
+		void child_name_cache::evict_over_budget()
+		{
+			// never the newest (see insert())
+			while (n_entries > max_entries && order.size() > 1)
+			{
+				auto found = tables.find(order.front());
+				assert(found != tables.end());
+				n_entries -= found->second.size();
+				tables.erase(found);
+				order.pop_front();
+			}
+		}
+		const child_name_cache::table *child_name_cache::insert(Dwarf_Off parent_off, table&& t)
+		{
+			/* We only build a table on a miss. */
+			assert(tables.find(parent_off) == tables.end());
+			n_entries += t.size();
+			order.push_back(parent_off);
+			table& kept = tables[parent_off];
+			kept = std::move(t);
+			/* This won't drop ours, since it's the newest. If ours is over
+			 * budget on its own, it's all we keep. */
+			evict_over_budget();
+			return &kept;
+		}
+		
+		optional<Dwarf_Off>
+		root_die::find_parent_offset(Dwarf_Off off)
+		{
+			if (off == 0UL) return optional<Dwarf_Off>();
+			auto found = parent_of.find(off);
+			if (found) return found;
+			if (p_skeleton)
+			{
+				const skeleton_index::entry *p_e = p_skeleton->find(off);
+				if (!p_e) return optional<Dwarf_Off>();
+				return optional<Dwarf_Off>(p_skeleton->parent_offset(*p_e));
+			}
 			
-				last_seen_cu_header_length = seen_cu_header_length;
-				last_seen_version_stamp = seen_version_stamp;
-				last_seen_abbrev_offset = seen_abbrev_offset;
-				last_seen_address_size = seen_address_size;
-				last_seen_offset_size = seen_offset_size;
-				last_seen_extension_size = seen_extension_size;
-				last_seen_next_cu_header = seen_next_cu_header;
-				
-				// also grab the current CU DIE offset
-				Die tmp_d(*this); // "current CU" constructor
-				
-				current_cu_offset = //iterator_base(std::move(tmp_handle), 1U, *this).offset_here();
-					// can't use iterator_base because it will recursively try to make payload, make_cu_payload, 
-					// set_cu_context, ...
-					tmp_d.offset_here();
-				
-				if (prev_current_cu_offset == 0UL)
+			/* The cache doesn't know. Walk down from the CU DIE, at each level
+			 * taking the last child whose offset is <= off. We use raw libdwarf 
+			 * calls so as not to create iterators (which would recurse into us). */
+			auto maybe_d = Die::try_construct(*this, off);
+			if (!maybe_d) return optional<Dwarf_Off>();
+			Dwarf_Off cu_off = Die(std::move(maybe_d)).enclosing_cu_offset_here();
+			if (cu_off == off) { parent_of.insert(off, off, 0UL); return optional<Dwarf_Off>(0UL); }
+			
+			Die cur(Die::try_construct(*this, cu_off));
+			Dwarf_Off cur_off = cu_off;
+			while (true)
+			{
+				Dwarf_Die raw_child;
+				int ret = dwarf_child(cur.raw_handle(), &raw_child, &current_dwarf_error);
+				if (ret != DW_DLV_OK) return optional<Dwarf_Off>(); // off is not in this CU's tree?!
+				Die best(Die::handle_type(raw_child, Die::deleter(dbg.handle.get(), *this)));
+				Dwarf_Off best_off = best.offset_here();
+				parent_of.insert(cu_off, best_off, cur_off);
+				while (best_off < off)
 				{
-					first_cu_offset = optional<Dwarf_Off>(current_cu_offset);
-				} 
-				if (prev_next_cu_header) // sanity check
+					Dwarf_Die raw_sib;
+					ret = dwarf_siblingof(dbg.handle.get(), best.raw_handle(), &raw_sib, &current_dwarf_error);
+					if (ret != DW_DLV_OK) break;
+					Die sib(Die::handle_type(raw_sib, Die::deleter(dbg.handle.get(), *this)));
+					Dwarf_Off sib_off = sib.offset_here();
+					if (sib_off > off) break;
+					parent_of.insert(cu_off, sib_off, cur_off);
+					best = std::move(sib);
+					best_off = sib_off;
+				}
+				if (best_off == off) return optional<Dwarf_Off>(cur_off);
+				if (best_off > off) return optional<Dwarf_Off>(); // off is not a DIE boundary
+				// off must be inside best's subtree
+				cur = std::move(best);
+				cur_off = best_off;
+			}
+		}
+		
+		size_t parent_cache::cu_table::merge_pending()
+		{
+			if (unsorted.empty()) return 0;
+			auto old_total = size();
+			std::stable_sort(unsorted.begin(), unsorted.end()); // stable: later inserts win
+			auto old_size = sorted.size();
+			sorted.insert(sorted.end(), unsorted.begin(), unsorted.end());
+			std::inplace_merge(sorted.begin(), sorted.begin() + old_size, sorted.end());
+			// we may have been told the same thing twice; keep the later entry
+			auto new_end = std::unique(sorted.rbegin(), sorted.rend(), 
+				[](const entry& e1, const entry& e2) { return e1.off == e2.off; });
+			sorted.erase(sorted.begin(), new_end.base());
+			unsorted.clear();
+			return old_total - sorted.size();
+		}
+		
+		parent_cache::cu_table&
+		parent_cache::table_for(Dwarf_Off cu_off)
+		{
+			auto found = tables.find(cu_off);
+			if (found == tables.end())
+			{
+				found = tables.insert(make_pair(cu_off, cu_table())).first;
+				recently_used.push_front(cu_off);
+				found->second.lru_pos = recently_used.begin();
+			}
+			else if (found->second.lru_pos != recently_used.begin())
+			{
+				recently_used.splice(recently_used.begin(), recently_used, found->second.lru_pos);
+			}
+			return found->second;
+		}
+		
+		void parent_cache::evict_over_budget()
+		{
+			/* Never drop the most recent table; we're probably inserting into it. */
+			while (n_entries > max_entries && recently_used.size() > 1)
+			{
+				auto found = tables.find(recently_used.back());
+				assert(found != tables.end());
+				n_entries -= found->second.size();
+				tables.erase(found);
+				recently_used.pop_back();
+			}
+		}
+		
+		void parent_cache::insert(Dwarf_Off cu_off, Dwarf_Off off, Dwarf_Off parent_off)
+		{
+			assert(off >= cu_off);
+			assert(off - cu_off < NO_PARENT);
+			entry e = { (uint32_t)(off - cu_off), 
+				(off == cu_off) ? NO_PARENT : (uint32_t)(parent_off - cu_off) };
+			assert(off != cu_off || parent_off == 0UL);
+			assert(off == cu_off || (parent_off >= cu_off && parent_off < off));
+			
+			cu_table& t = table_for(cu_off);
+			if (t.sorted.empty() || t.sorted.back().off < e.off) { t.sorted.push_back(e); ++n_entries; }
+			else if (t.sorted.back().off == e.off) t.sorted.back() = e;
+			else { t.unsorted.push_back(e); ++n_entries; }
+			if (n_entries > max_entries) evict_over_budget();
+		}
+		
+		optional<Dwarf_Off> parent_cache::find(Dwarf_Off off)
+		{
+			/* The only CU that can contain off is the greatest one starting at or 
+			 * before it. If that CU's table was dropped, we might find an earlier
+			 * CU's table, but then the lookup will simply miss. */
+			auto found_cu = tables.upper_bound(off);
+			if (found_cu == tables.begin()) return optional<Dwarf_Off>();
+			--found_cu;
+			Dwarf_Off cu_off = found_cu->first;
+			cu_table& t = found_cu->second;
+			n_entries -= t.merge_pending();
+			if (off - cu_off >= NO_PARENT) return optional<Dwarf_Off>();
+			
+			entry key = { (uint32_t)(off - cu_off), 0 };
+			auto found = std::lower_bound(t.sorted.begin(), t.sorted.end(), key);
+			if (found == t.sorted.end() || found->off != key.off) return optional<Dwarf_Off>();
+			if (found->parent == NO_PARENT) return optional<Dwarf_Off>(0UL);
+			return optional<Dwarf_Off>(cu_off + found->parent);
+		}
+		
+		void parent_cache::drop(Dwarf_Off cu_off)
+		{
+			auto found = tables.find(cu_off);
+			if (found == tables.end()) return;
+			n_entries -= found->second.size();
+			recently_used.erase(found->second.lru_pos);
+			tables.erase(found);
+		}
+		
+		payload_cache::ptr_type payload_cache::find(Dwarf_Off off)
+		{
+			auto found = entries.find(off);
+			if (found == entries.end()) { ++misses; return ptr_type(); }
+			++hits;
+			lru.splice(lru.begin(), lru, found->second.lru_pos);
+			return found->second.p;
+		}
+		void payload_cache::insert(Dwarf_Off off, const ptr_type& p)
+		{
+			assert(p);
+			auto found = entries.find(off);
+			if (found != entries.end())
+			{
+				// can only happen if the old one wasn't pinned, i.e. nobody can tell
+				found->second.p = p;
+				lru.splice(lru.begin(), lru, found->second.lru_pos);
+				return;
+			}
+			lru.push_front(off);
+			entry e = { p, lru.begin() };
+			entries.insert(make_pair(off, e));
+			evict();
+		}
+		void payload_cache::erase(Dwarf_Off off)
+		{
+			auto found = entries.find(off);
+			if (found == entries.end()) return;
+			lru.erase(found->second.lru_pos);
+			entries.erase(found);
+		}
+		void payload_cache::evict()
+		{
+			/* Walk from the least recently used end. Pinned entries get moved
+			 * to the front, like a second chance in CLOCK; if we get all the
+			 * way round without getting under the limit, everything is pinned,
+			 * so give up for now. */
+			unsigned to_visit = lru.size();
+			while (entries.size() > max_entries && to_visit > 0)
+			{
+				--to_visit;
+				Dwarf_Off victim = lru.back();
+				auto found = entries.find(victim);
+				assert(found != entries.end());
+				if (is_pinned(found->second.p))
 				{
-					/* Note that next_cu_header is subtle:
-					 * according to libdwarf,
-					 * "the offset into the debug_info section of the next CU header",
-					 * BUT it tends to be smaller than the value we got
-					 * from offset_here(). */
-					
-					//assert(current_cu_offset == *prev_next_cu_header); // -- this is wrong
-					
-					assert(first_cu_offset);
-					assert(current_cu_offset == *first_cu_offset
-					 ||    current_cu_offset == *prev_next_cu_header + *first_cu_offset);
+					lru.splice(lru.begin(), lru, found->second.lru_pos);
+					continue;
 				}
-				
+				lru.pop_back();
+				entries.erase(found);
+				++evictions;
+			}
+		}
+		void payload_cache::erase_unpinned_in(Dwarf_Off begin, Dwarf_Off end)
+		{
+			for (auto i_e = entries.begin(); i_e != entries.end(); )
+			{
+				if (i_e->first >= begin && i_e->first < end && !is_pinned(i_e->second.p))
+				{
+					lru.erase(i_e->second.lru_pos);
+					i_e = entries.erase(i_e);
+				}
+				else ++i_e;
+			}
+		}
+		unsigned payload_cache::pinned() const
+		{
+			unsigned count = 0;
+			for (auto i_e = entries.begin(); i_e != entries.end(); ++i_e)
+			{
+				if (is_pinned(i_e->second.p)) ++count;
+			}
+			return count;
+		}
+		
+		const skeleton_index::entry *skeleton_index::find(Dwarf_Off off) const
+		{
+			entry key; key.off = off;
+			auto found = std::lower_bound(entries.begin(), entries.end(), key);
+			if (found == entries.end() || found->off != off) return nullptr;
+			return &*found;
+		}
+		
+		void root_die::build_skeleton_index()
+		{
+			auto p_idx = std::make_shared<skeleton_index>();
+			vector<uint32_t> last_at_depth; // index of the latest entry at each depth
+			auto add = [&p_idx, &last_at_depth](Dwarf_Off off, unsigned depth) {
+				assert(depth >= 1);
+				assert(p_idx->entries.size() < skeleton_index::NO_PARENT);
+				skeleton_index::entry e;
+				e.off = off;
+				e.depth = depth;
+				e.parent = (depth == 1) ? skeleton_index::NO_PARENT : last_at_depth.at(depth - 1);
+				if (last_at_depth.size() <= depth) last_at_depth.resize(depth + 1);
+				last_at_depth[depth] = p_idx->entries.size();
+				p_idx->entries.push_back(e);
+			};
+			/* Depth-first order is offset order, so we only need to append.
+			 * If the native decoder gives up on a corrupt unit, start again
+			 * with libdwarf. */
+			bool done = false;
+			if (p_native && p_native->complete())
+			{
+				for (auto i = p_native->begin(); i != p_native->end(); ++i) add(i.offset_here(), i.depth());
+				done = p_native->complete();
+				if (!done) { p_idx->entries.clear(); last_at_depth.clear(); }
+			}
+			if (!done)
+			{
+				for (iterator_df<> i = begin(); i != end(); ++i)
+				{
+					if (i.is_real_die_position()) add(i.offset_here(), i.depth());
+				}
+			}
+			assert(std::is_sorted(p_idx->entries.begin(), p_idx->entries.end()));
+			p_skeleton = p_idx;
+		}
+		
+		const uint32_t address_index::layer::NONE;
+		void address_index::layer::build_segments()
+		{
+			/* Sweep over the entries' ends, keeping the entries covering the
+			 * current point ordered best first: deepest, then narrowest, then
+			 * (so that the order is total) latest. */
+			auto better = [this](uint32_t a, uint32_t b) {
+				const entry& ea = entries[a];
+				const entry& eb = entries[b];
+				if (ea.depth != eb.depth) return ea.depth > eb.depth;
+				if (ea.hi - ea.lo != eb.hi - eb.lo) return ea.hi - ea.lo < eb.hi - eb.lo;
+				return a > b;
+			};
+			std::set<uint32_t, decltype(better)> covering(better);
+			struct event { Dwarf_Addr addr; uint32_t idx; bool is_start; };
+			vector<event> events;
+			events.reserve(2 * entries.size());
+			for (uint32_t i = 0; i < entries.size(); ++i)
+			{
+				if (entries[i].lo >= entries[i].hi) continue; // covers nothing
+				event start = { entries[i].lo, i, true };
+				event end = { entries[i].hi, i, false };
+				events.push_back(start);
+				events.push_back(end);
+			}
+			std::sort(events.begin(), events.end(), [](const event& a, const event& b) {
+				return a.addr < b.addr || (a.addr == b.addr && !a.is_start && b.is_start);
+			});
+			segments.clear();
+			for (auto i_ev = events.begin(); i_ev != events.end(); )
+			{
+				Dwarf_Addr here = i_ev->addr;
+				for (; i_ev != events.end() && i_ev->addr == here; ++i_ev)
+				{
+					if (i_ev->is_start) covering.insert(i_ev->idx);
+					else covering.erase(i_ev->idx);
+				}
+				uint32_t best = covering.empty() ? NONE : *covering.begin();
+				if (!segments.empty() && segments.back().best == best) continue;
+				segment seg = { here, best };
+				segments.push_back(seg);
+			}
+		}
+		
+		const address_index::entry *
+		address_index::find(Dwarf_Addr addr, kind k) const
+		{
+			const layer& l = layers[k];
+			auto found = std::upper_bound(l.segments.begin(), l.segments.end(), addr,
+				[](Dwarf_Addr a, const layer::segment& s) { return a < s.lo; });
+			if (found == l.segments.begin()) return nullptr;
+			return l.best_of(*(found - 1));
+		}
+		
+		const address_index::entry *
+		address_index::find(Dwarf_Addr addr) const
+		{
+			const entry *found;
+			if ((found = find(addr, VARIABLE))) return found;
+			if ((found = find(addr, SUBPROGRAM))) return found;
+			return find(addr, CU);
+		}
+		
+		void address_index::find_sorted(const vector<Dwarf_Addr>& addrs, kind k,
+			vector<const entry *>& out) const
+		{
+			const layer& l = layers[k];
+			out.resize(addrs.size());
+			size_t n = 0; // segments starting at or before the current address
+			for (unsigned i = 0; i < addrs.size(); ++i)
+			{
+				assert(i == 0 || addrs[i - 1] <= addrs[i]);
+				while (n < l.segments.size() && l.segments[n].lo <= addrs[i]) ++n;
+				out[i] = (n == 0) ? nullptr : l.best_of(l.segments[n - 1]);
+			}
+		}
+		
+		void root_die::build_address_index()
+		{
+			auto p_idx = std::make_shared<address_index>();
+			auto kind_of = [](Dwarf_Half tag) -> int {
+				switch (tag)
+				{
+					case DW_TAG_compile_unit: return address_index::CU;
+					case DW_TAG_subprogram: return address_index::SUBPROGRAM;
+					case DW_TAG_variable: return address_index::VARIABLE;
+					default: return -1;
+				}
+			};
+			/* We reuse file_relative_intervals, so that we agree with
+			 * spans_addr about ranges, static storage and so on. */
+			auto add = [this, &p_idx](const iterator_base& i, int k) {
+				iterator_df<with_static_location_die> i_s = i;
+				auto intervals = i_s->file_relative_intervals(*this, nullptr, nullptr);
+				for (auto i_int = intervals.begin(); i_int != intervals.end(); ++i_int)
+				{
+					address_index::entry e;
+					e.lo = i_int->first.lower();
+					e.hi = i_int->first.upper();
+					e.off = i.offset_here();
+					// the map's values are cumulative sizes, up to the end of each piece
+					e.object_off = i_int->second - (e.hi - e.lo);
+					e.depth = i.depth();
+					p_idx->layers[k].entries.push_back(e);
+				}
+			};
+			bool done = false;
+			if (p_native && p_native->complete())
+			{
+				/* Only hop to the core iterator for DIEs that might have addresses. */
+				for (auto i = p_native->begin(); i != p_native->end(); ++i)
+				{
+					int k = kind_of(i.tag_here());
+					if (k == -1) continue;
+					if (!i.has_attr_here(DW_AT_low_pc) && !i.has_attr_here(DW_AT_ranges)
+						&& !i.has_attr_here(DW_AT_location)) continue;
+					add(i.core_pos<iterator_base>(*this), k);
+				}
+				// as for the skeleton index, start again if a unit was corrupt
+				done = p_native->complete();
+				if (!done) for (unsigned k = 0; k < address_index::NKINDS; ++k) p_idx->layers[k].entries.clear();
+			}
+			if (!done)
+			{
+				for (iterator_df<> i = begin(); i != end(); ++i)
+				{
+					if (!i.is_real_die_position()) continue;
+					int k = kind_of(i.tag_here());
+					if (k == -1) continue;
+					if (!i.has_attr_here(DW_AT_low_pc) && !i.has_attr_here(DW_AT_ranges)
+						&& !i.has_attr_here(DW_AT_location)) continue;
+					add(i, k);
+				}
+			}
+			for (unsigned k = 0; k < address_index::NKINDS; ++k)
+			{
+				auto& l = p_idx->layers[k];
+				std::sort(l.entries.begin(), l.entries.end());
+				l.build_segments();
+			}
+			p_address_index = p_idx;
+		}
+		
+		bool root_die::build_name_index()
+		{
+			if (!p_native) return false;
+			p_name_index = name_index::build_for(*p_native);
+			return (bool) p_name_index;
+		}
+		
+		const accel_index *root_die::get_accel_index()
+		{
+			if (!tried_accel)
+			{
+				tried_accel = true;
+				p_accel = accel_index::open(p_native);
+			}
+			return p_accel.get();
+		}
+		
+		iterator_base root_die::visible_named_grandchild(const string& name)
+		{
+			auto cu_of = [this](Dwarf_Off off) {
+				const cu_index::record *p_rec = get_cu_index().containing(off);
+				assert(p_rec);
+				return optional<Dwarf_Off>(p_rec->cu_die_offset);
+			};
+			/* Our own index has every named DIE, so it's definitive. */
+			if (p_name_index)
+			{
+				auto range = p_name_index->equal_range(name);
+				for (auto p_e = range.first; p_e != range.second; ++p_e)
+				{
+					if (p_e->depth == 2 && (p_e->flags & name_index::VISIBLE))
+					{
+						return pos<iterator_base>(p_e->die_off, 2, cu_of(p_e->die_off));
+					}
+				}
+				return iterator_base::END;
+			}
+			/* The producer's tables aren't, so we combine their first hit with
+			 * what we know they leave out; if they don't know, we search. */
+			if (get_accel_index())
+			{
+				Dwarf_Off found = p_accel->first_visible_grandchild(name);
+				if (found != 0UL) return pos<iterator_base>(found, 2, cu_of(found));
+			}
+			auto cus = begin().children_here();
+			for (auto i_cu = std::move(cus.first); i_cu != cus.second; ++i_cu)
+			{
+				auto children = i_cu.children_here();
+				for (auto i_child = std::move(children.first); i_child != children.second; ++i_child)
+				{
+					auto name_here = i_child.name_view_here();
+					if (!name_here.data() || name_here != name) continue;
+					if (i_child.is_a<program_element_die>())
+					{
+						iterator_df<program_element_die> i_el = i_child;
+						auto vis = i_el->get_visibility();
+						if (vis && *vis == DW_VIS_local) continue;
+					}
+					return i_child;
+				}
+			}
+			return iterator_base::END;
+		}
+		
+		bool root_die::resolve_by_name_index(const iterator_base& start, const string& qualified,
+			unsigned path_len, iterator_base& out)
+		{
+			/* From the root, the first path element names a CU, and CUs
+			 * aren't in the index. */
+			if (!p_name_index || !start.is_real_die_position()) return false;
+			
+			/* Work out start's own qualified name, from the names of it and its
+			 * ancestors below the CU. If any is anonymous, we can't. */
+			Dwarf_Off start_off = start.offset_here();
+			vector<Dwarf_Off> chain; // innermost first
+			Dwarf_Off cur = start_off;
+			for (unsigned depth = start.depth(); depth >= 2; --depth)
+			{
+				chain.push_back(cur);
+				auto parent_off = find_parent_offset(cur);
+				if (!parent_off) return false;
+				cur = *parent_off;
+			}
+			Dwarf_Off cu_off = cur;
+			string prefix;
+			for (auto i_off = chain.rbegin(); i_off != chain.rend(); ++i_off)
+			{
+				native_die nd;
+				if (!native_die_at(*i_off, &nd)) return false;
+				const char *name = nd.raw_name();
+				if (!name) return false;
+				if (!prefix.empty()) prefix += "::";
+				prefix += name;
+			}
+			
+			/* Now every DIE we could be looking for is in the index. We want 
+			 * the first (in offset order) that is a descendant of start. 
+			 * NOTE: this differs from the linear search in one corner case:
+			 * if start has two children with the same name, and only the 
+			 * second leads somewhere, we find it whereas the search gives up. */
+			auto range = p_name_index->equal_range(prefix.empty() ? qualified : prefix + "::" + qualified);
+			unsigned target_depth = start.depth() + path_len;
+			const cu_index::record *p_cu = get_cu_index().find(cu_off);
+			assert(p_cu);
+			const cu_index::record *p_next_cu = get_cu_index().next_after(cu_off);
+			for (auto p_e = range.first; p_e != range.second; ++p_e)
+			{
+				if (p_e->depth != target_depth || p_e->die_off <= start_off) continue;
+				if (p_e->die_off < p_cu->cu_die_offset
+					|| (p_next_cu && p_e->die_off >= p_next_cu->cu_die_offset)) continue;
+				Dwarf_Off ancestor = p_e->die_off;
+				optional<Dwarf_Off> parent_off;
+				for (unsigned i = 0; i < path_len; ++i)
+				{
+					auto found = find_parent_offset(ancestor);
+					if (!found) break;
+					if (i == 0) parent_off = found;
+					ancestor = *found;
+				}
+				if (ancestor != start_off) continue;
+				out = pos<iterator_base>(p_e->die_off, p_e->depth, parent_off);
 				return true;
 			}
+			out = iterator_base::END;
+			return true;
 		}
-		bool root_die::clear_cu_context()
+		
+		const size_t payload_arena::header_size;
+		const size_t payload_arena::chunk_size;
+		void *payload_arena::region::allocate(size_t sz)
 		{
-			if (current_cu_offset == 0UL) return true;
-			while(advance_cu_context());
-			return true; // i.e. success
+			auto found = free_lists.find(sz);
+			if (found != free_lists.end() && found->second)
+			{
+				void *block = found->second;
+				found->second = *reinterpret_cast<void **>(block);
+				return static_cast<char *>(block) - header_size;
+			}
+			size_t total = header_size + (sz + header_size - 1) / header_size * header_size;
+			if (total > chunk_size)
+			{
+				// big enough to get a chunk to itself; keep the current one last
+				chunks.insert(chunks.begin(), unique_ptr<char[]>(new char[total]));
+				return chunks.front().get();
+			}
+			if (used_in_last_chunk + total > chunk_size)
+			{
+				chunks.push_back(unique_ptr<char[]>(new char[chunk_size]));
+				used_in_last_chunk = 0;
+			}
+			char *p = chunks.back().get() + used_in_last_chunk;
+			used_in_last_chunk += total;
+			return p;
 		}
-		bool root_die::set_subsequent_cu_context(Dwarf_Off off)
+		void *payload_arena::allocate(Dwarf_Off cu_off, size_t sz)
 		{
-			if (current_cu_offset == off) return true;
-			bool have_no_context = (current_cu_offset == 0UL);
-			//else assert(!last_seen_next_cu_header);
-			bool ret; //= last_seen_next_cu_header; // i.e. false if we have no current context
-			do
+			auto found = regions.find(cu_off);
+			region *p_r;
+			if (found == regions.end())
 			{
-				ret = advance_cu_context();
-				if (ret && have_no_context) { have_no_context = false; assert(current_cu_offset == 11); }
+				p_r = new region(cu_off);
+				regions.insert(make_pair(cu_off, p_r));
+			} else p_r = found->second;
+			unsigned chunks_before = p_r->chunks.size();
+			char *p = static_cast<char *>(p_r->allocate(sz));
+			if (p_r->chunks.size() != chunks_before)
+			{
+				bytes_allocated += std::max<size_t>(chunk_size, header_size + sz);
 			}
-			while (current_cu_offset != 0 // i.e. stop if we hit the no-context case
-				&& current_cu_offset != off // i.e. stop if we reach our target
-				&& ret); // i.e. stop if we fail to advance
-			// begin sanity check
-			if (ret)
+			block_header *p_h = reinterpret_cast<block_header *>(p);
+			p_h->p_region = p_r;
+			p_h->size = sz;
+			++p_r->live;
+			return p + header_size;
+		}
+		void payload_arena::deallocate(void *p)
+		{
+			block_header *p_h = reinterpret_cast<block_header *>(static_cast<char *>(p) - header_size);
+			region *p_r = p_h->p_region;
+			if (!p_r) { delete[] reinterpret_cast<char *>(p_h); return; }
+			assert(p_r->live > 0);
+			--p_r->live;
+			if (p_r->released && p_r->live == 0) { delete p_r; return; }
+			// recycle the block
+			void *&head = p_r->free_lists[p_h->size];
+			*reinterpret_cast<void **>(p) = head;
+			head = p;
+		}
+		void payload_arena::release(Dwarf_Off cu_off)
+		{
+			auto found = regions.find(cu_off);
+			if (found == regions.end()) return;
+			region *p_r = found->second;
+			regions.erase(found);
+			p_r->released = true;
+			if (p_r->live == 0) delete p_r;
+			// else the last deallocate() will delete it
+		}
+		payload_arena::~payload_arena()
+		{
+			while (!regions.empty()) release(regions.begin()->first);
+		}
+		
+		void *basic_die::operator new(size_t sz)
+		{
+			char *p = new char[payload_arena::header_size + sz];
+			auto p_h = reinterpret_cast<payload_arena::block_header *>(p);
+			p_h->p_region = nullptr;
+			p_h->size = sz;
+			return p + payload_arena::header_size;
+		}
+		void *basic_die::operator new(size_t sz, payload_arena& a, Dwarf_Off cu_off)
+		{
+			return a.allocate(cu_off, sz);
+		}
+		void basic_die::operator delete(void *p)
+		{
+			if (p) payload_arena::deallocate(p);
+		}
+		void basic_die::operator delete(void *p, payload_arena& a, Dwarf_Off cu_off)
+		{
+			// only called if a constructor throws
+			if (p) payload_arena::deallocate(p);
+		}
+		
+		void root_die::release_cu(Dwarf_Off cu_off)
+		{
+			const cu_index::record *p_next = get_cu_index().next_after(cu_off);
+			Dwarf_Off end = p_next ? p_next->cu_die_offset : std::numeric_limits<Dwarf_Off>::max();
+			payloads.erase_unpinned_in(cu_off, end);
+			parent_of.drop(cu_off);
+			arena.release(cu_off);
+		}
+		
+		const cu_index::record *cu_index::find(Dwarf_Off cu_die_off) const
+		{
+			record key; key.cu_die_offset = cu_die_off;
+			auto found = std::lower_bound(records.begin(), records.end(), key);
+			if (found == records.end() || found->cu_die_offset != cu_die_off) return nullptr;
+			return &*found;
+		}
+		const cu_index::record *cu_index::next_after(Dwarf_Off cu_die_off) const
+		{
+			record key; key.cu_die_offset = cu_die_off;
+			auto found = std::upper_bound(records.begin(), records.end(), key);
+			if (found == records.end()) return nullptr;
+			return &*found;
+		}
+		const cu_index::record *cu_index::containing(Dwarf_Off off) const
+		{
+			record key; key.cu_die_offset = off;
+			auto found = std::upper_bound(records.begin(), records.end(), key);
+			if (found == records.begin()) return nullptr;
+			return &*(found - 1);
+		}
+		
+		const cu_index& root_die::get_cu_index()
+		{
+			if (!p_cu_index) build_cu_index();
+			return *p_cu_index;
+		}
+		
+		void root_die::build_cu_index()
+		{
+			/* This is the only place we drive libdwarf's CU iteration. We 
+			 * expect it to be in the no-context state, which it always is, 
+			 * because nobody else calls dwarf_next_cu_header_b on our dbg.
+			 * Walking off the end puts it back in that state. */
+			auto p_idx = std::make_shared<cu_index>();
+			while (true)
 			{
-				Dwarf_Die test;
-				Dwarf_Error temporary_error;
-				int test_ret = dwarf_siblingof(dbg.handle.get(), nullptr, &test, &temporary_error);
-				assert(test_ret == DW_DLV_OK);
-				Dwarf_Off test_off;
-				dwarf_dieoffset(test, &test_off, &temporary_error);
-				assert(test_off == off);
+				cu_index::record rec;
+				int retval = dwarf_next_cu_header_b(dbg.handle.get(),
+					&rec.cu_header_length, &rec.version_stamp, 
+					&rec.abbrev_offset, &rec.address_size, 
+					&rec.offset_size, &rec.extension_size,
+					&rec.next_cu_header, &current_dwarf_error);
+				assert(retval == DW_DLV_OK || retval == DW_DLV_NO_ENTRY);
+				if (retval == DW_DLV_NO_ENTRY) break;
+				
+				// grab the CU DIE offset -- can't use iterator_base because
+				// it will recursively try to make payload, make_cu_payload, ...
+				Dwarf_Die raw_cu;
+				retval = dwarf_siblingof(dbg.handle.get(), nullptr, &raw_cu, &current_dwarf_error);
+				assert(retval == DW_DLV_OK);
+				Die tmp_d(Die::handle_type(raw_cu, Die::deleter(dbg.handle.get(), *this)));
+				rec.cu_die_offset = tmp_d.offset_here();
+				
+				/* Note that next_cu_header is subtle:
+				 * according to libdwarf,
+				 * "the offset into the debug_info section of the next CU header",
+				 * BUT it tends to be smaller than the value we got
+				 * from offset_here(). So we only check that it's past the previous. */
+				assert(p_idx->records.empty()
+					|| rec.cu_die_offset > p_idx->records.back().next_cu_header);
+				p_idx->records.push_back(rec);
 			}
-			// end sanity check
-			return ret;
+			// libdwarf hands them out in section order, so we're already sorted
+			assert(std::is_sorted(p_idx->records.begin(), p_idx->records.end()));
+			p_cu_index = p_idx;
+			if (!p_idx->records.empty()) first_cu_offset = p_idx->records.front().cu_die_offset;
 		}
-		bool root_die::set_cu_context(Dwarf_Off off)
+		
+		void root_die::set_cu_context_from(const cu_index::record *p_rec)
 		{
-			bool ret = set_subsequent_cu_context(off);
-			if (!ret)
+			if (!p_rec)
 			{
-				// we got to the end; try again
-				clear_cu_context(); // should be a no-op
-				return set_subsequent_cu_context(off);
-				// FIXME: avoid repeated search
+				last_seen_cu_header_length = optional<decltype(*last_seen_cu_header_length)>(); assert(!last_seen_cu_header_length);
+				last_seen_version_stamp = optional<decltype(*last_seen_version_stamp)>(); assert(!last_seen_version_stamp);
+				last_seen_abbrev_offset = optional<decltype(*last_seen_abbrev_offset)>(); assert(!last_seen_abbrev_offset);
+				last_seen_address_size = optional<decltype(*last_seen_address_size)>(); assert(!last_seen_address_size);
+				last_seen_offset_size = optional<decltype(*last_seen_offset_size)>(); assert(!last_seen_offset_size);
+				last_seen_extension_size = optional<decltype(*last_seen_extension_size)>(); assert(!last_seen_extension_size);
+				last_seen_next_cu_header = optional<decltype(*last_seen_next_cu_header)>(); assert(!last_seen_next_cu_header);
+				current_cu_offset = 0UL;
+				return;
 			}
-			else return true;
+			last_seen_cu_header_length = p_rec->cu_header_length;
+			last_seen_version_stamp = p_rec->version_stamp;
+			last_seen_abbrev_offset = p_rec->abbrev_offset;
+			last_seen_address_size = p_rec->address_size;
+			last_seen_offset_size = p_rec->offset_size;
+			last_seen_extension_size = p_rec->extension_size;
+			last_seen_next_cu_header = p_rec->next_cu_header;
+			current_cu_offset = p_rec->cu_die_offset;
+		}
+		
+		bool root_die::advance_cu_context()
+		{
+			// like libdwarf: from no context, go to the first CU; off the end, go to no context
+			const cu_index::record *p_next = get_cu_index().next_after(current_cu_offset);
+			set_cu_context_from(p_next);
+			return p_next != nullptr;
+		}
+		bool root_die::clear_cu_context()
+		{
+			set_cu_context_from(nullptr);
+			return true; // i.e. success
+		}
+		bool root_die::set_subsequent_cu_context(Dwarf_Off off)
+		{
+			/* Now the same as set_cu_context, except we refuse to go backwards. */
+			if (current_cu_offset == off) return true;
+			if (current_cu_offset != 0UL && off < current_cu_offset) return false;
+			return set_cu_context(off);
+		}
+		bool root_die::set_cu_context(Dwarf_Off off)
+		{
+			if (current_cu_offset == off && off != 0UL) return true;
+			const cu_index::record *p_rec = get_cu_index().find(off);
+			if (!p_rec) return false;
+			set_cu_context_from(p_rec);
+			return true;
 		}
 		iterator_base
 		root_die::next_sibling(const iterator_base& it)
@@ -399,11 +1254,9 @@ namespace dwarf
 			if (!it.is_real_die_position()) return iterator_base::END;
 
 			Dwarf_Off offset_here = it.offset_here();
-			auto found = parent_of.find(offset_here);
-			// if we issued `it', we should have recorded its parent
-			// FIXME: relax this policy perhaps, to allow soft cache?
-			assert(found != parent_of.end());
-			Dwarf_Off common_parent_offset = found->second;
+			auto found = find_parent_offset(offset_here);
+			assert(found);
+			Dwarf_Off common_parent_offset = *found;
 			Die::handle_type maybe_handle(nullptr, Die::deleter(nullptr)); // TODO: reenable deleter default constructor
 			
 			if (it.tag_here() == DW_TAG_compile_unit)
@@ -426,7 +1279,9 @@ namespace dwarf
 			{
 				auto new_it = iterator_base(std::move(maybe_handle), it.get_depth(), *this);
 				// install in parent cache
-				parent_of[new_it.offset_here()] = common_parent_offset;
+				Dwarf_Off new_off = new_it.offset_here();
+				parent_of.insert(common_parent_offset == 0UL ? new_off : new_it.enclosing_cu_offset_here(),
+					new_off, common_parent_offset);
 				return new_it;
 			} else return iterator_base::END;
 		}
@@ -434,6 +1289,11 @@ namespace dwarf
 		bool 
 		root_die::move_to_next_sibling(iterator_base& it)
 		{
+			// CUs are siblings only via libdwarf's CU context, so they take the slow path
+			if (cursor_navigation && it.is_real_die_position() && it.depth() > 1)
+			{
+				return step_to_next_sibling_in_place(it);
+			}
 			Dwarf_Off start_off = it.offset_here();
 			unsigned start_depth = it.depth();
 			auto maybe_sibling = next_sibling(it); 
@@ -446,6 +1306,75 @@ namespace dwarf
 			else return false;
 		}
 		
+		/* The cursor-style primitives. Each of these makes exactly one libdwarf
+		 * call to get the new position's handle, and swaps it into the iterator,
+		 * releasing the old handle (or payload reference). No intermediate
+		 * iterator_base is built. If the iterator had been upgraded to a payload
+		 * (e.g. because it was copied), it reverts to a plain handle. */
+		Die::raw_handle_type
+		root_die::raw_handle_of(const iterator_base& it)
+		{
+			assert(it.is_real_die_position());
+			return (it.state == iterator_base::HANDLE_ONLY) 
+				? it.cur_handle.raw_handle() : it.cur_payload->d.raw_handle();
+		}
+		void
+		root_die::replace_handle_in_place(iterator_base& it, Die&& d, unsigned depth)
+		{
+			if (is_sticky(static_cast<const abstract_die&>(d)))
+			{
+				// only the iterator_base constructor knows the sticky set
+				it = iterator_base(std::move(d), depth, *this);
+				return;
+			}
+			it.cur_handle = std::move(d);
+			it.cur_payload = nullptr;
+			it.state = iterator_base::HANDLE_ONLY;
+			it.m_depth = depth;
+		}
+		bool
+		root_die::step_to_parent_in_place(iterator_base& it)
+		{
+			assert(it.depth() > 2); // parents at depth <= 1 are sticky or root
+			auto parent_off = find_parent_offset(it.offset_here());
+			assert(parent_off);
+			Dwarf_Die raw;
+			int ret = dwarf_offdie(dbg.handle.get(), *parent_off, &raw, &current_dwarf_error);
+			if (ret != DW_DLV_OK) return false;
+			replace_handle_in_place(it, 
+				Die(Die::handle_type(raw, Die::deleter(dbg.handle.get(), *this))), it.depth() - 1);
+			return true;
+		}
+		bool
+		root_die::step_to_first_child_in_place(iterator_base& it)
+		{
+			Dwarf_Off start_off = it.offset_here();
+			unsigned start_depth = it.depth();
+			Dwarf_Die raw;
+			int ret = dwarf_child(raw_handle_of(it), &raw, &current_dwarf_error);
+			if (ret != DW_DLV_OK) return false;
+			Dwarf_Off cu_off = (start_depth == 1) ? start_off : it.enclosing_cu_offset_here();
+			replace_handle_in_place(it, 
+				Die(Die::handle_type(raw, Die::deleter(dbg.handle.get(), *this))), start_depth + 1);
+			parent_of.insert(cu_off, it.offset_here(), start_off);
+			return true;
+		}
+		bool
+		root_die::step_to_next_sibling_in_place(iterator_base& it)
+		{
+			assert(it.depth() > 1);
+			auto parent_off = find_parent_offset(it.offset_here());
+			assert(parent_off);
+			Dwarf_Die raw;
+			int ret = dwarf_siblingof(dbg.handle.get(), raw_handle_of(it), &raw, &current_dwarf_error);
+			if (ret != DW_DLV_OK) return false;
+			Dwarf_Off cu_off = (it.depth() == 2) ? *parent_off : it.enclosing_cu_offset_here();
+			replace_handle_in_place(it, 
+				Die(Die::handle_type(raw, Die::deleter(dbg.handle.get(), *this))), it.depth());
+			parent_of.insert(cu_off, it.offset_here(), *parent_off);
+			return true;
+		}
+		
 /* Here comes the factory. */
 		root_die::ptr_type 
 		root_die::make_payload(const iterator_base& it) // note: we update *mutable* fields
@@ -464,16 +1393,23 @@ namespace dwarf
 				// Whenever we construct an iterator, we build sticky payload if necessary.
 				assert(!is_sticky(it.get_handle()));
 				
+				/* If we made payload for this offset recently, share it. */
+				Dwarf_Off off = it.offset_here();
+				auto found = payloads.find(off);
+				if (found)
+				{
+					it.cur_handle = std::move(Die(nullptr, nullptr));
+					it.cur_payload = found;
+					it.state = iterator_base::WITH_PAYLOAD;
+					return it.cur_payload;
+				}
+				
 				/* heap-allocate the right kind of basic_die, 
 				 * creating the intrusive ptr, hence bumping the refcount */
 				it.cur_payload = core::factory::for_spec(it.spec_here())
 					.make_payload(std::move(dynamic_cast<Die&>(it.get_handle()).handle), *this);
 				it.state = iterator_base::WITH_PAYLOAD;
-				
-				if (it.tag_here() != DW_TAG_compile_unit)
-				{
-					cerr << "Warning: made payload for non-CU " << endl;
-				}
+				payloads.insert(off, it.cur_payload);
 				
 				return it.cur_payload;
 			}
@@ -495,13 +1431,14 @@ namespace dwarf
 				basic_die *p;
 				Die d(std::move(h));
 				assert(d.tag_here() != DW_TAG_compile_unit);
+				Dwarf_Off cu_off = d.enclosing_cu_offset_here();
 				switch (d.tag_here())
 				{
 #define factory_case(name, ...) \
-case DW_TAG_ ## name: p = new name ## _die(d.spec_here(r), std::move(d.handle)); break; // FIXME: not "basic_die"...
+case DW_TAG_ ## name: p = new (r.arena, cu_off) name ## _die(d.spec_here(r), std::move(d.handle)); break; // FIXME: not "basic_die"...
 #include "dwarf3-factory.h"
 #undef factory_case
-					default: p = new basic_die(d.spec_here(r), std::move(d.handle)); break;
+					default: p = new (r.arena, cu_off) basic_die(d.spec_here(r), std::move(d.handle)); break;
 				}
 				return p;
 		}
@@ -513,7 +1450,7 @@ case DW_TAG_ ## name: p = new name ## _die(d.spec_here(r), std::move(d.handle));
 			// so on... for now, just construct the thing.
 			Die d(std::move(h));
 			Dwarf_Off off = d.offset_here();
-			auto p = new compile_unit_die(dwarf::spec::dwarf3, std::move(d.handle));
+			auto p = new (r.arena, off) compile_unit_die(dwarf::spec::dwarf3, std::move(d.handle));
 			/* fill in the CU fields -- this code would be shared by all 
 			 * factories, so we put it here (but HMM, if our factories were
 			 * a delegation chain, we could just put it in the root). */
@@ -596,6 +1533,31 @@ case DW_TAG_ ## name: return &dummy_ ## name;
 				str, string_deleter(get_dbg()));
 			assert(false);
 		}
+		string_ref
+		Die::name_view_here() const
+		{
+			/* If our root has the native decoder, the name is right there in
+			 * the mapping. */
+			root_die *p_r = handle.get_deleter().p_constructing_root;
+			native_die n;
+			if (p_r && p_r->native_die_at(offset_here(), &n))
+			{
+				const char *s = n.raw_name();
+				if (s) return string_ref(s);
+				/* If we have a name but couldn't decode it (dwz's
+				 * DW_FORM_GNU_strp_alt, say, or strx without 
+				 * .debug_str_offsets), libdwarf might manage. */
+				if (!n.has_attr(DW_AT_name)) return string_ref();
+			}
+			/* Otherwise, libdwarf's string also points into the section data.
+			 * (dwarf_dealloc of a DW_DLA_STRING in a section is a no-op, so
+			 * not calling it leaks nothing.) */
+			char *str;
+			int ret = dwarf_diename(raw_handle(), &str, &current_dwarf_error);
+			if (ret == DW_DLV_NO_ENTRY) return string_ref();
+			if (ret == DW_DLV_OK) return string_ref(str);
+			throw Error(current_dwarf_error, get_dbg());
+		}
 		//std::unique_ptr<const char, string_deleter>
 		opt<string>
 		iterator_base::name_here() const
@@ -603,8 +1565,19 @@ case DW_TAG_ ## name: return &dummy_ ## name;
 			if (!is_real_die_position()) return nullptr;
 			return get_handle().get_name();
 		}
+		string_ref
+		iterator_base::name_view_here() const
+		{
+			if (!is_real_die_position()) return string_ref();
+			return dynamic_cast<Die&>(get_handle()).name_view_here();
+		}
 		bool Die::has_attr_here(Dwarf_Half attr) const
 		{
+			/* If our root has the abbreviation tables, presence is just a bit test. */
+			root_die *p_r = handle.get_deleter().p_constructing_root;
+			native_die n;
+			if (p_r && p_r->native_die_at(offset_here(), &n)) return n.has_attr(attr);
+			
 			Dwarf_Bool returned;
 			int ret = dwarf_hasattr(raw_handle(), attr, &returned, &current_dwarf_error);
 			assert(ret == DW_DLV_OK);
@@ -1200,44 +2173,203 @@ case DW_TAG_ ## name: return &dummy_ ## name;
 			if (i >= cnt) throw No_entry();
 			return dwarf_get_arange_info(p_aranges[i], start, length, cu_die_offset, error);
 		}
+		void aranges::build_sorted()
+		{
+			sorted.reserve(cnt);
+			for (int i = 0; i < cnt; ++i)
+			{
+				entry e;
+				Dwarf_Unsigned length;
+				int ret = dwarf_get_arange_info(p_aranges[i], &e.start, &length, &e.cu_die_offset, p_last_error);
+				if (ret != DW_DLV_OK)
+				{
+					/* We're called from file's constructor, and a bad 
+					 * .debug_aranges shouldn't stop the file opening. So we
+					 * leave the table empty, as if there were no aranges. */
+					sorted.clear();
+					return;
+				}
+				if (length == 0) continue; // e.g. left over from discarded sections
+				e.end = e.start + length;
+				sorted.push_back(e);
+			}
+			std::sort(sorted.begin(), sorted.end());
+			/* Coalesce, in place. */
+			auto out = sorted.begin();
+			for (auto i_e = sorted.begin(); i_e != sorted.end(); ++i_e)
+			{
+				if (out != sorted.begin() && (out - 1)->cu_die_offset == i_e->cu_die_offset
+					&& i_e->start <= (out - 1)->end)
+				{
+					(out - 1)->end = std::max((out - 1)->end, i_e->end);
+				}
+				else *out++ = *i_e;
+			}
+			sorted.erase(out, sorted.end());
+			assert(sorted.size() < NONE);
+			build_segments();
+		}
+		const uint32_t aranges::NONE;
+		void aranges::build_segments()
+		{
+			/* Sweep over the ranges' ends. Since sorted is in start order, the
+			 * latest-starting range covering a point is the one with the
+			 * greatest index, so we keep the covering ones in a set. */
+			vector<pair<Dwarf_Addr, uint32_t> > ends;
+			ends.reserve(sorted.size());
+			for (uint32_t i = 0; i < sorted.size(); ++i) ends.push_back(make_pair(sorted[i].end, i));
+			std::sort(ends.begin(), ends.end());
+			std::set<uint32_t> covering;
+			uint32_t i_start = 0;
+			auto i_end = ends.begin();
+			while (i_start < sorted.size() || i_end != ends.end())
+			{
+				Dwarf_Addr a = (i_end == ends.end() || (i_start < sorted.size()
+					&& sorted[i_start].start < i_end->first)) ? sorted[i_start].start : i_end->first;
+				for (; i_end != ends.end() && i_end->first == a; ++i_end) covering.erase(i_end->second);
+				for (; i_start < sorted.size() && sorted[i_start].start == a; ++i_start) covering.insert(i_start);
+				uint32_t best = covering.empty() ? NONE : *covering.rbegin();
+				if (segments.empty() || segments.back().best != best)
+				{
+					segment seg = { a, best };
+					segments.push_back(seg);
+				}
+			}
+		}
+		const aranges::entry *aranges::find(Dwarf_Addr addr) const
+		{
+			auto found = std::upper_bound(segments.begin(), segments.end(), addr,
+				[](Dwarf_Addr a, const segment& seg) { return a < seg.lo; });
+			if (found == segments.begin() || (found - 1)->best == NONE) return nullptr;
+			return &sorted[(found - 1)->best];
+		}
 		int aranges::get_info_for_addr(Dwarf_Addr addr, Dwarf_Addr *start, Dwarf_Unsigned *length, 
 			Dwarf_Off *cu_die_offset, Dwarf_Error *error/* = 0*/)
 		{
-			if (error == 0) error = p_last_error; // TODO: fix
-			cerr << "Getting info for addr 0x" << std::hex << addr << std::dec
-				<< " from aranges block at " << p_aranges << endl;
-			for (int j = 0; j < cnt && j < 10; ++j)
-			{
-				Dwarf_Addr tmp_start;
-				Dwarf_Unsigned tmp_length;
-				Dwarf_Off tmp_cu_die_offset;
-				int ret2 = dwarf_get_arange_info(p_aranges[j], 
-					&tmp_start, &tmp_length, &tmp_cu_die_offset, error);
-				assert(ret2 == DW_DLV_OK);
-				cerr << "Arange number " << j << " has "
-					<< "start address 0x" << std::hex << tmp_start << std::dec
-					<< ", length " << tmp_length
-					<< ", CU offset 0x" << std::hex << tmp_cu_die_offset << std::dec << endl;
-			}
-			if (cnt > 10) cerr << "More aranges follow." << endl;
-			Dwarf_Arange returned;
-			assert(p_aranges);
-			assert(cnt > 0);
-			int ret = dwarf_get_arange(p_aranges, cnt, addr, &returned, error);
-			if (ret == DW_DLV_OK)
-			{
-				cerr << "get_arange succeeded" << endl;
-				int ret2 = dwarf_get_arange_info(returned, start, length, cu_die_offset, error);
-				return ret2;
-			} else if (ret == -1) cerr << "get_arange found no entry convering address 0x" 
-				<< std::hex << addr << std::dec << endl;
-			else cerr << "get_arange failed with error " << ret << endl;
-			return ret;
-			
+			const entry *found = find(addr);
+			if (!found) return DW_DLV_NO_ENTRY;
+			if (start) *start = found->start;
+			if (length) *length = found->end - found->start;
+			if (cu_die_offset) *cu_die_offset = found->cu_die_offset;
+			return DW_DLV_OK;
 		}
 
 		
 		
+		/* methods defined on line_table */
+		line_table::line_table(Dwarf_Debug dbg, Dwarf_Die cu_die, Dwarf_Error *error)
+		{ build(dbg, cu_die, error); }
+		line_table::line_table(die& d, Dwarf_Error *error/* = 0*/)
+		{ build(d.f.get_dbg(), d.get_die(), error ? error : d.p_last_error); }
+		
+		void line_table::build(Dwarf_Debug dbg, Dwarf_Die cu_die, Dwarf_Error *error)
+		{
+			Dwarf_Line *linebuf;
+			Dwarf_Signed linecount;
+			int ret = dwarf_srclines(cu_die, &linebuf, &linecount, error);
+			if (ret == DW_DLV_NO_ENTRY) return; // no line info, so an empty table
+			if (ret != DW_DLV_OK) throw Error(*error, dbg);
+			// make sure we dealloc on every path out of here
+			struct dealloc_guard
+			{
+				Dwarf_Debug dbg; Dwarf_Line *linebuf; Dwarf_Signed linecount;
+				~dealloc_guard() { dwarf_srclines_dealloc(dbg, linebuf, linecount); }
+			} guard = { dbg, linebuf, linecount };
+			
+			/* Decode row-wise first, so that we can sort. */
+			struct row
+			{
+				Dwarf_Addr addr;
+				uint32_t file;
+				uint32_t line;
+				uint32_t column;
+				uint8_t flags;
+				bool operator<(const row& r) const
+				{
+					return addr < r.addr
+						|| (addr == r.addr && (flags & END_SEQUENCE) && !(r.flags & END_SEQUENCE));
+				}
+			};
+			std::vector<row> rows;
+			rows.reserve(linecount);
+			// we only ask libdwarf for each file's name once
+			std::map<Dwarf_Unsigned, uint32_t> by_fileno;
+			std::map<std::string, uint32_t> by_name;
+			auto check = [error, dbg](int ret) { if (ret != DW_DLV_OK) throw Error(*error, dbg); };
+			for (Dwarf_Signed i = 0; i < linecount; ++i)
+			{
+				Dwarf_Line l = linebuf[i];
+				row r;
+				Dwarf_Unsigned lineno, fileno;
+				Dwarf_Signed column;
+				Dwarf_Bool is_stmt, basic_block, end_sequence;
+				check(dwarf_lineaddr(l, &r.addr, error));
+				check(dwarf_lineno(l, &lineno, error));
+				check(dwarf_lineoff(l, &column, error));
+				check(dwarf_line_srcfileno(l, &fileno, error));
+				check(dwarf_linebeginstatement(l, &is_stmt, error));
+				check(dwarf_lineblock(l, &basic_block, error));
+				check(dwarf_lineendsequence(l, &end_sequence, error));
+				r.line = lineno;
+				r.column = (column < 0) ? 0 : column; // -1 means "unknown"
+				r.flags = (is_stmt ? IS_STMT : 0) | (basic_block ? BASIC_BLOCK : 0)
+					| (end_sequence ? END_SEQUENCE : 0);
+				auto found = by_fileno.find(fileno);
+				if (found == by_fileno.end())
+				{
+					char *name;
+					std::string name_str;
+					if (dwarf_linesrc(l, &name, error) == DW_DLV_OK)
+					{
+						name_str = name;
+						dwarf_dealloc(dbg, name, DW_DLA_STRING);
+					}
+					auto interned = by_name.insert(std::make_pair(name_str, (uint32_t) files.size()));
+					if (interned.second) files.push_back(name_str);
+					found = by_fileno.insert(std::make_pair(fileno, interned.first->second)).first;
+				}
+				r.file = found->second;
+				rows.push_back(r);
+			}
+			std::stable_sort(rows.begin(), rows.end());
+			
+			addrs.resize(rows.size());
+			file_idxs.resize(rows.size());
+			line_nos.resize(rows.size());
+			column_nos.resize(rows.size());
+			row_flags_.resize(rows.size());
+			for (unsigned i = 0; i < rows.size(); ++i)
+			{
+				addrs[i] = rows[i].addr;
+				file_idxs[i] = rows[i].file;
+				line_nos[i] = rows[i].line;
+				column_nos[i] = rows[i].column;
+				row_flags_[i] = rows[i].flags;
+			}
+		}
+		
+		const size_t line_table::npos;
+		size_t line_table::find(Dwarf_Addr a) const
+		{
+			auto found = std::upper_bound(addrs.begin(), addrs.end(), a);
+			if (found == addrs.begin()) return npos;
+			size_t i = (found - addrs.begin()) - 1;
+			return (row_flags_[i] & END_SEQUENCE) ? npos : i;
+		}
+		
+		void line_table::find_sorted(const std::vector<Dwarf_Addr>& sorted_addrs, 
+			std::vector<size_t>& out) const
+		{
+			out.resize(sorted_addrs.size());
+			size_t n = 0; // rows at or before the current address
+			for (unsigned i = 0; i < sorted_addrs.size(); ++i)
+			{
+				assert(i == 0 || sorted_addrs[i - 1] <= sorted_addrs[i]);
+				while (n < addrs.size() && addrs[n] <= sorted_addrs[i]) ++n;
+				out[i] = (n == 0 || (row_flags_[n - 1] & END_SEQUENCE)) ? npos : n - 1;
+			}
+		}
+		
 		std::ostream& operator<<(std::ostream& s, const Dwarf_Locdesc& ld)
 		{
 			s << dwarf::encap::loc_expr(ld);
@@ -1769,6 +2901,16 @@ case DW_TAG_ ## name: return &dummy_ ## name;
 			//}
 			return true;
 		}
+		std::shared_ptr<const lib::line_table> compile_unit_die::get_line_table() const
+		{
+			if (!p_line_table)
+			{
+				p_line_table = std::make_shared<lib::line_table>(
+					d.get_dbg(), d.raw_handle(), &current_dwarf_error);
+			}
+			return p_line_table;
+		}
+		
 		boost::icl::interval_map<Dwarf_Addr, Dwarf_Unsigned> 
 		with_static_location_die::file_relative_intervals(
 		
@@ -0,0 +1,227 @@
+/* dwarfpp: C++ binding for a useful subset of libdwarf, plus extra goodies.
+ *
+ * name_index.cpp: building, writing and mapping the sidecar name index.
+ *
+ * Copyright (c) 2013, Stephen Kell.
+ */
+
+#include "dwarfpp/name_index.hpp"
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <cstdlib>
+#include <cstdio>
+#include <cerrno>
+#include <cstring>
+#include <algorithm>
+#include <vector>
+#include <map>
+#include <sstream>
+
+#ifndef DW_VIS_local
+#define DW_VIS_local 0x01
+#endif
+
+namespace dwarf
+{
+	namespace core
+	{
+		using std::vector;
+		using std::make_pair;
+
+		static const char name_index_magic[8] = { 'D', 'W', 'P', 'P', 'N', 'I', 'X', '1' };
+
+		name_index::~name_index()
+		{
+			if (mapping) munmap(mapping, mapping_length);
+		}
+
+		shared_ptr<name_index> name_index::open(const string& path, const string& build_id)
+		{
+			if (build_id.empty() || build_id.size() > sizeof (header().build_id)) return shared_ptr<name_index>();
+			int fd = ::open(path.c_str(), O_RDONLY);
+			if (fd == -1) return shared_ptr<name_index>();
+			struct stat st;
+			if (fstat(fd, &st) != 0 || (size_t) st.st_size < sizeof (header)) { close(fd); return shared_ptr<name_index>(); }
+			void *mapping = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+			close(fd);
+			if (mapping == MAP_FAILED) return shared_ptr<name_index>();
+			shared_ptr<name_index> p(new name_index);
+			p->mapping = mapping;
+			p->mapping_length = st.st_size;
+			p->p_header = static_cast<const header *>(mapping);
+
+			/* Check everything before trusting any offsets. */
+			const header& h = *p->p_header;
+			if (0 != memcmp(h.magic, name_index_magic, sizeof name_index_magic)
+				|| h.version != VERSION
+				|| h.build_id_len != build_id.size()
+				|| 0 != memcmp(h.build_id, build_id.data(), build_id.size())
+				|| h.entries_off % alignof(entry) != 0
+				|| h.entries_off > p->mapping_length
+				|| h.nentries > (p->mapping_length - h.entries_off) / sizeof (entry)
+				|| h.strings_off > p->mapping_length
+				|| h.strings_len > p->mapping_length - h.strings_off)
+			{
+				return shared_ptr<name_index>();
+			}
+			const char *base = static_cast<const char *>(mapping);
+			p->entries = reinterpret_cast<const entry *>(base + h.entries_off);
+			p->strings = base + h.strings_off;
+			for (auto i_e = p->begin(); i_e != p->end(); ++i_e)
+			{
+				if ((uint64_t) i_e->name_off + i_e->name_len > h.strings_len) return shared_ptr<name_index>();
+			}
+			return p;
+		}
+
+		bool name_index::write(const native_root_die& r, const string& path)
+		{
+			string build_id = r.sections().build_id();
+			if (build_id.empty() || build_id.size() > sizeof (header().build_id)) return false;
+			if (!r.complete()) return false; // we'd miss some names
+
+			/* One pass in DWARF order. At each depth we remember the qualified
+			 * name of the most recent DIE, or that it had none (in which case
+			 * nothing under it gets a qualified name either). Depth 1 is the
+			 * CU, which doesn't contribute to qualified names. */
+			vector<string> qualified_at_depth(2);
+			vector<bool> named_at_depth(2, true);
+			string strings;
+			vector<entry> out;
+			std::map<string, uint32_t> string_offsets; // so repeated names share storage
+			for (auto i = r.begin(); i != r.end(); ++i)
+			{
+				unsigned depth = i.depth();
+				if (qualified_at_depth.size() <= depth)
+				{
+					qualified_at_depth.resize(depth + 1);
+					named_at_depth.resize(depth + 1);
+				}
+				if (depth < 2) continue; // CU
+				const char *name = i.name_here();
+				if (!name && i.has_attr_here(DW_AT_name)) return false; // can't decode it (e.g. dwz's), so we'd miss it
+				named_at_depth[depth] = name && named_at_depth[depth - 1];
+				if (!named_at_depth[depth]) continue;
+				qualified_at_depth[depth] = (depth == 2) ? string(name)
+					: qualified_at_depth[depth - 1] + "::" + name;
+				const string& q = qualified_at_depth[depth];
+
+				auto found = string_offsets.find(q);
+				if (found == string_offsets.end())
+				{
+					if (strings.size() + q.size() > UINT32_MAX) return false;
+					found = string_offsets.insert(make_pair(q, (uint32_t) strings.size())).first;
+					strings += q;
+				}
+				entry e;
+				e.name_off = found->second;
+				e.name_len = q.size();
+				e.die_off = i.offset_here();
+				e.tag = i.tag_here();
+				auto vis = (*i).attr_unsigned(DW_AT_visibility);
+				e.flags = (!vis || *vis != DW_VIS_local) ? VISIBLE : 0;
+				e.depth = depth;
+				out.push_back(e);
+			}
+			if (!r.complete()) return false; // a unit turned out to be corrupt, so we missed its names
+			std::sort(out.begin(), out.end(), [&strings](const entry& e1, const entry& e2) {
+				int cmp = strings.compare(e1.name_off, e1.name_len, strings, e2.name_off, e2.name_len);
+				return cmp < 0 || (cmp == 0 && e1.die_off < e2.die_off);
+			});
+
+			header h;
+			memset(&h, 0, sizeof h);
+			memcpy(h.magic, name_index_magic, sizeof name_index_magic);
+			h.version = VERSION;
+			h.build_id_len = build_id.size();
+			memcpy(h.build_id, build_id.data(), build_id.size());
+			h.nentries = out.size();
+			h.entries_off = sizeof h; // which keeps entries aligned; see the header
+			h.strings_off = h.entries_off + out.size() * sizeof (entry);
+			h.strings_len = strings.size();
+
+			std::ostringstream tmp_name;
+			tmp_name << path << ".tmp." << getpid();
+			string tmp_path = tmp_name.str();
+			FILE *f = fopen(tmp_path.c_str(), "wb");
+			if (!f) return false;
+			bool ok = fwrite(&h, sizeof h, 1, f) == 1
+				&& (out.empty() || fwrite(&out[0], sizeof (entry), out.size(), f) == out.size())
+				&& (strings.empty() || fwrite(strings.data(), strings.size(), 1, f) == 1);
+			ok = (fclose(f) == 0) && ok;
+			if (!ok || 0 != rename(tmp_path.c_str(), path.c_str()))
+			{
+				unlink(tmp_path.c_str());
+				return false;
+			}
+			return true;
+		}
+
+		string name_index::default_path(const string& build_id)
+		{
+			string dir;
+			const char *env;
+			if ((env = getenv("DWARFPP_NAME_INDEX_DIR")) && *env) dir = env;
+			else if ((env = getenv("XDG_CACHE_HOME")) && *env) dir = string(env) + "/dwarfpp";
+			else if ((env = getenv("HOME")) && *env) dir = string(env) + "/.cache/dwarfpp";
+			else return string();
+
+			std::ostringstream s;
+			s << dir << "/";
+			static const char hex[] = "0123456789abcdef";
+			for (auto i_c = build_id.begin(); i_c != build_id.end(); ++i_c)
+			{
+				unsigned char c = *i_c;
+				s << hex[c >> 4] << hex[c & 0xf];
+			}
+			s << ".names";
+			return s.str();
+		}
+
+		shared_ptr<name_index> name_index::open_for(const debug_sections& s)
+		{
+			string build_id = s.build_id();
+			if (build_id.empty()) return shared_ptr<name_index>();
+			string path = default_path(build_id);
+			if (path.empty()) return shared_ptr<name_index>();
+			return open(path, build_id);
+		}
+
+		shared_ptr<name_index> name_index::build_for(const native_root_die& r)
+		{
+			auto p = open_for(r.sections());
+			if (p) return p;
+			if (!r.complete()) return shared_ptr<name_index>(); // we'd miss some names
+			string build_id = r.sections().build_id();
+			string path = default_path(build_id);
+			if (build_id.empty() || path.empty()) return shared_ptr<name_index>();
+
+			/* Make the directory (and its parent, for the ~/.cache case);
+			 * it's fine if they exist already. */
+			string dir = path.substr(0, path.rfind('/'));
+			string parent = dir.substr(0, dir.rfind('/'));
+			if (!parent.empty()) mkdir(parent.c_str(), 0755);
+			if (mkdir(dir.c_str(), 0755) != 0 && errno != EEXIST) return shared_ptr<name_index>();
+			if (!write(r, path)) return shared_ptr<name_index>();
+			return open(path, build_id);
+		}
+
+		pair<const name_index::entry *, const name_index::entry *>
+		name_index::equal_range(const string& qualified_name) const
+		{
+			const char *strs = strings;
+			auto less_than_name = [strs, &qualified_name](const entry& e, const string&) {
+				return qualified_name.compare(0, string::npos, strs + e.name_off, e.name_len) > 0;
+			};
+			auto name_less_than = [strs, &qualified_name](const string&, const entry& e) {
+				return qualified_name.compare(0, string::npos, strs + e.name_off, e.name_len) < 0;
+			};
+			const entry *lower = std::lower_bound(begin(), end(), qualified_name, less_than_name);
+			const entry *upper = std::upper_bound(lower, end(), qualified_name, name_less_than);
+			return make_pair(lower, upper);
+		}
+	}
+}
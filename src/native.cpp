@@ -0,0 +1,705 @@
+/* dwarfpp: C++ binding for a useful subset of libdwarf, plus extra goodies.
+ *
+ * native.cpp: read-only DIE decoding straight out of the mapped debug
+ * sections, bypassing libdwarf.
+ *
+ * Copyright (c) 2013, Stephen Kell.
+ */
+
+#include "dwarfpp/native.hpp"
+#include "dwarfpp/attr.hpp"
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <libelf.h>
+#include <gelf.h>
+
+/* Our dwarf.h might predate DWARF 5 (and the GNU split-DWARF extensions).
+ * We only need the numbers, to know how big things are. */
+#ifndef DW_FORM_strx
+#define DW_FORM_strx 0x1a
+#define DW_FORM_addrx 0x1b
+#define DW_FORM_ref_sup4 0x1c
+#define DW_FORM_strp_sup 0x1d
+#define DW_FORM_data16 0x1e
+#define DW_FORM_line_strp 0x1f
+#define DW_FORM_implicit_const 0x21
+#define DW_FORM_loclistx 0x22
+#define DW_FORM_rnglistx 0x23
+#define DW_FORM_ref_sup8 0x24
+#define DW_FORM_strx1 0x25
+#define DW_FORM_strx2 0x26
+#define DW_FORM_strx3 0x27
+#define DW_FORM_strx4 0x28
+#define DW_FORM_addrx1 0x29
+#define DW_FORM_addrx2 0x2a
+#define DW_FORM_addrx3 0x2b
+#define DW_FORM_addrx4 0x2c
+#endif
+#ifndef DW_FORM_GNU_addr_index
+#define DW_FORM_GNU_addr_index 0x1f01
+#define DW_FORM_GNU_str_index 0x1f02
+#define DW_FORM_GNU_ref_alt 0x1f20
+#define DW_FORM_GNU_strp_alt 0x1f21
+#endif
+#ifndef DW_AT_str_offsets_base
+#define DW_AT_str_offsets_base 0x72
+#endif
+#ifndef DW_UT_compile
+#define DW_UT_compile 0x01
+#define DW_UT_type 0x02
+#define DW_UT_partial 0x03
+#define DW_UT_skeleton 0x04
+#define DW_UT_split_compile 0x05
+#define DW_UT_split_type 0x06
+#endif
+
+namespace dwarf
+{
+	namespace core
+	{
+		using namespace native_decode;
+		using std::make_shared;
+
+		shared_ptr<debug_sections> debug_sections::open(int fd)
+		{
+			struct stat st;
+			if (fstat(fd, &st) != 0 || st.st_size == 0) return shared_ptr<debug_sections>();
+
+			if (elf_version(EV_CURRENT) == EV_NONE) return shared_ptr<debug_sections>();
+			::Elf *e = elf_begin(fd, ELF_C_READ, nullptr);
+			if (!e) return shared_ptr<debug_sections>();
+			// make sure we elf_end() on every path out of here
+			std::unique_ptr< ::Elf, int(*)(::Elf *)> elf_holder(e, elf_end);
+			if (elf_kind(e) != ELF_K_ELF) return shared_ptr<debug_sections>();
+
+			GElf_Ehdr ehdr;
+			if (gelf_getehdr(e, &ehdr) == 0) return shared_ptr<debug_sections>();
+			const uint16_t one = 1;
+			bool host_is_little_endian = *reinterpret_cast<const unsigned char *>(&one) == 1;
+			if ((ehdr.e_ident[EI_DATA] == ELFDATA2LSB) != host_is_little_endian)
+			{
+				return shared_ptr<debug_sections>(); // FIXME: support byte-swapping
+			}
+			size_t shstrndx;
+			if (elf_getshdrstrndx(e, &shstrndx) != 0) return shared_ptr<debug_sections>();
+
+			void *mapping = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+			if (mapping == MAP_FAILED) return shared_ptr<debug_sections>();
+			shared_ptr<debug_sections> p(new debug_sections);
+			p->mapping = mapping;
+			p->mapping_length = st.st_size;
+			const unsigned char *base = static_cast<const unsigned char *>(mapping);
+
+			Elf_Scn *scn = nullptr;
+			GElf_Shdr shdr;
+			while ((scn = elf_nextscn(e, scn)) != nullptr)
+			{
+				if (gelf_getshdr(scn, &shdr) != &shdr) continue;
+				const char *name = elf_strptr(e, shstrndx, shdr.sh_name);
+				if (!name || (0 != strncmp(name, ".debug_", 7)
+					&& 0 != strcmp(name, ".gdb_index")
+					&& 0 != strcmp(name, ".note.gnu.build-id"))) continue;
+				/* Compressed sections would need inflating into private memory,
+				 * which defeats the point. Let the caller fall back to libdwarf. */
+				if (shdr.sh_flags & SHF_COMPRESSED) return shared_ptr<debug_sections>();
+				if (shdr.sh_type == SHT_NOBITS) continue;
+				if (shdr.sh_offset + shdr.sh_size > p->mapping_length) return shared_ptr<debug_sections>();
+				p->by_name[name] = section(base + shdr.sh_offset, shdr.sh_size);
+			}
+			p->info = p->get(".debug_info");
+			p->abbrev = p->get(".debug_abbrev");
+			p->str = p->get(".debug_str");
+			p->line_str = p->get(".debug_line_str");
+			p->str_offsets = p->get(".debug_str_offsets");
+			if (!p->info || !p->abbrev) return shared_ptr<debug_sections>();
+			return p;
+		}
+
+		string debug_sections::build_id() const
+		{
+			section note = get(".note.gnu.build-id");
+			const unsigned char *p = note.data;
+			while (p && p + 12 <= note.end())
+			{
+				uint32_t namesz = read_fixed<uint32_t>(p);
+				uint32_t descsz = read_fixed<uint32_t>(p);
+				uint32_t type = read_fixed<uint32_t>(p);
+				const unsigned char *name = p;
+				p += (namesz + 3) & ~3u;
+				const unsigned char *desc = p;
+				p += (descsz + 3) & ~3u;
+				if (p > note.end()) break;
+				if (type == 3 /* NT_GNU_BUILD_ID */ && namesz == 4 && 0 == memcmp(name, "GNU", 4))
+				{
+					return string(reinterpret_cast<const char *>(desc), descsz);
+				}
+			}
+			return string();
+		}
+
+		debug_sections::~debug_sections()
+		{
+			if (mapping) munmap(mapping, mapping_length);
+		}
+
+		int abbrev_table::fixed_form_size(Dwarf_Half form, 
+			Dwarf_Half address_size, Dwarf_Half offset_size, Dwarf_Half version)
+		{
+			switch (form)
+			{
+				case DW_FORM_flag_present: case DW_FORM_implicit_const:
+					return 0;
+				case DW_FORM_addr:
+					return address_size;
+				case DW_FORM_data1: case DW_FORM_ref1: case DW_FORM_flag:
+				case DW_FORM_strx1: case DW_FORM_addrx1:
+					return 1;
+				case DW_FORM_data2: case DW_FORM_ref2: case DW_FORM_strx2: case DW_FORM_addrx2:
+					return 2;
+				case DW_FORM_strx3: case DW_FORM_addrx3:
+					return 3;
+				case DW_FORM_data4: case DW_FORM_ref4: case DW_FORM_ref_sup4:
+				case DW_FORM_strx4: case DW_FORM_addrx4:
+					return 4;
+				case DW_FORM_data8: case DW_FORM_ref8: case DW_FORM_ref_sig8: case DW_FORM_ref_sup8:
+					return 8;
+				case DW_FORM_data16:
+					return 16;
+				case DW_FORM_strp: case DW_FORM_line_strp: case DW_FORM_sec_offset:
+				case DW_FORM_strp_sup: case DW_FORM_GNU_ref_alt: case DW_FORM_GNU_strp_alt:
+					return offset_size;
+				case DW_FORM_ref_addr:
+					return (version <= 2) ? address_size : offset_size;
+				default: // LEB128s, strings, blocks, indirect
+					return -1;
+			}
+		}
+
+		bool abbrev_table::is_known_form(Dwarf_Half form)
+		{
+			switch (form)
+			{
+				case DW_FORM_udata: case DW_FORM_ref_udata: case DW_FORM_strx: case DW_FORM_addrx:
+				case DW_FORM_loclistx: case DW_FORM_rnglistx:
+				case DW_FORM_GNU_addr_index: case DW_FORM_GNU_str_index:
+				case DW_FORM_sdata: case DW_FORM_string:
+				case DW_FORM_block1: case DW_FORM_block2: case DW_FORM_block4:
+				case DW_FORM_block: case DW_FORM_exprloc:
+				case DW_FORM_indirect: // the real form is checked by skip_form()
+					return true;
+				default:
+					// any other form we know is fixed-size; the size doesn't matter here
+					return fixed_form_size(form, 8, 8, 5) != -1;
+			}
+		}
+
+		abbrev_table::abbrev_table(const unsigned char *p, const unsigned char *end,
+			Dwarf_Half address_size, Dwarf_Half offset_size, Dwarf_Half version)
+		 : decodable(true), has_indirect(false)
+		{
+			while (p < end)
+			{
+				abbrev a;
+				a.code = read_uleb128(p, end);
+				if (!p) { decodable = false; return; }
+				if (a.code == 0) break;
+				a.tag = read_uleb128(p, end);
+				a.has_children = (read_fixed<uint8_t>(p, end) == DW_CHILDREN_yes);
+				if (!p) { decodable = false; return; }
+				int offset = 0; // -1 once we've seen a variable-size form
+				a.min_size = 0;
+				while (true)
+				{
+					abbrev::attr_spec spec;
+					spec.attr = read_uleb128(p, end);
+					spec.form = read_uleb128(p, end);
+					spec.implicit_const = (spec.form == DW_FORM_implicit_const) ? read_sleb128(p, end) : 0;
+					if (!p) { decodable = false; return; }
+					if (spec.attr == 0 && spec.form == 0) break;
+					if (!is_known_form(spec.form)) decodable = false;
+					if (spec.form == DW_FORM_indirect) has_indirect = true;
+					spec.fixed_offset = offset;
+					if (offset != -1)
+					{
+						int size = fixed_form_size(spec.form, address_size, offset_size, version);
+						offset = (size == -1) ? -1 : offset + size;
+						if (offset != -1) a.min_size = offset;
+					}
+					if (spec.attr < a.present.size()) a.present[spec.attr] = true;
+					a.attrs.push_back(spec);
+				}
+				a.fixed_size = offset;
+				if (a.code == dense.size() + 1) dense.push_back(std::move(a));
+				else sparse.insert(make_pair(a.code, std::move(a)));
+			}
+		}
+
+		bool unit_header::decode(const unsigned char *section_begin, const unsigned char *p,
+			const unsigned char *section_end)
+		{
+			if (section_end - p < 11) return false;
+			offset = p - section_begin;
+			length = read_fixed<uint32_t>(p);
+			offset_size = 4;
+			if (length == 0xffffffff)
+			{
+				length = read_fixed<uint64_t>(p);
+				offset_size = 8;
+			}
+			else if (length >= 0xfffffff0) return false; // reserved
+			end_offset = (p - section_begin) + length;
+			if (section_begin + end_offset > section_end) return false;
+			version = read_fixed<uint16_t>(p);
+			if (version < 2 || version > 5) return false;
+			if (version >= 5)
+			{
+				unit_type = read_fixed<uint8_t>(p);
+				address_size = read_fixed<uint8_t>(p);
+				abbrev_offset = read_sized(p, offset_size);
+				switch (unit_type)
+				{
+					case DW_UT_skeleton:
+					case DW_UT_split_compile:
+						p += 8; // dwo_id
+						break;
+					case DW_UT_type:
+					case DW_UT_split_type:
+						p += 8 + offset_size; // type signature, type offset
+						break;
+					default: break;
+				}
+			}
+			else
+			{
+				unit_type = DW_UT_compile;
+				abbrev_offset = read_sized(p, offset_size);
+				address_size = read_fixed<uint8_t>(p);
+			}
+			first_die_offset = p - section_begin;
+			str_offsets_base = 0;
+			p_abbrevs = nullptr;
+			return true;
+		}
+
+		native_root_die::native_root_die(shared_ptr<debug_sections> p_sections)
+		 : p_sections(p_sections), m_complete(true), m_abandoned(false)
+		{
+			const debug_sections::section& info = p_sections->info;
+			const unsigned char *p = info.data;
+			while (p < info.end())
+			{
+				unit_header u;
+				if (!u.decode(info.data, p, info.end())) break;
+				p = info.data + u.end_offset;
+				if (u.abbrev_offset >= p_sections->abbrev.size) { m_complete = false; continue; }
+				auto key = std::make_tuple(u.abbrev_offset, u.address_size, u.offset_size, 
+					(u.version <= 2) ? (Dwarf_Half) 2 : (Dwarf_Half) 3); // only ref_addr cares
+				auto found = abbrev_tables.find(key);
+				if (found == abbrev_tables.end())
+				{
+					found = abbrev_tables.insert(make_pair(key,
+						abbrev_table(p_sections->abbrev.data + u.abbrev_offset,
+							p_sections->abbrev.end(), 
+							u.address_size, u.offset_size, u.version))).first;
+				}
+				/* If the unit uses a form we can't skip over, we can't decode it.
+				 * Leave it out; its DIEs will come from libdwarf. */
+				if (!found->second.decodable) { m_complete = false; continue; }
+				u.p_abbrevs = &found->second;
+				/* With DW_FORM_indirect, we only find out whether we know the
+				 * forms as we decode, so do that now rather than giving up
+				 * halfway through somebody's scan. Producers hardly use it. */
+				if (found->second.has_indirect && !unit_decodes(u)) { m_complete = false; continue; }
+				units.push_back(u);
+			}
+			/* DW_AT_str_offsets_base lives on the CU DIE, and we need it to
+			 * decode any strx-form string in the unit, so grab it now. */
+			for (auto i_u = units.begin(); i_u != units.end(); ++i_u)
+			{
+				if (i_u->version < 5) continue;
+				const unsigned char *p_die = info.data + i_u->first_die_offset;
+				const unsigned char *unit_end = info.data + i_u->end_offset;
+				Dwarf_Unsigned code = read_uleb128(p_die, unit_end);
+				if (!p_die) continue;
+				const abbrev *p_abbrev = i_u->p_abbrevs->find(code);
+				if (!p_abbrev || unit_end - p_die < p_abbrev->min_size) continue;
+				native_die d(this, &*i_u, p_abbrev, i_u->first_die_offset, p_die);
+				auto base = d.attr_unsigned(DW_AT_str_offsets_base);
+				if (base) i_u->str_offsets_base = *base;
+				else i_u->str_offsets_base = 2 * i_u->offset_size; // skip the contribution header
+			}
+		}
+
+		bool native_root_die::unit_decodes(const unit_header& u) const
+		{
+			const unsigned char *info_begin = p_sections->info.data;
+			const unsigned char *p = info_begin + u.first_die_offset;
+			const unsigned char *end = info_begin + u.end_offset;
+			while (p < end)
+			{
+				Dwarf_Off off = p - info_begin;
+				Dwarf_Unsigned code = read_uleb128(p, end);
+				if (!p) return false;
+				if (code == 0) continue;
+				const abbrev *p_abbrev = u.p_abbrevs->find(code);
+				if (!p_abbrev || end - p < p_abbrev->min_size) return false;
+				p = native_die(this, &u, p_abbrev, off, p).attrs_end();
+				if (!p) return false;
+			}
+			return true;
+		}
+
+		shared_ptr<native_root_die> native_root_die::open(int fd)
+		{
+			auto p_sections = debug_sections::open(fd);
+			if (!p_sections) return shared_ptr<native_root_die>();
+			return make_shared<native_root_die>(p_sections);
+		}
+
+		const unit_header *
+		native_root_die::unit_containing(Dwarf_Off off) const
+		{
+			auto found = std::upper_bound(units.begin(), units.end(), off,
+				[](Dwarf_Off o, const unit_header& u) { return o < u.offset; });
+			if (found == units.begin()) return nullptr;
+			--found;
+			return (off < found->end_offset) ? &*found : nullptr;
+		}
+
+		const unsigned char *
+		native_root_die::skip_form(Dwarf_Half form, const unsigned char *p, const unit_header& u) const
+		{
+			const unsigned char *end = p_sections->info.data + u.end_offset;
+			if (p > end) return nullptr;
+			int size = abbrev_table::fixed_form_size(form, u.address_size, u.offset_size, u.version);
+			if (size != -1) return (end - p >= size) ? p + size : nullptr;
+			Dwarf_Unsigned len;
+			switch (form)
+			{
+				case DW_FORM_udata: case DW_FORM_ref_udata: case DW_FORM_strx: case DW_FORM_addrx:
+				case DW_FORM_loclistx: case DW_FORM_rnglistx:
+				case DW_FORM_GNU_addr_index: case DW_FORM_GNU_str_index:
+					read_uleb128(p, end); return p;
+				case DW_FORM_sdata:
+					read_sleb128(p, end); return p;
+				case DW_FORM_string:
+				{
+					const void *nul = memchr(p, 0, end - p);
+					return nul ? static_cast<const unsigned char *>(nul) + 1 : nullptr;
+				}
+				case DW_FORM_block1: len = read_fixed<uint8_t>(p, end); break;
+				case DW_FORM_block2: len = read_fixed<uint16_t>(p, end); break;
+				case DW_FORM_block4: len = read_fixed<uint32_t>(p, end); break;
+				case DW_FORM_block: case DW_FORM_exprloc: len = read_uleb128(p, end); break;
+				case DW_FORM_indirect:
+				{
+					Dwarf_Half actual = read_uleb128(p, end);
+					return p ? skip_form(actual, p, u) : nullptr;
+				}
+				default:
+					/* Units whose abbrevs use unknown forms are never decoded
+					 * (see the constructor), so only DW_FORM_indirect gets us here. */
+					return nullptr;
+			}
+			// a block
+			return (p && len <= (Dwarf_Unsigned)(end - p)) ? p + len : nullptr;
+		}
+
+		const char *
+		native_root_die::string_of_form(Dwarf_Half form, const unsigned char *p, const unit_header& u) const
+		{
+			const debug_sections& s = *p_sections;
+			Dwarf_Unsigned str_off;
+			switch (form)
+			{
+				case DW_FORM_string:
+					return reinterpret_cast<const char *>(p);
+				case DW_FORM_strp:
+					str_off = read_sized(p, u.offset_size);
+					return (str_off < s.str.size) ? reinterpret_cast<const char *>(s.str.data + str_off) : nullptr;
+				case DW_FORM_line_strp:
+					str_off = read_sized(p, u.offset_size);
+					return (str_off < s.line_str.size) ? reinterpret_cast<const char *>(s.line_str.data + str_off) : nullptr;
+				case DW_FORM_strx: case DW_FORM_GNU_str_index:
+				case DW_FORM_strx1: case DW_FORM_strx2: case DW_FORM_strx3: case DW_FORM_strx4:
+				{
+					Dwarf_Unsigned index = (form == DW_FORM_strx || form == DW_FORM_GNU_str_index)
+						? read_uleb128(p)
+						: read_sized(p, form - DW_FORM_strx1 + 1);
+					Dwarf_Unsigned entry_off = u.str_offsets_base + index * u.offset_size;
+					if (!s.str_offsets || entry_off + u.offset_size > s.str_offsets.size) return nullptr;
+					const unsigned char *p_entry = s.str_offsets.data + entry_off;
+					str_off = read_sized(p_entry, u.offset_size);
+					return (str_off < s.str.size) ? reinterpret_cast<const char *>(s.str.data + str_off) : nullptr;
+				}
+				default: // not a string (or in a supplementary file we don't have)
+					return nullptr;
+			}
+		}
+
+		const unsigned char *
+		native_die::find_attr(Dwarf_Half attr, Dwarf_Half *out_form, Dwarf_Signed *out_implicit_const) const
+		{
+			int index = p_abbrev->index_of(attr);
+			if (index == -1) return nullptr;
+			const abbrev::attr_spec& found_spec = p_abbrev->attrs[index];
+			const unsigned char *unit_end = p_root->p_sections->info.data + p_unit->end_offset;
+			if (found_spec.fixed_offset != -1)
+			{
+				// the common case: no need to decode anything before it
+				const unsigned char *p = attrs_begin + found_spec.fixed_offset;
+				Dwarf_Half form = found_spec.form;
+				// the real form comes first, and only its value is at a fixed offset
+				if (form == DW_FORM_indirect) form = read_uleb128(p, unit_end);
+				if (!p) return nullptr;
+				if (out_form) *out_form = form;
+				if (out_implicit_const) *out_implicit_const = found_spec.implicit_const;
+				return p;
+			}
+			const unsigned char *p = attrs_begin;
+			for (auto i_spec = p_abbrev->attrs.begin(); i_spec != p_abbrev->attrs.end(); ++i_spec)
+			{
+				Dwarf_Half form = i_spec->form;
+				if (form == DW_FORM_indirect) form = read_uleb128(p, unit_end);
+				if (!p) return nullptr;
+				if (i_spec->attr == attr)
+				{
+					if (out_form) *out_form = form;
+					if (out_implicit_const) *out_implicit_const = i_spec->implicit_const;
+					return p;
+				}
+				p = p_root->skip_form(form, p, *p_unit);
+				if (!p) return nullptr; // an indirect form we don't know
+			}
+			return nullptr;
+		}
+
+		const unsigned char *
+		native_die::attrs_end() const
+		{
+			if (p_abbrev->fixed_size != -1) return attrs_begin + p_abbrev->fixed_size;
+			/* Start from the last attribute whose offset we know. */
+			auto i_spec = p_abbrev->attrs.begin();
+			const unsigned char *p = attrs_begin;
+			while (i_spec != p_abbrev->attrs.end() && i_spec + 1 != p_abbrev->attrs.end()
+				&& (i_spec + 1)->fixed_offset != -1) ++i_spec;
+			if (i_spec != p_abbrev->attrs.end() && i_spec->fixed_offset != -1) p += i_spec->fixed_offset;
+			for (; i_spec != p_abbrev->attrs.end() && p; ++i_spec)
+			{
+				p = p_root->skip_form(i_spec->form, p, *p_unit);
+			}
+			return p; // null if there was an indirect form we don't know
+		}
+
+		const char *
+		native_die::attr_string(Dwarf_Half attr) const
+		{
+			Dwarf_Half form;
+			const unsigned char *p = find_attr(attr, &form);
+			if (!p) return nullptr;
+			return p_root->string_of_form(form, p, *p_unit);
+		}
+
+		opt<string>
+		native_die::get_name() const
+		{
+			const char *name = raw_name();
+			return name ? opt<string>(string(name)) : opt<string>();
+		}
+
+		optional<Dwarf_Unsigned>
+		native_die::attr_unsigned(Dwarf_Half attr) const
+		{
+			Dwarf_Half form;
+			Dwarf_Signed implicit_const;
+			const unsigned char *p = find_attr(attr, &form, &implicit_const);
+			if (!p) return optional<Dwarf_Unsigned>();
+			switch (form)
+			{
+				case DW_FORM_flag_present: return optional<Dwarf_Unsigned>(1);
+				case DW_FORM_implicit_const: return optional<Dwarf_Unsigned>(implicit_const);
+				case DW_FORM_addr: return optional<Dwarf_Unsigned>(read_sized(p, p_unit->address_size));
+				case DW_FORM_data1: case DW_FORM_flag: return optional<Dwarf_Unsigned>(read_sized(p, 1));
+				case DW_FORM_data2: return optional<Dwarf_Unsigned>(read_sized(p, 2));
+				case DW_FORM_data4: return optional<Dwarf_Unsigned>(read_sized(p, 4));
+				case DW_FORM_data8: case DW_FORM_ref_sig8: return optional<Dwarf_Unsigned>(read_sized(p, 8));
+				case DW_FORM_udata: return optional<Dwarf_Unsigned>(read_uleb128(p));
+				case DW_FORM_sdata: return optional<Dwarf_Unsigned>(read_sleb128(p));
+				case DW_FORM_sec_offset: return optional<Dwarf_Unsigned>(read_sized(p, p_unit->offset_size));
+				// unit-relative references become section-relative
+				case DW_FORM_ref1: return optional<Dwarf_Unsigned>(p_unit->offset + read_sized(p, 1));
+				case DW_FORM_ref2: return optional<Dwarf_Unsigned>(p_unit->offset + read_sized(p, 2));
+				case DW_FORM_ref4: return optional<Dwarf_Unsigned>(p_unit->offset + read_sized(p, 4));
+				case DW_FORM_ref8: return optional<Dwarf_Unsigned>(p_unit->offset + read_sized(p, 8));
+				case DW_FORM_ref_udata: return optional<Dwarf_Unsigned>(p_unit->offset + read_uleb128(p));
+				case DW_FORM_ref_addr:
+					return optional<Dwarf_Unsigned>(read_sized(p,
+						(p_unit->version <= 2) ? p_unit->address_size : p_unit->offset_size));
+				default: return optional<Dwarf_Unsigned>(); // e.g. blocks, strings, addrx
+			}
+		}
+
+		optional<pair<const unsigned char *, Dwarf_Unsigned> >
+		native_die::attr_block(Dwarf_Half attr) const
+		{
+			typedef pair<const unsigned char *, Dwarf_Unsigned> ret_t;
+			Dwarf_Half form;
+			const unsigned char *p = find_attr(attr, &form);
+			if (!p) return optional<ret_t>();
+			Dwarf_Unsigned len;
+			switch (form)
+			{
+				case DW_FORM_block1: len = read_fixed<uint8_t>(p); break;
+				case DW_FORM_block2: len = read_fixed<uint16_t>(p); break;
+				case DW_FORM_block4: len = read_fixed<uint32_t>(p); break;
+				case DW_FORM_block: case DW_FORM_exprloc: len = read_uleb128(p); break;
+				default: return optional<ret_t>();
+			}
+			return optional<ret_t>(make_pair(p, len));
+		}
+
+		encap::attribute_map
+		native_die::copy_attrs(opt<root_die&> opt_r) const
+		{
+			/* We don't decode attributes into encap::attribute_values ourselves;
+			 * get libdwarf to do it. */
+			assert(opt_r);
+			Die d(*opt_r, off);
+			return encap::attribute_map(core::AttributeList(d), d, *opt_r, get_spec(*opt_r));
+		}
+
+		spec&
+		native_die::get_spec(root_die& r) const
+		{
+			// FIXME: CUs can lie about their spec; we're as bad as Die::spec_here
+			return ::dwarf::spec::DEFAULT_DWARF_SPEC;
+		}
+
+		/* Traversal. Since DWARF order is depth-first order, this is mostly
+		 * a linear scan: a DIE with children is followed by its first child;
+		 * a null entry ends a sibling chain; running off the end of a unit
+		 * takes us to the next unit's CU DIE. */
+		void
+		native_iterator_df::decode_at(const unsigned char *p)
+		{
+			const native_root_die *p_root = cur.p_root;
+			const unit_header *p_unit = cur.p_unit;
+			const unsigned char *info_begin = p_root->p_sections->info.data;
+			while (true)
+			{
+				const unsigned char *unit_end = info_begin + p_unit->end_offset;
+				if (p >= unit_end)
+				{
+					// next unit, if any
+					auto i_next = p_root->units.begin() + (p_unit - &p_root->units[0]) + 1;
+					if (i_next == p_root->units.end()) { set_end(); return; }
+					p_unit = &*i_next;
+					p = info_begin + p_unit->first_die_offset;
+					m_depth = 0; // the CU DIE will make it 1
+					ancestors.clear();
+					continue;
+				}
+				Dwarf_Off off = p - info_begin;
+				Dwarf_Unsigned code = read_uleb128(p, unit_end);
+				if (!p) { p_root->m_abandoned = true; p = unit_end; continue; }
+				/* NOTE: at this point, m_depth is the depth of the *parent*
+				 * of the entry we're about to read. */
+				if (code == 0)
+				{
+					if (m_depth == 0) continue; // padding after the CU's subtree
+					// end of a sibling chain; pop up a level
+					--m_depth;
+					ancestors.pop_back();
+					continue;
+				}
+				const abbrev *p_abbrev = p_unit->p_abbrevs->find(code);
+				if (!p_abbrev || unit_end - p < p_abbrev->min_size)
+				{
+					/* Corrupt, so we can't trust anything after this in the
+					 * unit. Skip to the next one, and remember we did. */
+					p_root->m_abandoned = true;
+					p = unit_end;
+					continue;
+				}
+				++m_depth;
+				cur = native_die(p_root, p_unit, p_abbrev, off, p);
+				return;
+			}
+		}
+
+		void
+		native_iterator_df::increment()
+		{
+			assert(!is_end_position());
+			const unsigned char *p = cur.attrs_end();
+			if (!p)
+			{
+				/* We can't find the end of this DIE (it's corrupt, or uses an
+				 * indirect form we don't know), so we can't go on. Skip the
+				 * rest of the unit rather than decoding garbage, and remember
+				 * we did, so that complete() says so. */
+				const unit_header *p_unit = cur.p_unit;
+				cur.p_root->m_abandoned = true;
+				m_depth = 0; ancestors.clear();
+				decode_at(cur.p_root->p_sections->info.data + p_unit->end_offset);
+				return;
+			}
+			/* decode_at() wants the depth of the next DIE's parent: that's us
+			 * if we have children, else our parent. */
+			if (cur.p_abbrev->has_children) ancestors.push_back(cur.off);
+			else --m_depth;
+			decode_at(p);
+		}
+
+		void
+		native_iterator_df::increment_skipping_subtree()
+		{
+			assert(!is_end_position());
+			if (!cur.p_abbrev->has_children) { increment(); return; }
+			const unsigned char *info_begin = cur.p_root->p_sections->info.data;
+			auto sibling = cur.attr_unsigned(DW_AT_sibling);
+			if (sibling && *sibling > cur.off && *sibling < cur.p_unit->end_offset)
+			{
+				--m_depth;
+				decode_at(info_begin + *sibling);
+				return;
+			}
+			// no DW_AT_sibling, so scan until we come back up to our depth
+			unsigned start_depth = m_depth;
+			do { increment(); } while (!is_end_position() && m_depth > start_depth);
+		}
+
+		native_iterator_df
+		native_root_die::begin() const
+		{
+			native_iterator_df it;
+			if (units.empty()) return it;
+			it.cur = native_die(this, &units[0], nullptr, 0, nullptr);
+			it.decode_at(p_sections->info.data + units[0].first_die_offset);
+			return it;
+		}
+
+		native_iterator_df
+		native_root_die::pos(Dwarf_Off off) const
+		{
+			/* Walk down from the CU DIE, skipping subtrees that end before off. */
+			const unit_header *p_unit = unit_containing(off);
+			if (!p_unit) return end();
+			native_iterator_df it;
+			it.cur = native_die(this, p_unit, nullptr, 0, nullptr);
+			it.decode_at(p_sections->info.data + p_unit->first_die_offset);
+			while (!it.is_end_position() && it.offset_here() < off && it.cur.p_unit == p_unit)
+			{
+				native_iterator_df next = it;
+				next.increment_skipping_subtree();
+				if (!next.is_end_position() && next.cur.p_unit == p_unit && next.offset_here() <= off)
+				{
+					it = std::move(next);
+				}
+				else it.increment(); // off must be inside this subtree
+			}
+			return (!it.is_end_position() && it.offset_here() == off) ? it : end();
+		}
+	}
+}
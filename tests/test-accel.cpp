@@ -0,0 +1,66 @@
+#include <dwarfpp/lib.hpp>
+#include <dwarfpp/accel.hpp>
+#include <cstdio>
+#include <cassert>
+#include <cstring>
+
+/* Look up some global names in our own DWARF, through whatever
+ * .debug_names, .gdb_index or pubnames tables the toolchain gave us,
+ * and check the answers against a plain search of every CU's children.
+ * shared_name comes from test-multi-cu.c, static in all CUs but the last;
+ * point_3 is a type, which pubnames don't list at all.
+ * Build with -gpubnames (or link with --gdb-index) to exercise the tables. */
+
+int
+main(int argc, char *argv[])
+{
+	using namespace std;
+	using namespace dwarf;
+	using core::root_die;
+	using core::iterator_base;
+	using core::accel_index;
+
+	assert(argc > 0);
+	FILE* f = fopen(argv[0], "r");
+	assert(f);
+
+	root_die r(fileno(f));
+	const accel_index *p_accel = r.get_accel_index();
+	if (!p_accel) cout << "No accelerator tables; testing the fallback only." << endl;
+	else cout << "Accelerator tables are of kind " << p_accel->get_kind() << "." << endl;
+
+	const char *names[] = { "main", "printf", "shared_name", "cu_function_5", "point_3",
+		"no_such_name_in_this_file" };
+	for (unsigned i = 0; i < sizeof names / sizeof names[0]; ++i)
+	{
+		iterator_base slow = iterator_base::END;
+		auto cus = r.begin().children_here();
+		for (auto i_cu = std::move(cus.first); i_cu != cus.second && slow == iterator_base::END; ++i_cu)
+		{
+			auto children = i_cu.children_here();
+			for (auto i_child = std::move(children.first); i_child != children.second; ++i_child)
+			{
+				auto name = i_child.name_here();
+				if (name && *name == names[i]) { slow = i_child; break; }
+			}
+		}
+		iterator_base fast = r.visible_named_grandchild(names[i]);
+		assert(fast == slow);
+		if (fast != iterator_base::END)
+		{
+			assert(fast.depth() == 2);
+			assert(*fast.name_here() == names[i]);
+		}
+		if (p_accel)
+		{
+			auto found = p_accel->visible_grandchildren(names[i]);
+			for (auto i_off = found.begin(); i_off != found.end(); ++i_off)
+			{
+				assert(*r.find(*i_off).name_here() == names[i]);
+			}
+		}
+		cout << names[i] << ": " << ((fast == iterator_base::END) ? string("not found") : "found") << endl;
+	}
+
+	return 0;
+}
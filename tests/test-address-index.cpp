@@ -0,0 +1,108 @@
+#include <dwarfpp/lib.hpp>
+#include <cstdio>
+#include <cassert>
+#include <vector>
+#include <algorithm>
+
+/* Build the address index for our own DWARF, look up our own main(),
+ * and check that single and batched lookups agree with spans_addr, and
+ * with a brute-force search of each layer around every entry's ends. */
+
+static const dwarf::core::address_index::entry *
+brute_force_find(const dwarf::core::address_index::layer& l, dwarf::lib::Dwarf_Addr addr)
+{
+	const dwarf::core::address_index::entry *best = nullptr;
+	for (auto i_e = l.entries.begin(); i_e != l.entries.end(); ++i_e)
+	{
+		if (!(i_e->lo <= addr && addr < i_e->hi)) continue;
+		/* Deepest, then narrowest; on a tie, the later one. */
+		if (!best || i_e->depth > best->depth
+			|| (i_e->depth == best->depth && i_e->hi - i_e->lo <= best->hi - best->lo)) best = &*i_e;
+	}
+	return best;
+}
+
+int
+main(int argc, char *argv[])
+{
+	using namespace std;
+	using namespace dwarf;
+	using core::root_die;
+	using core::iterator_df;
+	using core::address_index;
+	using core::subprogram_die;
+	using core::with_static_location_die;
+
+	assert(argc > 0);
+	FILE* f = fopen(argv[0], "r");
+	assert(f);
+
+	root_die r(fileno(f));
+	r.build_address_index();
+	const address_index *p_idx = r.get_address_index();
+	assert(p_idx);
+	cout << "Address index has " << p_idx->layers[address_index::CU].entries.size() << " CU pieces, "
+		<< p_idx->layers[address_index::SUBPROGRAM].entries.size() << " subprogram pieces and "
+		<< p_idx->layers[address_index::VARIABLE].entries.size() << " variable pieces." << endl;
+
+	/* Every piece's own start address should find something at least as
+	 * deep, which really does span that address. */
+	vector<lib::Dwarf_Addr> addrs;
+	for (unsigned k = 0; k < address_index::NKINDS; ++k)
+	{
+		auto& entries = p_idx->layers[k].entries;
+		for (auto i_e = entries.begin(); i_e != entries.end(); ++i_e)
+		{
+			const address_index::entry *found = p_idx->find(i_e->lo, (address_index::kind) k);
+			assert(found);
+			assert(found->lo <= i_e->lo && i_e->lo < found->hi);
+			assert(found->depth >= i_e->depth);
+			iterator_df<with_static_location_die> i_d = r.find(found->off);
+			auto spanned = i_d->spans_addr(i_e->lo, r);
+			assert(spanned && *spanned == address_index::offset_within(*found, i_e->lo));
+			if (k == address_index::SUBPROGRAM) addrs.push_back(i_e->lo);
+		}
+	}
+
+	for (unsigned k = 0; k < address_index::NKINDS; ++k)
+	{
+		const address_index::layer& l = p_idx->layers[k];
+		assert(l.segments.size() <= 2 * l.entries.size());
+		for (auto i_e = l.entries.begin(); i_e != l.entries.end(); ++i_e)
+		{
+			lib::Dwarf_Addr probes[] = { i_e->lo, i_e->hi - 1, i_e->hi };
+			for (unsigned i = 0; i < sizeof probes / sizeof probes[0]; ++i)
+			{
+				assert(p_idx->find(probes[i], (address_index::kind) k)
+					== brute_force_find(l, probes[i]));
+			}
+		}
+	}
+
+	/* Batched lookups should agree with single ones. */
+	std::sort(addrs.begin(), addrs.end());
+	vector<const address_index::entry *> batch;
+	p_idx->find_sorted(addrs, address_index::SUBPROGRAM, batch);
+	assert(batch.size() == addrs.size());
+	for (unsigned i = 0; i < addrs.size(); ++i)
+	{
+		assert(batch[i] == p_idx->find(addrs[i], address_index::SUBPROGRAM));
+	}
+
+	/* Our own main() should be where the index says it is. */
+	auto cus = r.begin().children_here();
+	for (auto i_cu = std::move(cus.first); i_cu != cus.second; ++i_cu)
+	{
+		auto found = r.resolve(i_cu, "main");
+		if (found == core::iterator_base::END) continue;
+		iterator_df<subprogram_die> i_main = found;
+		auto low_pc = i_main->get_low_pc();
+		if (!low_pc) continue; // just a declaration
+		const address_index::entry *p_e = p_idx->find(low_pc->addr);
+		assert(p_e && p_e->off == i_main.offset_here());
+		cout << "Found main at 0x" << std::hex << p_e->lo << std::dec << endl;
+		break;
+	}
+
+	return 0;
+}
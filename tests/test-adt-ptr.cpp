@@ -0,0 +1,43 @@
+#include <dwarfpp/lib.hpp>
+#include <dwarfpp/adt.hpp>
+#include <cstdio>
+#include <cassert>
+
+/* Walk our own DWARF through the ADT, checking that shared_from_this() and
+ * adt_cast<> give back the same DIE, whichever way adt_ptr is defined.
+ * Build with -DDWARFPP_INTRUSIVE_ADT (and a library built the same way)
+ * to test the intrusive mode. */
+
+int
+main(int argc, char *argv[])
+{
+	using namespace std;
+	using namespace dwarf;
+	using spec::adt_ptr;
+	using spec::adt_cast;
+
+	assert(argc > 0);
+	FILE* f = fopen(argv[0], "r");
+	assert(f);
+	lib::file df(fileno(f));
+	lib::dieset ds(df);
+
+	unsigned count = 0, cus = 0;
+	for (auto i = ds.begin(); i != ds.end(); ++i)
+	{
+		adt_ptr<spec::basic_die> p = *i;
+		assert(p);
+		assert(p->shared_from_this() == p);
+		auto p_cu = adt_cast<spec::compile_unit_die>(p);
+		assert(!!p_cu == (p->get_tag() == DW_TAG_compile_unit));
+		if (p_cu) { assert(adt_cast<spec::basic_die>(p_cu) == p); ++cus; }
+		++count;
+	}
+	assert(cus > 0);
+#ifdef DWARFPP_INTRUSIVE_ADT
+	cout << "(intrusive) ";
+#endif
+	cout << "Walked " << count << " DIEs in " << cus << " CUs." << endl;
+
+	return 0;
+}
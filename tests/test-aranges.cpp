@@ -0,0 +1,68 @@
+#include <dwarfpp/lib.hpp>
+#include <cstdio>
+#include <cassert>
+
+/* Check that the sorted aranges table agrees with libdwarf's raw one:
+ * every address in every raw range should map to the same CU. Then check
+ * find() against a linear scan of the sorted table. */
+
+int
+main(int argc, char *argv[])
+{
+	using namespace std;
+	using namespace dwarf;
+	using namespace dwarf::lib;
+
+	assert(argc > 0);
+	FILE* f = fopen(argv[0], "r");
+	assert(f);
+
+	file df(fileno(f));
+	aranges *p_ar;
+	try { p_ar = &df.get_aranges(); }
+	catch (No_entry) { cout << "No .debug_aranges; nothing to test." << endl; return 0; }
+
+	auto& sorted = p_ar->sorted_entries();
+	for (unsigned i = 1; i < sorted.size(); ++i) assert(sorted[i - 1].start <= sorted[i].start);
+
+	for (int i = 0; i < p_ar->count(); ++i)
+	{
+		Dwarf_Addr start;
+		Dwarf_Unsigned length;
+		Dwarf_Off cu_off;
+		int ret = p_ar->get_info(i, &start, &length, &cu_off);
+		assert(ret == DW_DLV_OK);
+		if (length == 0) continue;
+		Dwarf_Addr probes[] = { start, start + length / 2, start + length - 1 };
+		for (unsigned j = 0; j < sizeof probes / sizeof probes[0]; ++j)
+		{
+			Dwarf_Addr found_start;
+			Dwarf_Unsigned found_length;
+			Dwarf_Off found_cu_off;
+			ret = p_ar->get_info_for_addr(probes[j], &found_start, &found_length, &found_cu_off);
+			assert(ret == DW_DLV_OK);
+			assert(found_cu_off == cu_off);
+			assert(found_start <= probes[j] && probes[j] < found_start + found_length);
+		}
+	}
+	assert(p_ar->find(0) == nullptr || p_ar->find(0)->start == 0);
+
+	/* Where ranges overlap, the latest-starting one wins; check that against
+	 * a brute-force scan at the edges of every coalesced range. */
+	for (unsigned i = 0; i < sorted.size(); ++i)
+	{
+		Dwarf_Addr probes[] = { sorted[i].start, sorted[i].end - 1, sorted[i].end };
+		for (unsigned j = 0; j < sizeof probes / sizeof probes[0]; ++j)
+		{
+			const aranges::entry *expected = nullptr;
+			for (unsigned k = 0; k < sorted.size() && sorted[k].start <= probes[j]; ++k)
+			{
+				if (probes[j] < sorted[k].end) expected = &sorted[k];
+			}
+			assert(p_ar->find(probes[j]) == expected);
+		}
+	}
+	cout << "Checked " << p_ar->count() << " aranges, coalesced into " << sorted.size() << "." << endl;
+
+	return 0;
+}
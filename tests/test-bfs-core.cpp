@@ -0,0 +1,51 @@
+#include <dwarfpp/lib.hpp>
+#include <cstdio>
+#include <cassert>
+#include <set>
+
+/* Breadth-first traversal of our own DWARF should visit exactly the
+ * DIEs that depth-first traversal does, in non-decreasing depth order. */
+
+int
+main(int argc, char *argv[])
+{
+	using namespace std;
+	using namespace dwarf;
+	using core::root_die;
+	using core::iterator_df;
+	using core::iterator_bf;
+
+	assert(argc > 0);
+	FILE* f = fopen(argv[0], "r");
+	assert(f);
+
+	root_die r(fileno(f));
+
+	set<lib::Dwarf_Off> df_seen;
+	for (iterator_df<> i = r.begin(); i != r.end(); ++i)
+	{
+		if (i.is_real_die_position()) df_seen.insert(i.offset_here());
+	}
+
+	set<lib::Dwarf_Off> bf_seen;
+	unsigned last_depth = 0;
+	for (iterator_bf<> i = r.begin(); i != r.end(); ++i)
+	{
+		assert(i.depth() >= last_depth);
+		last_depth = i.depth();
+		if (!i.is_real_die_position()) continue;
+		bool inserted = bf_seen.insert(i.offset_here()).second;
+		assert(inserted);
+
+		/* Copies should be cheap, and should carry on the same way. */
+		iterator_bf<> copy = i;
+		++copy;
+		iterator_bf<> other = i;
+		++other;
+		assert(copy == other);
+	}
+	assert(bf_seen == df_seen);
+	cout << "Breadth-first walk visited all " << bf_seen.size() << " DIEs." << endl;
+
+	return 0;
+}
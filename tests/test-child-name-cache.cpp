@@ -0,0 +1,91 @@
+#include <dwarfpp/lib.hpp>
+#include <cstdio>
+#include <cassert>
+#include <set>
+
+/* Walk our own DWARF, checking that find_named_child_cached agrees with the
+ * linear find_named_child for children's names (and a name that isn't there)
+ * in every scope, first with the default budget, then with a tiny one, where
+ * the cache must stay within budget, except for keeping the newest table. */
+
+static unsigned check_scopes(dwarf::core::root_die& r)
+{
+	using namespace std;
+	using namespace dwarf;
+	using core::iterator_df;
+	using core::iterator_base;
+
+	unsigned checked = 0;
+	for (iterator_df<> i = r.begin(); i != r.end(); ++i)
+	{
+		auto children = i.children_here();
+		if (children.first == children.second) continue;
+		/* Don't make this quadratic in big scopes; the first few names
+		 * and the last one are enough to exercise the table. */
+		set<string> names;
+		string last_name;
+		for (auto i_child = std::move(children.first); i_child != children.second; ++i_child)
+		{
+			auto name = i_child.name_view_here();
+			if (!name.data()) continue;
+			last_name = name.to_string();
+			if (names.size() < 20) names.insert(last_name);
+		}
+		if (last_name != "") names.insert(last_name);
+		names.insert("no such child, surely");
+		for (auto i_name = names.begin(); i_name != names.end(); ++i_name)
+		{
+			iterator_base slow = r.find_named_child(i, *i_name);
+			iterator_base fast = r.find_named_child_cached(i, *i_name);
+			assert(fast == slow);
+			// the newest table is kept even if it's over budget on its own
+			assert(r.child_names.size() <= r.child_names.get_max_entries()
+				|| r.child_names.table_count() == 1);
+			++checked;
+		}
+	}
+	return checked;
+}
+
+int
+main(int argc, char *argv[])
+{
+	using namespace std;
+	using namespace dwarf;
+	using core::root_die;
+
+	assert(argc > 0);
+	FILE* f = fopen(argv[0], "r");
+	assert(f);
+
+	root_die r(fileno(f));
+	assert(!r.cache_child_names); // so find_named_child stays linear
+	unsigned checked = check_scopes(r);
+	assert(checked > 0);
+	assert(r.child_names.table_count() > 0);
+
+	r.child_names.set_max_entries(16);
+	assert(r.child_names.size() <= 16 || r.child_names.table_count() == 1);
+	unsigned checked_small = check_scopes(r);
+	assert(checked_small == checked);
+
+	/* A scope that's over budget on its own still gets its table kept,
+	 * so that repeated lookups in it don't rebuild it. */
+	auto cus = r.begin().children_here();
+	for (auto i_cu = std::move(cus.first); i_cu != cus.second; ++i_cu)
+	{
+		auto children = i_cu.children_here();
+		unsigned n = 0;
+		for (auto i_child = std::move(children.first); i_child != children.second; ++i_child) ++n;
+		if (n <= 16) continue;
+		r.find_named_child_cached(i_cu, "no such child, surely");
+		assert(r.child_names.find(i_cu.offset_here()));
+		assert(r.child_names.size() <= 16 || r.child_names.table_count() == 1);
+		break;
+	}
+
+	cout << "Cached child lookups agreed for " << checked << " names; "
+		<< r.child_names.table_count() << " tables kept under a budget of 16." << endl;
+
+	return 0;
+}
@@ -0,0 +1,87 @@
+#include <dwarfpp/lib.hpp>
+#include <cstdio>
+#include <cstdlib>
+#include <cassert>
+#include <vector>
+#include <algorithm>
+
+/* Record every CU's offset and header fields from a forward walk of our own
+ * DWARF (which has extra CUs from test-multi-cu.c), then set the CU context
+ * to each CU in reverse and in random order, checking that the root agrees. */
+
+struct cu_rec
+{
+	dwarf::lib::Dwarf_Off off;
+	dwarf::lib::Dwarf_Unsigned cu_header_length;
+	dwarf::lib::Dwarf_Half version_stamp;
+	dwarf::lib::Dwarf_Unsigned abbrev_offset;
+	dwarf::lib::Dwarf_Half address_size;
+	dwarf::lib::Dwarf_Unsigned next_cu_header;
+};
+
+static void check_context(dwarf::core::root_die& r, const cu_rec& rec)
+{
+	bool ret = r.set_cu_context(rec.off);
+	assert(ret);
+	assert(r.current_cu_offset == rec.off);
+	assert(*r.last_seen_cu_header_length == rec.cu_header_length);
+	assert(*r.last_seen_version_stamp == rec.version_stamp);
+	assert(*r.last_seen_abbrev_offset == rec.abbrev_offset);
+	assert(*r.last_seen_address_size == rec.address_size);
+	assert(*r.last_seen_next_cu_header == rec.next_cu_header);
+}
+
+int
+main(int argc, char *argv[])
+{
+	using namespace std;
+	using namespace dwarf;
+	using core::root_die;
+	using core::iterator_df;
+	using core::compile_unit_die;
+
+	assert(argc > 0);
+	FILE* f = fopen(argv[0], "r");
+	assert(f);
+
+	vector<cu_rec> forward;
+	{
+		root_die r(fileno(f));
+		auto cus = r.begin().children_here();
+		for (auto i_cu = std::move(cus.first); i_cu != cus.second; ++i_cu)
+		{
+			iterator_df<compile_unit_die> i = i_cu;
+			cu_rec rec = { i.offset_here(), i->get_cu_header_length(), i->get_version_stamp(),
+				i->get_abbrev_offset(), i->get_address_size(), i->get_next_cu_header() };
+			forward.push_back(rec);
+		}
+	}
+	assert(forward.size() > 4);
+	for (unsigned i = 1; i < forward.size(); ++i) assert(forward[i-1].off < forward[i].off);
+
+	root_die r(fileno(f));
+	for (auto i_rec = forward.rbegin(); i_rec != forward.rend(); ++i_rec) check_context(r, *i_rec);
+
+	vector<cu_rec> shuffled = forward;
+	srand(1);
+	for (unsigned round = 0; round < 10; ++round)
+	{
+		random_shuffle(shuffled.begin(), shuffled.end());
+		for (auto i_rec = shuffled.begin(); i_rec != shuffled.end(); ++i_rec) check_context(r, *i_rec);
+	}
+
+	/* Advancing from anywhere should give the next CU, as libdwarf would. */
+	for (unsigned i = 0; i < forward.size(); ++i)
+	{
+		check_context(r, forward[forward.size() - 1 - i]);
+		bool more = r.advance_cu_context();
+		assert(more == (i != 0));
+		if (more) assert(r.current_cu_offset == forward[forward.size() - i].off);
+	}
+	/* Offsets that aren't CUs are refused. */
+	assert(!r.set_cu_context(forward[0].off + 1));
+
+	cout << "CU contexts agreed for " << forward.size() << " CUs." << endl;
+
+	return 0;
+}
@@ -0,0 +1,114 @@
+#include <dwarfpp/encap.hpp>
+#include <cstdio>
+#include <cassert>
+#include <map>
+
+/* Encapsulate our own DWARF and check that copying attributes with strings,
+ * blocks, loclists or rangelists shares the payload rather than copying it,
+ * and that equal strings are interned; also that payloads go when nothing
+ * uses them (after an overwrite, or eviction) and that copies outlive the
+ * dieset they came from. */
+
+static bool is_interned(dwarf::encap::dieset& ds, const std::string& s)
+{
+	dwarf::encap::counted_string key{std::string(s), 0};
+	return ds.payloads().strings.find(&key) != ds.payloads().strings.end();
+}
+
+int
+main(int argc, char *argv[])
+{
+	using namespace std;
+	using namespace dwarf;
+	using encap::dieset;
+	using encap::attribute_value;
+
+	assert(argc > 0);
+	FILE* f = fopen(argv[0], "r");
+	assert(f);
+	encap::file df(fileno(f));
+	dieset& ds = df.get_ds();
+
+	unsigned shared = 0;
+	map<string, const string *> names;
+	unsigned repeated_names = 0;
+	for (auto i = ds.map_begin(); i != ds.map_end(); ++i)
+	{
+		auto attrs = i->second->get_attrs(); // copying
+		for (auto i_a = attrs.begin(); i_a != attrs.end(); ++i_a)
+		{
+			const attribute_value& orig = (*i->second)[i_a->first];
+			switch (orig.get_form())
+			{
+				case attribute_value::STRING:
+					assert(&orig.get_string() == &i_a->second.get_string()); ++shared; break;
+				case attribute_value::BLOCK:
+					assert(orig.get_block() == i_a->second.get_block()); ++shared; break;
+				case attribute_value::LOCLIST:
+					assert(&orig.get_loclist() == &i_a->second.get_loclist()); ++shared; break;
+				case attribute_value::RANGELIST:
+					assert(&orig.get_rangelist() == &i_a->second.get_rangelist()); ++shared; break;
+				default: break;
+			}
+		}
+	}
+	assert(shared > 0); // we have names, at least
+
+	for (auto i = ds.map_begin(); i != ds.map_end(); ++i)
+	{
+		if (!i->second->has_attr(DW_AT_name)) continue;
+		const string& name = (*i->second)[DW_AT_name].get_string();
+		auto inserted = names.insert(make_pair(name, &name));
+		if (!inserted.second) { assert(inserted.first->second == &name); ++repeated_names; }
+	}
+
+	/* A value put into a DIE shares with later copies too. */
+	auto p_cu = ds.map_find(*ds.map_find(0UL)->second->children().begin())->second;
+	attribute_value& put = p_cu->put_attr(DW_AT_producer, attribute_value(ds, string("test")));
+	{
+		attribute_value copied = put;
+		assert(&copied.get_string() == &put.get_string() && copied.get_string() == "test");
+	}
+
+	/* Overwriting it lets the old string go. */
+	p_cu->put_attr(DW_AT_producer, attribute_value(ds, string("test, again")));
+	assert(!is_interned(ds, "test"));
+	assert(is_interned(ds, "test, again"));
+
+	/* Copies taken out of a dieset keep working after it's gone. */
+	map<string, attribute_value> kept;
+	{
+		FILE* f2 = fopen(argv[0], "r");
+		assert(f2);
+		encap::file df2(fileno(f2));
+		for (auto i = df2.get_ds().map_begin(); i != df2.get_ds().map_end(); ++i)
+		{
+			if (!i->second->has_attr(DW_AT_name)) continue;
+			auto attrs = i->second->get_attrs();
+			auto found = attrs.find(DW_AT_name);
+			kept.insert(make_pair(found->second.get_string(), found->second));
+		}
+		fclose(f2);
+	}
+	assert(!kept.empty());
+	for (auto i_k = kept.begin(); i_k != kept.end(); ++i_k) assert(i_k->second.get_string() == i_k->first);
+
+	/* Evicting CUs lets their strings go, so reloading them doesn't grow
+	 * anything. */
+	FILE* f3 = fopen(argv[0], "r");
+	assert(f3);
+	encap::file lazy(fileno(f3), DW_DLC_READ, encap::file::LAZY);
+	dieset& l = lazy.get_ds();
+	l.load_all();
+	size_t interned = l.payloads().strings.size();
+	l.evict_untouched();
+	unsigned evicted = l.evict_untouched();
+	assert(evicted > 0 && l.payloads().strings.size() < interned);
+	l.load_all();
+	assert(l.payloads().strings.size() == interned);
+
+	cout << "Shared " << shared << " attribute payloads; "
+		<< repeated_names << " names were repeats." << endl;
+
+	return 0;
+}
@@ -0,0 +1,57 @@
+#include <dwarfpp/encap.hpp>
+#include <cstdio>
+#include <cassert>
+
+/* Open our own DWARF lazily and eagerly, check that touching one CU loads
+ * only that CU, with the same DIEs as eager encapsulation, and that
+ * evicting and touching it again gives the same DIEs back. */
+
+int
+main(int argc, char *argv[])
+{
+	using namespace std;
+	using namespace dwarf;
+	using encap::dieset;
+
+	assert(argc > 0);
+	FILE* f1 = fopen(argv[0], "r");
+	FILE* f2 = fopen(argv[0], "r");
+	assert(f1 && f2);
+	encap::file eager(fileno(f1));
+	encap::file lazy(fileno(f2), DW_DLC_READ, encap::file::LAZY);
+	dieset& e = eager.get_ds();
+	dieset& l = lazy.get_ds();
+	assert(l.is_lazy());
+	assert(l.map_size() == 1); // just the toplevel
+	auto cus = e.map_find(0UL)->second->children();
+	assert(l.map_find(0UL)->second->children() == cus);
+
+	/* Touch the last CU, and only that. */
+	lib::Dwarf_Off cu_off = *cus.rbegin();
+	auto p_cu = l[cu_off];
+	assert(p_cu && p_cu->get_tag() == DW_TAG_compile_unit);
+	unsigned loaded = l.map_size();
+	assert(loaded > 1 && (cus.size() == 1 || loaded < e.map_size()));
+	for (auto i = l.map_begin(); i != l.map_end(); ++i)
+	{
+		auto found = e.map_find(i->first);
+		assert(found != e.map_end());
+		assert(found->second->get_tag() == i->second->get_tag());
+		assert(found->second->children() == i->second->children());
+		assert(found->second->const_attrs().size() == i->second->const_attrs().size());
+	}
+	p_cu.reset();
+
+	/* Nothing has touched it since, so it goes, then comes back. */
+	assert(l.evict_untouched() == 0); // touched since loading
+	assert(l.evict_untouched() == 1);
+	assert(l.map_size() == 1);
+	assert(l[cu_off]->get_tag() == DW_TAG_compile_unit);
+	assert(l.map_size() == loaded);
+
+	l.load_all();
+	assert(l.map_size() == e.map_size());
+	cout << "Lazily loaded " << loaded - 1 << " of " << e.map_size() - 1 << " DIEs first." << endl;
+
+	return 0;
+}
@@ -0,0 +1,44 @@
+#include <dwarfpp/lib.hpp>
+#include <cstdio>
+#include <cassert>
+
+/* With a skeleton index, find() should position us at every DIE in our
+ * own DWARF with the right depth and parent. */
+
+int
+main(int argc, char *argv[])
+{
+	using namespace std;
+	using namespace dwarf;
+	using core::root_die;
+	using core::iterator_df;
+
+	assert(argc > 0);
+	FILE* f = fopen(argv[0], "r");
+	assert(f);
+
+	root_die r(fileno(f));
+	r.build_skeleton_index();
+	assert(r.get_skeleton_index());
+
+	/* Use a separate root for the walk, so that find() can't be
+	 * helped by a warm parent cache. */
+	root_die walk_r(fileno(f));
+	unsigned long count = 0;
+	for (iterator_df<> i = walk_r.begin(); i != walk_r.end(); ++i)
+	{
+		if (!i.is_real_die_position()) continue;
+		iterator_df<> found = r.find(i.offset_here());
+		assert(found != r.end());
+		assert(found.offset_here() == i.offset_here());
+		assert(found.depth() == i.depth());
+		assert(r.parent(found).offset_here() == walk_r.parent(i).offset_here());
+		++count;
+	}
+	/* Offsets that aren't DIEs aren't found. */
+	auto cus = walk_r.begin().children_here();
+	assert(r.find<iterator_df<> >(cus.first.offset_here() + 1) == iterator_df<>(core::iterator_base::END));
+	cout << "Found all " << count << " DIEs through the skeleton index." << endl;
+
+	return 0;
+}
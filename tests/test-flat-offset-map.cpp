@@ -0,0 +1,89 @@
+#include <dwarfpp/flat_offset_map.hpp>
+#include <map>
+#include <memory>
+#include <cstdlib>
+#include <cassert>
+#include <iostream>
+
+/* Do random inserts and range-erases on a flat_offset_map and a std::map
+ * side by side, and check they always agree, with and without runs. */
+
+int
+main(int argc, char *argv[])
+{
+	using namespace std;
+	using dwarf::encap::flat_offset_map;
+	typedef flat_offset_map<shared_ptr<int> >::key_type key_type;
+
+	flat_offset_map<shared_ptr<int> > f;
+	map<key_type, shared_ptr<int> > m;
+	srand(1);
+	for (int i = 0; i < 100000; ++i)
+	{
+		key_type k = rand() % 500;
+		if (rand() % 3 < 2)
+		{
+			auto v = make_shared<int>(i);
+			auto r1 = f.insert(make_pair(k, v));
+			auto r2 = m.insert(make_pair(k, v));
+			assert(r1.second == r2.second);
+			assert(r1.first->first == k && r1.first->second == r2.first->second);
+		}
+		else
+		{
+			key_type k2 = k + rand() % 20;
+			f.erase(f.lower_bound(k), f.lower_bound(k2));
+			m.erase(m.lower_bound(k), m.lower_bound(k2));
+		}
+		assert(f.size() == m.size());
+		assert((f.find(k) == f.end()) == (m.find(k) == m.end()));
+		if (i % 1000 == 0)
+		{
+			auto i_m = m.begin();
+			for (auto i_f = f.begin(); i_f != f.end(); ++i_f, ++i_m)
+			{
+				assert(i_f->first == i_m->first && i_f->second == i_m->second);
+			}
+			assert(i_m == m.end());
+			if (!m.empty()) assert((--f.end())->first == (--m.end())->first);
+		}
+	}
+
+	/* Now load runs of increasing offsets below and among the existing
+	 * ones, as lazily loading a CU does, with the odd repeat or step
+	 * backwards, and finds in between. */
+	for (int i = 0; i < 1000; ++i)
+	{
+		f.begin_run();
+		key_type k = rand() % 1000;
+		for (int j = 0; j < 50; ++j)
+		{
+			if (rand() % 10 == 0 && k >= 2) k -= rand() % 3;
+			else k += 1 + rand() % 3;
+			auto v = make_shared<int>(i);
+			auto r1 = f.insert(make_pair(k, v));
+			auto r2 = m.insert(make_pair(k, v));
+			assert(r1.second == r2.second);
+			assert(r1.first->first == k && r1.first->second == r2.first->second);
+			key_type k2 = rand() % 1200;
+			assert((f.find(k2) == f.end()) == (m.find(k2) == m.end()));
+		}
+		f.end_run();
+		if (rand() % 2)
+		{
+			key_type k2 = rand() % 1200;
+			f.erase(f.lower_bound(k2), f.lower_bound(k2 + 100));
+			m.erase(m.lower_bound(k2), m.lower_bound(k2 + 100));
+		}
+		assert(f.size() == m.size());
+		auto i_m = m.begin();
+		for (auto i_f = f.begin(); i_f != f.end(); ++i_f, ++i_m)
+		{
+			assert(i_f->first == i_m->first && i_f->second == i_m->second);
+		}
+		assert(i_m == m.end());
+	}
+	cout << "flat_offset_map agreed with std::map; " << f.size() << " entries left." << endl;
+
+	return 0;
+}
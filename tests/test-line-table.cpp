@@ -0,0 +1,73 @@
+#include <dwarfpp/lib.hpp>
+#include <cstdio>
+#include <cassert>
+#include <vector>
+#include <algorithm>
+
+/* Decode the line table of each CU in our own DWARF, check that batched
+ * lookups agree with single ones, and that main() is in this file. */
+
+int
+main(int argc, char *argv[])
+{
+	using namespace std;
+	using namespace dwarf;
+	using core::root_die;
+	using core::iterator_df;
+	using core::subprogram_die;
+	using core::compile_unit_die;
+	using lib::line_table;
+
+	assert(argc > 0);
+	FILE* f = fopen(argv[0], "r");
+	assert(f);
+
+	root_die r(fileno(f));
+	unsigned long total_rows = 0;
+	bool found_main = false;
+	auto cus = r.begin().children_here();
+	for (auto i_cu = std::move(cus.first); i_cu != cus.second; ++i_cu)
+	{
+		iterator_df<compile_unit_die> i_typed_cu = i_cu;
+		auto p_lt = i_typed_cu->get_line_table();
+		assert(p_lt);
+		assert(p_lt == i_typed_cu->get_line_table()); // cached
+		total_rows += p_lt->size();
+		assert(std::is_sorted(p_lt->addresses().begin(), p_lt->addresses().end()));
+
+		/* Probe every row's address, and one past it. */
+		vector<lib::Dwarf_Addr> probes;
+		for (unsigned i = 0; i < p_lt->size(); ++i)
+		{
+			probes.push_back(p_lt->addr(i));
+			probes.push_back(p_lt->addr(i) + 1);
+		}
+		std::sort(probes.begin(), probes.end());
+		vector<size_t> batch;
+		p_lt->find_sorted(probes, batch);
+		for (unsigned i = 0; i < probes.size(); ++i)
+		{
+			assert(batch[i] == p_lt->find(probes[i]));
+			if (batch[i] != line_table::npos)
+			{
+				assert(p_lt->addr(batch[i]) <= probes[i]);
+				assert(!(p_lt->flags(batch[i]) & line_table::END_SEQUENCE));
+			}
+		}
+
+		auto found = r.resolve(i_cu, "main");
+		if (found == core::iterator_base::END) continue;
+		iterator_df<subprogram_die> i_main = found;
+		auto low_pc = i_main->get_low_pc();
+		if (!low_pc) continue;
+		size_t row = p_lt->find(low_pc->addr);
+		assert(row != line_table::npos);
+		assert(p_lt->file_name(row).find("test-line-table") != string::npos);
+		cout << "main is at " << p_lt->file_name(row) << ":" << p_lt->line(row) << endl;
+		found_main = true;
+	}
+	assert(found_main);
+	cout << "Decoded " << total_rows << " line table rows." << endl;
+
+	return 0;
+}
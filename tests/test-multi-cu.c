@@ -0,0 +1,25 @@
+/* Compiled several times, with a different CU_NUMBER each time, and linked
+ * into the tests that want lots of CUs (see MULTI_CU_TESTS in the Makefile). */
+
+#define PASTE(a, b) a ## b
+#define NAME(a, n) PASTE(a, n)
+
+struct NAME(point_, CU_NUMBER) { int x; int y; };
+
+/* Static everywhere but the last CU, so a lookup must find the first CU's,
+ * although pubnames only list the last one's (see test-accel). */
+#if CU_NUMBER == 8
+int shared_name(void) { return CU_NUMBER; }
+#else
+static int shared_name(void) { return CU_NUMBER; }
+#endif
+
+int NAME(cu_function_, CU_NUMBER)(struct NAME(point_, CU_NUMBER) *p)
+{
+	int sum = shared_name();
+	{
+		int i;
+		for (i = 0; i < CU_NUMBER; ++i) sum += p->x * i + p->y;
+	}
+	return sum;
+}
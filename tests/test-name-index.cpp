@@ -0,0 +1,59 @@
+#include <dwarfpp/lib.hpp>
+#include <dwarfpp/name_index.hpp>
+#include <cstdio>
+#include <cstdlib>
+#include <cassert>
+#include <unistd.h>
+
+/* Build a name index for our own DWARF in a scratch directory, and check
+ * that resolving through it agrees with resolving without it. */
+
+int
+main(int argc, char *argv[])
+{
+	using namespace std;
+	using namespace dwarf;
+	using core::root_die;
+	using core::iterator_base;
+
+	assert(argc > 0);
+	FILE* f = fopen(argv[0], "r");
+	assert(f);
+
+	char dir_template[] = "/tmp/dwarfpp-names.XXXXXX";
+	char *dir = mkdtemp(dir_template);
+	assert(dir);
+	setenv("DWARFPP_NAME_INDEX_DIR", dir, 1);
+
+	root_die r(fileno(f));
+	assert(!r.get_name_index()); // the directory is empty
+	iterator_base cu, slow;
+	auto cus = r.begin().children_here();
+	for (auto i_cu = std::move(cus.first); i_cu != cus.second; ++i_cu)
+	{
+		slow = r.resolve(i_cu, "main");
+		if (slow != iterator_base::END) { cu = i_cu; break; }
+	}
+	assert(slow != iterator_base::END);
+
+	if (!r.build_name_index())
+	{
+		cout << "No build-id (or no native decoder), so no name index; skipping." << endl;
+		return 0;
+	}
+	assert(r.get_name_index());
+	iterator_base fast = r.resolve(cu, "main");
+	assert(fast == slow);
+	assert(r.resolve(cu, "no_such_name_in_this_file") == iterator_base::END);
+
+	/* A fresh root_die should pick up the file we just wrote. */
+	root_die r2(fileno(f));
+	assert(r2.get_name_index());
+	assert(r2.resolve(r2.find(cu.offset_here()), "main").offset_here() == slow.offset_here());
+	cout << "Name index has " << r2.get_name_index()->size()
+		<< " entries and agrees on main at 0x" << std::hex << slow.offset_here() << std::dec << endl;
+
+	unlink(core::name_index::default_path(core::debug_sections::open(fileno(f))->build_id()).c_str());
+	rmdir(dir);
+	return 0;
+}
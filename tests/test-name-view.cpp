@@ -0,0 +1,43 @@
+#include <dwarfpp/lib.hpp>
+#include <cstdio>
+#include <cassert>
+
+/* Walk our own DWARF, checking that every DIE's name_view_here() agrees with
+ * name_here(), and that find_named_child finds main() through it. */
+
+int
+main(int argc, char *argv[])
+{
+	using namespace std;
+	using namespace dwarf;
+	using core::root_die;
+	using core::iterator_df;
+	using core::string_ref;
+
+	assert(argc > 0);
+	FILE* f = fopen(argv[0], "r");
+	assert(f);
+
+	root_die r(fileno(f));
+	unsigned named = 0;
+	for (iterator_df<> i = r.begin(); i != r.end(); ++i)
+	{
+		auto name = i.name_here();
+		string_ref view = i.name_view_here();
+		assert(!name == !view.data());
+		if (name) { assert(view == *name); ++named; }
+	}
+	assert(named > 0);
+
+	bool found_main = false;
+	auto cus = r.begin().children_here();
+	for (auto i_cu = std::move(cus.first); i_cu != cus.second; ++i_cu)
+	{
+		auto found = r.find_named_child(i_cu, "main");
+		if (found != core::iterator_base::END) { assert(found.name_view_here() == "main"); found_main = true; }
+	}
+	assert(found_main);
+	cout << "Name views agreed for " << named << " named DIEs." << endl;
+
+	return 0;
+}
@@ -0,0 +1,76 @@
+#include <dwarfpp/lib.hpp>
+#include <dwarfpp/native.hpp>
+#include <cstdio>
+#include <cstring>
+#include <cassert>
+
+/* Compilers don't emit DW_FORM_indirect, so we add a CU of our own that
+ * uses it: a variable whose DW_AT_name is indirect but at a fixed offset
+ * (after a data1), and whose DW_AT_decl_file is indirect after that. Then
+ * check the native decoder agrees with libdwarf about it. */
+__asm__(
+	".pushsection .debug_abbrev,\"\",@progbits\n"
+	".Lindirect_abbrevs:\n"
+	".uleb128 1\n.uleb128 0x11\n.byte 1\n"     /* DW_TAG_compile_unit, has children */
+	".uleb128 0x03\n.uleb128 0x08\n"           /* DW_AT_name, DW_FORM_string */
+	".uleb128 0\n.uleb128 0\n"
+	".uleb128 2\n.uleb128 0x34\n.byte 0\n"     /* DW_TAG_variable, no children */
+	".uleb128 0x3b\n.uleb128 0x0b\n"           /* DW_AT_decl_line, DW_FORM_data1 */
+	".uleb128 0x03\n.uleb128 0x16\n"           /* DW_AT_name, DW_FORM_indirect */
+	".uleb128 0x3a\n.uleb128 0x16\n"           /* DW_AT_decl_file, DW_FORM_indirect */
+	".uleb128 0\n.uleb128 0\n"
+	".uleb128 0\n"
+	".popsection\n"
+	".pushsection .debug_info,\"\",@progbits\n"
+	".long .Lindirect_end - .Lindirect_begin\n"
+	".Lindirect_begin:\n"
+	".short 4\n"                               /* version */
+	".long .Lindirect_abbrevs\n"
+	".byte 8\n"                                /* address size */
+	".uleb128 1\n.asciz \"indirect.s\"\n"
+	".uleb128 2\n.byte 42\n"
+	".uleb128 0x08\n.asciz \"indirect_var\"\n" /* DW_FORM_string */
+	".uleb128 0x0f\n.uleb128 7\n"              /* DW_FORM_udata */
+	".byte 0\n"
+	".Lindirect_end:\n"
+	".popsection\n"
+);
+
+int
+main(int argc, char *argv[])
+{
+	using namespace std;
+	using namespace dwarf;
+	using core::root_die;
+	using core::native_root_die;
+
+	assert(argc > 0);
+	FILE* f = fopen(argv[0], "r");
+	assert(f);
+
+	root_die r(fileno(f));
+	auto p_native = native_root_die::open(fileno(f));
+	assert(p_native);
+	assert(p_native->complete()); // we know all the real forms
+
+	auto i = p_native->begin();
+	while (i != p_native->end() && !(i.tag_here() == DW_TAG_variable
+		&& i.name_here() && 0 == strcmp(i.name_here(), "indirect_var"))) ++i;
+	assert(i != p_native->end());
+	dwarf::lib::Dwarf_Half form;
+	assert((*i).find_attr(DW_AT_name, &form));
+	assert(form == DW_FORM_string); // not DW_FORM_indirect
+	assert((*i).attr_unsigned(DW_AT_decl_line) && *(*i).attr_unsigned(DW_AT_decl_line) == 42);
+	assert((*i).attr_unsigned(DW_AT_decl_file) && *(*i).attr_unsigned(DW_AT_decl_file) == 7);
+
+	auto i_core = i.core_pos(r);
+	auto name = i_core.name_here();
+	assert(name && *name == "indirect_var");
+
+	// we can get past it, too
+	++i;
+	assert(p_native->complete());
+	cout << "Native decoder read DW_FORM_indirect attributes as libdwarf does." << endl;
+
+	return 0;
+}
@@ -0,0 +1,77 @@
+#include <dwarfpp/lib.hpp>
+#include <dwarfpp/native.hpp>
+#include <cstdio>
+#include <cstring>
+#include <cassert>
+
+/* Walk our own DWARF with both the libdwarf-backed core iterators and
+ * the native decoder, and check they agree on every DIE. */
+
+int
+main(int argc, char *argv[])
+{
+	using namespace std;
+	using namespace dwarf;
+	using core::root_die;
+	using core::native_root_die;
+
+	assert(argc > 0);
+	FILE* f = fopen(argv[0], "r");
+	assert(f);
+
+	root_die r(fileno(f));
+	auto p_native = native_root_die::open(fileno(f));
+	assert(p_native);
+	assert(p_native->complete()); // our compiler uses only forms we know
+	/* A vendor form we don't know makes a unit non-native, not a crash. */
+	assert(core::abbrev_table::is_known_form(DW_FORM_strp));
+	assert(core::abbrev_table::is_known_form(DW_FORM_indirect));
+	assert(!core::abbrev_table::is_known_form(0x1f7f));
+
+	unsigned long count = 0;
+	auto i_native = p_native->begin();
+	for (auto i = r.begin(); i != r.end(); ++i)
+	{
+		if (i.is_root_position()) continue;
+		assert(i_native != p_native->end());
+		assert(i.offset_here() == i_native.offset_here());
+		assert(i.depth() == i_native.depth());
+		assert(i.tag_here() == i_native.tag_here());
+		auto name = i.name_here();
+		const char *native_name = i_native.name_here();
+		assert(!name == !native_name);
+		assert(!name || *name == native_name);
+		assert(i.has_attr_here(DW_AT_location) == i_native.has_attr_here(DW_AT_location));
+		++i_native;
+		++count;
+	}
+	assert(i_native == p_native->end());
+	assert(p_native->complete()); // we didn't have to abandon any unit
+	cout << "Native decoder agreed with libdwarf on " << count << " DIEs." << endl;
+
+	/* Skipping subtrees should visit exactly the CU children. */
+	unsigned long cu_children = 0, native_cu_children = 0;
+	auto cus = r.begin().children_here();
+	for (auto i_cu = std::move(cus.first); i_cu != cus.second; ++i_cu)
+	{
+		auto children = i_cu.children_here();
+		for (auto i = std::move(children.first); i != children.second; ++i) ++cu_children;
+	}
+	for (auto i = p_native->begin(); i != p_native->end(); )
+	{
+		if (i.depth() == 2) ++native_cu_children;
+		if (i.depth() >= 2) i.increment_skipping_subtree(); else ++i;
+	}
+	assert(cu_children == native_cu_children);
+
+	/* Check we can hop back to the core iterators. */
+	auto i_main = p_native->begin();
+	while (i_main != p_native->end() && !(i_main.tag_here() == DW_TAG_subprogram
+		&& i_main.name_here() && 0 == strcmp(i_main.name_here(), "main"))) ++i_main;
+	assert(i_main != p_native->end());
+	auto i_core = i_main.core_pos(r);
+	assert(i_core.offset_here() == i_main.offset_here());
+	assert(r.parent(i_core).offset_here() == *i_main.parent_offset_here());
+
+	return 0;
+}
@@ -0,0 +1,59 @@
+#include <dwarfpp/lib.hpp>
+#include <cstdio>
+#include <cassert>
+#include <atomic>
+#include <mutex>
+#include <set>
+
+/* Count DIEs under each CU of our own DWARF, first serially, then with
+ * parallel_for_each_cu, and check the two agree. */
+
+int
+main(int argc, char *argv[])
+{
+	using namespace std;
+	using namespace dwarf;
+	using core::root_die;
+	using core::iterator_df;
+	using core::compile_unit_die;
+
+	assert(argc > 0);
+	FILE* f = fopen(argv[0], "r");
+	assert(f);
+
+	root_die r(fileno(f));
+
+	unsigned long serial_count = 0, serial_cus = 0;
+	auto cus = r.begin().children_here();
+	for (auto i_cu = std::move(cus.first); i_cu != cus.second; ++i_cu)
+	{
+		++serial_cus;
+		unsigned cu_depth = i_cu.depth();
+		iterator_df<> i = i_cu;
+		do { ++serial_count; ++i; } while (i != r.end() && i.depth() > cu_depth);
+	}
+
+	std::atomic<unsigned long> parallel_count(0);
+	std::mutex seen_mutex;
+	std::set<lib::Dwarf_Off> seen;
+	r.parallel_for_each_cu([&](root_die& worker_r, iterator_df<compile_unit_die>& i_cu) {
+		assert(&worker_r != &r);
+		{
+			std::lock_guard<std::mutex> guard(seen_mutex);
+			bool inserted = seen.insert(i_cu.offset_here()).second;
+			assert(inserted); // each CU exactly once
+		}
+		unsigned long count = 0;
+		unsigned cu_depth = i_cu.depth();
+		iterator_df<> i = i_cu;
+		do { ++count; ++i; } while (i != worker_r.end() && i.depth() > cu_depth);
+		parallel_count += count;
+	}, 4);
+
+	assert(seen.size() == serial_cus);
+	assert(parallel_count == serial_count);
+	cout << "Parallel walk agreed with serial walk on " << serial_count
+		<< " DIEs in " << serial_cus << " CUs." << endl;
+
+	return 0;
+}
@@ -0,0 +1,66 @@
+#include <dwarfpp/lib.hpp>
+#include <cstdio>
+#include <cassert>
+#include <map>
+
+/* Walk our own DWARF breadth-first, across more than a handful of CUs (see
+ * test-multi-cu.c), checking that every DIE's parent agrees with a
+ * depth-first walk, and that the parent cache kept a table for every CU. */
+
+extern "C" {
+#define declare_cu(n) struct point_ ## n; int cu_function_ ## n(struct point_ ## n *p);
+declare_cu(1) declare_cu(2) declare_cu(3) declare_cu(4)
+declare_cu(5) declare_cu(6) declare_cu(7) declare_cu(8)
+}
+
+int
+main(int argc, char *argv[])
+{
+	using namespace std;
+	using namespace dwarf;
+	using core::root_die;
+	using core::iterator_df;
+	using core::iterator_bf;
+	using core::iterator_base;
+
+	/* Make sure the linker keeps our extra CUs. */
+	void *fns[] = { (void*) cu_function_1, (void*) cu_function_2, (void*) cu_function_3,
+		(void*) cu_function_4, (void*) cu_function_5, (void*) cu_function_6,
+		(void*) cu_function_7, (void*) cu_function_8 };
+	assert(fns[7]);
+
+	assert(argc > 0);
+	FILE* f = fopen(argv[0], "r");
+	assert(f);
+
+	map<lib::Dwarf_Off, lib::Dwarf_Off> df_parents;
+	unsigned cus = 0;
+	{
+		root_die r(fileno(f));
+		for (iterator_df<> i = r.begin(); i != r.end(); ++i)
+		{
+			if (!i.is_real_die_position()) continue;
+			if (i.depth() == 1) ++cus;
+			df_parents[i.offset_here()] = (i.depth() == 1) ? 0UL : i.parent().offset_here();
+		}
+	}
+	assert(cus > 4);
+
+	root_die r(fileno(f));
+	unsigned checked = 0;
+	for (iterator_bf<> i = r.begin(); i != r.end(); ++i)
+	{
+		if (!i.is_real_die_position()) continue;
+		iterator_base p = i.parent();
+		lib::Dwarf_Off parent_off = (i.depth() == 1) ? 0UL : p.offset_here();
+		assert(df_parents.at(i.offset_here()) == parent_off);
+		++checked;
+	}
+	assert(checked == df_parents.size());
+	/* Nowhere near the budget, so no CU's table should have been dropped. */
+	assert(r.parent_of.table_count() == cus);
+	cout << "Breadth-first parents agreed for " << checked << " DIEs in "
+		<< cus << " CUs." << endl;
+
+	return 0;
+}
@@ -0,0 +1,63 @@
+#include <dwarfpp/lib.hpp>
+#include <cstdio>
+#include <cassert>
+#include <vector>
+
+/* Copy an iterator to every DIE in our own DWARF, with a small payload
+ * cache, and check the cache stays bounded (except for what we pin). */
+
+int
+main(int argc, char *argv[])
+{
+	using namespace std;
+	using namespace dwarf;
+	using core::root_die;
+	using core::iterator_df;
+	using core::iterator_base;
+
+	assert(argc > 0);
+	FILE* f = fopen(argv[0], "r");
+	assert(f);
+
+	root_die r(fileno(f));
+	r.payloads.set_max_entries(64);
+
+	unsigned long count = 0;
+	for (iterator_df<> i = r.begin(); i != r.end(); ++i)
+	{
+		if (!i.is_real_die_position()) continue;
+		iterator_base copy1 = i; // makes payload
+		iterator_base copy2 = i; // should share it
+		assert(&copy1.dereference() == &copy2.dereference());
+		++count;
+		assert(r.payloads.size() <= 64 + r.payloads.pinned());
+	}
+	assert(r.payloads.hits >= count);
+	cout << "Copied " << count << " DIEs; payload cache has " << r.payloads.size()
+		<< " entries, " << r.payloads.hits << " hits, " << r.payloads.misses << " misses, "
+		<< r.payloads.evictions << " evictions." << endl;
+
+	/* Held iterators pin their payloads. */
+	vector<iterator_base> held;
+	for (iterator_df<> i = r.begin(); i != r.end() && held.size() < 128; ++i)
+	{
+		if (i.is_real_die_position()) held.push_back(i);
+	}
+	assert(r.payloads.pinned() >= held.size());
+	held.clear();
+	r.payloads.set_max_entries(16);
+	assert(r.payloads.size() <= 16);
+
+	/* Releasing every CU should release every payload region. */
+	assert(r.arena.region_count() > 0);
+	auto cus = r.begin().children_here();
+	for (auto i_cu = std::move(cus.first); i_cu != cus.second; )
+	{
+		lib::Dwarf_Off off = i_cu.offset_here();
+		++i_cu;
+		r.release_cu(off);
+	}
+	assert(r.arena.region_count() == 0);
+
+	return 0;
+}
@@ -0,0 +1,56 @@
+#include <dwarfpp/lib.hpp>
+#include <cstdio>
+#include <cassert>
+
+/* Walk our own DWARF, checking that the tag-based is_a and dereference
+ * (for concrete classes like subprogram_die) and the dynamic_cast ones
+ * (for mixins like with_static_location_die) agree with plain dynamic_cast. */
+
+int
+main(int argc, char *argv[])
+{
+	using namespace std;
+	using namespace dwarf;
+	using core::root_die;
+	using core::iterator_df;
+	using core::basic_die;
+	using core::subprogram_die;
+	using core::with_static_location_die;
+	using core::payload_tag;
+
+	static_assert(payload_tag<subprogram_die>::is_concrete, "subprogram is concrete");
+	static_assert(!payload_tag<with_static_location_die>::is_concrete, "mixins are not");
+
+	assert(argc > 0);
+	FILE* f = fopen(argv[0], "r");
+	assert(f);
+
+	root_die r(fileno(f));
+	unsigned subprograms = 0, static_located = 0;
+	for (iterator_df<> i = r.begin(); i != r.end(); ++i)
+	{
+		if (!i.is_real_die_position()) continue;
+		basic_die& d = *i;
+		bool is_subprogram = dynamic_cast<subprogram_die *>(&d) != nullptr;
+		assert(i.is_a<subprogram_die>() == is_subprogram);
+		if (is_subprogram)
+		{
+			iterator_df<subprogram_die> i_subp = i;
+			assert(&*i_subp == dynamic_cast<subprogram_die *>(&d));
+			++subprograms;
+		}
+		bool is_static_located = dynamic_cast<with_static_location_die *>(&d) != nullptr;
+		assert(i.is_a<with_static_location_die>() == is_static_located);
+		if (is_static_located)
+		{
+			iterator_df<with_static_location_die> i_static = i;
+			assert(&*i_static == dynamic_cast<with_static_location_die *>(&d));
+			++static_located;
+		}
+	}
+	assert(subprograms > 0 && static_located >= subprograms);
+	cout << "Casts agreed for " << subprograms << " subprograms and "
+		<< static_located << " DIEs with static location." << endl;
+
+	return 0;
+}
@@ -0,0 +1,70 @@
+#include <dwarfpp/small_attr_map.hpp>
+#include <map>
+#include <cstdlib>
+#include <cassert>
+#include <iostream>
+
+/* Do random inserts and erases on a small_attr_map and a std::map side by
+ * side, and check they always agree, that the small map spills when it
+ * should, and that every value it constructs is destroyed exactly once. */
+
+static int live_values;
+struct counted
+{
+	int v;
+	counted(int v) : v(v) { ++live_values; }
+	counted(const counted& c) : v(c.v) { ++live_values; }
+	counted& operator=(const counted&) = delete; // the map must never assign
+	~counted() { --live_values; }
+};
+
+int
+main(int argc, char *argv[])
+{
+	using namespace std;
+	using dwarf::encap::small_attr_map;
+	typedef small_attr_map<counted, 4> map_type;
+	typedef map_type::key_type key_type;
+
+	{
+		map_type s;
+		map<key_type, int> m;
+		srand(1);
+		for (int i = 0; i < 100000; ++i)
+		{
+			/* Keep the key range small most of the time, so we go back and
+			 * forth across the inline/spilled boundary. */
+			key_type k = rand() % ((i / 1000) % 2 ? 6 : 40);
+			if (rand() % 2)
+			{
+				auto r1 = s.insert(make_pair(k, counted(i)));
+				auto r2 = m.insert(make_pair(k, i));
+				assert(r1.second == r2.second);
+				assert(r1.first->first == k && r1.first->second.v == r2.first->second);
+			}
+			else assert(s.erase(k) == m.erase(k));
+			assert(s.size() == m.size());
+			assert((s.find(k) == s.end()) == (m.find(k) == m.end()));
+			assert(s.size() <= 4 || s.capacity() > 4);
+			if (i % 100 == 0)
+			{
+				map_type copied(s);
+				auto i_m = m.begin();
+				for (auto i_s = copied.begin(); i_s != copied.end(); ++i_s, ++i_m)
+				{
+					assert(i_s->first == i_m->first && i_s->second.v == i_m->second);
+				}
+				assert(i_m == m.end());
+				map_type moved(std::move(copied));
+				assert(moved.size() == m.size() && copied.empty());
+			}
+		}
+		assert(live_values == (int) s.size());
+		s.clear();
+		assert(live_values == 0);
+	}
+	assert(live_values == 0);
+	cout << "small_attr_map agreed with std::map." << endl;
+
+	return 0;
+}